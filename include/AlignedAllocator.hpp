@@ -0,0 +1,199 @@
+#pragma once
+
+// Standard libraries
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace KCT::io {
+
+/**
+ * Alignment of the buffers, file offsets and transfer sizes required by O_DIRECT.
+ *
+ * 4096 is the page size on x86_64 and a multiple of the logical block size of all common block
+ * devices.
+ */
+constexpr std::size_t DIRECT_IO_ALIGNMENT = 4096;
+
+/**
+ * Test if the pointer is aligned to the given number of bytes.
+ */
+inline bool isAligned(const void* pointer, std::size_t alignment)
+{
+    return reinterpret_cast<std::uintptr_t>(pointer) % alignment == 0;
+}
+
+/**
+ * Allocate uninitialized memory for count elements of type T aligned to alignment bytes.
+ *
+ * The memory must be released by alignedFree. Throws std::bad_alloc on failure.
+ */
+template <typename T>
+T* alignedAllocate(std::size_t count, std::size_t alignment = alignof(T))
+{
+    alignment = std::max({ alignment, alignof(T), sizeof(void*) });
+    std::size_t byteSize = std::max(count * sizeof(T), static_cast<std::size_t>(1));
+    void* p = nullptr;
+    if(posix_memalign(&p, alignment, byteSize) != 0)
+    {
+        throw std::bad_alloc();
+    }
+    return static_cast<T*>(p);
+}
+
+/**
+ * Release memory obtained by alignedAllocate, nullptr is ignored.
+ */
+inline void alignedFree(void* p) { std::free(p); }
+
+/**
+ * Allocator for standard containers that aligns their storage to Alignment bytes.
+ *
+ * std::vector<uint8_t, AlignedAllocator<uint8_t>> is suitable as a buffer for O_DIRECT transfers.
+ */
+template <typename T, std::size_t Alignment = DIRECT_IO_ALIGNMENT>
+class AlignedAllocator
+{
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        if(n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+        {
+            throw std::bad_alloc();
+        }
+        return alignedAllocate<T>(n, Alignment);
+    }
+
+    void deallocate(T* p, std::size_t) noexcept { alignedFree(p); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept
+    {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept
+    {
+        return false;
+    }
+};
+
+/**
+ * AlignedAllocator that default initializes the elements constructed without arguments.
+ *
+ * std::vector<T, UninitializedAllocator<T>>(n) of trivial T neither zeroes nor touches its memory,
+ * so that pages of large buffers are faulted in only when they are written, e.g. by the lazy
+ * loading of the frames of DenFile.
+ */
+template <typename T, std::size_t Alignment = DIRECT_IO_ALIGNMENT>
+class UninitializedAllocator : public AlignedAllocator<T, Alignment>
+{
+public:
+    template <typename U>
+    struct rebind
+    {
+        using other = UninitializedAllocator<U, Alignment>;
+    };
+
+    UninitializedAllocator() noexcept = default;
+
+    template <typename U>
+    UninitializedAllocator(const UninitializedAllocator<U, Alignment>&) noexcept
+    {
+    }
+
+    template <typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value)
+    {
+        ::new(static_cast<void*>(p)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args)
+    {
+        ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+namespace detail {
+    inline std::vector<uint8_t, AlignedAllocator<uint8_t>>& threadScratch()
+    {
+        thread_local std::vector<uint8_t, AlignedAllocator<uint8_t>> scratch;
+        return scratch;
+    }
+
+    inline std::vector<uint8_t, AlignedAllocator<uint8_t>>& threadTransposeScratch()
+    {
+        thread_local std::vector<uint8_t, AlignedAllocator<uint8_t>> scratch;
+        return scratch;
+    }
+
+    inline uint8_t* growScratch(std::vector<uint8_t, AlignedAllocator<uint8_t>>& scratch,
+                                std::size_t byteSize)
+    {
+        if(scratch.size() < byteSize)
+        {
+            // Replace rather than resize not to copy the old content
+            scratch = std::vector<uint8_t, AlignedAllocator<uint8_t>>();
+            scratch.resize(byteSize);
+        }
+        return scratch.data();
+    }
+} // namespace detail
+
+/**
+ * Scratch memory of at least byteSize bytes owned by the calling thread, aligned to
+ * DIRECT_IO_ALIGNMENT.
+ *
+ * Threads converting frames do not share staging buffers, so that they neither lock nor have to
+ * know the number of threads in advance. The memory is reused by the next call on the same thread,
+ * it grows to the largest size requested and is released when the thread exits or by
+ * releaseThreadScratchBuffer. Callers must not hold the memory across calls that might use it.
+ */
+inline uint8_t* threadScratchBuffer(std::size_t byteSize)
+{
+    return detail::growScratch(detail::threadScratch(), byteSize);
+}
+
+/**
+ * Second scratch memory of the calling thread, the staging of the transposed elements.
+ *
+ * Frames read into threadScratchBuffer are transposed into this buffer before their conversion, so
+ * that both can be held at once. The same rules as for threadScratchBuffer apply.
+ */
+inline uint8_t* threadTransposeBuffer(std::size_t byteSize)
+{
+    return detail::growScratch(detail::threadTransposeScratch(), byteSize);
+}
+
+/**
+ * Release the scratch memory of the calling thread, including the transpose buffer.
+ */
+inline void releaseThreadScratchBuffer()
+{
+    std::vector<uint8_t, AlignedAllocator<uint8_t>>().swap(detail::threadScratch());
+    std::vector<uint8_t, AlignedAllocator<uint8_t>>().swap(detail::threadTransposeScratch());
+}
+
+} // namespace KCT::io
@@ -1,8 +1,12 @@
 #pragma once
+#include <cstring>
 #include <memory>
 
 // Internal
+#include "AlignedAllocator.hpp"
 #include "BufferedFrame2DI.hpp"
+#include "FramePool.hpp"
+#include "Transpose.hpp"
 
 namespace KCT {
 namespace io {
@@ -26,7 +30,30 @@ namespace io {
             , sizey(sizey)
             , frameSize((uint64_t)sizex * (uint64_t)sizey)
         {
-            this->frameDataArray = new T[frameSize];
+            this->frameDataArray = alignedAllocate<T>(frameSize, alignment);
+        }
+
+        /**Construct BufferedFrame2D with the memory borrowed from the pool.
+         *
+         *The memory is not initialized and it is returned to the pool when the object is
+         *destroyed. When pool is nullptr or its buffers are smaller than the frame, the memory is
+         *allocated as by BufferedFrame2D(sizex, sizey).
+         */
+        BufferedFrame2D(uint32_t sizex, uint32_t sizey, std::shared_ptr<FramePool<T>> pool)
+            : sizex(sizex)
+            , sizey(sizey)
+            , frameSize((uint64_t)sizex * (uint64_t)sizey)
+        {
+            if(pool != nullptr && pool->getElementCount() >= frameSize)
+            {
+                typename FramePool<T>::Buffer b = pool->acquire();
+                this->alignment = pool->getAlignment();
+                this->deleter = b.get_deleter();
+                this->frameDataArray = b.release();
+            } else
+            {
+                this->frameDataArray = alignedAllocate<T>(frameSize, alignment);
+            }
         }
 
         /**Create BufferedFrame2D using buffer of the data.
@@ -34,13 +61,20 @@ namespace io {
          *Can be called with a buffer that will be used to construct the frame. Deep copy is created
          *while creating object. When the buffer is nullptr, memory is allocated but nothing is
          *copied. Frame then have to be filled by calling set to individual elements.
+         *
+         *Optional alignment of the allocated memory in bytes might be specified, use
+         *DIRECT_IO_ALIGNMENT for frames to be read or written with O_DIRECT.
          */
-        BufferedFrame2D(const T* buffer, uint32_t sizex, uint32_t sizey)
+        BufferedFrame2D(const T* buffer,
+                        uint32_t sizex,
+                        uint32_t sizey,
+                        std::size_t alignment = alignof(T))
             : sizex(sizex)
             , sizey(sizey)
             , frameSize((uint64_t)sizex * (uint64_t)sizey)
+            , alignment(alignment)
         {
-            this->frameDataArray = new T[frameSize];
+            this->frameDataArray = alignedAllocate<T>(frameSize, alignment);
             if(buffer != nullptr)
             {
                 memcpy(this->frameDataArray, buffer, frameSize * sizeof(T));
@@ -58,7 +92,7 @@ namespace io {
             , frameSize((uint64_t)sizex * (uint64_t)sizey)
 
         {
-            this->frameDataArray = new T[frameSize];
+            this->frameDataArray = alignedAllocate<T>(frameSize, alignment);
             std::fill(this->frameDataArray, this->frameDataArray + frameSize, elm);
         }
 
@@ -66,7 +100,7 @@ namespace io {
          *
          */
         BufferedFrame2D(const BufferedFrame2D& b)
-            : BufferedFrame2D(b.frameDataArray, b.sizex, b.sizey)
+            : BufferedFrame2D(b.frameDataArray, b.sizex, b.sizey, b.alignment)
         {
         }
 
@@ -85,7 +119,7 @@ namespace io {
         {
             if(frameDataArray != nullptr)
             {
-                delete[] frameDataArray;
+                deleter(frameDataArray);
             }
             frameDataArray = nullptr;
         } // destructor
@@ -100,12 +134,14 @@ namespace io {
                 this->sizex = b.sizex;
                 this->sizey = b.sizey;
                 this->frameSize = b.frameSize;
+                this->alignment = b.alignment;
                 if(this->frameDataArray != nullptr)
                 {
-                    delete[] this->frameDataArray;
+                    deleter(this->frameDataArray);
                 }
                 this->frameDataArray = nullptr;
-                this->frameDataArray = new T[frameSize];
+                this->deleter = FrameBufferDeleter<T>();
+                this->frameDataArray = alignedAllocate<T>(frameSize, alignment);
                 memcpy(this->frameDataArray, b.frameDataArray, frameSize * sizeof(T));
             }
             return *this;
@@ -118,6 +154,8 @@ namespace io {
             this->sizex = other.sizex;
             this->sizey = other.sizey;
             this->frameSize = other.frameSize;
+            this->alignment = other.alignment;
+            this->deleter = std::move(other.deleter);
             other.frameDataArray = nullptr;
             other.sizex = 0;
             other.sizey = 0;
@@ -130,13 +168,15 @@ namespace io {
             {
                 if(this->frameDataArray != nullptr)
                 {
-                    delete[] this->frameDataArray;
+                    deleter(this->frameDataArray);
                 }
                 this->frameDataArray = nullptr;
                 this->frameDataArray = other.frameDataArray;
+                this->deleter = std::move(other.deleter);
                 this->sizex = other.sizex;
                 this->sizey = other.sizey;
                 this->frameSize = other.frameSize;
+                this->alignment = other.alignment;
                 other.frameDataArray = nullptr;
             }
             return *this;
@@ -160,11 +200,7 @@ namespace io {
         {
             std::shared_ptr<io::BufferedFrame2D<T>> ft
                 = std::make_shared<BufferedFrame2D<T>>(nullptr, sizey, sizex);
-            for(uint32_t x = 0; x != sizex; x++)
-                for(uint32_t y = 0; y != sizey; y++)
-                {
-                    ft->set(frameDataArray[y * sizex + x], y, x);
-                }
+            transpose(frameDataArray, ft->data(), sizey, sizex);
             return ft;
         }
 
@@ -181,6 +217,9 @@ namespace io {
         T* frameDataArray;
         uint32_t sizex, sizey;
         uint64_t frameSize;
+        std::size_t alignment = alignof(T);
+        // Returns the memory to the pool it was borrowed from, otherwise frees it
+        FrameBufferDeleter<T> deleter;
     };
 } // namespace io
 } // namespace KCT
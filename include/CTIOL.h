@@ -7,9 +7,23 @@
 #include "stringFormatter.h" //Formating strings, INCLUDES NOTHING
 // Ghost #include "utils/convertEndians.h" //includes io/DenSupportedType.hpp, io/stringFormatter.h
 #include "rawop.h" //Raw reading of the part file into the uint8_t buffer Functions:readBytesFrom, includes from KCT: utils/convertEndians.h(io/DenSupportedType.hpp, io/stringFormatter.h)
+#include "AlignedAllocator.hpp" //Aligned memory for O_DIRECT transfers, INCLUDES NOTHING
+#include "FramePool.hpp" //Pool of fixed size frame buffers reused across reads, includes io/AlignedAllocator.hpp
+#include "Transpose.hpp" //Cache oblivious SIMD transposition of frames between XMajor and YMajor, INCLUDES NOTHING
+#include "NumaMemory.hpp" //NUMA placement of memory and threads by mbind and affinity, INCLUDES NOTHING
+#include "ShardedCache.hpp" //Byte budgeted FIFO/LRU/CLOCK/ARC cache with sharded locks, INCLUDES NOTHING
+#include "RawFile.hpp" //Persistent file descriptor for positional pread/pwrite, includes io/stringFormatter.h
+#include "WriteBehindQueue.hpp" //Bounded queue of writes by background threads with backpressure, includes io/FramePool.hpp, io/RawFile.hpp
+#include "WriteCombiner.hpp" //Out of order frames written in sequential runs under a shared byte budget, includes io/FramePool.hpp, io/RawFile.hpp
+#include "FrameCache.hpp" //Process wide cache of immutable frames with one budget, includes io/ShardedCache.hpp, io/RawFile.hpp
 
 // Classes
+#include "DEN/DenStatistics.hpp" //Single pass parallel statistics of the DEN data, includes io/DenSupportedType.hpp, io/RawFile.hpp
+#include "DEN/DenReslice.hpp" //Out of core reordering of the axes of DEN files, INCLUDES NOTHING
+#include "DEN/DenElementConversion.hpp" //Bulk conversion of the DEN elements by the kernels selected once per frame, INCLUDES io/DenSupportedType.hpp
 #include "DEN/DenFileInfo.hpp" //Provide information about particular den file, includes io/DenSupportedType.hpp, io/rawop.h, utils/convertEndians.h, io/DenSupportedType.hpp, io/stringFormatter.h
+#include "DEN/DenFileHandle.hpp" //Header parsed once per process and shared by readers, includes io/DenFileInfo.hpp, io/RawFile.hpp
+#include "DEN/DenWriteJournal.hpp" //Sidecar journal of the written frames for resumable writes, includes io/RawFile.hpp
 //#include "RawSliceReader.hpp" //Reading of the slices in the ITK format, depends on
 //io/DenFileInfo.hpp, io/rawop.h, utils/convertEndians.h(io/DenSupportedType.hpp,
 //io/stringFormatter.h)
@@ -29,11 +43,15 @@
 #ifdef WITHITK
 #include "DENITK/ItkImageChunk.hpp" //Provide interface to read ItkImage as a chunk, INCLUDES io/Frame2DI.hpp
 // Implementations
-#include "DEN/DenAsyncFrame2DWritter.hpp" //INCLUDES io/AsyncFrame2DWritterI.hpp
+#include "DEN/DenAsyncFrame2DWritter.hpp" //Optional write behind, INCLUDES io/AsyncFrame2DWritterI.hpp, io/WriteBehindQueue.hpp
 
 #include "Frame2DReaderI.hpp" //Reader for chunks, INCLUDES io/Frame2DI.hpp
 // Implementations
 #include "DEN/DenFrame2DReader.hpp" //INCLUDES io/Frame2DI.hpp, io/Frame2DReaderI.hpp, io/BufferedFrame2D.hpp
+#include "DEN/DenFrame2DMappedReader.hpp" //Zero copy frame views into mmaped file, INCLUDES io/DenFrame2DReader.hpp, io/MappedFile.hpp, io/FrameMemoryViewer2D.hpp
+#include "DEN/DenFrame2DAsyncReader.hpp" //Many frame reads in flight via io_uring or ThreadPool, INCLUDES io/DenFrame2DReader.hpp, io/IoUring.hpp
+#include "DEN/DenFrame2DPrefetchReader.hpp" //Lookahead of scheduled frames by background threads, INCLUDES io/DenFrame2DReader.hpp
+#include "DEN/DenSinogramReader.hpp" //Sinograms of projection stacks served from the cache of bands of detector rows, INCLUDES io/DenFileHandle.hpp, io/ShardedCache.hpp, io/Transpose.hpp
 #include "DENITK/Frame2DReaderItkI.hpp" //Reader of chunks to itk images, INCLUDES io/Frame2DReaderI.hpp
 // Implementations
 #include "DENITK/DenFrame2DReaderItk.hpp" //Den files, INCLUDES io/Frame2DReaderItkI.hpp
@@ -1,20 +1,32 @@
 #pragma once
 
 // External libraries
-#include <mutex>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <typeinfo>
+#include <vector>
 
 // Internal libraries
 #include "AsyncFrame2DWritterI.hpp"
 #include "BufferedFrame2DI.hpp"
+#include "DEN/DenElementConversion.hpp"
 #include "DEN/DenFileInfo.hpp"
+#include "DEN/DenWriteJournal.hpp"
+#include "RawFile.hpp"
+#include "Transpose.hpp"
+#include "WriteCombiner.hpp"
 #include "littleEndianAlignment.h"
 #include "rawop.h"
 
 namespace KCT::io {
 /**
 Interface for writing images. It is not necessery to write matrices along them.
+
+Frames arriving in any order are buffered by WriteCombiner and written in long sequential runs of
+consecutive frames. Memory is taken only for the frames waiting for their run, up to the process
+wide WriteCombiningBudget shared by all the writers. enableJournal persists the written frames
+into the sidecar journal, so that after the crash only pendingFrames have to be written again.
 */
 template <typename T>
 class DenAsyncFrame2DBufferedWritter : public AsyncFrame2DWritterI<T>
@@ -28,11 +40,10 @@ private:
     uint64_t offset;
     bool extended;
     bool XMajor;
-    uint8_t* buffer;
-    mutable std::mutex writingMutex;
-    std::shared_ptr<std::ofstream> ofstream;
-    std::vector<char> _pubsetbuf_buffer;
-    uint64_t _pubsetbuf_buffer_size = 1073741824; // 2^30
+    uint64_t maxWriteBytesize = 1073741824; // 2^30
+    std::shared_ptr<RawFile> rawFile;
+    std::unique_ptr<WriteCombiner> combiner;
+    std::unique_ptr<DenWriteJournal> journal;
     bool littleEndianArchitecture;
     bool existingFile = false;
     void initialize();
@@ -48,13 +59,16 @@ public:
      * @param sizey
      * @param sizez
      * @param XMajor
+     * @param maxWriteBytesize Maximum size of one sequential write.
+     * @param allocation Allocation of the data part when the file is created, see FileAllocation.
      */
     DenAsyncFrame2DBufferedWritter(std::string denFile,
                                    uint32_t sizex,
                                    uint32_t sizey,
                                    uint32_t sizez,
                                    bool XMajor = true,
-                                   uint64_t pastebufBytesize = 1073741824);
+                                   uint64_t maxWriteBytesize = 1073741824,
+                                   FileAllocation allocation = FileAllocation::SPARSE);
 
     /**
      *	Constructor using file name and dimensions.
@@ -65,20 +79,24 @@ public:
      * @param dimCount
      * @param dim
      * @param XMajor
+     * @param maxWriteBytesize Maximum size of one sequential write.
+     * @param allocation Allocation of the data part when the file is created, see FileAllocation.
      */
     DenAsyncFrame2DBufferedWritter(std::string denFile,
                                    uint16_t dimCount,
                                    uint32_t* dim,
                                    bool XMajor = true,
-                                   uint64_t pastebufBytesize = 1073741824);
+                                   uint64_t maxWriteBytesize = 1073741824,
+                                   FileAllocation allocation = FileAllocation::SPARSE);
 
     /**
      * Constructor using file name of existing DEN file. It does not imediatelly overwrite or
      * zero the file.
      *
      * @param denFile
+     * @param maxWriteBytesize Maximum size of one sequential write.
      */
-    DenAsyncFrame2DBufferedWritter(std::string denFile, uint64_t pastebufBytesize = 1073741824);
+    DenAsyncFrame2DBufferedWritter(std::string denFile, uint64_t maxWriteBytesize = 1073741824);
 
     /**
      * @brief Writes buffered frame to the file.
@@ -118,6 +136,26 @@ public:
     /**Returns file name.**/
     std::string getFileName() const;
 
+    /**
+     * Write the buffered frames, checkpoint the journal and throw the errors of the writes. The
+     * journal is removed when all the frames are recorded in it.
+     */
+    void flush();
+
+    WriteCombinerStatistics getStatistics() const;
+
+    /**
+     * Record the written frames in the journal DenWriteJournal::getJournalPath(getFileName()),
+     * call before the writing starts. When the writer reused the existing file, the frames of its
+     * journal are kept.
+     */
+    void enableJournal(DenWriteJournalPolicy policy = DenWriteJournalPolicy());
+    /**
+     * Frames not recorded in the journal, all the frames when the journal is disabled.
+     */
+    std::vector<uint64_t> pendingFrames() const;
+    DenWriteJournalStatistics getJournalStatistics() const;
+
     /// Destructor
     ~DenAsyncFrame2DBufferedWritter();
     /// Copy constructor
@@ -137,27 +175,9 @@ void DenAsyncFrame2DBufferedWritter<T>::initialize()
 {
     int num = 1;
     littleEndianArchitecture = (*(char*)&num == 1);
-    buffer = new uint8_t[frameByteSize];
-    ofstream = std::make_shared<std::ofstream>();
-    if(_pubsetbuf_buffer_size > frameByteSize)
-    {
-        uint64_t fitFrames = _pubsetbuf_buffer_size / frameByteSize;
-        if(fitFrames > frameCount)
-        {
-            fitFrames = frameCount;
-        }
-        if(fitFrames * frameByteSize != _pubsetbuf_buffer_size)
-        {
-            _pubsetbuf_buffer_size = fitFrames * frameByteSize;
-            LOGD << io::xprintf("Adjusted _pubsetbuf_buffer_size to %lu bytes, it fits %lu frames",
-                                _pubsetbuf_buffer_size, fitFrames);
-        }
-    }
-    _pubsetbuf_buffer.resize(_pubsetbuf_buffer_size);
-    ofstream->rdbuf()->pubsetbuf(&_pubsetbuf_buffer[0], _pubsetbuf_buffer_size);
-    ofstream->open(denFile,
-                   std::ios::binary | std::ios::out
-                       | std::ios::in); // Open binary, for output, for input
+    rawFile = std::make_shared<RawFile>(denFile, true);
+    combiner = std::make_unique<WriteCombiner>(rawFile, offset, frameByteSize, frameCount,
+                                               maxWriteBytesize);
 }
 
 template <typename T>
@@ -166,13 +186,14 @@ DenAsyncFrame2DBufferedWritter<T>::DenAsyncFrame2DBufferedWritter(std::string de
                                                                   uint32_t dimy,
                                                                   uint32_t dimz,
                                                                   bool XMajor,
-                                                                  uint64_t pastebufBytesize)
+                                                                  uint64_t maxWriteBytesize,
+                                                                  FileAllocation allocation)
     : denFile(denFile)
     , sizex(dimx)
     , sizey(dimy)
     , frameCount(dimz)
     , XMajor(XMajor)
-    , _pubsetbuf_buffer_size(pastebufBytesize)
+    , maxWriteBytesize(maxWriteBytesize)
 {
     DenSupportedType type = getDenSupportedTypeByTypeID(typeid(T));
     offset = 4096;
@@ -190,12 +211,13 @@ DenAsyncFrame2DBufferedWritter<T>::DenAsyncFrame2DBufferedWritter(std::string de
             LOGD << io::xprintf("Will be writting to existing file %s.", denFile.c_str());
         } else
         {
-            DenFileInfo::createEmpty3DDenFile(denFile, type, dimx, dimy, dimz, XMajor);
+            DenFileInfo::createEmpty3DDenFile(denFile, type, dimx, dimy, dimz, XMajor,
+                                              allocation);
             LOGD << io::xprintf("Just overwritten the file %s with empty file.", denFile.c_str());
         }
     } else
     {
-        DenFileInfo::createEmpty3DDenFile(denFile, type, dimx, dimy, dimz, XMajor);
+        DenFileInfo::createEmpty3DDenFile(denFile, type, dimx, dimy, dimz, XMajor, allocation);
     }
     frameSize = (uint64_t)sizex * (uint64_t)sizey;
     frameByteSize = sizeof(T) * frameSize;
@@ -204,10 +226,15 @@ DenAsyncFrame2DBufferedWritter<T>::DenAsyncFrame2DBufferedWritter(std::string de
 
 template <typename T>
 DenAsyncFrame2DBufferedWritter<T>::DenAsyncFrame2DBufferedWritter(
-    std::string denFile, uint16_t dimCount, uint32_t* dim, bool XMajor, uint64_t pastebufBytesize)
+    std::string denFile,
+    uint16_t dimCount,
+    uint32_t* dim,
+    bool XMajor,
+    uint64_t maxWriteBytesize,
+    FileAllocation allocation)
     : denFile(denFile)
     , XMajor(XMajor)
-    , _pubsetbuf_buffer_size(pastebufBytesize)
+    , maxWriteBytesize(maxWriteBytesize)
 {
     DenSupportedType type = getDenSupportedTypeByTypeID(typeid(T));
     offset = 4096;
@@ -252,12 +279,12 @@ DenAsyncFrame2DBufferedWritter<T>::DenAsyncFrame2DBufferedWritter(
             LOGD << io::xprintf("Will be writting to existing file %s.", denFile.c_str());
         } else
         {
-            DenFileInfo::createEmptyDenFile(denFile, type, dimCount, dim, XMajor);
+            DenFileInfo::createEmptyDenFile(denFile, type, dimCount, dim, XMajor, allocation);
             LOGD << io::xprintf("Just overwritten the file %s with empty file.", denFile.c_str());
         }
     } else
     {
-        DenFileInfo::createEmptyDenFile(denFile, type, dimCount, dim, XMajor);
+        DenFileInfo::createEmptyDenFile(denFile, type, dimCount, dim, XMajor, allocation);
     }
     frameSize = (uint64_t)sizex * (uint64_t)sizey;
     frameByteSize = sizeof(T) * frameSize;
@@ -266,9 +293,9 @@ DenAsyncFrame2DBufferedWritter<T>::DenAsyncFrame2DBufferedWritter(
 
 template <typename T>
 DenAsyncFrame2DBufferedWritter<T>::DenAsyncFrame2DBufferedWritter(std::string denFile,
-                                                                  uint64_t pastebufBytesize)
+                                                                  uint64_t maxWriteBytesize)
     : denFile(denFile)
-    , _pubsetbuf_buffer_size(pastebufBytesize)
+    , maxWriteBytesize(maxWriteBytesize)
 {
     std::string err;
     if(!io::pathExists(denFile))
@@ -302,26 +329,75 @@ DenAsyncFrame2DBufferedWritter<T>::DenAsyncFrame2DBufferedWritter(std::string de
     initialize();
 }
 
-/// Guard for move constructor stealed objects
 template <typename T>
 DenAsyncFrame2DBufferedWritter<T>::~DenAsyncFrame2DBufferedWritter()
 {
-    if(buffer != nullptr)
-        delete[] buffer;
-    buffer = nullptr;
-    if(ofstream != nullptr)
+    // WriteCombiner destructor writes the buffered frames and logs the errors
+    combiner.reset();
+    journal.reset();
+}
+
+template <typename T>
+void DenAsyncFrame2DBufferedWritter<T>::flush()
+{
+    combiner->flush();
+    if(journal != nullptr)
+    {
+        journal->complete();
+    }
+}
+
+template <typename T>
+void DenAsyncFrame2DBufferedWritter<T>::enableJournal(DenWriteJournalPolicy policy)
+{
+    journal = std::make_unique<DenWriteJournal>(rawFile, offset, frameByteSize, frameCount,
+                                                existingFile, policy);
+    combiner->setCompletionListener([this](uint64_t k) { journal->markWritten(k); });
+}
+
+template <typename T>
+std::vector<uint64_t> DenAsyncFrame2DBufferedWritter<T>::pendingFrames() const
+{
+    if(journal != nullptr)
+    {
+        return journal->pendingFrames();
+    }
+    std::vector<uint64_t> pending(frameCount);
+    for(uint64_t k = 0; k != frameCount; k++)
+    {
+        pending[k] = k;
+    }
+    return pending;
+}
+
+template <typename T>
+DenWriteJournalStatistics DenAsyncFrame2DBufferedWritter<T>::getJournalStatistics() const
+{
+    if(journal != nullptr)
     {
-        ofstream->close();
-        ofstream = nullptr;
+        return journal->getStatistics();
     }
+    return DenWriteJournalStatistics();
+}
+
+template <typename T>
+WriteCombinerStatistics DenAsyncFrame2DBufferedWritter<T>::getStatistics() const
+{
+    return combiner->getStatistics();
 }
 
 template <typename T>
 void DenAsyncFrame2DBufferedWritter<T>::writeFrame(const Frame2DI<T>& f, uint64_t k)
 {
-    uint64_t position = offset + k * frameByteSize;
-    std::lock_guard<std::mutex> guard(
-        writingMutex); // Mutex will be released as this goes out of scope.
+    const BufferedFrame2DI<T>* buffered = dynamic_cast<const BufferedFrame2DI<T>*>(&f);
+    if(buffered != nullptr)
+    {
+        writeBuffer(buffered->data(), k);
+        return;
+    }
+    // Converted by the calling thread without lock
+    WriteCombiner::Buffer b = combiner->acquire();
+    uint8_t* buffer = b.get();
     if(XMajor)
     {
         for(uint32_t j = 0; j != sizey; j++)
@@ -341,40 +417,26 @@ void DenAsyncFrame2DBufferedWritter<T>::writeFrame(const Frame2DI<T>& f, uint64_
             }
         }
     }
-    io::writeBytesFrom(ofstream, position, buffer, frameByteSize);
-    return;
+    combiner->add(k, std::move(b));
 }
 
 template <typename T>
 void DenAsyncFrame2DBufferedWritter<T>::writeBuffer(const T* buf, uint64_t k)
 {
-    uint64_t position = offset + k * frameByteSize;
-    std::lock_guard<std::mutex> guard(
-        writingMutex); // Mutex will be released as this goes out of scope.
+    WriteCombiner::Buffer b = combiner->acquire();
+    uint8_t* buffer = b.get();
     if(XMajor && littleEndianArchitecture)
     {
-        io::writeBytesFrom(ofstream, position, (uint8_t*)buf, frameByteSize);
+        std::memcpy(buffer, buf, frameByteSize);
+    } else if(XMajor)
+    {
+        util::storeElements<T>(buf, getDenSupportedTypeByTypeID(typeid(T)), buffer, frameSize);
     } else
     {
-        if(XMajor)
-        {
-            for(uint64_t i = 0; i != frameSize; i++)
-            {
-                util::setNextElement<T>(*(buf + i), &buffer[sizeof(T) * i]);
-            }
-        } else
-        {
-            for(uint32_t i = 0; i != sizex; i++)
-            {
-                for(uint32_t j = 0; j != sizey; j++)
-                {
-                    util::setNextElement<T>(*(buf + j * sizex + i),
-                                            &buffer[(i * sizey + j) * sizeof(T)]);
-                }
-            }
-        }
-        io::writeBytesFrom(ofstream, position, buffer, frameByteSize);
+        transposeElements(buf, sizex, buffer, sizey, sizey, sizex, sizeof(T));
+        util::convertByteOrderInPlace(buffer, sizeof(T), frameSize);
     }
+    combiner->add(k, std::move(b));
 }
 
 template <typename T>
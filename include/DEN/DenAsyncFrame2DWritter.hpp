@@ -1,20 +1,37 @@
 #pragma once
 
 // External libraries
-#include <mutex>
+#include <atomic>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <typeinfo>
+#include <vector>
 
 // Internal libraries
 #include "AsyncFrame2DWritterI.hpp"
 #include "BufferedFrame2DI.hpp"
+#include "DEN/DenElementConversion.hpp"
+#include "DEN/DenFileHandle.hpp"
 #include "DEN/DenFileInfo.hpp"
+#include "DEN/DenWriteJournal.hpp"
+#include "RawFile.hpp"
+#include "Transpose.hpp"
+#include "WriteBehindQueue.hpp"
 #include "littleEndianAlignment.h"
 #include "rawop.h"
 
 namespace KCT::io {
 /**
 Interface for writing images. It is not necessery to write matrices along them.
+
+By default the frames are written synchronously, concurrent writers convert the frames in their
+own buffers and write them by pwrite to the shared descriptor without any lock, as the frames do
+not overlap. enableCompletionTracking records the written frames, so that finalize verifies that
+the whole file was written. enableJournal persists the written frames into the sidecar journal,
+so that after the crash only pendingFrames have to be written again. After enableWriteBehind
+the writes return as soon as the frame is converted into a queued buffer and background threads
+write it, call flush or close to wait for the writes and to get their errors.
 */
 template <typename T>
 class DenAsyncFrame2DWritter : public AsyncFrame2DWritterI<T>
@@ -30,8 +47,18 @@ private:
     bool XMajor;
     bool existingFile = false;
     bool littleEndianArchitecture;
-    uint8_t* buffer;
-    mutable std::mutex writingMutex;
+    // Descriptor held for the whole lifetime of the writer
+    std::shared_ptr<RawFile> rawFile;
+    std::unique_ptr<WriteBehindQueue> writeBehind;
+    // Statistics of the last closed queue
+    WriteBehindStatistics closedWriteBehindStatistics;
+    // Bit k % 64 of the word k / 64 is set when the frame k was written
+    std::unique_ptr<std::atomic<uint64_t>[]> completion;
+    std::unique_ptr<DenWriteJournal> journal;
+    void checkFrameIndex(uint64_t k) const;
+    void markWritten(uint64_t k);
+    void convertFrame(const Frame2DI<T>& f, uint8_t* out) const;
+    void convertBuffer(const T* buf, uint8_t* out) const;
 
 public:
     /**
@@ -44,9 +71,16 @@ public:
      * @param sizey
      * @param sizez
      * @param XMajor Alignment of output.
+     * @param directIO Write with O_DIRECT bypassing the page cache.
+     * @param allocation Allocation of the data part when the file is created, see FileAllocation.
      */
-    DenAsyncFrame2DWritter(
-        std::string denFile, uint32_t sizex, uint32_t sizey, uint32_t sizez, bool XMajor = true);
+    DenAsyncFrame2DWritter(std::string denFile,
+                           uint32_t sizex,
+                           uint32_t sizey,
+                           uint32_t sizez,
+                           bool XMajor = true,
+                           bool directIO = false,
+                           FileAllocation allocation = FileAllocation::SPARSE);
 
     /**
      *	Constructor using file name and dimensions.
@@ -57,18 +91,30 @@ public:
      * @param dimCount
      * @param dim
      * @param XMajor Alignment of output.
+     * @param directIO Write with O_DIRECT bypassing the page cache.
+     * @param allocation Allocation of the data part when the file is created, see FileAllocation.
      */
     DenAsyncFrame2DWritter(std::string denFile,
                            uint16_t dimCount,
                            uint32_t* dim,
-                           bool XMajor = true);
+                           bool XMajor = true,
+                           bool directIO = false,
+                           FileAllocation allocation = FileAllocation::SPARSE);
     /**
      * Constructor using file name of existing DEN file. It does not imediatelly overwrite or
      * zero the file.
      *
      * @param denFile
+     * @param directIO Write with O_DIRECT bypassing the page cache.
+     */
+    DenAsyncFrame2DWritter(std::string denFile, bool directIO = false);
+    /**
+     * Constructor using the shared handle of existing DEN file, the header is not parsed again.
+     *
+     * @param handle Handle obtained by DenFileHandle::open.
+     * @param directIO Write with O_DIRECT bypassing the page cache.
      */
-    DenAsyncFrame2DWritter(std::string denFile);
+    DenAsyncFrame2DWritter(std::shared_ptr<DenFileHandle> handle, bool directIO = false);
 
     /**
      * @brief Writes buffered frame to the file.
@@ -108,23 +154,79 @@ public:
     /**Returns file name.**/
     std::string getFileName() const;
 
-    /// Destructor
+    /**
+     * Write the frames by background threads, call before the writing starts.
+     *
+     * @param queueFrames Number of frames that might be queued or being written at once.
+     * @param policy Behavior of the writes when queueFrames frames are queued, with DROP the frame
+     * is discarded and counted in getWriteBehindStatistics.
+     * @param ioThreads Number of background threads issuing the writes.
+     * @param growByteBudget Maximum bytes of the queued frames under the GROW policy.
+     */
+    void enableWriteBehind(uint32_t queueFrames = 16,
+                           BackpressurePolicy policy = BackpressurePolicy::BLOCK,
+                           uint32_t ioThreads = 1,
+                           uint64_t growByteBudget = 0);
+
+    /**
+     * Wait for the queued writes and throw the first write error since the last flush, no-op
+     * without write behind.
+     */
+    void flush();
+
+    /**
+     * Flush and stop the write behind threads after the producers finished, subsequent writes
+     * are synchronous.
+     */
+    void close();
+
+    WriteBehindStatistics getWriteBehindStatistics() const;
+
+    /**
+     * Record the frames written from now on, call before the writing starts.
+     */
+    void enableCompletionTracking();
+    bool isWritten(uint64_t k) const;
+    uint64_t getWrittenFrameCount() const;
+    /**
+     * Frames not written since enableCompletionTracking, empty when the tracking is disabled.
+     */
+    std::vector<uint64_t> getMissingFrames() const;
+
+    /**
+     * Record the written frames in the journal DenWriteJournal::getJournalPath(getFileName()),
+     * call before the writing starts. When the writer reused the existing file, the frames of its
+     * journal are kept.
+     */
+    void enableJournal(DenWriteJournalPolicy policy = DenWriteJournalPolicy());
+    /**
+     * Frames not recorded in the journal, all the frames when the journal is disabled.
+     */
+    std::vector<uint64_t> pendingFrames() const;
+    DenWriteJournalStatistics getJournalStatistics() const;
+
+    /**
+     * Flush and checkpoint the journal. When the completion is tracked, throw if some frame was
+     * not written. The journal is removed when all the frames are recorded in it.
+     */
+    void finalize();
+
+    /// Destructor, queued frames are written and the errors logged
     ~DenAsyncFrame2DWritter();
-    /// Copy constructor
-    DenAsyncFrame2DWritter(const DenAsyncFrame2DWritter<T>& b);
-    // Copy assignment
-    DenAsyncFrame2DWritter<T>& operator=(const DenAsyncFrame2DWritter<T> b);
-    // Swap
-    static void swap(DenAsyncFrame2DWritter<T>& a, DenAsyncFrame2DWritter<T>& b);
-    // Move constructor
-    DenAsyncFrame2DWritter(DenAsyncFrame2DWritter<T>&& b);
-    // Move assignment
-    DenAsyncFrame2DWritter<T>& operator=(DenAsyncFrame2DWritter<T>&& other);
+    DenAsyncFrame2DWritter(const DenAsyncFrame2DWritter<T>& b) = delete;
+    DenAsyncFrame2DWritter<T>& operator=(const DenAsyncFrame2DWritter<T>& b) = delete;
+    DenAsyncFrame2DWritter(DenAsyncFrame2DWritter<T>&& b) = delete;
+    DenAsyncFrame2DWritter<T>& operator=(DenAsyncFrame2DWritter<T>&& other) = delete;
 };
 
 template <typename T>
-DenAsyncFrame2DWritter<T>::DenAsyncFrame2DWritter(
-    std::string denFile, uint32_t dimx, uint32_t dimy, uint32_t dimz, bool XMajor)
+DenAsyncFrame2DWritter<T>::DenAsyncFrame2DWritter(std::string denFile,
+                                                  uint32_t dimx,
+                                                  uint32_t dimy,
+                                                  uint32_t dimz,
+                                                  bool XMajor,
+                                                  bool directIO,
+                                                  FileAllocation allocation)
     : denFile(denFile)
     , sizex(dimx)
     , sizey(dimy)
@@ -149,23 +251,26 @@ DenAsyncFrame2DWritter<T>::DenAsyncFrame2DWritter(
             LOGD << io::xprintf("Will be writting to existing file %s.", denFile.c_str());
         } else
         {
-            DenFileInfo::createEmpty3DDenFile(denFile, type, dimx, dimy, dimz, XMajor);
+            DenFileInfo::createEmpty3DDenFile(denFile, type, dimx, dimy, dimz, XMajor,
+                                              allocation);
             LOGD << io::xprintf("Just overwritten the file %s with empty file.", denFile.c_str());
         }
     } else
     {
-        DenFileInfo::createEmpty3DDenFile(denFile, type, dimx, dimy, dimz, XMajor);
+        DenFileInfo::createEmpty3DDenFile(denFile, type, dimx, dimy, dimz, XMajor, allocation);
     }
     frameSize = (uint64_t)sizex * (uint64_t)sizey;
     frameByteSize = sizeof(T) * frameSize;
-    buffer = new uint8_t[frameByteSize];
+    rawFile = std::make_shared<RawFile>(denFile, true, directIO);
 }
 
 template <typename T>
 DenAsyncFrame2DWritter<T>::DenAsyncFrame2DWritter(std::string denFile,
                                                   uint16_t dimCount,
                                                   uint32_t* dim,
-                                                  bool XMajor)
+                                                  bool XMajor,
+                                                  bool directIO,
+                                                  FileAllocation allocation)
     : denFile(denFile)
     , XMajor(XMajor)
 {
@@ -214,36 +319,33 @@ DenAsyncFrame2DWritter<T>::DenAsyncFrame2DWritter(std::string denFile,
             extended = inf.isExtended();
         } else
         {
-            DenFileInfo::createEmptyDenFile(denFile, type, dimCount, dim, XMajor);
+            DenFileInfo::createEmptyDenFile(denFile, type, dimCount, dim, XMajor, allocation);
             LOGD << io::xprintf("Just overwritten the file %s with empty file.", denFile.c_str());
         }
     } else
     {
-        DenFileInfo::createEmptyDenFile(denFile, type, dimCount, dim, XMajor);
+        DenFileInfo::createEmptyDenFile(denFile, type, dimCount, dim, XMajor, allocation);
     }
     frameSize = (uint64_t)sizex * (uint64_t)sizey;
     frameByteSize = sizeof(T) * frameSize;
-    buffer = new uint8_t[frameByteSize];
+    rawFile = std::make_shared<RawFile>(denFile, true, directIO);
 }
 
 template <typename T>
-DenAsyncFrame2DWritter<T>::DenAsyncFrame2DWritter(std::string denFile)
-    : denFile(denFile)
+DenAsyncFrame2DWritter<T>::DenAsyncFrame2DWritter(std::string denFile, bool directIO)
+    : DenAsyncFrame2DWritter(DenFileHandle::open(denFile), directIO)
+{
+}
+
+template <typename T>
+DenAsyncFrame2DWritter<T>::DenAsyncFrame2DWritter(std::shared_ptr<DenFileHandle> handle,
+                                                  bool directIO)
+    : denFile(handle->getFileName())
 {
     int num = 1;
     this->littleEndianArchitecture = (*(char*)&num == 1);
     std::string err;
-    if(!io::pathExists(denFile))
-    {
-        err = io::xprintf("The file %s does not exist.", denFile.c_str());
-        KCTERR(err);
-    }
-    io::DenFileInfo info(denFile);
-    if(!info.isValid())
-    {
-        err = io::xprintf("The file %s is not valid DEN.", denFile.c_str());
-        KCTERR(err);
-    }
+    const io::DenFileInfo& info = handle->getInfo();
     uint64_t elementByteSize = sizeof(T);
     if(info.getElementByteSize() != elementByteSize)
     {
@@ -261,96 +363,209 @@ DenAsyncFrame2DWritter<T>::DenAsyncFrame2DWritter(std::string denFile)
     this->frameSize = info.getFrameSize();
     this->frameByteSize = info.getFrameByteSize();
     this->XMajor = info.hasXMajorAlignment();
-    buffer = new uint8_t[frameByteSize];
+    // Handle descriptor is read only
+    rawFile = std::make_shared<RawFile>(denFile, true, directIO);
 }
 
-/// Guard for move constructor stealed objects
 template <typename T>
 DenAsyncFrame2DWritter<T>::~DenAsyncFrame2DWritter()
 {
-    if(buffer != nullptr)
-        delete[] buffer;
-    buffer = nullptr;
+    // WriteBehindQueue destructor writes the queued frames and logs the errors
+    writeBehind.reset();
+    journal.reset();
+}
+
+template <typename T>
+void DenAsyncFrame2DWritter<T>::enableWriteBehind(uint32_t queueFrames,
+                                                  BackpressurePolicy policy,
+                                                  uint32_t ioThreads,
+                                                  uint64_t growByteBudget)
+{
+    close();
+    writeBehind = std::make_unique<WriteBehindQueue>(rawFile, frameByteSize, queueFrames, policy,
+                                                     ioThreads, growByteBudget);
+    writeBehind->setCompletionListener(
+        [this](uint64_t position) { markWritten((position - offset) / frameByteSize); });
+}
+
+template <typename T>
+void DenAsyncFrame2DWritter<T>::enableCompletionTracking()
+{
+    uint64_t words = (frameCount + 63) / 64;
+    completion = std::make_unique<std::atomic<uint64_t>[]>(words);
+    for(uint64_t i = 0; i != words; i++)
+    {
+        completion[i].store(0);
+    }
+}
+
+template <typename T>
+void DenAsyncFrame2DWritter<T>::enableJournal(DenWriteJournalPolicy policy)
+{
+    journal = std::make_unique<DenWriteJournal>(rawFile, offset, frameByteSize, frameCount,
+                                                existingFile, policy);
+}
+
+template <typename T>
+std::vector<uint64_t> DenAsyncFrame2DWritter<T>::pendingFrames() const
+{
+    if(journal != nullptr)
+    {
+        return journal->pendingFrames();
+    }
+    std::vector<uint64_t> pending(frameCount);
+    for(uint64_t k = 0; k != frameCount; k++)
+    {
+        pending[k] = k;
+    }
+    return pending;
 }
 
-/// Copy constructor
 template <typename T>
-DenAsyncFrame2DWritter<T>::DenAsyncFrame2DWritter(const DenAsyncFrame2DWritter<T>& b)
-    : DenAsyncFrame2DWritter<T>::DenAsyncFrame2DWritter(b.denFile, b.dimx, b.dimy, b.dimz)
+DenWriteJournalStatistics DenAsyncFrame2DWritter<T>::getJournalStatistics() const
 {
-    LOGD << "Caling Copy constructor of DenAsyncFrame2DWritter";
+    if(journal != nullptr)
+    {
+        return journal->getStatistics();
+    }
+    return DenWriteJournalStatistics();
 }
 
-// Copy assignment
 template <typename T>
-DenAsyncFrame2DWritter<T>& DenAsyncFrame2DWritter<T>::operator=(const DenAsyncFrame2DWritter<T> b)
+void DenAsyncFrame2DWritter<T>::checkFrameIndex(uint64_t k) const
 {
-    LOGD << "Caling Copy assignment constructor of DenAsyncFrame2DWritter";
-    swap(*this, b);
-    return *this;
+    if(k >= frameCount)
+    {
+        KCTERR(io::xprintf("Frame %lu out of range of %lu frames of %s.", k, frameCount,
+                           denFile.c_str()));
+    }
 }
 
 template <typename T>
-void DenAsyncFrame2DWritter<T>::swap(DenAsyncFrame2DWritter<T>& a, DenAsyncFrame2DWritter<T>& b)
+void DenAsyncFrame2DWritter<T>::markWritten(uint64_t k)
 {
-    std::swap(a.denFile, b.denFile);
-    std::swap(a.sizex, b.sizex);
-    std::swap(a.sizey, b.sizey);
-    std::swap(a.sizez, b.sizez);
-    std::swap(a.offset, b.offset);
-    std::swap(a.extended, b.extended);
-    std::swap(a.buffer, b.buffer);
+    if(completion != nullptr)
+    {
+        completion[k / 64].fetch_or(uint64_t(1) << (k % 64), std::memory_order_relaxed);
+    }
+    if(journal != nullptr)
+    {
+        journal->markWritten(k);
+    }
 }
 
-// Move constructor
 template <typename T>
-DenAsyncFrame2DWritter<T>::DenAsyncFrame2DWritter(DenAsyncFrame2DWritter<T>&& b)
+bool DenAsyncFrame2DWritter<T>::isWritten(uint64_t k) const
 {
-    LOGD << "Caling Move constructor of DenAsyncFrame2DWritter";
-    this->denFile = b.denFile;
-    this->sizex = b.sizex;
-    this->sizey = b.sizey;
-    this->sizez = b.sizez;
-    this->offset = b.offset;
-    this->extended = b.extended;
-    this->buffer = std::exchange(b.buffer, nullptr);
+    return completion != nullptr && ((completion[k / 64].load() >> (k % 64)) & 1);
 }
 
-// Move assignment
 template <typename T>
-DenAsyncFrame2DWritter<T>& DenAsyncFrame2DWritter<T>::operator=(DenAsyncFrame2DWritter<T>&& b)
+uint64_t DenAsyncFrame2DWritter<T>::getWrittenFrameCount() const
 {
-    LOGD << "Caling Move assignment constructor of DenAsyncFrame2DWritter";
-    if(&b != this) // To elegantly solve situation when assigning to itself
+    uint64_t count = 0;
+    if(completion != nullptr)
     {
-        this->denFile = b.denFile;
-        this->sizex = b.sizex;
-        this->sizey = b.sizey;
-        this->sizez = b.sizez;
-        this->offset = b.offset;
-        this->extended = b.extended;
-        if(this->buffer != nullptr)
+        for(uint64_t i = 0; i != (frameCount + 63) / 64; i++)
         {
-            delete[] this->buffer;
-            this->buffer = nullptr;
+            count += __builtin_popcountll(completion[i].load());
         }
-        this->buffer = std::exchange(b.buffer, nullptr);
     }
+    return count;
 }
 
 template <typename T>
-void DenAsyncFrame2DWritter<T>::writeFrame(const Frame2DI<T>& f, uint64_t k)
+std::vector<uint64_t> DenAsyncFrame2DWritter<T>::getMissingFrames() const
 {
-    uint64_t position = offset + k * frameByteSize;
-    std::lock_guard<std::mutex> guard(
-        writingMutex); // Mutex will be released as this goes out of scope.
+    std::vector<uint64_t> missing;
+    if(completion != nullptr)
+    {
+        for(uint64_t k = 0; k != frameCount; k++)
+        {
+            if(!isWritten(k))
+            {
+                missing.push_back(k);
+            }
+        }
+    }
+    return missing;
+}
+
+template <typename T>
+void DenAsyncFrame2DWritter<T>::finalize()
+{
+    flush();
+    if(journal != nullptr)
+    {
+        journal->checkpoint();
+    }
+    std::vector<uint64_t> missing = getMissingFrames();
+    if(!missing.empty())
+    {
+        KCTERR(io::xprintf("%lu of %lu frames of %s were not written, the first missing frame is "
+                           "%lu.",
+                           missing.size(), frameCount, denFile.c_str(), missing[0]));
+    }
+    if(journal != nullptr)
+    {
+        journal->complete();
+    }
+}
+
+template <typename T>
+void DenAsyncFrame2DWritter<T>::flush()
+{
+    if(writeBehind != nullptr)
+    {
+        writeBehind->flush();
+    }
+}
+
+template <typename T>
+void DenAsyncFrame2DWritter<T>::close()
+{
+    if(writeBehind != nullptr)
+    {
+        // Writes fall back to synchronous even when the queued writes failed
+        std::unique_ptr<WriteBehindQueue> q = std::move(writeBehind);
+        try
+        {
+            q->close();
+        } catch(...)
+        {
+            closedWriteBehindStatistics = q->getStatistics();
+            throw;
+        }
+        closedWriteBehindStatistics = q->getStatistics();
+    }
+}
+
+template <typename T>
+WriteBehindStatistics DenAsyncFrame2DWritter<T>::getWriteBehindStatistics() const
+{
+    if(writeBehind != nullptr)
+    {
+        return writeBehind->getStatistics();
+    }
+    return closedWriteBehindStatistics;
+}
+
+template <typename T>
+void DenAsyncFrame2DWritter<T>::convertFrame(const Frame2DI<T>& f, uint8_t* out) const
+{
+    const BufferedFrame2DI<T>* buffered = dynamic_cast<const BufferedFrame2DI<T>*>(&f);
+    if(buffered != nullptr)
+    {
+        convertBuffer(buffered->data(), out);
+        return;
+    }
     if(XMajor)
     {
         for(uint32_t j = 0; j != sizey; j++)
         {
             for(uint32_t i = 0; i != sizex; i++)
             {
-                util::setNextElement<T>(f(i, j), &buffer[(j * sizex + i) * sizeof(T)]);
+                util::setNextElement<T>(f(i, j), &out[(j * sizex + i) * sizeof(T)]);
             }
         }
     } else
@@ -359,44 +574,77 @@ void DenAsyncFrame2DWritter<T>::writeFrame(const Frame2DI<T>& f, uint64_t k)
         {
             for(uint32_t j = 0; j != sizey; j++)
             {
-                util::setNextElement<T>(f(i, j), &buffer[(i * sizey + j) * sizeof(T)]);
+                util::setNextElement<T>(f(i, j), &out[(i * sizey + j) * sizeof(T)]);
             }
         }
     }
-    io::writeBytesFrom(denFile, position, buffer, frameByteSize);
-    return;
 }
 
 template <typename T>
-void DenAsyncFrame2DWritter<T>::writeBuffer(T* buf, uint64_t k)
+void DenAsyncFrame2DWritter<T>::convertBuffer(const T* buf, uint8_t* out) const
 {
-    uint64_t position = offset + k * frameByteSize;
-    std::lock_guard<std::mutex> guard(
-        writingMutex); // Mutex will be released as this goes out of scope.
-    if(XMajor && littleEndianArchitecture)
+    if(XMajor)
     {
-        io::writeBytesFrom(denFile, position, (uint8_t*)buf, frameByteSize);
+        if(littleEndianArchitecture)
+        {
+            std::memcpy(out, buf, frameByteSize);
+            return;
+        }
+        util::storeElements<T>(buf, getDenSupportedTypeByTypeID(typeid(T)), out, frameSize);
     } else
     {
-        if(XMajor)
+        transposeElements(buf, sizex, out, sizey, sizey, sizex, sizeof(T));
+        util::convertByteOrderInPlace(out, sizeof(T), frameSize);
+    }
+}
+
+template <typename T>
+void DenAsyncFrame2DWritter<T>::writeFrame(const Frame2DI<T>& f, uint64_t k)
+{
+    checkFrameIndex(k);
+    uint64_t position = offset + k * frameByteSize;
+    if(writeBehind != nullptr)
+    {
+        WriteBehindQueue::Buffer b = writeBehind->acquire();
+        if(b != nullptr)
         {
-            for(uint64_t i = 0; i != frameSize; i++)
-            {
-                util::setNextElement<T>(*(buf + i), &buffer[sizeof(T) * i]);
-            }
-        } else
+            convertFrame(f, b.get());
+            writeBehind->submit(position, std::move(b));
+        }
+        return;
+    }
+    // Each thread converts into its own buffer, pwrite does not need serialization
+    uint8_t* buffer = threadScratchBuffer(frameByteSize);
+    convertFrame(f, buffer);
+    rawFile->writeBytesFrom(position, buffer, frameByteSize);
+    markWritten(k);
+}
+
+template <typename T>
+void DenAsyncFrame2DWritter<T>::writeBuffer(T* buf, uint64_t k)
+{
+    checkFrameIndex(k);
+    uint64_t position = offset + k * frameByteSize;
+    if(writeBehind != nullptr)
+    {
+        WriteBehindQueue::Buffer b = writeBehind->acquire();
+        if(b != nullptr)
         {
-            for(uint32_t i = 0; i != sizex; i++)
-            {
-                for(uint32_t j = 0; j != sizey; j++)
-                {
-                    util::setNextElement<T>(*(buf + j * sizex + i),
-                                            &buffer[(i * sizey + j) * sizeof(T)]);
-                }
-            }
+            convertBuffer(buf, b.get());
+            writeBehind->submit(position, std::move(b));
         }
-        io::writeBytesFrom(denFile, position, (uint8_t*)buffer, frameByteSize);
+        return;
+    }
+    if(XMajor && littleEndianArchitecture)
+    {
+        rawFile->writeBytesFrom(position, (uint8_t*)buf, frameByteSize);
+    } else
+    {
+        uint8_t* buffer = threadScratchBuffer(frameByteSize);
+        convertBuffer(buf, buffer);
+        rawFile->writeBytesFrom(position, buffer, frameByteSize);
     }
+    markWritten(k);
 }
 
 template <typename T>
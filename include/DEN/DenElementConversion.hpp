@@ -0,0 +1,235 @@
+#pragma once
+
+// Standard libraries
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Internal libraries
+#include "DEN/DenSupportedType.hpp"
+#include "PROG/KCTException.hpp"
+#include "stringFormatter.h"
+
+namespace KCT::util {
+
+namespace detail {
+    /// Elements of the DEN files are little endian, their bytes are swapped on big endian hosts
+    constexpr bool HOST_BYTESWAP = __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__;
+
+    template <typename S>
+    inline S byteSwap(S v)
+    {
+        if constexpr(sizeof(S) == 1)
+        {
+            return v;
+        } else
+        {
+            using U = std::conditional_t<
+                sizeof(S) == 2, uint16_t,
+                std::conditional_t<sizeof(S) == 4, uint32_t, uint64_t>>;
+            U u;
+            std::memcpy(&u, &v, sizeof(S));
+            if constexpr(sizeof(S) == 2)
+            {
+                u = __builtin_bswap16(u);
+            } else if constexpr(sizeof(S) == 4)
+            {
+                u = __builtin_bswap32(u);
+            } else
+            {
+                u = __builtin_bswap64(u);
+            }
+            std::memcpy(&v, &u, sizeof(S));
+            return v;
+        }
+    }
+
+    /**
+     * Convert count elements of the type S stored in the buffer into the elements of the type D,
+     * swapping their bytes when BYTESWAP is set. Works in place when S and D have the same size.
+     */
+    template <typename S, typename D, bool BYTESWAP>
+    void convertKernel(const uint8_t* in, D* out, uint64_t count)
+    {
+        if constexpr(std::is_same<S, D>::value && !BYTESWAP)
+        {
+            if(count != 0 && static_cast<const void*>(in) != static_cast<const void*>(out))
+            {
+                std::memcpy(out, in, count * sizeof(S));
+            }
+        } else
+        {
+            for(uint64_t i = 0; i != count; i++)
+            {
+                S v;
+                std::memcpy(&v, in + i * sizeof(S), sizeof(S));
+                if constexpr(BYTESWAP)
+                {
+                    v = byteSwap(v);
+                }
+                out[i] = static_cast<D>(v);
+            }
+        }
+    }
+
+    template <typename U>
+    void byteSwapInPlace(uint8_t* buffer, uint64_t count)
+    {
+        for(uint64_t i = 0; i != count; i++)
+        {
+            U v;
+            std::memcpy(&v, buffer + i * sizeof(U), sizeof(U));
+            v = byteSwap(v);
+            std::memcpy(buffer + i * sizeof(U), &v, sizeof(U));
+        }
+    }
+
+    /**
+     * Store count elements of the type S as the elements of the type D into the buffer, swapping
+     * their bytes when BYTESWAP is set.
+     */
+    template <typename S, typename D, bool BYTESWAP>
+    void storeKernel(const S* in, uint8_t* out, uint64_t count)
+    {
+        if constexpr(std::is_same<S, D>::value && !BYTESWAP)
+        {
+            if(count != 0)
+            {
+                std::memcpy(out, in, count * sizeof(S));
+            }
+        } else
+        {
+            for(uint64_t i = 0; i != count; i++)
+            {
+                D v = static_cast<D>(in[i]);
+                if constexpr(BYTESWAP)
+                {
+                    v = byteSwap(v);
+                }
+                std::memcpy(out + i * sizeof(D), &v, sizeof(D));
+            }
+        }
+    }
+
+    /**
+     * SIMD widening of UINT8, UINT16, INT16 and INT32 elements to float on x86, see
+     * src/DenElementConversion.cpp.
+     *
+     * @return False when there is no kernel for the dataType and nothing was converted.
+     */
+    bool convertToFloatSIMD(const uint8_t* in,
+                            io::DenSupportedType dataType,
+                            float* out,
+                            uint64_t count);
+} // namespace detail
+
+/**
+ * Convert count elements of the dataType stored in the buffer in the byte order of the DEN files
+ * into the elements of the type T.
+ *
+ * The kernel of the (source type, T, byte swap) combination is selected once per call, so that
+ * whole frames are converted by tight loops. Integer to float conversion is done by SIMD kernels
+ * when the CPU supports them. Works in place when the element sizes are equal.
+ */
+template <typename T>
+void convertElements(const uint8_t* buffer, io::DenSupportedType dataType, T* out, uint64_t count)
+{
+    using namespace detail;
+    if constexpr(std::is_same<T, float>::value && !HOST_BYTESWAP)
+    {
+        if(convertToFloatSIMD(buffer, dataType, out, count))
+        {
+            return;
+        }
+    }
+    switch(dataType)
+    {
+    case io::DenSupportedType::UINT16:
+        return convertKernel<uint16_t, T, HOST_BYTESWAP>(buffer, out, count);
+    case io::DenSupportedType::INT16:
+        return convertKernel<int16_t, T, HOST_BYTESWAP>(buffer, out, count);
+    case io::DenSupportedType::UINT32:
+        return convertKernel<uint32_t, T, HOST_BYTESWAP>(buffer, out, count);
+    case io::DenSupportedType::INT32:
+        return convertKernel<int32_t, T, HOST_BYTESWAP>(buffer, out, count);
+    case io::DenSupportedType::UINT64:
+        return convertKernel<uint64_t, T, HOST_BYTESWAP>(buffer, out, count);
+    case io::DenSupportedType::INT64:
+        return convertKernel<int64_t, T, HOST_BYTESWAP>(buffer, out, count);
+    case io::DenSupportedType::FLOAT32:
+        return convertKernel<float, T, HOST_BYTESWAP>(buffer, out, count);
+    case io::DenSupportedType::FLOAT64:
+        return convertKernel<double, T, HOST_BYTESWAP>(buffer, out, count);
+    case io::DenSupportedType::UINT8:
+        return convertKernel<uint8_t, T, HOST_BYTESWAP>(buffer, out, count);
+    default:
+        KCTERR(io::xprintf("Unsupported data type %s.",
+                           io::DenSupportedTypeToString(dataType).c_str()));
+    }
+}
+
+/**
+ * Store count elements of the type T into the buffer as the elements of the dataType in the byte
+ * order of the DEN files, the kernel is selected once per call.
+ */
+template <typename T>
+void storeElements(const T* in, io::DenSupportedType dataType, uint8_t* buffer, uint64_t count)
+{
+    using namespace detail;
+    switch(dataType)
+    {
+    case io::DenSupportedType::UINT16:
+        return storeKernel<T, uint16_t, HOST_BYTESWAP>(in, buffer, count);
+    case io::DenSupportedType::INT16:
+        return storeKernel<T, int16_t, HOST_BYTESWAP>(in, buffer, count);
+    case io::DenSupportedType::UINT32:
+        return storeKernel<T, uint32_t, HOST_BYTESWAP>(in, buffer, count);
+    case io::DenSupportedType::INT32:
+        return storeKernel<T, int32_t, HOST_BYTESWAP>(in, buffer, count);
+    case io::DenSupportedType::UINT64:
+        return storeKernel<T, uint64_t, HOST_BYTESWAP>(in, buffer, count);
+    case io::DenSupportedType::INT64:
+        return storeKernel<T, int64_t, HOST_BYTESWAP>(in, buffer, count);
+    case io::DenSupportedType::FLOAT32:
+        return storeKernel<T, float, HOST_BYTESWAP>(in, buffer, count);
+    case io::DenSupportedType::FLOAT64:
+        return storeKernel<T, double, HOST_BYTESWAP>(in, buffer, count);
+    case io::DenSupportedType::UINT8:
+        return storeKernel<T, uint8_t, HOST_BYTESWAP>(in, buffer, count);
+    default:
+        KCTERR(io::xprintf("Unsupported data type %s.",
+                           io::DenSupportedTypeToString(dataType).c_str()));
+    }
+}
+
+/**
+ * Swap in place the bytes of count elements of elementByteSize bytes between the byte order of the
+ * DEN files and the byte order of the host, does nothing on little endian hosts.
+ */
+inline void convertByteOrderInPlace(uint8_t* buffer, uint32_t elementByteSize, uint64_t count)
+{
+    using namespace detail;
+    if constexpr(HOST_BYTESWAP)
+    {
+        switch(elementByteSize)
+        {
+        case 1:
+            return;
+        case 2:
+            return byteSwapInPlace<uint16_t>(buffer, count);
+        case 4:
+            return byteSwapInPlace<uint32_t>(buffer, count);
+        case 8:
+            return byteSwapInPlace<uint64_t>(buffer, count);
+        default:
+            KCTERR(io::xprintf("Elements of %u bytes are not supported.", elementByteSize));
+        }
+    }
+}
+
+/**
+ * Name of the integer to float kernels selected for this CPU, avx2, sse2 or scalar.
+ */
+const char* conversionKernelName();
+
+} // namespace KCT::util
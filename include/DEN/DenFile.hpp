@@ -1,32 +1,126 @@
 #pragma once
 
 // External
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 // Internal
 #include "BufferedFrame2D.hpp"
+#include "DEN/DenElementConversion.hpp"
+#include "DEN/DenFileHandle.hpp"
 #include "DEN/DenFileInfo.hpp"
 #include "Frame2DI.hpp"
 #include "Frame2DReaderI.hpp"
+#include "FrameMemoryViewer2D.hpp"
+#include "FramePool.hpp"
+#include "NumaMemory.hpp"
+#include "RawFile.hpp"
 
 namespace KCT::io {
 
+/**
+ * When DenFile reads the frames into memory.
+ *
+ * EAGER reads the whole file by numThreads threads in the constructor. LAZY returns after parsing
+ * the header and reads each frame on its first access, memory of the frames not accessed is not
+ * committed. BACKGROUND is LAZY with numThreads threads populating all the frames in the
+ * background.
+ */
+enum class DenFileLoading { EAGER, LAZY, BACKGROUND };
+
+/**
+ * Frames [fromFrame, toFrame) whose memory is on the NUMA node, -1 when not resident or unknown.
+ */
+struct DenFileNumaRange
+{
+    uint64_t fromFrame;
+    uint64_t toFrame;
+    int node;
+};
+
 /**
  * Class to read the entire DEN file into memory and provide access to individual frames.
+ *
+ * In the LAZY and BACKGROUND modes, getFrame, getFramePointer, beginFrame and endFrame read the
+ * frame when it is not resident yet, accessors of the whole data getDataPointer, begin, end and
+ * writeFile read all the missing frames first. Frames are read at most once, concurrent accesses
+ * are safe.
+ *
+ * Accessors that expose mutable memory mark the frames dirty, flush writes only the dirty frames
+ * back to the file. Use getConstFramePointer and getConstFrameView for read only access.
  */
 template <typename T>
 class DenFile
 {
 public:
-    DenFile(std::string denFile, uint32_t numThreads = std::thread::hardware_concurrency());
+    using iterator = typename std::vector<T, UninitializedAllocator<T>>::iterator;
+
+    /**
+     * Read the whole DEN file into memory.
+     *
+     * @param denFile File in a DEN format.
+     * @param numThreads Number of threads to read and write the file.
+     * @param directIO Read and write with O_DIRECT bypassing the page cache, the data are held in
+     * memory by this object so that caching them also in the page cache is a waste. Falls back to
+     * buffered I/O when the file system does not support it.
+     * @param loading When the frames are read, by default all in the constructor.
+     * @param numaPolicy Placement of the data on the NUMA nodes. With FIRST_TOUCH the memory of the
+     * frames is not touched before they are read, so that it is placed on the node of the reading
+     * thread. On the systems with more nodes the threads of the EAGER read are spread over the
+     * nodes, the thread reading the i-th of numThreads contiguous chunks of the frames runs on the
+     * node numaNodes()[i * numaNodeCount() / numThreads].
+     * @param numaNode Node of the BIND policy.
+     */
+    DenFile(std::string denFile,
+            uint32_t numThreads = std::thread::hardware_concurrency(),
+            bool directIO = false,
+            DenFileLoading loading = DenFileLoading::EAGER,
+            NumaPolicy numaPolicy = NumaPolicy::FIRST_TOUCH,
+            uint32_t numaNode = 0);
+    /**
+     * Read the whole DEN file given by the shared handle into memory.
+     *
+     * @param handle Handle obtained by DenFileHandle::open, the header is not parsed again.
+     * @param numThreads Number of threads to read and write the file.
+     * @param loading When the frames are read, by default all in the constructor.
+     * @param numaPolicy Placement of the data on the NUMA nodes.
+     * @param numaNode Node of the BIND policy.
+     */
+    DenFile(std::shared_ptr<DenFileHandle> handle,
+            uint32_t numThreads = std::thread::hardware_concurrency(),
+            DenFileLoading loading = DenFileLoading::EAGER,
+            NumaPolicy numaPolicy = NumaPolicy::FIRST_TOUCH,
+            uint32_t numaNode = 0);
     ~DenFile();
+    DenFile(const DenFile& b) = delete;
+    DenFile& operator=(const DenFile& b) = delete;
 
+    /**
+     * Copy of the frame k in the x major alignment.
+     */
     std::shared_ptr<io::Frame2DI<T>> getFrame(uint64_t k);
+    /**
+     * View of the frame k in the memory of this object without copy, valid while the object
+     * lives. Marks the frame dirty.
+     */
+    std::shared_ptr<FrameMemoryViewer2D<T>> getFrameView(uint64_t k);
+    std::shared_ptr<const FrameMemoryViewer2D<T>> getConstFrameView(uint64_t k);
+    /**
+     * Borrow the memory of the frames returned by getFrame from the pool of buffers of at least
+     * getFrameSize() elements, nullptr restores allocation per frame.
+     */
+    void setFramePool(std::shared_ptr<FramePool<T>> pool);
+    std::shared_ptr<FramePool<T>> getFramePool() const;
     uint32_t dimx() const;
     uint32_t dimy() const;
     uint64_t getFrameCount() const;
@@ -36,22 +130,79 @@ public:
     DenSupportedType getDataType() const;
 
     void writeFile(std::string fileName, bool overwrite = false);
+    /**
+     * Write the dirty frames to the file this object was read from and clear their dirty bits,
+     * adjacent dirty frames are written by a single call.
+     *
+     * Modifications through the pointers obtained before the flush made after it are not tracked,
+     * mark such frames by markDirty. When some writes fail, their frames stay dirty and the first
+     * error is thrown after all the writes finished.
+     *
+     * @return Number of frames written.
+     */
+    uint64_t flush();
+    /**
+     * Mark the frames [fromFrame, toFrame) dirty, the frames that are not resident are read first
+     * so that flush does not write their uninitialized memory.
+     */
+    void markDirty(uint64_t fromFrame, uint64_t toFrame);
+    bool isDirty(uint64_t k) const;
+    uint64_t getDirtyFrameCount() const;
 
     // Pointers and iterators
     T* getDataPointer();
     T* getFramePointer(uint64_t k);
-    typename std::vector<T>::iterator begin();
-    typename std::vector<T>::iterator end();
-    typename std::vector<T>::iterator beginFrame(uint64_t k);
-    typename std::vector<T>::iterator endFrame(uint64_t k);
+    const T* getConstFramePointer(uint64_t k);
+    iterator begin();
+    iterator end();
+    iterator beginFrame(uint64_t k);
+    iterator endFrame(uint64_t k);
+
+    /**
+     * Read the frames [fromFrame, toFrame) that are not resident by the calling thread.
+     */
+    void ensureResident(uint64_t fromFrame, uint64_t toFrame);
+    /**
+     * Schedule reading of the frames [fromFrame, toFrame) by the background threads and return
+     * immediately. Ranges requested by prefetch are read before the remaining frames of the
+     * BACKGROUND population.
+     */
+    void prefetch(uint64_t fromFrame, uint64_t toFrame);
+    bool isResident(uint64_t k) const;
+    /**
+     * Residency bitmap, bit k % 64 of the word k / 64 is set when the frame k is in memory.
+     */
+    std::vector<uint64_t> getResidency() const;
+    uint64_t getResidentFrameCount() const;
+    DenFileLoading getLoading() const;
+
+    /**
+     * NUMA node of the memory of the first element of the frame, -1 when the frame is not
+     * resident or the node can not be determined.
+     */
+    int getFrameNumaNode(uint64_t k) const;
+    /**
+     * Maximal ranges of consecutive frames on the same node, see getFrameNumaNode.
+     */
+    std::vector<DenFileNumaRange> getNumaPlacement() const;
+    NumaPolicy getNumaPolicy() const;
 
 private:
     void readFileIntoMemory();
-    void readFileChunk(uint64_t startFrame, uint64_t endFrame);
-    void writeFileChunk(std::string fileName, uint64_t startFrame, uint64_t endFrame);
+    void readFileChunk(uint64_t startFrame, uint64_t endFrame, int numaNode = -1);
+    void readFrame(uint64_t k, uint8_t* buffer);
+    void loadFrame(uint64_t k);
+    void startWorkers();
+    void workerLoop();
+    void
+    writeFileChunk(std::shared_ptr<RawFile> outputFile, uint64_t startFrame, uint64_t endFrame);
+    void writeFrames(const RawFile& outputFile, uint64_t startFrame, uint64_t endFrame);
+    void setDirtyBits(uint64_t fromFrame, uint64_t toFrame);
 
     std::string denFile;
+    std::shared_ptr<DenFileHandle> fileHandle;
     DenFileInfo denFileInfo;
+    std::shared_ptr<RawFile> rawFile;
     uint64_t offset;
     bool XMajorAlignment;
     uint32_t sizex, sizey;
@@ -61,21 +212,59 @@ private:
     DenSupportedType dataType;
     uint64_t elementByteSize;
 
-    std::vector<T> fileData;
+    // Pages of the frames that are not read are not committed
+    std::vector<T, UninitializedAllocator<T>> fileData;
+    std::shared_ptr<FramePool<T>> framePool;
     std::vector<uint64_t> frameOffsets;
     uint32_t numThreads;
+    bool directIO;
 
     bool littleEndianArchitecture;
-    std::atomic<bool> readCompleted;
-    std::mutex readMutex;
+    // Frames are copied between the file and the memory without conversion
+    bool directCopy;
+    DenFileLoading loading;
+    NumaPolicy numaPolicy;
+    std::unique_ptr<std::atomic<uint64_t>[]> residency;
+    std::atomic<uint64_t> residentFrames;
+    // Same layout as residency
+    std::unique_ptr<std::atomic<uint64_t>[]> dirty;
+    // Frames are loaded under the lock of the stripe to read each frame once
+    static constexpr uint32_t LOAD_STRIPES = 64;
+    std::mutex loadMutexes[LOAD_STRIPES];
+    // Background population
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::deque<std::pair<uint64_t, uint64_t>> queue;
+    std::vector<std::thread> workers;
+    bool stopWorkers = false;
 };
 
 template <typename T>
-DenFile<T>::DenFile(std::string denFile, uint32_t numThreads)
-    : denFile(denFile)
-    , denFileInfo(denFile)
+DenFile<T>::DenFile(std::string denFile,
+                    uint32_t numThreads,
+                    bool directIO,
+                    DenFileLoading loading,
+                    NumaPolicy numaPolicy,
+                    uint32_t numaNode)
+    : DenFile(DenFileHandle::open(denFile, directIO), numThreads, loading, numaPolicy, numaNode)
+{
+}
+
+template <typename T>
+DenFile<T>::DenFile(std::shared_ptr<DenFileHandle> handle,
+                    uint32_t numThreads,
+                    DenFileLoading loading,
+                    NumaPolicy numaPolicy,
+                    uint32_t numaNode)
+    : denFile(handle->getFileName())
+    , fileHandle(handle)
+    , denFileInfo(handle->getInfo())
+    , rawFile(handle->getRawFile())
     , numThreads(numThreads)
-    , readCompleted(false)
+    , directIO(rawFile->isDirectIO())
+    , loading(loading)
+    , numaPolicy(numaPolicy)
+    , residentFrames(0)
 {
     std::string ERR;
     this->dataType = denFileInfo.getElementType();
@@ -102,18 +291,44 @@ DenFile<T>::DenFile(std::string denFile, uint32_t numThreads)
         frameOffsets[i] = offset + i * frameByteSize;
     }
 
+    // Elements are not initialized, the pages are placed when the frames are read
     fileData.resize(frameSize * frameCount);
+    applyNumaPolicy(fileData.data(), frameSize * frameCount * sizeof(T), numaPolicy, numaNode);
 
     int num = 1;
     littleEndianArchitecture = (*(char*)&num == 1);
+    directCopy = littleEndianArchitecture && dataType == readerDataType;
 
-    readFileIntoMemory();
+    uint64_t words = (frameCount + 63) / 64;
+    residency = std::make_unique<std::atomic<uint64_t>[]>(words);
+    dirty = std::make_unique<std::atomic<uint64_t>[]>(words);
+    for(uint64_t i = 0; i != words; i++)
+    {
+        residency[i].store(0);
+        dirty[i].store(0);
+    }
+    if(loading == DenFileLoading::EAGER)
+    {
+        readFileIntoMemory();
+    } else if(loading == DenFileLoading::BACKGROUND)
+    {
+        prefetch(0, frameCount);
+    }
 }
 
 template <typename T>
 DenFile<T>::~DenFile()
 {
-    // Destructor
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopWorkers = true;
+        queue.clear();
+    }
+    queueCondition.notify_all();
+    for(std::thread& w : workers)
+    {
+        w.join();
+    }
 }
 
 template <typename T>
@@ -122,83 +337,391 @@ void DenFile<T>::readFileIntoMemory()
     if(numThreads <= 1)
     {
         readFileChunk(0, frameCount);
-        readCompleted.store(true);
         return;
     }
 
     std::vector<std::thread> async_threads;
     uint64_t threads = std::min(static_cast<uint64_t>(numThreads), frameCount);
     uint64_t framesPerThread = (frameCount + threads - 1) / threads;
+    std::vector<uint32_t> nodes = numaNodes();
+    bool spreadThreads = numaPolicy == NumaPolicy::FIRST_TOUCH && nodes.size() > 1;
 
     for(uint32_t i = 0; i < threads; ++i)
     {
         uint64_t startFrame = i * framesPerThread;
         uint64_t endFrame = std::min(startFrame + framesPerThread, frameCount);
-        async_threads.emplace_back(&DenFile::readFileChunk, this, startFrame, endFrame);
+        int node = spreadThreads ? static_cast<int>(nodes[i * nodes.size() / threads]) : -1;
+        async_threads.emplace_back(&DenFile::readFileChunk, this, startFrame, endFrame, node);
     }
 
     for(auto& thread : async_threads)
     {
         thread.join();
     }
-
-    readCompleted.store(true);
 }
 
 template <typename T>
-void DenFile<T>::readFileChunk(uint64_t startFrame, uint64_t endFrame)
+void DenFile<T>::readFileChunk(uint64_t startFrame, uint64_t endFrame, int numaNode)
 {
-    uint8_t* buffer = new uint8_t[frameByteSize];
+    // The chunk is first touched by this thread, run it on the node where it shall be placed
+    if(numaNode >= 0 && !bindThreadToNumaNode(numaNode))
+    {
+        LOGW << io::xprintf("Can not run the thread reading %s on the NUMA node %d.",
+                            denFile.c_str(), numaNode);
+    }
+    // Chunks of the eager read are disjoint, no locking is needed
+    uint8_t* buffer = directCopy ? nullptr : threadScratchBuffer(frameByteSize);
     for(uint64_t k = startFrame; k < endFrame; ++k)
     {
-        uint64_t position = frameOffsets[k];
-        io::readBytesFrom(this->denFile, position, buffer, frameByteSize);
+        readFrame(k, buffer);
+        residency[k / 64].fetch_or(uint64_t(1) << (k % 64), std::memory_order_release);
+        residentFrames++;
+    }
+}
 
-        if(littleEndianArchitecture)
+template <typename T>
+void DenFile<T>::readFrame(uint64_t k, uint8_t* buffer)
+{
+    uint64_t position = frameOffsets[k];
+    if(directCopy)
+    {
+        // Frame memory is aligned when the frame byte size is a multiple of the alignment
+        rawFile->readBytesFrom(position, (uint8_t*)&fileData[k * frameSize], frameByteSize);
+        return;
+    }
+    rawFile->readBytesFrom(position, buffer, frameByteSize);
+    util::convertElements<T>(buffer, dataType, &fileData[k * frameSize], frameSize);
+}
+
+template <typename T>
+bool DenFile<T>::isResident(uint64_t k) const
+{
+    return (residency[k / 64].load(std::memory_order_acquire) >> (k % 64)) & 1;
+}
+
+template <typename T>
+void DenFile<T>::loadFrame(uint64_t k)
+{
+    if(isResident(k))
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(loadMutexes[k % LOAD_STRIPES]);
+    if(isResident(k))
+    {
+        return;
+    }
+    readFrame(k, directCopy ? nullptr : threadScratchBuffer(frameByteSize));
+    residency[k / 64].fetch_or(uint64_t(1) << (k % 64), std::memory_order_release);
+    residentFrames++;
+}
+
+template <typename T>
+void DenFile<T>::ensureResident(uint64_t fromFrame, uint64_t toFrame)
+{
+    if(fromFrame > toFrame || toFrame > frameCount)
+    {
+        KCTERR(io::xprintf("Frames [%lu, %lu) out of range of %lu frames in %s.", fromFrame,
+                           toFrame, frameCount, denFile.c_str()));
+    }
+    if(residentFrames.load() == frameCount)
+    {
+        return;
+    }
+    for(uint64_t k = fromFrame; k != toFrame; k++)
+    {
+        loadFrame(k);
+    }
+}
+
+template <typename T>
+void DenFile<T>::prefetch(uint64_t fromFrame, uint64_t toFrame)
+{
+    if(fromFrame > toFrame || toFrame > frameCount)
+    {
+        KCTERR(io::xprintf("Frames [%lu, %lu) out of range of %lu frames in %s.", fromFrame,
+                           toFrame, frameCount, denFile.c_str()));
+    }
+    if(fromFrame == toFrame || residentFrames.load() == frameCount)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        // Explicit requests go before the remaining background population
+        queue.emplace_front(fromFrame, toFrame);
+        startWorkers();
+    }
+    queueCondition.notify_all();
+}
+
+template <typename T>
+void DenFile<T>::startWorkers()
+{
+    if(!workers.empty())
+    {
+        return;
+    }
+    uint32_t threads = std::max<uint32_t>(numThreads, 1);
+    for(uint32_t i = 0; i != threads; i++)
+    {
+        workers.emplace_back(&DenFile::workerLoop, this);
+    }
+}
+
+template <typename T>
+void DenFile<T>::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while(true)
+    {
+        queueCondition.wait(lock, [this]() { return stopWorkers || !queue.empty(); });
+        if(stopWorkers)
+        {
+            return;
+        }
+        // Take the first frame of the first range, so that the threads share the range
+        std::pair<uint64_t, uint64_t>& range = queue.front();
+        uint64_t k = range.first++;
+        if(range.first == range.second)
+        {
+            queue.pop_front();
+        }
+        lock.unlock();
+        try
+        {
+            loadFrame(k);
+        } catch(const std::exception& e)
         {
-            std::memcpy(&fileData[k * frameSize], buffer, frameByteSize);
+            // Frame stays not resident and the access reports the error
+            LOGE << io::xprintf("Background read of the frame %lu of %s failed: %s", k,
+                                denFile.c_str(), e.what());
+        }
+        lock.lock();
+    }
+}
+
+template <typename T>
+std::vector<uint64_t> DenFile<T>::getResidency() const
+{
+    std::vector<uint64_t> bitmap((frameCount + 63) / 64);
+    for(uint64_t i = 0; i != bitmap.size(); i++)
+    {
+        bitmap[i] = residency[i].load(std::memory_order_acquire);
+    }
+    return bitmap;
+}
+
+template <typename T>
+uint64_t DenFile<T>::getResidentFrameCount() const
+{
+    return residentFrames.load();
+}
+
+template <typename T>
+DenFileLoading DenFile<T>::getLoading() const
+{
+    return loading;
+}
+
+template <typename T>
+int DenFile<T>::getFrameNumaNode(uint64_t k) const
+{
+    if(k >= frameCount || !isResident(k))
+    {
+        return -1;
+    }
+    return numaNodesOfAddresses({ fileData.data() + k * frameSize })[0];
+}
+
+template <typename T>
+std::vector<DenFileNumaRange> DenFile<T>::getNumaPlacement() const
+{
+    std::vector<const void*> addresses(frameCount);
+    for(uint64_t k = 0; k != frameCount; k++)
+    {
+        addresses[k] = fileData.data() + k * frameSize;
+    }
+    // Pages of the frames not read are not faulted in by the query
+    std::vector<int> nodes = numaNodesOfAddresses(addresses);
+    std::vector<DenFileNumaRange> ranges;
+    for(uint64_t k = 0; k != frameCount; k++)
+    {
+        int node = isResident(k) ? nodes[k] : -1;
+        if(ranges.empty() || ranges.back().node != node)
+        {
+            ranges.push_back({ k, k + 1, node });
         } else
         {
-            for(uint64_t a = 0; a != frameSize; a++)
-            {
-                fileData[k * frameSize + a]
-                    = util::getNextElement<T>(&buffer[a * elementByteSize], dataType);
-            }
+            ranges.back().toFrame = k + 1;
         }
     }
-    delete[] buffer;
+    return ranges;
 }
 
 template <typename T>
-void DenFile<T>::writeFileChunk(std::string fileName, uint64_t startFrame, uint64_t endFrame)
+NumaPolicy DenFile<T>::getNumaPolicy() const
 {
-    uint64_t fileOffset = 0;
-    T* pointer = fileData.data();
-    T* framePointer = nullptr;
-    if(littleEndianArchitecture)
+    return numaPolicy;
+}
+
+template <typename T>
+void DenFile<T>::writeFileChunk(std::shared_ptr<RawFile> outputFile,
+                                uint64_t startFrame,
+                                uint64_t endFrame)
+{
+    writeFrames(*outputFile, startFrame, endFrame);
+}
+
+template <typename T>
+void DenFile<T>::writeFrames(const RawFile& outputFile, uint64_t startFrame, uint64_t endFrame)
+{
+    if(directCopy)
+    {
+        // Frames are contiguous both in memory and in the file
+        outputFile.writeBytesFrom(frameOffsets[startFrame],
+                                  (const uint8_t*)(fileData.data() + startFrame * frameSize),
+                                  (endFrame - startFrame) * frameByteSize);
+    } else
     {
+        uint8_t* buffer = threadScratchBuffer(frameByteSize);
         for(uint64_t k = startFrame; k < endFrame; ++k)
         {
-            fileOffset = frameOffsets[k];
-            framePointer = pointer + k * frameSize;
-            io::writeBytesFrom(fileName, fileOffset, (uint8_t*)framePointer, frameByteSize);
+            const T* framePointer = fileData.data() + k * frameSize;
+            util::storeElements<T>(framePointer, dataType, buffer, frameSize);
+            outputFile.writeBytesFrom(frameOffsets[k], buffer, frameByteSize);
         }
-    } else
+    }
+}
+
+template <typename T>
+void DenFile<T>::markDirty(uint64_t fromFrame, uint64_t toFrame)
+{
+    if(fromFrame > toFrame || toFrame > frameCount)
     {
+        KCTERR(io::xprintf("Frames [%lu, %lu) out of range of %lu frames in %s.", fromFrame,
+                           toFrame, frameCount, denFile.c_str()));
+    }
+    ensureResident(fromFrame, toFrame);
+    setDirtyBits(fromFrame, toFrame);
+}
 
-        uint8_t* buffer = new uint8_t[frameByteSize];
-        for(uint64_t k = startFrame; k < endFrame; ++k)
+template <typename T>
+void DenFile<T>::setDirtyBits(uint64_t fromFrame, uint64_t toFrame)
+{
+    uint64_t k = fromFrame;
+    while(k < toFrame)
+    {
+        uint64_t bits = std::min<uint64_t>(64 - k % 64, toFrame - k);
+        uint64_t mask = (bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1) << (k % 64);
+        dirty[k / 64].fetch_or(mask, std::memory_order_relaxed);
+        k += bits;
+    }
+}
+
+template <typename T>
+bool DenFile<T>::isDirty(uint64_t k) const
+{
+    if(k >= frameCount)
+    {
+        KCTERR(io::xprintf("Frame %lu out of range of %lu frames in %s.", k, frameCount,
+                           denFile.c_str()));
+    }
+    return (dirty[k / 64].load(std::memory_order_relaxed) >> (k % 64)) & 1;
+}
+
+template <typename T>
+uint64_t DenFile<T>::getDirtyFrameCount() const
+{
+    uint64_t count = 0;
+    for(uint64_t i = 0; i != (frameCount + 63) / 64; i++)
+    {
+        count += __builtin_popcountll(dirty[i].load(std::memory_order_relaxed));
+    }
+    return count;
+}
+
+template <typename T>
+uint64_t DenFile<T>::flush()
+{
+    // Runs of adjacent dirty frames, their bits are cleared before the write so that the frames
+    // marked again meanwhile are written by the next flush
+    std::vector<std::pair<uint64_t, uint64_t>> runs;
+    uint64_t frames = 0;
+    for(uint64_t i = 0; i != (frameCount + 63) / 64; i++)
+    {
+        uint64_t word = dirty[i].exchange(0, std::memory_order_acquire);
+        while(word != 0)
         {
-            fileOffset = frameOffsets[k];
-            framePointer = pointer + k * frameSize;
-            for(uint64_t a = 0; a != frameSize; a++)
+            uint64_t k = i * 64 + __builtin_ctzll(word);
+            word &= word - 1;
+            if(!runs.empty() && runs.back().second == k)
+            {
+                runs.back().second = k + 1;
+            } else
             {
-                util::setNextElement<T>(*framePointer, &buffer[a * elementByteSize]);
+                runs.emplace_back(k, k + 1);
+            }
+            frames++;
+        }
+    }
+    if(runs.empty())
+    {
+        return 0;
+    }
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    // Runs that failed are marked dirty again so that the modifications are not lost
+    auto writeRuns = [&](const RawFile& outputFile, uint64_t first, uint64_t step) {
+        for(uint64_t i = first; i < runs.size(); i += step)
+        {
+            try
+            {
+                writeFrames(outputFile, runs[i].first, runs[i].second);
+            } catch(...)
+            {
+                setDirtyBits(runs[i].first, runs[i].second);
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if(!error)
+                {
+                    error = std::current_exception();
+                }
             }
-            io::writeBytesFrom(fileName, fileOffset, buffer, frameByteSize);
         }
-        delete[] buffer;
+    };
+    std::unique_ptr<RawFile> outputFile;
+    try
+    {
+        outputFile = std::make_unique<RawFile>(denFile, true, directIO);
+    } catch(...)
+    {
+        for(const std::pair<uint64_t, uint64_t>& r : runs)
+        {
+            setDirtyBits(r.first, r.second);
+        }
+        throw;
+    }
+    uint64_t threads = std::min<uint64_t>(std::max<uint32_t>(numThreads, 1), runs.size());
+    if(threads <= 1)
+    {
+        writeRuns(*outputFile, 0, 1);
+    } else
+    {
+        std::vector<std::thread> async_threads;
+        for(uint64_t t = 0; t != threads; t++)
+        {
+            async_threads.emplace_back(writeRuns, std::cref(*outputFile), t, threads);
+        }
+        for(auto& thread : async_threads)
+        {
+            thread.join();
+        }
+    }
+    if(error)
+    {
+        std::rethrow_exception(error);
     }
+    return frames;
 }
 
 template <typename T>
@@ -254,9 +777,11 @@ void DenFile<T>::writeFile(std::string fileName, bool force)
         DenFileInfo::createEmptyDenFile(fileName, dataType, dims.size(), dims.data(),
                                         XMajorAlignment);
     }
+    ensureResident(0, frameCount);
+    std::shared_ptr<RawFile> outputFile = std::make_shared<RawFile>(fileName, true, directIO);
     if(numThreads <= 1)
     {
-        writeFileChunk(fileName, 0, frameCount);
+        writeFileChunk(outputFile, 0, frameCount);
         return;
     }
 
@@ -268,7 +793,8 @@ void DenFile<T>::writeFile(std::string fileName, bool force)
     {
         uint64_t startFrame = i * framesPerThread;
         uint64_t endFrame = std::min(startFrame + framesPerThread, frameCount);
-        async_threads.emplace_back(&DenFile::writeFileChunk, this, fileName, startFrame, endFrame);
+        async_threads.emplace_back(&DenFile::writeFileChunk, this, outputFile, startFrame,
+                                   endFrame);
     }
 
     for(auto& thread : async_threads)
@@ -280,12 +806,11 @@ void DenFile<T>::writeFile(std::string fileName, bool force)
 template <typename T>
 std::shared_ptr<io::Frame2DI<T>> DenFile<T>::getFrame(uint64_t k)
 {
-    if(!readCompleted.load())
-    {
-        std::lock_guard<std::mutex> lock(readMutex);
-    }
+    ensureResident(k, k + 1);
 
-    T* buffer_copy = new T[frameSize];
+    std::shared_ptr<BufferedFrame2D<T>> frame
+        = std::make_shared<BufferedFrame2D<T>>(sizex, sizey, framePool);
+    T* buffer_copy = frame->data();
     if(this->XMajorAlignment)
     {
         std::memcpy(buffer_copy, &fileData[k * frameSize], frameSize * sizeof(T));
@@ -299,11 +824,41 @@ std::shared_ptr<io::Frame2DI<T>> DenFile<T>::getFrame(uint64_t k)
             }
         }
     }
-    std::shared_ptr<io::Frame2DI<T>> frame
-        = std::make_shared<BufferedFrame2D<T>>(buffer_copy, sizex, sizey);
     return frame;
 }
 
+template <typename T>
+std::shared_ptr<FrameMemoryViewer2D<T>> DenFile<T>::getFrameView(uint64_t k)
+{
+    T* p = getFramePointer(k);
+    return std::make_shared<FrameMemoryViewer2D<T>>(p, sizex, sizey, XMajorAlignment);
+}
+
+template <typename T>
+std::shared_ptr<const FrameMemoryViewer2D<T>> DenFile<T>::getConstFrameView(uint64_t k)
+{
+    T* p = const_cast<T*>(getConstFramePointer(k));
+    return std::make_shared<const FrameMemoryViewer2D<T>>(p, sizex, sizey, XMajorAlignment);
+}
+
+template <typename T>
+void DenFile<T>::setFramePool(std::shared_ptr<FramePool<T>> pool)
+{
+    if(pool != nullptr && pool->getElementCount() < frameSize)
+    {
+        KCTERR(io::xprintf("Buffers of the pool of %lu elements can not hold frames of %lu "
+                           "elements of the file %s.",
+                           pool->getElementCount(), frameSize, denFile.c_str()));
+    }
+    framePool = pool;
+}
+
+template <typename T>
+std::shared_ptr<FramePool<T>> DenFile<T>::getFramePool() const
+{
+    return framePool;
+}
+
 template <typename T>
 uint32_t DenFile<T>::dimx() const
 {
@@ -349,36 +904,55 @@ DenSupportedType DenFile<T>::getDataType() const
 template <typename T>
 T* DenFile<T>::getDataPointer()
 {
+    ensureResident(0, frameCount);
+    markDirty(0, frameCount);
     return fileData.data();
 }
 
 template <typename T>
 T* DenFile<T>::getFramePointer(uint64_t k)
 {
+    ensureResident(k, k + 1);
+    markDirty(k, k + 1);
+    return fileData.data() + k * frameSize;
+}
+
+template <typename T>
+const T* DenFile<T>::getConstFramePointer(uint64_t k)
+{
+    ensureResident(k, k + 1);
     return fileData.data() + k * frameSize;
 }
 
 template <typename T>
-typename std::vector<T>::iterator DenFile<T>::begin()
+typename DenFile<T>::iterator DenFile<T>::begin()
 {
+    ensureResident(0, frameCount);
+    markDirty(0, frameCount);
     return fileData.begin();
 }
 
 template <typename T>
-typename std::vector<T>::iterator DenFile<T>::end()
+typename DenFile<T>::iterator DenFile<T>::end()
 {
+    ensureResident(0, frameCount);
+    markDirty(0, frameCount);
     return fileData.end();
 }
 
 template <typename T>
-typename std::vector<T>::iterator DenFile<T>::beginFrame(uint64_t k)
+typename DenFile<T>::iterator DenFile<T>::beginFrame(uint64_t k)
 {
+    ensureResident(k, k + 1);
+    markDirty(k, k + 1);
     return fileData.begin() + k * frameSize;
 }
 
 template <typename T>
-typename std::vector<T>::iterator DenFile<T>::endFrame(uint64_t k)
+typename DenFile<T>::iterator DenFile<T>::endFrame(uint64_t k)
 {
+    ensureResident(k, k + 1);
+    markDirty(k, k + 1);
     return fileData.begin() + (k + 1) * frameSize;
 }
 
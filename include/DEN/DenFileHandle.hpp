@@ -0,0 +1,66 @@
+#pragma once
+
+// External
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Internal
+#include "DEN/DenFileInfo.hpp"
+#include "RawFile.hpp"
+
+namespace KCT::io {
+/**
+ * Open DEN file with the parsed header shared by all readers of the file within the process.
+ *
+ * Handles are obtained by DenFileHandle::open, which returns the existing handle when the same
+ * file, identified by device and inode, is already opened and its size and modification time did
+ * not change. Otherwise the header is parsed and the new handle is registered. Registry holds only
+ * weak references, the handle is closed when the last reader holding it is destroyed.
+ *
+ * The descriptor is read only and used by pread, so that the handle might be shared across
+ * threads.
+ */
+class DenFileHandle
+{
+public:
+    /**
+     * Get handle of the DEN file.
+     *
+     * @param fileName Path to the DEN file.
+     * @param directIO Open the file with O_DIRECT, handles with and without direct I/O are
+     * registered separately.
+     */
+    static std::shared_ptr<DenFileHandle> open(std::string fileName, bool directIO = false);
+
+    /**
+     * Number of alive handles in the registry, intended for diagnostics and tests.
+     */
+    static uint64_t registeredHandles();
+
+    const DenFileInfo& getInfo() const;
+    std::shared_ptr<RawFile> getRawFile() const;
+    /**
+     * Identity of the file at the time the handle was opened, used as the key of FrameCache.
+     */
+    FileIdentity getIdentity() const;
+    std::string getFileName() const;
+    uint64_t getOffset() const;
+    uint64_t getFrameSize() const;
+    uint64_t getFrameByteSize() const;
+    uint64_t getFrameCount() const;
+
+    /**
+     * Construct the handle, use open to share handles.
+     */
+    DenFileHandle(std::string fileName, bool directIO);
+    DenFileHandle(const DenFileHandle& b) = delete;
+    DenFileHandle& operator=(const DenFileHandle& b) = delete;
+
+private:
+    std::shared_ptr<RawFile> rawFile;
+    DenFileInfo info;
+    FileIdentity identity;
+};
+
+} // namespace KCT::io
@@ -3,13 +3,20 @@
 #include <plog/Log.h>
 
 // Standard libraries
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstring>
 #include <string>
+#include <vector>
 
 // Internal libraries
+#include "DEN/DenElementConversion.hpp"
 #include "DEN/DenNextElement.h"
+#include "DEN/DenStatistics.hpp"
 #include "DEN/DenSupportedType.hpp"
+#include "RawFile.hpp"
+#include "Transpose.hpp"
 #include "littleEndianAlignment.h"
 #include "rawop.h" //To get number of rows...
 
@@ -19,6 +26,10 @@ class DenFileInfo
 {
 public:
     DenFileInfo(std::string fileName, bool exceptInvalid = true);
+    /**
+     * Parse the header using already opened file, no additional open is performed.
+     */
+    DenFileInfo(const RawFile& rawFile, bool exceptInvalid = true);
     uint32_t dimx() const;
     uint32_t dimy() const;
     /**
@@ -56,6 +67,26 @@ public:
     uint64_t getOffset() const;
     DenSupportedType getElementType() const;
     uint16_t getElementByteSize() const;
+    /**
+     * Cost of one read request in the units of bytes transferred, used to decide whether the
+     * region of interest is read by one request per row or by one request spanning all its rows.
+     */
+    static constexpr uint64_t ROI_REQUEST_COST = 4096;
+    /**
+     * Compute min, max, sum, sum of squares, mean, variance, counts of non finite elements and
+     * optionally percentiles in a single parallel pass over the file. Prefer it to the getters
+     * below when more than one statistic is needed, each of them scans the whole file.
+     *
+     * @param opts Threads, percentiles and I/O options.
+     */
+    DenStatistics
+    computeStatistics(const DenStatisticsOptions& opts = DenStatisticsOptions()) const;
+    /**
+     * Getters of the individual statistics derived from computeStatistics with the legacy
+     * semantics. Max and min ignore NaN but not infinite elements, l2 square, mean and variance
+     * are taken over all elements, so that any non finite element makes them non finite. Mean and
+     * variance are truncated to T. Use computeStatistics for the statistics of finite elements.
+     */
     template <typename T>
     T getMaxVal() const;
     template <typename T>
@@ -131,20 +162,31 @@ public:
                                 uint16_t dimCount,
                                 uint32_t* dim,
                                 bool XMajorAlignment = true);
-    static void createEmptyLegacyDenFile(
-        std::string fileName, DenSupportedType dst, uint16_t dimx, uint16_t dimy, uint16_t dimz);
+    /**
+     * Creators of the DEN files filled with zeros, the header and the data are created using
+     * single open. See FileAllocation for the policies of allocating the data part, RESERVE is
+     * recommended for big outputs written out of order by many threads.
+     */
+    static void createEmptyLegacyDenFile(std::string fileName,
+                                         DenSupportedType dst,
+                                         uint16_t dimx,
+                                         uint16_t dimy,
+                                         uint16_t dimz,
+                                         FileAllocation allocation = FileAllocation::SPARSE);
     static void createEmpty3DDenFile(std::string fileName,
                                      DenSupportedType dst,
                                      uint32_t dimx,
                                      uint32_t dimy,
                                      uint32_t dimz,
-                                     bool XMajorAlignment = true);
+                                     bool XMajorAlignment = true,
+                                     FileAllocation allocation = FileAllocation::SPARSE);
 
     static void createEmptyDenFile(std::string fileName,
                                    DenSupportedType dst,
                                    uint16_t dimCount,
                                    uint32_t* dim,
-                                   bool XMajorAlignment = true);
+                                   bool XMajorAlignment = true,
+                                   FileAllocation allocation = FileAllocation::SPARSE);
 
     template <typename T>
     static void create3DDenFileFromArray(T* c_array,
@@ -184,71 +226,97 @@ private:
     uint64_t elementCount;
     uint64_t frameCount;
 
+    // Region of interest of the frame described in the order of the file, rows are contiguous
+    // runs of innerCount elements along the dimension that is stored first
+    struct RoiReadPlan
+    {
+        uint64_t innerFrom;
+        uint64_t innerCount;
+        uint64_t innerDim;
+        uint64_t outerFrom;
+        uint64_t outerCount;
+        // Issue one request per row instead of one request spanning all rows
+        bool perRow;
+        // Estimated cost in bytes of reading the region from one frame
+        uint64_t cost;
+    };
+
+    void parseHeader(const RawFile& rawFile, bool exceptInvalid);
+    // Validate the region, zero counts mean up to the end of the dimension
+    RoiReadPlan
+    planRoiRead(uint32_t x_from, uint32_t x_count, uint32_t y_from, uint32_t y_count) const;
+    // Read the region of the frame into tmpbuffer of frameByteSize bytes, returns the pointer
+    // to the first element and sets rowStride to the distance of rows in elements
+    const uint8_t* readRoi(const RawFile& rawFile,
+                           uint64_t flatZIndex,
+                           const RoiReadPlan& plan,
+                           uint8_t* tmpbuffer,
+                           uint64_t& rowStride) const;
     // If x can represent given dimension
     bool isAdmissibleDimension(uint32_t x, uint32_t dimID, bool canBeOfDimSize = false) const;
+    // Variants operating on already opened file handle to be called in loops over frames
+    template <typename T>
+    void writeBufferIntoFlatFrame(const RawFile& rawFile,
+                                  uint64_t flatZIndex,
+                                  T* bufferToWrite,
+                                  bool bufferXMajor,
+                                  uint8_t* tmpbuffer) const;
+    template <typename T>
+    void readFlatFrameIntoBuffer(const RawFile& rawFile,
+                                 uint64_t flatZIndex,
+                                 T* bufferToFill,
+                                 bool fillXMajor,
+                                 uint8_t* tmpbuffer,
+                                 uint32_t x_from,
+                                 uint32_t x_count,
+                                 uint32_t y_from,
+                                 uint32_t y_count) const;
+    // Convert frame bytes as stored in the file into bufferToFill
+    template <typename T>
+    void convertFlatFrame(uint8_t* tmpbuffer,
+                          T* bufferToFill,
+                          bool fillXMajor,
+                          uint32_t x_from,
+                          uint32_t x_count,
+                          uint32_t y_from,
+                          uint32_t y_count) const;
+    // Convert the region rows starting at src into bufferToFill
+    template <typename T>
+    void convertRoi(const uint8_t* src,
+                    uint64_t rowStride,
+                    T* bufferToFill,
+                    bool fillXMajor,
+                    const RoiReadPlan& plan) const;
 };
 
 template <typename T>
 T DenFileInfo::getMaxVal() const
 {
-    std::shared_ptr<std::ifstream> ifstream = std::make_shared<std::ifstream>();
-    ifstream->open(fileName,
-                   std::ios::binary | std::ios::in); // Open binary, for output, for input
-    uint64_t currentPosition;
-    T max = std::numeric_limits<T>::lowest();
-    uint8_t* buffer = new uint8_t[frameByteSize];
-    for(uint64_t k = 0; k != frameCount; k++)
+    DenStatistics stats = computeStatistics();
+    if(stats.posInfCount != 0)
     {
-        currentPosition = offset + k * frameByteSize;
-        io::readBytesFrom(ifstream, currentPosition, buffer, frameByteSize);
-        T val;
-        for(uint64_t pos = 0; pos != frameSize; pos++)
-        {
-            val = util::getNextElement<T>(&buffer[pos * elementByteSize], elementType);
-            if(val > max)
-            {
-                max = val;
-            }
-        }
+        return static_cast<T>(std::numeric_limits<double>::infinity());
     }
-    delete[] buffer;
-    if(ifstream != nullptr)
+    if(stats.count == 0)
     {
-        ifstream->close();
+        return std::numeric_limits<T>::lowest();
     }
-    return max;
+    return static_cast<T>(stats.max);
 }
 
 template <typename T>
 T DenFileInfo::getMinVal() const
 {
-    std::shared_ptr<std::ifstream> ifstream = std::make_shared<std::ifstream>();
-    ifstream->open(fileName,
-                   std::ios::binary | std::ios::out
-                       | std::ios::in); // Open binary, for output, for input
-    uint64_t currentPosition;
-    T min = std::numeric_limits<T>::max();
-    uint8_t* buffer = new uint8_t[frameByteSize];
-    for(uint64_t k = 0; k != frameCount; k++)
+    DenStatistics stats = computeStatistics();
+    if(stats.negInfCount != 0)
     {
-        currentPosition = offset + k * frameByteSize;
-        io::readBytesFrom(ifstream, currentPosition, buffer, frameByteSize);
-        T val;
-        for(uint64_t pos = 0; pos != frameSize; pos++)
-        {
-            val = util::getNextElement<T>(&buffer[pos * elementByteSize], elementType);
-            if(val < min)
-            {
-                min = val;
-            }
-        }
+        return static_cast<T>(-std::numeric_limits<double>::infinity());
     }
-    delete[] buffer;
-    if(ifstream != nullptr)
+    if(stats.count == 0)
     {
-        ifstream->close();
+        return std::numeric_limits<T>::max();
     }
-    return min;
+    return static_cast<T>(stats.min);
 }
 
 /**
@@ -259,73 +327,49 @@ T DenFileInfo::getMinVal() const
 template <typename T>
 double DenFileInfo::getl2Square() const
 {
-    std::shared_ptr<std::ifstream> ifstream = std::make_shared<std::ifstream>();
-    ifstream->open(fileName,
-                   std::ios::binary | std::ios::out
-                       | std::ios::in); // Open binary, for output, for input
-    uint64_t currentPosition;
-    uint8_t* buffer = new uint8_t[frameByteSize];
-    double sumSquares = 0.0;
-    for(uint64_t k = 0; k != frameCount; k++)
+    DenStatistics stats = computeStatistics();
+    if(stats.nanCount != 0)
     {
-        currentPosition = offset + k * frameByteSize;
-        io::readBytesFrom(ifstream, currentPosition, buffer, frameByteSize);
-        double val;
-        for(uint64_t pos = 0; pos != frameSize; pos++)
-        {
-            val = (double)util::getNextElement<T>(&buffer[pos * elementByteSize], elementType);
-            sumSquares += (val * val);
-        }
+        return std::numeric_limits<double>::quiet_NaN();
     }
-    delete[] buffer;
-    if(ifstream != nullptr)
+    if(stats.posInfCount + stats.negInfCount != 0)
     {
-        ifstream->close();
+        return std::numeric_limits<double>::infinity();
     }
-    return sumSquares;
+    return stats.sumSquares;
 }
 
 template <typename T>
 double DenFileInfo::getMean() const
 {
-    uint64_t currentPosition;
-    double sum = 0.0;
-    double val;
-    uint8_t* buffer = new uint8_t[frameByteSize];
-    for(uint64_t z = 0; z != frameCount; z++)
+    DenStatistics stats = computeStatistics();
+    if(stats.nanCount != 0 || (stats.posInfCount != 0 && stats.negInfCount != 0))
     {
-        currentPosition = offset + z * frameByteSize;
-        io::readBytesFrom(fileName, currentPosition, buffer, frameByteSize);
-        for(uint64_t pos = 0; pos != frameSize; pos++)
-        {
-            val = (double)util::getNextElement<T>(&buffer[pos * elementByteSize], elementType);
-            sum += val;
-        }
+        return T(std::numeric_limits<double>::quiet_NaN());
     }
-    delete[] buffer;
-    return T(sum / elementCount);
+    if(stats.posInfCount != 0)
+    {
+        return T(std::numeric_limits<double>::infinity());
+    }
+    if(stats.negInfCount != 0)
+    {
+        return T(-std::numeric_limits<double>::infinity());
+    }
+    return T(stats.sum / elementCount);
 }
 
 template <typename T>
 double DenFileInfo::getVariance() const
 {
-    uint64_t currentPosition;
-    double sum = 0.0;
-    double val;
-    double mean = (double)getMean<T>();
-    uint8_t* buffer = new uint8_t[frameByteSize];
-    for(uint64_t z = 0; z != frameCount; z++)
+    DenStatistics stats = computeStatistics();
+    if(stats.count != elementCount)
     {
-        currentPosition = offset + z * frameByteSize;
-        io::readBytesFrom(fileName, currentPosition, buffer, frameByteSize);
-        for(uint64_t pos = 0; pos != frameSize; pos++)
-        {
-            val = (double)util::getNextElement<T>(&buffer[pos * elementByteSize], elementType);
-            sum += (val - mean) * (val - mean);
-        }
+        // Deviations from the non finite mean are not finite
+        return T(std::numeric_limits<double>::quiet_NaN());
     }
-    delete[] buffer;
-    return T(sum / elementCount);
+    // Deviations are taken from the mean truncated to T as getMean returns it
+    double shift = stats.mean - double(T(stats.mean));
+    return T(stats.variance + shift * shift);
 }
 
 template <typename T>
@@ -333,43 +377,39 @@ void DenFileInfo::writeBufferIntoFlatFrame(uint64_t flatZIndex,
                                            T* bufferToWrite,
                                            bool bufferXMajor,
                                            uint8_t* tmpbuffer) const
+{
+    RawFile rawFile(this->fileName, true);
+    writeBufferIntoFlatFrame<T>(rawFile, flatZIndex, bufferToWrite, bufferXMajor, tmpbuffer);
+}
+
+template <typename T>
+void DenFileInfo::writeBufferIntoFlatFrame(const RawFile& rawFile,
+                                           uint64_t flatZIndex,
+                                           T* bufferToWrite,
+                                           bool bufferXMajor,
+                                           uint8_t* tmpbuffer) const
 {
     uint64_t position = this->offset + flatZIndex * frameByteSize;
     if(bufferXMajor == this->XMajorAlignment)
     {
-        for(uint64_t a = 0; a != frameSize; a++)
-        {
-            util::setNextElement<T>(bufferToWrite[a], &tmpbuffer[a * elementByteSize]);
-        }
+        util::storeElements<T>(bufferToWrite, elementType, tmpbuffer, frameSize);
     } else
     {
-        uint64_t innerIndex, outerIndex;
-        uint64_t _dimx = dimx();
-        uint64_t _dimy = dimy();
-        for(uint64_t x = 0; x != _dimx; x++)
+        // Buffer stored XMajor is the matrix of dimy rows and dimx columns
+        uint64_t rows = bufferXMajor ? dimy() : dimx();
+        uint64_t cols = bufferXMajor ? dimx() : dimy();
+        if(getDenSupportedTypeByTypeID(typeid(T)) == elementType)
         {
-            for(uint64_t y = 0; y != _dimy; y++)
-            {
-                if(this->XMajorAlignment)
-                {
-                    innerIndex = x + _dimx * y;
-                } else
-                {
-                    innerIndex = y + _dimy * x;
-                }
-                if(bufferXMajor)
-                {
-                    outerIndex = x + _dimx * y;
-                } else
-                {
-                    outerIndex = y + _dimy * x;
-                }
-                util::setNextElement<T>(bufferToWrite[outerIndex],
-                                        &tmpbuffer[innerIndex * elementByteSize]);
-            }
+            transposeElements(bufferToWrite, cols, tmpbuffer, rows, rows, cols, sizeof(T));
+            util::convertByteOrderInPlace(tmpbuffer, sizeof(T), frameSize);
+        } else
+        {
+            T* transposed = reinterpret_cast<T*>(threadTransposeBuffer(frameSize * sizeof(T)));
+            transposeElements(bufferToWrite, cols, transposed, rows, rows, cols, sizeof(T));
+            util::storeElements<T>(transposed, elementType, tmpbuffer, frameSize);
         }
     }
-    io::writeBytesFrom(this->fileName, position, tmpbuffer, frameByteSize);
+    rawFile.writeBytesFrom(position, tmpbuffer, frameByteSize);
 }
 
 template <typename T>
@@ -381,6 +421,22 @@ void DenFileInfo::readFlatFrameIntoBuffer(uint64_t flatZIndex,
                                           uint32_t x_count,
                                           uint32_t y_from,
                                           uint32_t y_count) const
+{
+    RawFile rawFile(this->fileName);
+    readFlatFrameIntoBuffer<T>(rawFile, flatZIndex, bufferToFill, fillXMajor, tmpbuffer, x_from,
+                               x_count, y_from, y_count);
+}
+
+template <typename T>
+void DenFileInfo::readFlatFrameIntoBuffer(const RawFile& rawFile,
+                                          uint64_t flatZIndex,
+                                          T* bufferToFill,
+                                          bool fillXMajor,
+                                          uint8_t* tmpbuffer,
+                                          uint32_t x_from,
+                                          uint32_t x_count,
+                                          uint32_t y_from,
+                                          uint32_t y_count) const
 {
     std::string ERR;
     if(getDenSupportedTypeByTypeID(typeid(T)) != elementType)
@@ -395,66 +451,69 @@ void DenFileInfo::readFlatFrameIntoBuffer(uint64_t flatZIndex,
                           dimCount);
         KCTERR(ERR);
     }
-    uint64_t position = this->offset + flatZIndex * frameByteSize;
-    io::readBytesFrom(this->fileName, position, tmpbuffer, frameByteSize);
-    if(fillXMajor == this->XMajorAlignment && x_from == 0 && (x_count == 0 || x_count == _dim[0])
-       && y_from == 0 && (y_count == 0 || y_count == _dim[1]))
+    if(x_from == 0 && (x_count == 0 || x_count == _dim[0]) && y_from == 0
+       && (y_count == 0 || y_count == _dim[1]))
     {
-        for(uint64_t a = 0; a != frameSize; a++)
-        {
-            bufferToFill[a] = util::getNextElement<T>(&tmpbuffer[a * elementByteSize], elementType);
-        }
-    } else
+        uint64_t position = this->offset + flatZIndex * frameByteSize;
+        rawFile.readBytesFrom(position, tmpbuffer, frameByteSize);
+        convertFlatFrame<T>(tmpbuffer, bufferToFill, fillXMajor, x_from, x_count, y_from,
+                            y_count);
+        return;
+    }
+    // Only the byte ranges of the region are read
+    RoiReadPlan plan = planRoiRead(x_from, x_count, y_from, y_count);
+    uint64_t rowStride;
+    const uint8_t* src = readRoi(rawFile, flatZIndex, plan, tmpbuffer, rowStride);
+    convertRoi<T>(src, rowStride, bufferToFill, fillXMajor, plan);
+}
+
+template <typename T>
+void DenFileInfo::convertFlatFrame(uint8_t* tmpbuffer,
+                                   T* bufferToFill,
+                                   bool fillXMajor,
+                                   uint32_t x_from,
+                                   uint32_t x_count,
+                                   uint32_t y_from,
+                                   uint32_t y_count) const
+{
+    RoiReadPlan plan = planRoiRead(x_from, x_count, y_from, y_count);
+    const uint8_t* src
+        = tmpbuffer + (plan.innerFrom + plan.outerFrom * plan.innerDim) * elementByteSize;
+    convertRoi<T>(src, plan.innerDim, bufferToFill, fillXMajor, plan);
+}
+
+template <typename T>
+void DenFileInfo::convertRoi(const uint8_t* src,
+                             uint64_t rowStride,
+                             T* bufferToFill,
+                             bool fillXMajor,
+                             const RoiReadPlan& plan) const
+{
+    // Type of T matches the type of the file, only the byte order might differ
+    const uint64_t innerCount = plan.innerCount;
+    const uint64_t outerCount = plan.outerCount;
+    const uint64_t rowBytes = rowStride * sizeof(T);
+    if(fillXMajor == this->XMajorAlignment)
     {
-        bool admissibleDimensions = true;
-        admissibleDimensions &= isAdmissibleDimension(x_from, 0);
-        admissibleDimensions &= isAdmissibleDimension(y_from, 1);
-        if(x_count == 0)
+        if(rowStride == innerCount)
         {
-            x_count = _dim[0] - x_from;
-        }
-        if(y_count == 0)
-        {
-            y_count = _dim[1] - y_from;
-        }
-        admissibleDimensions &= isAdmissibleDimension(x_from + x_count, 0, true);
-        admissibleDimensions &= isAdmissibleDimension(y_from + y_count, 1, true);
-        if(!admissibleDimensions)
+            // Rows are adjacent both in the source and in the target
+            std::memcpy(bufferToFill, src, innerCount * outerCount * sizeof(T));
+        } else
         {
-            ERR = io::xprintf("File %s wrong dimensions specified.", fileName.c_str());
-            KCTERR(ERR);
-        }
-        uint64_t innerIndex, outerIndex;
-        uint64_t _dimx = _dim[0];
-        uint64_t _dimy = _dim[1];
-        uint64_t x_to = x_from + x_count;
-        uint64_t y_to = y_from + y_count;
-        int i, j;
-        for(uint64_t x = x_from; x != x_to; x++)
-        {
-            i = x - x_from;
-            for(uint64_t y = y_from; y != y_to; y++)
+            for(uint64_t o = 0; o != outerCount; o++)
             {
-                j = y - y_from;
-                if(this->XMajorAlignment)
-                {
-                    innerIndex = x + _dimx * y;
-                } else
-                {
-                    innerIndex = y + _dimy * x;
-                }
-                if(fillXMajor)
-                {
-                    outerIndex = i + x_count * j;
-                } else
-                {
-                    outerIndex = j + y_count * i;
-                }
-                bufferToFill[outerIndex] = util::getNextElement<T>(
-                    &tmpbuffer[innerIndex * elementByteSize], elementType);
+                std::memcpy(bufferToFill + o * innerCount, src + o * rowBytes,
+                            innerCount * sizeof(T));
             }
         }
+    } else
+    {
+        transposeElements(src, rowStride, bufferToFill, outerCount, outerCount, innerCount,
+                          sizeof(T));
     }
+    util::convertByteOrderInPlace(reinterpret_cast<uint8_t*>(bufferToFill), sizeof(T),
+                                  innerCount * outerCount);
 }
 
 template <typename T>
@@ -497,15 +556,56 @@ void DenFileInfo::readIntoArray(T* c_array,
         std::string ERR = io::xprintf("File %s wrong dimensions specified.", fileName.c_str());
         KCTERR(ERR);
     }
-    uint8_t* tmpbuffer = new uint8_t[frameByteSize];
-    uint64_t IND;
+    if(getDenSupportedTypeByTypeID(typeid(T)) != elementType)
+    {
+        std::string ERR
+            = io::xprintf("File %s has incompatible type, need to fill buffer of %s.",
+                          fileName.c_str(), DenSupportedTypeToString(elementType).c_str());
+        KCTERR(ERR);
+    }
     uint64_t arrayFrameSize = static_cast<uint64_t>(x_count) * static_cast<uint64_t>(y_count);
     uint64_t z_to = z_from + z_count;
-    for(uint64_t k = z_from; k != z_to; k++)
+    RawFile rawFile(this->fileName);
+    int num = 1;
+    bool littleEndianArchitecture = (*(char*)&num == 1);
+    if(littleEndianArchitecture && c_array_xmajor == this->XMajorAlignment && x_from == 0
+       && x_count == _dim[0] && y_from == 0 && y_count == _dim[1])
+    {
+        // Whole frames in the file order, single sequential read into the array
+        rawFile.readBytesFrom(this->offset + z_from * frameByteSize, (uint8_t*)c_array,
+                              z_count * frameByteSize);
+        return;
+    }
+    RoiReadPlan plan = planRoiRead(x_from, x_count, y_from, y_count);
+    if(plan.cost < frameByteSize)
     {
-        IND = k - z_from;
-        this->readFlatFrameIntoBuffer(k, c_array + IND * arrayFrameSize, c_array_xmajor, tmpbuffer,
+        // Small region, read only its byte ranges frame by frame
+        uint8_t* tmpbuffer = new uint8_t[frameByteSize];
+        uint64_t rowStride;
+        for(uint64_t k = z_from; k != z_to; k++)
+        {
+            const uint8_t* src = readRoi(rawFile, k, plan, tmpbuffer, rowStride);
+            convertRoi<T>(src, rowStride, c_array + (k - z_from) * arrayFrameSize,
+                          c_array_xmajor, plan);
+        }
+        delete[] tmpbuffer;
+        return;
+    }
+    // Read multiple consecutive frames at once and convert them
+    const uint64_t maxChunkBytes = 64 * 1024 * 1024;
+    uint64_t chunkFrames = std::max(maxChunkBytes / frameByteSize, (uint64_t)1);
+    chunkFrames = std::min(chunkFrames, std::max((uint64_t)z_count, (uint64_t)1));
+    uint8_t* tmpbuffer = new uint8_t[chunkFrames * frameByteSize];
+    for(uint64_t k = z_from; k < z_to; k += chunkFrames)
+    {
+        uint64_t n = std::min(chunkFrames, z_to - k);
+        rawFile.readBytesFrom(this->offset + k * frameByteSize, tmpbuffer, n * frameByteSize);
+        for(uint64_t f = 0; f != n; f++)
+        {
+            this->convertFlatFrame<T>(tmpbuffer + f * frameByteSize,
+                                      c_array + (k + f - z_from) * arrayFrameSize, c_array_xmajor,
                                       x_from, x_count, y_from, y_count);
+        }
     }
     delete[] tmpbuffer;
 }
@@ -548,9 +648,11 @@ void DenFileInfo::createDenFileFromArray(T* c_array,
     uint64_t frameCount = fileInfo.getFrameCount();
     uint64_t frameSize = fileInfo.getFrameSize();
     uint8_t* tmpbuffer = new uint8_t[frameByteSize];
+    RawFile rawFile(fileName, true);
     for(uint64_t k = 0; k != frameCount; k++)
     {
-        fileInfo.writeBufferIntoFlatFrame(k, c_array + k * frameSize, c_array_xmajor, tmpbuffer);
+        fileInfo.writeBufferIntoFlatFrame<T>(rawFile, k, c_array + k * frameSize, c_array_xmajor,
+                                             tmpbuffer);
     }
     delete[] tmpbuffer;
 }
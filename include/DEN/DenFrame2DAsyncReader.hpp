@@ -0,0 +1,353 @@
+#pragma once
+
+// External
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+// Internal
+#include "DEN/DenFrame2DReader.hpp"
+#include "IoUring.hpp"
+#include "PROG/ThreadPool.hpp"
+
+namespace KCT::io {
+
+/**
+ * Engine used by DenFrame2DAsyncReader to perform asynchronous reads.
+ */
+enum class AsyncReadEngine { AUTO, IO_URING, THREAD_POOL };
+
+/**
+ * Reader of DEN frames that in addition to the synchronous Frame2DReaderI interface allows to keep
+ * many frame reads in flight from one thread.
+ *
+ * Reads are submitted by submitRead, completed reads are reaped by poll and waitAll. When io_uring
+ * is available, all requests are served by one ring, otherwise the requests are emulated by the
+ * pool of threads issuing synchronous reads. The synchronous methods inherited from
+ * DenFrame2DReader are thread safe, the asynchronous methods submitRead, poll and waitAll shall be
+ * called from a single thread.
+ */
+template <typename T>
+class DenFrame2DAsyncReader : public DenFrame2DReader<T>
+{
+public:
+    /**
+     * Constructs DenFrame2DAsyncReader from file name.
+     *
+     * @param denFile File in a DEN format to read by frames.
+     * @param queueDepth Maximum number of frame reads in flight.
+     * @param engine Engine to use, AUTO selects io_uring when available.
+     */
+    DenFrame2DAsyncReader(std::string denFile,
+                          uint32_t queueDepth = 64,
+                          AsyncReadEngine engine = AsyncReadEngine::AUTO);
+    ~DenFrame2DAsyncReader();
+
+    /**
+     * Submit read of the frame k into the dst buffer of frameSize elements in X major alignment.
+     *
+     * The buffer must stay valid until the read is reported complete by poll or waitAll. When
+     * queueDepth reads are in flight, blocks until one of them completes, reads completed while
+     * blocking are reported by the next poll or waitAll.
+     *
+     * @param k Index of the frame.
+     * @param dst Buffer to fill.
+     */
+    void submitRead(uint64_t k, T* dst);
+
+    /**
+     * Reap completed reads without blocking.
+     *
+     * @return Number of reads completed by this call.
+     */
+    uint32_t poll();
+
+    /**
+     * Block until all submitted reads are completed.
+     *
+     * @return Number of reads completed by this call.
+     */
+    uint32_t waitAll();
+
+    /**
+     * @return Number of submitted reads that were not reaped yet.
+     */
+    uint32_t inFlight() const;
+
+    /**
+     * @return Engine that is used, never AUTO.
+     */
+    AsyncReadEngine getEngine() const;
+
+private:
+    struct Request
+    {
+        uint64_t k;
+        T* dst;
+        std::vector<uint8_t> staging;
+        struct iovec iov;
+        uint64_t position;
+        uint64_t done;
+    };
+    uint32_t queueDepth;
+    AsyncReadEngine engine;
+    std::unique_ptr<IoUring> ring;
+    std::vector<Request> requests;
+    std::vector<uint32_t> freeRequests;
+    std::unique_ptr<ThreadPool<>> pool;
+    std::vector<std::future<void>> futures;
+    // Reads reaped by submitRead that were not reported by poll or waitAll yet
+    uint32_t unreported = 0;
+    void prepareRequest(uint32_t id);
+    uint32_t reapRing(bool blocking);
+    uint32_t reapFutures(bool blocking);
+};
+
+template <typename T>
+DenFrame2DAsyncReader<T>::DenFrame2DAsyncReader(std::string denFile,
+                                                uint32_t queueDepth,
+                                                AsyncReadEngine engine)
+    : DenFrame2DReader<T>(denFile)
+    , queueDepth(std::max(queueDepth, 1u))
+    , engine(engine)
+{
+    if(engine != AsyncReadEngine::THREAD_POOL)
+    {
+        try
+        {
+            ring = std::make_unique<IoUring>(this->queueDepth);
+            this->engine = AsyncReadEngine::IO_URING;
+        } catch(const util::KCTException& e)
+        {
+            if(engine == AsyncReadEngine::IO_URING)
+            {
+                throw;
+            }
+            LOGI << io::xprintf("io_uring is not available, emulating asynchronous reads of %s by "
+                                "the pool of threads.",
+                                denFile.c_str());
+            ring = nullptr;
+        }
+    }
+    if(ring)
+    {
+        requests.resize(this->queueDepth);
+        for(uint32_t i = 0; i != this->queueDepth; i++)
+        {
+            freeRequests.push_back(this->queueDepth - 1 - i);
+        }
+    } else
+    {
+        this->engine = AsyncReadEngine::THREAD_POOL;
+        uint32_t threads = std::min(this->queueDepth, 32u);
+        pool = std::make_unique<ThreadPool<>>(threads);
+    }
+}
+
+template <typename T>
+DenFrame2DAsyncReader<T>::~DenFrame2DAsyncReader()
+{
+    // Buffers of outstanding reads might be owned by the caller, do not leave kernel or threads
+    // writing into them after the object is destroyed.
+    // waitAll stops at the first failed read, repeat until nothing is left in flight.
+    while(inFlight() > 0)
+    {
+        try
+        {
+            waitAll();
+        } catch(const std::exception& e)
+        {
+            LOGE << e.what();
+        }
+    }
+}
+
+template <typename T>
+void DenFrame2DAsyncReader<T>::prepareRequest(uint32_t id)
+{
+    Request& r = requests[id];
+    uint8_t* target = r.staging.empty() ? (uint8_t*)r.dst : r.staging.data();
+    r.iov.iov_base = target + r.done;
+    r.iov.iov_len = this->frameByteSize - r.done;
+    if(!ring->prepareReadv(this->rawFile->getFileDescriptor(), &r.iov, r.position + r.done, id))
+    {
+        // Can not happen as the number of requests is bounded by the ring size
+        KCTERR("io_uring submission queue is full.");
+    }
+}
+
+template <typename T>
+void DenFrame2DAsyncReader<T>::submitRead(uint64_t k, T* dst)
+{
+    if(k >= this->frameCount)
+    {
+        KCTERR(io::xprintf("Frame %lu out of range of %lu frames in %s.", k, this->frameCount,
+                           this->denFile.c_str()));
+    }
+    if(!ring)
+    {
+        // Bound the reads in flight as the ring does by the number of requests
+        while(futures.size() >= queueDepth)
+        {
+            uint32_t completed = reapFutures(false);
+            if(completed == 0)
+            {
+                futures.front().wait();
+            }
+            unreported += completed;
+        }
+        futures.emplace_back(pool->submit(
+            [this, k, dst](std::shared_ptr<typename ThreadPool<>::ThreadInfo>) {
+                this->readFrameIntoBuffer(k, dst, true);
+            }));
+        return;
+    }
+    while(freeRequests.empty())
+    {
+        unreported += reapRing(true);
+    }
+    uint32_t id = freeRequests.back();
+    freeRequests.pop_back();
+    Request& r = requests[id];
+    r.k = k;
+    r.dst = dst;
+    r.position = this->offset + k * this->frameByteSize;
+    r.done = 0;
+    if(this->isDirectReadable(true))
+    {
+        r.staging.clear();
+    } else
+    {
+        r.staging.resize(this->frameByteSize);
+    }
+    prepareRequest(id);
+    ring->submit();
+}
+
+template <typename T>
+uint32_t DenFrame2DAsyncReader<T>::reapRing(bool blocking)
+{
+    uint32_t completed = 0;
+    uint64_t userData;
+    int32_t result;
+    // The first failure is reported after the completion queue is drained, so that no completed
+    // request is left unreaped
+    std::string ERR;
+    bool have = blocking ? (ring->waitCompletion(userData, result), true)
+                         : ring->peekCompletion(userData, result);
+    while(have)
+    {
+        uint32_t id = (uint32_t)userData;
+        Request& r = requests[id];
+        if(result <= 0)
+        {
+            freeRequests.push_back(id);
+            if(ERR.empty())
+            {
+                ERR = io::xprintf("Asynchronous read of frame %lu from %s failed, %s.", r.k,
+                                  this->denFile.c_str(),
+                                  result == 0 ? "unexpected end of file" : strerror(-result));
+            }
+            have = ring->peekCompletion(userData, result);
+            continue;
+        }
+        r.done += result;
+        if(r.done < this->frameByteSize)
+        {
+            // Short read, resubmit the rest
+            prepareRequest(id);
+            ring->submit();
+        } else
+        {
+            if(!r.staging.empty())
+            {
+                this->convertRawFrame(r.staging.data(), r.dst, true);
+            }
+            freeRequests.push_back(id);
+            completed++;
+        }
+        have = ring->peekCompletion(userData, result);
+    }
+    if(!ERR.empty())
+    {
+        KCTERR(ERR);
+    }
+    return completed;
+}
+
+template <typename T>
+uint32_t DenFrame2DAsyncReader<T>::reapFutures(bool blocking)
+{
+    uint32_t completed = 0;
+    auto it = futures.begin();
+    while(it != futures.end())
+    {
+        if(blocking || it->wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            std::future<void> f = std::move(*it);
+            it = futures.erase(it);
+            f.get(); // Propagates exceptions of the read
+            completed++;
+        } else
+        {
+            ++it;
+        }
+    }
+    return completed;
+}
+
+template <typename T>
+uint32_t DenFrame2DAsyncReader<T>::poll()
+{
+    uint32_t completed = unreported;
+    unreported = 0;
+    if(ring)
+    {
+        completed += reapRing(false);
+    } else
+    {
+        completed += reapFutures(false);
+    }
+    return completed;
+}
+
+template <typename T>
+uint32_t DenFrame2DAsyncReader<T>::waitAll()
+{
+    uint32_t completed = unreported;
+    unreported = 0;
+    if(ring)
+    {
+        while(inFlight() > 0)
+        {
+            completed += reapRing(true);
+        }
+    } else
+    {
+        completed += reapFutures(true);
+    }
+    return completed;
+}
+
+template <typename T>
+uint32_t DenFrame2DAsyncReader<T>::inFlight() const
+{
+    if(ring)
+    {
+        return queueDepth - freeRequests.size();
+    } else
+    {
+        return futures.size();
+    }
+}
+
+template <typename T>
+AsyncReadEngine DenFrame2DAsyncReader<T>::getEngine() const
+{
+    return engine;
+}
+
+} // namespace KCT::io
@@ -2,20 +2,36 @@
 
 // External
 #include <algorithm>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <string>
+#include <vector>
 
 // Internal
 #include "BufferedFrame2D.hpp"
+#include "DEN/DenElementConversion.hpp"
+#include "DEN/DenFileHandle.hpp"
 #include "DEN/DenFileInfo.hpp"
 #include "Frame2DI.hpp"
 #include "Frame2DReaderI.hpp"
+#include "FrameCache.hpp"
+#include "FramePool.hpp"
+#include "RawFile.hpp"
+#include "ShardedCache.hpp"
+#include "Transpose.hpp"
 
 namespace KCT::io {
 /**
  * Thread safe implementation of the ProjectionReader for projections and projection matrices stored
  * in the den files.
+ *
+ * Frames are kept in the ShardedCache with the budget in bytes and the selected replacement
+ * policy, so that many threads reading frames do not serialize on a single lock. Frames returned
+ * by readFrame stay valid after eviction.
+ *
+ * Readers of the same file created in different threads keep separate caches. To share one copy
+ * of each frame among them, construct the readers with zero budget and call setSharedCache, then
+ * all reads are served from the process wide FrameCache.
  */
 template <typename T>
 class DenFrame2DCachedReader : virtual public Frame2DReaderI<T>
@@ -28,13 +44,42 @@ public:
      *
      * @param denFile
      * @param denFile File in a DEN format to read by frames.
-     * @param additionalBufferNum Number of additional buffers to allocate. Defaults to 0 for 1
-     * default buffer.
+     * @param additionalBufferNum Ignored, kept for compatibility. Conversion buffers are thread
+     * local, see threadScratchBuffer.
      * @param cache_size Store cache_size frames in memory
      */
     DenFrame2DCachedReader(std::string denFile,
                            uint32_t additionalBufferNum = 0,
                            uint32_t cache_size = 0);
+    /**Constructs DenFrame2DCachedReader from the shared handle, the header is not parsed again.
+     *
+     * @param handle Handle obtained by DenFileHandle::open.
+     * @param additionalBufferNum Ignored, kept for compatibility.
+     * @param cache_size Store cache_size frames in memory
+     */
+    DenFrame2DCachedReader(std::shared_ptr<DenFileHandle> handle,
+                           uint32_t additionalBufferNum = 0,
+                           uint32_t cache_size = 0);
+    /**Constructs DenFrame2DCachedReader with the cache budget in bytes.
+     *
+     * @param denFile File in a DEN format to read by frames.
+     * @param cacheBytes Maximum number of bytes of cached frames.
+     * @param policy Replacement policy of the cache.
+     * @param additionalBufferNum Ignored, kept for compatibility.
+     * @param shardCount Number of independently locked cache shards, 0 selects it from the number
+     * of frames fitting into the budget. Each shard holds cacheBytes / shardCount bytes, the count
+     * is clamped so that each shard holds at least one frame.
+     */
+    DenFrame2DCachedReader(std::string denFile,
+                           uint64_t cacheBytes,
+                           CachePolicy policy,
+                           uint32_t additionalBufferNum = 0,
+                           uint32_t shardCount = 0);
+    DenFrame2DCachedReader(std::shared_ptr<DenFileHandle> handle,
+                           uint64_t cacheBytes,
+                           CachePolicy policy,
+                           uint32_t additionalBufferNum = 0,
+                           uint32_t shardCount = 0);
     /// Destructor
     ~DenFrame2DCachedReader();
     /// Copy constructor
@@ -51,7 +96,18 @@ public:
                              T* outside_buffer,
                              bool XMajorAlignment = true) override;
     /**
-     * Populate cache by frameCount frames.
+     * Frame from the process wide FrameCache shared by all readers of the same file.
+     */
+    std::shared_ptr<const io::BufferedFrame2DI<T>> readSharedFrame(uint64_t k) override;
+    /**
+     * Serve readFrame, readBufferedFrame and readFrameIntoBuffer from the process wide FrameCache
+     * instead of the cache of this reader, frames returned by readBufferedFrame are then copies.
+     * As with the cache of this reader, readFrameIntoBuffer copies the cached frames but does not
+     * insert the frames it reads.
+     */
+    void setSharedCache(bool useSharedCache);
+    /**
+     * Populate cache by frameCount frames, at most the number of frames fitting into the budget.
      *
      * @param fromID Index to start populating cache.
      * @param frameCount Number of frames to put into the cache.
@@ -65,6 +121,17 @@ public:
     std::string getFileName() const;
     /**Returns file name of the underlying DEN file.**/
     DenSupportedType getDataType() const;
+    /**Hits, misses and evictions of the frame cache.**/
+    CacheStatistics getCacheStatistics() const;
+    CachePolicy getCachePolicy() const;
+    uint64_t getCacheBytes() const;
+    /**
+     * Borrow the memory of the cached frames and of the frames returned by readBufferedFrame from
+     * the pool, evicted frames return their memory to the pool. The buffers of the pool must hold
+     * at least getFrameSize() elements, nullptr restores allocation per frame.
+     */
+    void setFramePool(std::shared_ptr<FramePool<T>> pool);
+    std::shared_ptr<FramePool<T>> getFramePool() const;
 
 protected:
     // protected: // Visible in inheritance structure
@@ -77,19 +144,23 @@ protected:
     uint64_t frameCount;
     DenSupportedType dataType;
     uint64_t elementByteSize;
+    // Descriptor held for the whole lifetime of the reader, pread is used so it is thread safe
+    std::shared_ptr<DenFileHandle> fileHandle;
+    std::shared_ptr<RawFile> rawFile;
+    std::shared_ptr<FramePool<T>> framePool;
 
 private:
-    mutable std::mutex* consistencyMutexes;
-    mutable std::mutex cacheConsistencyMutex;
-    uint8_t** buffers;
-    std::vector<std::shared_ptr<BufferedFrame2DI<T>>> cache;
-    std::queue<uint32_t> cachedFramesQueue;
-    uint32_t bufferCount;
-    uint32_t cacheSize;
+    uint64_t cacheBytes;
+    CachePolicy cachePolicy;
+    // Size of the cached BufferedFrame2D
+    uint64_t cachedFrameBytes;
+    std::unique_ptr<ShardedCache<uint64_t, std::shared_ptr<BufferedFrame2DI<T>>>> cache;
+    bool useSharedCache = false;
     bool littleEndianArchitecture;
     bool elementTypeMatches;
     void initialize();
-    void frameToCache(uint32_t k, std::shared_ptr<BufferedFrame2DI<T>> f);
+    FrameCacheKey sharedCacheKey(uint64_t k) const;
+    void readFromFile(uint64_t k, T* outside_buffer, bool XMajorAlignment);
 };
 
 template <typename T>
@@ -103,12 +174,47 @@ template <typename T>
 DenFrame2DCachedReader<T>::DenFrame2DCachedReader(std::string denFile,
                                                   uint32_t additionalBufferNum,
                                                   uint32_t cacheSize)
-    : denFile(denFile)
-    , bufferCount(additionalBufferNum + 1)
-    , cacheSize(cacheSize)
+    : DenFrame2DCachedReader(DenFileHandle::open(denFile), additionalBufferNum, cacheSize)
+{
+}
+
+template <typename T>
+DenFrame2DCachedReader<T>::DenFrame2DCachedReader(std::shared_ptr<DenFileHandle> handle,
+                                                  uint32_t additionalBufferNum,
+                                                  uint32_t cacheSize)
+    : DenFrame2DCachedReader(handle,
+                             std::min<uint64_t>(cacheSize, handle->getFrameCount())
+                                 * handle->getFrameSize() * sizeof(T),
+                             CachePolicy::LRU,
+                             additionalBufferNum)
+{
+}
+
+template <typename T>
+DenFrame2DCachedReader<T>::DenFrame2DCachedReader(std::string denFile,
+                                                  uint64_t cacheBytes,
+                                                  CachePolicy policy,
+                                                  uint32_t additionalBufferNum,
+                                                  uint32_t shardCount)
+    : DenFrame2DCachedReader(
+        DenFileHandle::open(denFile), cacheBytes, policy, additionalBufferNum, shardCount)
+{
+}
+
+template <typename T>
+DenFrame2DCachedReader<T>::DenFrame2DCachedReader(std::shared_ptr<DenFileHandle> handle,
+                                                  uint64_t cacheBytes,
+                                                  CachePolicy policy,
+                                                  uint32_t additionalBufferNum,
+                                                  uint32_t shardCount)
+    : denFile(handle->getFileName())
+    , fileHandle(handle)
+    , cacheBytes(cacheBytes)
+    , cachePolicy(policy)
 {
     std::string ERR;
-    DenFileInfo pi = DenFileInfo(this->denFile);
+    const DenFileInfo& pi = fileHandle->getInfo();
+    this->rawFile = fileHandle->getRawFile();
     this->dataType = pi.getElementType();
     DenSupportedType readerDataType = getDenSupportedTypeByTypeID(typeid(T));
     if(dataType != readerDataType)
@@ -130,48 +236,35 @@ DenFrame2DCachedReader<T>::DenFrame2DCachedReader(std::string denFile,
     this->frameSize = pi.getFrameSize();
     this->frameByteSize = pi.getFrameByteSize();
     this->XMajorAlignment = pi.hasXMajorAlignment();
-    this->consistencyMutexes = new std::mutex[bufferCount];
-    this->buffers = new uint8_t*[bufferCount];
-    if(this->cacheSize > this->frameCount)
-    {
-        this->cacheSize = this->frameCount;
-    }
-    this->cache.resize(this->frameCount, nullptr); // Initialized by nullptrs
-    for(uint32_t i = 0; i != bufferCount; i++)
+    this->cachedFrameBytes = std::max<uint64_t>(frameSize * sizeof(T), 1);
+    uint64_t cacheFrames = std::min(cacheBytes / cachedFrameBytes, frameCount);
+    if(cacheFrames > 0)
     {
-        this->buffers[i] = new uint8_t[frameByteSize];
-    }
-    // Buffers are used for the alocation of new frames. Since this class uses the
-    // instance that copies memory, this memory might me reused.
-    initialize();
-}
-
-// This mumbo jumbo is for correctly deleting object after move assignment operation was
-// performed to be able to delete such object with stealed internals where its buffers are
-// nullptr.
-template <typename T>
-DenFrame2DCachedReader<T>::~DenFrame2DCachedReader()
-{
-    if(consistencyMutexes != nullptr)
-    {
-        delete[] consistencyMutexes;
-    }
-    consistencyMutexes = nullptr;
-    if(buffers != nullptr)
-    {
-        for(uint32_t i = 0; i != bufferCount; i++)
+        if(shardCount == 0)
         {
-            if(buffers[i] != nullptr)
+            // At least 4 frames per shard, prefer divisors so that no budget is lost to rounding
+            shardCount = std::max<uint64_t>(std::min<uint64_t>(cacheFrames / 4, 64), 1);
+            while(cacheFrames % shardCount != 0)
             {
-                delete buffers[i];
+                shardCount--;
             }
-            buffers[i] = nullptr;
+        } else if(shardCount > cacheFrames)
+        {
+            // Each shard must hold at least one frame, otherwise no frame is ever cached
+            LOGW << io::xprintf("Cache of %lu frames of the file %s can not be split into %u "
+                                "shards, using %lu shards.",
+                                cacheFrames, denFile.c_str(), shardCount, cacheFrames);
+            shardCount = cacheFrames;
         }
-        delete[] buffers;
+        cache = std::make_unique<ShardedCache<uint64_t, std::shared_ptr<BufferedFrame2DI<T>>>>(
+            cacheFrames * cachedFrameBytes, policy, shardCount);
     }
-    buffers = nullptr;
+    initialize();
 }
 
+template <typename T>
+DenFrame2DCachedReader<T>::~DenFrame2DCachedReader() = default;
+
 template <typename T>
 std::string DenFrame2DCachedReader<T>::getFileName() const
 {
@@ -186,12 +279,15 @@ void DenFrame2DCachedReader<T>::fillCache(uint32_t fromID, uint32_t n)
         LOGW << io::xprintf("fromID=%d is greater or equal than frameCount=%d", fromID, frameCount);
         return;
     }
-    if(cacheSize != 0)
+    if(cache != nullptr)
     {
-        if(n < cacheSize)
+        uint64_t capacity = cache->getByteBudget() / cachedFrameBytes;
+        if(n > capacity)
         {
-            LOGW << io::xprintf("Specified n=%d exceeds cacheSize=%d, setting n to cacheSize.");
-            n = cacheSize;
+            LOGW << io::xprintf("Specified n=%d exceeds cache capacity of %lu frames, setting n to "
+                                "the capacity.",
+                                n, capacity);
+            n = capacity;
         }
         for(uint64_t k = fromID; k != std::min(uint64_t(fromID) + n, frameCount); k++)
         {
@@ -215,121 +311,137 @@ template <typename T>
 std::shared_ptr<io::BufferedFrame2DI<T>> DenFrame2DCachedReader<T>::readBufferedFrame(uint64_t k)
 {
     std::shared_ptr<BufferedFrame2DI<T>> f;
-    // If it is in cache, return it directly
+    if(useSharedCache)
     {
-        std::unique_lock<std::mutex> _synchronized_block(cacheConsistencyMutex);
-        f = cache[k];
+        // Shared frames are immutable, the caller gets its own copy
+        std::shared_ptr<const BufferedFrame2DI<T>> s = readSharedFrame(k);
+        f = std::make_shared<BufferedFrame2D<T>>(sizex, sizey, framePool);
+        std::copy(s->data(), s->data() + frameSize, f->data());
+        return f;
     }
-    if(f != nullptr)
+    // If it is in cache, return it directly
+    if(cache != nullptr && cache->lookup(k, f))
     {
         return f;
     }
-    f = std::make_shared<BufferedFrame2D<T>>(sizex, sizey);
-    this->readFrameIntoBuffer(k, f->data(),
-                              true); // Frame2D has always X major alignment, this->XMajorAlignment
-                                     // refers to the alignment of the data in the unerlying file.
-    frameToCache(k, f);
+    f = std::make_shared<BufferedFrame2D<T>>(sizex, sizey, framePool);
+    // Frame2D has always X major alignment, this->XMajorAlignment refers to the alignment of the
+    // data in the unerlying file.
+    readFromFile(k, f->data(), true);
+    if(cache != nullptr)
+    {
+        cache->insert(k, f, cachedFrameBytes);
+    }
     return f;
 }
 
 template <typename T>
-void DenFrame2DCachedReader<T>::frameToCache(uint32_t k, std::shared_ptr<BufferedFrame2DI<T>> f)
+void DenFrame2DCachedReader<T>::readFrameIntoBuffer(uint64_t k,
+                                                    T* outside_buffer,
+                                                    bool XMajorAlignment)
 {
-    if(cacheSize > 0)
+    // Cached frames are copied, frames that are not cached are read directly and not inserted,
+    // so that streaming the file once does not churn the cache
+    std::shared_ptr<const BufferedFrame2DI<T>> f;
+    if(useSharedCache)
+    {
+        f = FrameCache::instance().lookup<T>(sharedCacheKey(k));
+    } else if(cache != nullptr)
     {
-        std::unique_lock<std::mutex> _synchronized_block(cacheConsistencyMutex);
-        cache[k] = f;
-        cachedFramesQueue.push(k);
-        if(cachedFramesQueue.size() > cacheSize && !cachedFramesQueue.empty())
+        std::shared_ptr<BufferedFrame2DI<T>> cached;
+        if(cache->lookup(k, cached))
         {
-            while(cachedFramesQueue.size() > cacheSize && !cachedFramesQueue.empty())
-            {
-
-                uint32_t k_delete = cachedFramesQueue.front();
-                cachedFramesQueue.pop();
-                cache[k_delete] = nullptr;
-            }
+            f = cached;
         }
     }
+    if(f == nullptr)
+    {
+        readFromFile(k, outside_buffer, XMajorAlignment);
+        return;
+    }
+    const T* frame = f->data();
+    if(XMajorAlignment)
+    {
+        std::copy(frame, frame + frameSize, outside_buffer);
+    } else
+    {
+        // Cached frames are stored XMajor, the matrix of sizey rows and sizex columns
+        transpose<T>(frame, outside_buffer, sizey, sizex);
+    }
 }
 
 template <typename T>
-void DenFrame2DCachedReader<T>::readFrameIntoBuffer(uint64_t k,
-                                                    T* outside_buffer,
-                                                    bool XMajorAlignment)
+FrameCacheKey DenFrame2DCachedReader<T>::sharedCacheKey(uint64_t k) const
 {
-    std::shared_ptr<BufferedFrame2DI<T>> f;
-    // If it is in cache, copy it to the outside buffer and return
-    {
-        std::unique_lock<std::mutex> _synchronized_block(cacheConsistencyMutex);
-        f = cache[k];
-    }
-    if(f != nullptr)
+    FrameCacheKey key;
+    key.file = fileHandle->getIdentity();
+    key.frame = k;
+    key.elementType = getDenSupportedTypeByTypeID(typeid(T));
+    return key;
+}
+
+template <typename T>
+std::shared_ptr<const io::BufferedFrame2DI<T>>
+DenFrame2DCachedReader<T>::readSharedFrame(uint64_t k)
+{
+    return FrameCache::instance().getOrLoad<T>(
+        sharedCacheKey(k), [this, k]() -> std::shared_ptr<const BufferedFrame2DI<T>> {
+            std::shared_ptr<BufferedFrame2DI<T>> f
+                = std::make_shared<BufferedFrame2D<T>>(sizex, sizey, framePool);
+            readFromFile(k, f->data(), true);
+            return f;
+        });
+}
+
+template <typename T>
+void DenFrame2DCachedReader<T>::setFramePool(std::shared_ptr<FramePool<T>> pool)
+{
+    if(pool != nullptr && pool->getElementCount() < frameSize)
     {
-        std::copy(f->data(), f->data() + frameSize, outside_buffer);
-        return;
+        KCTERR(io::xprintf("Buffers of the pool of %lu elements can not hold frames of %lu "
+                           "elements of the file %s.",
+                           pool->getElementCount(), frameSize, denFile.c_str()));
     }
+    framePool = pool;
+}
+
+template <typename T>
+std::shared_ptr<FramePool<T>> DenFrame2DCachedReader<T>::getFramePool() const
+{
+    return framePool;
+}
+
+template <typename T>
+void DenFrame2DCachedReader<T>::setSharedCache(bool useSharedCache)
+{
+    this->useSharedCache = useSharedCache;
+}
+
+template <typename T>
+void DenFrame2DCachedReader<T>::readFromFile(uint64_t k, T* outside_buffer, bool XMajorAlignment)
+{
     if(this->XMajorAlignment == XMajorAlignment && this->littleEndianArchitecture
        && this->elementTypeMatches)
     {
         uint64_t position = this->offset + k * frameByteSize;
-        io::readBytesFrom(this->denFile, position, (uint8_t*)outside_buffer, frameByteSize);
+        rawFile->readBytesFrom(position, (uint8_t*)outside_buffer, frameByteSize);
         return;
     }
-    std::unique_lock<std::mutex> l;
-    bool locked = false;
-    uint32_t mutexnum = 0;
-    for(uint32_t i = 0; i != bufferCount; i++)
-    {
-        l = std::unique_lock<std::mutex>(consistencyMutexes[i], std::try_to_lock);
-        if(l.owns_lock())
-        {
-            locked = true;
-            mutexnum = i;
-            break;
-        }
-    }
-    if(!locked)
-    {
-        l = std::unique_lock<std::mutex>(consistencyMutexes[0]);
-        mutexnum = 0;
-    }
-    // Mutex will be released as this goes out of scope.
-    // To protect calling this method from another thread using the same block of memory
-    uint8_t* buffer = buffers[mutexnum];
+    // Each thread converts in its own buffer
+    uint8_t* buffer = threadScratchBuffer(frameByteSize);
     uint64_t position = this->offset + k * frameByteSize;
-    io::readBytesFrom(this->denFile, position, buffer, frameByteSize);
+    rawFile->readBytesFrom(position, buffer, frameByteSize);
     if(XMajorAlignment == this->XMajorAlignment)
     {
-        for(uint32_t a = 0; a != frameSize; a++)
-        {
-            outside_buffer[a] = util::getNextElement<T>(&buffer[a * elementByteSize], dataType);
-        }
+        util::convertElements<T>(buffer, dataType, outside_buffer, frameSize);
     } else
     {
-        uint32_t innerIndex, outerIndex;
-        for(uint32_t x = 0; x != sizex; x++)
-        {
-            for(uint32_t y = 0; y != sizey; y++)
-            {
-                if(this->XMajorAlignment)
-                {
-                    innerIndex = x + sizex * y;
-                } else
-                {
-                    innerIndex = y + sizey * x;
-                }
-                if(XMajorAlignment)
-                {
-                    outerIndex = x + sizex * y;
-                } else
-                {
-                    outerIndex = y + sizey * x;
-                }
-                outside_buffer[outerIndex]
-                    = util::getNextElement<T>(&buffer[innerIndex * elementByteSize], dataType);
-            }
-        }
+        // Transpose the raw elements, then convert them in the output order
+        uint64_t rows = this->XMajorAlignment ? sizey : sizex;
+        uint64_t cols = this->XMajorAlignment ? sizex : sizey;
+        uint8_t* transposed = threadTransposeBuffer(frameByteSize);
+        transposeElements(buffer, cols, transposed, rows, rows, cols, elementByteSize);
+        util::convertElements<T>(transposed, dataType, outside_buffer, frameSize);
     }
 }
 
@@ -368,4 +480,26 @@ DenSupportedType DenFrame2DCachedReader<T>::getDataType() const
 {
     return dataType;
 }
+
+template <typename T>
+CacheStatistics DenFrame2DCachedReader<T>::getCacheStatistics() const
+{
+    if(cache == nullptr)
+    {
+        return CacheStatistics();
+    }
+    return cache->getStatistics();
+}
+
+template <typename T>
+CachePolicy DenFrame2DCachedReader<T>::getCachePolicy() const
+{
+    return cachePolicy;
+}
+
+template <typename T>
+uint64_t DenFrame2DCachedReader<T>::getCacheBytes() const
+{
+    return cacheBytes;
+}
 } // namespace KCT::io
@@ -0,0 +1,170 @@
+#pragma once
+
+// External
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+
+// Internal
+#include "BufferedFrame2D.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "FrameMemoryViewer2D.hpp"
+#include "MappedFile.hpp"
+
+namespace KCT::io {
+/**
+ * Reader of DEN frames from the file mapped into memory.
+ *
+ * When the element type of the file matches T, the architecture is little endian, the file is X
+ * major and the frame is aligned for T, readFrame returns FrameMemoryViewer2D pointing directly
+ * into the mapping without copying the data. Otherwise the frames are converted from the mapping
+ * into the newly allocated buffer. The returned views keep the mapping alive, they stay valid
+ * after the reader is destroyed. Writes through the views are private to the process and do not
+ * modify the file.
+ */
+template <typename T>
+class DenFrame2DMappedReader : public DenFrame2DReader<T>
+{
+public:
+    /**
+     * Constructs DenFrame2DMappedReader from file name.
+     *
+     * @param denFile File in a DEN format to read by frames.
+     * @param populate Prefault the whole file by MAP_POPULATE.
+     * @param hugePages Ask for transparent huge pages.
+     */
+    DenFrame2DMappedReader(std::string denFile, bool populate = false, bool hugePages = false);
+
+    std::shared_ptr<io::Frame2DI<T>> readFrame(uint64_t k) override;
+    std::shared_ptr<io::BufferedFrame2DI<T>> readBufferedFrame(uint64_t k) override;
+    void readFrameIntoBuffer(uint64_t flatFrameIndex,
+                             T* outside_buffer,
+                             bool XMajorAlignment = true) override;
+
+    /**
+     * Pointer to the k-th frame in the mapping.
+     *
+     * @return Pointer valid for the lifetime of the reader or nullptr when the frame can not be
+     * accessed without conversion, see isZeroCopy.
+     */
+    T* getFramePointer(uint64_t k) const;
+
+    /**
+     * @return True if readFrame returns views into the mapping.
+     */
+    bool isZeroCopy() const;
+
+    /**
+     * Hint the expected access pattern to the whole file.
+     */
+    void advise(MemoryAdvice advice);
+
+    /**
+     * Hint the expected access pattern to the frames [fromFrame, fromFrame + count), e.g.
+     * MemoryAdvice::WILLNEED for the frames to be processed next.
+     */
+    void adviseFrames(uint64_t fromFrame, uint64_t count, MemoryAdvice advice);
+
+private:
+    std::shared_ptr<MappedFile> mapping;
+    bool zeroCopy;
+};
+
+template <typename T>
+DenFrame2DMappedReader<T>::DenFrame2DMappedReader(std::string denFile,
+                                                  bool populate,
+                                                  bool hugePages)
+    : DenFrame2DReader<T>(denFile)
+{
+    mapping = std::make_shared<MappedFile>(*this->rawFile, populate, hugePages);
+    // Mapping is page aligned, so that alignment of the frames depends only on the offset
+    zeroCopy = this->isDirectReadable(true) && this->offset % alignof(T) == 0
+        && this->frameByteSize % alignof(T) == 0;
+}
+
+template <typename T>
+bool DenFrame2DMappedReader<T>::isZeroCopy() const
+{
+    return zeroCopy;
+}
+
+template <typename T>
+T* DenFrame2DMappedReader<T>::getFramePointer(uint64_t k) const
+{
+    if(!zeroCopy)
+    {
+        return nullptr;
+    }
+    return reinterpret_cast<T*>(mapping->data() + this->offset + k * this->frameByteSize);
+}
+
+template <typename T>
+std::shared_ptr<io::Frame2DI<T>> DenFrame2DMappedReader<T>::readFrame(uint64_t k)
+{
+    if(k >= this->frameCount)
+    {
+        KCTERR(io::xprintf("Frame %lu out of range of %lu frames in %s.", k, this->frameCount,
+                           this->denFile.c_str()));
+    }
+    if(zeroCopy)
+    {
+        // Deleter holds the mapping so that the view does not outlive it
+        std::shared_ptr<MappedFile> m = mapping;
+        return std::shared_ptr<io::Frame2DI<T>>(
+            new FrameMemoryViewer2D<T>(getFramePointer(k), this->sizex, this->sizey),
+            [m](io::Frame2DI<T>* f) { delete f; });
+    }
+    return readBufferedFrame(k);
+}
+
+template <typename T>
+std::shared_ptr<io::BufferedFrame2DI<T>> DenFrame2DMappedReader<T>::readBufferedFrame(uint64_t k)
+{
+    std::shared_ptr<BufferedFrame2DI<T>> f
+        = std::make_shared<BufferedFrame2D<T>>(this->sizex, this->sizey);
+    readFrameIntoBuffer(k, f->data(), true);
+    return f;
+}
+
+template <typename T>
+void DenFrame2DMappedReader<T>::readFrameIntoBuffer(uint64_t k,
+                                                    T* outside_buffer,
+                                                    bool XMajorAlignment)
+{
+    if(k >= this->frameCount)
+    {
+        KCTERR(io::xprintf("Frame %lu out of range of %lu frames in %s.", k, this->frameCount,
+                           this->denFile.c_str()));
+    }
+    uint8_t* frame = mapping->data() + this->offset + k * this->frameByteSize;
+    if(this->isDirectReadable(XMajorAlignment))
+    {
+        std::memcpy(outside_buffer, frame, this->frameByteSize);
+    } else
+    {
+        this->convertRawFrame(frame, outside_buffer, XMajorAlignment);
+    }
+}
+
+template <typename T>
+void DenFrame2DMappedReader<T>::advise(MemoryAdvice advice)
+{
+    mapping->advise(advice);
+}
+
+template <typename T>
+void DenFrame2DMappedReader<T>::adviseFrames(uint64_t fromFrame,
+                                             uint64_t count,
+                                             MemoryAdvice advice)
+{
+    if(count == 0 || fromFrame >= this->frameCount)
+    {
+        return;
+    }
+    count = std::min(count, this->frameCount - fromFrame);
+    mapping->advise(advice, this->offset + fromFrame * this->frameByteSize,
+                    count * this->frameByteSize);
+}
+
+} // namespace KCT::io
@@ -0,0 +1,405 @@
+#pragma once
+
+// External
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Internal
+#include "AlignedAllocator.hpp"
+#include "BufferedFrame2D.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "Frame2DReaderI.hpp"
+#include "Transpose.hpp"
+
+namespace KCT::io {
+
+/**
+ * Counters of DenFrame2DPrefetchReader.
+ */
+struct PrefetchStatistics
+{
+    /// Frames served from the prefetched buffers
+    uint64_t hits = 0;
+    /// Frames not in the lookahead window of the schedule, read synchronously
+    uint64_t misses = 0;
+    /// Number of hits where the consumer had to wait for the read to finish
+    uint64_t stalls = 0;
+    /// Total time the consumer waited for the prefetched frames
+    double stallSeconds = 0.0;
+};
+
+/**
+ * Reader that keeps the next frames of the declared access schedule ready in a bounded ring of
+ * buffers, so that the reads overlap with the processing of the previous frames.
+ *
+ * Background threads read the frames of the schedule in order into the ring of lookahead buffers.
+ * When the consumer requests the frame that is next in the schedule, it is copied from the ring
+ * and its buffer is released for the next read. Frames later in the lookahead window might be
+ * requested as well, the frames of the schedule before them are dropped. Frames outside of the
+ * window are read synchronously and counted as misses. When such a frame occurs later in the
+ * schedule, the consumer skipped ahead and the window is moved behind it.
+ *
+ * Reading methods shall be called by a single consumer thread, concurrent consumers are not
+ * supported as the prefetched frame is copied out of the ring without holding the lock. The
+ * wrapped reader is accessed concurrently by the background threads and by the consumer on
+ * misses, all DEN readers are safe to be used this way.
+ */
+template <typename T>
+class DenFrame2DPrefetchReader : public Frame2DReaderI<T>
+{
+public:
+    /**
+     * Wrap existing reader.
+     *
+     * @param reader Reader to prefetch from.
+     * @param schedule Frame indices in the order they will be requested, e.g.
+     * ArgumentsFramespec::frames or output of sequentialSchedule.
+     * @param lookahead Number of frame buffers in the ring.
+     * @param numThreads Number of background threads issuing reads.
+     */
+    DenFrame2DPrefetchReader(std::shared_ptr<Frame2DReaderI<T>> reader,
+                             std::vector<uint64_t> schedule,
+                             uint32_t lookahead = 8,
+                             uint32_t numThreads = 1);
+    /**
+     * Prefetching reader of the DEN file.
+     */
+    DenFrame2DPrefetchReader(std::string denFile,
+                             std::vector<uint64_t> schedule,
+                             uint32_t lookahead = 8,
+                             uint32_t numThreads = 1);
+    ~DenFrame2DPrefetchReader();
+    DenFrame2DPrefetchReader(const DenFrame2DPrefetchReader& b) = delete;
+    DenFrame2DPrefetchReader& operator=(const DenFrame2DPrefetchReader& b) = delete;
+
+    /// Frames 0, 1, ..., frameCount - 1
+    static std::vector<uint64_t> sequentialSchedule(uint64_t frameCount);
+    /// Frames frameCount - 1, ..., 1, 0
+    static std::vector<uint64_t> reversedSchedule(uint64_t frameCount);
+    /// Frames from, from + stride, ... less than frameCount
+    static std::vector<uint64_t>
+    stridedSchedule(uint64_t frameCount, uint64_t from, uint64_t stride);
+
+    std::shared_ptr<io::Frame2DI<T>> readFrame(uint64_t k) override;
+    std::shared_ptr<io::BufferedFrame2DI<T>> readBufferedFrame(uint64_t k) override;
+    void readFrameIntoBuffer(uint64_t flatFrameIndex,
+                             T* outside_buffer,
+                             bool XMajorAlignment = true) override;
+    uint32_t dimx() const override;
+    uint32_t dimy() const override;
+    uint64_t getFrameCount() const override;
+    uint64_t getFrameSize() const override;
+    uint64_t getFrameByteSize() const override;
+
+    PrefetchStatistics getStatistics() const;
+    std::shared_ptr<Frame2DReaderI<T>> getReader() const;
+
+private:
+    struct Slot
+    {
+        std::vector<T, AlignedAllocator<T>> buffer;
+        // Position in the schedule the buffer is assigned to
+        uint64_t position = std::numeric_limits<uint64_t>::max();
+        bool ready = false;
+        // Read into the buffer is in progress, the slot can not be reassigned
+        bool loading = false;
+        std::exception_ptr error;
+    };
+    std::shared_ptr<Frame2DReaderI<T>> reader;
+    std::vector<uint64_t> schedule;
+    uint32_t lookahead;
+    uint32_t sizex, sizey;
+    uint64_t frameSize;
+    std::vector<Slot> slots;
+    std::vector<std::thread> threads;
+    mutable std::mutex mutex;
+    std::condition_variable producerCondition;
+    std::condition_variable consumerCondition;
+    // Position in the schedule of the next frame to be requested by the consumer
+    uint64_t consumed = 0;
+    // Position in the schedule of the next frame to be read by the background threads
+    uint64_t nextToLoad = 0;
+    bool stop = false;
+    PrefetchStatistics statistics;
+    void producer();
+    // Copy frame k into the buffer from the ring or by synchronous read
+    void fetch(uint64_t k, T* outside_buffer, bool XMajorAlignment);
+};
+
+template <typename T>
+DenFrame2DPrefetchReader<T>::DenFrame2DPrefetchReader(std::shared_ptr<Frame2DReaderI<T>> reader,
+                                                      std::vector<uint64_t> schedule,
+                                                      uint32_t lookahead,
+                                                      uint32_t numThreads)
+    : reader(reader)
+    , schedule(schedule)
+    , lookahead(std::max(lookahead, 1u))
+{
+    sizex = reader->dimx();
+    sizey = reader->dimy();
+    frameSize = reader->getFrameSize();
+    uint64_t frameCount = reader->getFrameCount();
+    for(uint64_t k : this->schedule)
+    {
+        if(k >= frameCount)
+        {
+            KCTERR(io::xprintf("Scheduled frame %lu is out of range of %lu frames.", k,
+                               frameCount));
+        }
+    }
+    slots.resize(this->lookahead);
+    for(Slot& s : slots)
+    {
+        s.buffer.resize(frameSize);
+    }
+    numThreads = std::max(std::min(numThreads, this->lookahead), 1u);
+    for(uint32_t i = 0; i != numThreads; i++)
+    {
+        threads.emplace_back(&DenFrame2DPrefetchReader<T>::producer, this);
+    }
+}
+
+template <typename T>
+DenFrame2DPrefetchReader<T>::DenFrame2DPrefetchReader(std::string denFile,
+                                                      std::vector<uint64_t> schedule,
+                                                      uint32_t lookahead,
+                                                      uint32_t numThreads)
+    : DenFrame2DPrefetchReader(std::make_shared<DenFrame2DReader<T>>(denFile),
+                               schedule,
+                               lookahead,
+                               numThreads)
+{
+}
+
+template <typename T>
+DenFrame2DPrefetchReader<T>::~DenFrame2DPrefetchReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    producerCondition.notify_all();
+    for(std::thread& t : threads)
+    {
+        t.join();
+    }
+}
+
+template <typename T>
+std::vector<uint64_t> DenFrame2DPrefetchReader<T>::sequentialSchedule(uint64_t frameCount)
+{
+    return stridedSchedule(frameCount, 0, 1);
+}
+
+template <typename T>
+std::vector<uint64_t> DenFrame2DPrefetchReader<T>::reversedSchedule(uint64_t frameCount)
+{
+    std::vector<uint64_t> s = sequentialSchedule(frameCount);
+    std::reverse(s.begin(), s.end());
+    return s;
+}
+
+template <typename T>
+std::vector<uint64_t>
+DenFrame2DPrefetchReader<T>::stridedSchedule(uint64_t frameCount, uint64_t from, uint64_t stride)
+{
+    std::vector<uint64_t> s;
+    stride = std::max(stride, (uint64_t)1);
+    for(uint64_t k = from; k < frameCount; k += stride)
+    {
+        s.push_back(k);
+    }
+    return s;
+}
+
+template <typename T>
+void DenFrame2DPrefetchReader<T>::producer()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true)
+    {
+        producerCondition.wait(lock, [this] {
+            return stop
+                || (nextToLoad < schedule.size() && nextToLoad < consumed + lookahead
+                    && !slots[nextToLoad % lookahead].loading);
+        });
+        if(stop)
+        {
+            return;
+        }
+        // Slot was released as its previous position is before consumed, and when the window
+        // was moved, the read of the dropped position has finished
+        uint64_t position = nextToLoad++;
+        Slot& s = slots[position % lookahead];
+        s.position = position;
+        s.ready = false;
+        s.loading = true;
+        s.error = nullptr;
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            reader->readFrameIntoBuffer(schedule[position], s.buffer.data(), true);
+        } catch(...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+        s.error = error;
+        s.ready = true;
+        s.loading = false;
+        consumerCondition.notify_all();
+        producerCondition.notify_all();
+    }
+}
+
+template <typename T>
+void DenFrame2DPrefetchReader<T>::fetch(uint64_t k, T* outside_buffer, bool XMajorAlignment)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t windowEnd = std::min(consumed + lookahead, (uint64_t)schedule.size());
+    uint64_t position = consumed;
+    while(position != windowEnd && schedule[position] != k)
+    {
+        position++;
+    }
+    if(position == windowEnd)
+    {
+        statistics.misses++;
+        // Frame later in the schedule means that the consumer skipped ahead, move the window
+        // behind it so that the producers prefetch the following frames
+        while(position != schedule.size() && schedule[position] != k)
+        {
+            position++;
+        }
+        bool resynchronize = position != schedule.size();
+        if(resynchronize)
+        {
+            consumed = position + 1;
+            nextToLoad = std::max(nextToLoad, consumed);
+        }
+        lock.unlock();
+        if(resynchronize)
+        {
+            producerCondition.notify_all();
+        }
+        reader->readFrameIntoBuffer(k, outside_buffer, XMajorAlignment);
+        return;
+    }
+    statistics.hits++;
+    auto ready = [this, position] {
+        const Slot& s = slots[position % lookahead];
+        return s.position == position && s.ready;
+    };
+    if(!ready())
+    {
+        statistics.stalls++;
+        auto start = std::chrono::steady_clock::now();
+        consumerCondition.wait(lock, ready);
+        std::chrono::duration<double> waited = std::chrono::steady_clock::now() - start;
+        statistics.stallSeconds += waited.count();
+    }
+    Slot& s = slots[position % lookahead];
+    std::exception_ptr error = s.error;
+    lock.unlock();
+    // Slot can not be reused by producers until consumed is advanced
+    if(!error)
+    {
+        const T* frame = s.buffer.data();
+        if(XMajorAlignment)
+        {
+            std::memcpy(outside_buffer, frame, frameSize * sizeof(T));
+        } else
+        {
+            // Slots hold the frames XMajor, the matrix of sizey rows and sizex columns
+            transpose<T>(frame, outside_buffer, sizey, sizex);
+        }
+    }
+    lock.lock();
+    consumed = std::max(consumed, position + 1);
+    lock.unlock();
+    producerCondition.notify_all();
+    if(error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+template <typename T>
+std::shared_ptr<io::Frame2DI<T>> DenFrame2DPrefetchReader<T>::readFrame(uint64_t k)
+{
+    std::shared_ptr<Frame2DI<T>> f = readBufferedFrame(k);
+    return f;
+}
+
+template <typename T>
+std::shared_ptr<io::BufferedFrame2DI<T>>
+DenFrame2DPrefetchReader<T>::readBufferedFrame(uint64_t k)
+{
+    std::shared_ptr<BufferedFrame2DI<T>> f
+        = std::make_shared<BufferedFrame2D<T>>(nullptr, sizex, sizey, DIRECT_IO_ALIGNMENT);
+    fetch(k, f->data(), true);
+    return f;
+}
+
+template <typename T>
+void DenFrame2DPrefetchReader<T>::readFrameIntoBuffer(uint64_t flatFrameIndex,
+                                                      T* outside_buffer,
+                                                      bool XMajorAlignment)
+{
+    fetch(flatFrameIndex, outside_buffer, XMajorAlignment);
+}
+
+template <typename T>
+uint32_t DenFrame2DPrefetchReader<T>::dimx() const
+{
+    return sizex;
+}
+
+template <typename T>
+uint32_t DenFrame2DPrefetchReader<T>::dimy() const
+{
+    return sizey;
+}
+
+template <typename T>
+uint64_t DenFrame2DPrefetchReader<T>::getFrameCount() const
+{
+    return reader->getFrameCount();
+}
+
+template <typename T>
+uint64_t DenFrame2DPrefetchReader<T>::getFrameSize() const
+{
+    return frameSize;
+}
+
+template <typename T>
+uint64_t DenFrame2DPrefetchReader<T>::getFrameByteSize() const
+{
+    return reader->getFrameByteSize();
+}
+
+template <typename T>
+PrefetchStatistics DenFrame2DPrefetchReader<T>::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+template <typename T>
+std::shared_ptr<Frame2DReaderI<T>> DenFrame2DPrefetchReader<T>::getReader() const
+{
+    return reader;
+}
+
+} // namespace KCT::io
@@ -1,14 +1,24 @@
 #pragma once
 
 // External
+#include <algorithm>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 // Internal
 #include "BufferedFrame2D.hpp"
+#include "DEN/DenElementConversion.hpp"
+#include "DEN/DenFileHandle.hpp"
 #include "DEN/DenFileInfo.hpp"
 #include "Frame2DI.hpp"
 #include "Frame2DReaderI.hpp"
+#include "FrameCache.hpp"
+#include "FramePool.hpp"
+#include "RawFile.hpp"
+#include "Transpose.hpp"
 
 namespace KCT::io {
 /**
@@ -26,10 +36,21 @@ public:
      *
      * @param denFile
      * @param denFile File in a DEN format to read by frames.
-     * @param additionalBufferNum Number of additional buffers to allocate. Defaults to 0 for 1
-     * default buffer.
+     * @param additionalBufferNum Ignored, kept for compatibility. Conversion buffers are thread
+     * local, see threadScratchBuffer.
+     * @param directIO Read frames with O_DIRECT bypassing the page cache, useful when streaming
+     * files much bigger than the memory once. Falls back to buffered reads when the file system
+     * does not support it.
      */
-    DenFrame2DReader(std::string denFile, uint32_t additionalBufferNum = 0);
+    DenFrame2DReader(std::string denFile,
+                     uint32_t additionalBufferNum = 0,
+                     bool directIO = false);
+    /**Constructs DenFrame2DReader from the shared handle, the header is not parsed again.
+     *
+     * @param handle Handle obtained by DenFileHandle::open.
+     * @param additionalBufferNum Ignored, kept for compatibility.
+     */
+    DenFrame2DReader(std::shared_ptr<DenFileHandle> handle, uint32_t additionalBufferNum = 0);
     /// Destructor
     ~DenFrame2DReader();
     /// Copy constructor
@@ -42,8 +63,31 @@ public:
     DenFrame2DReader<T>& operator=(DenFrame2DReader<T>&& other) = delete;
     std::shared_ptr<io::Frame2DI<T>> readFrame(uint64_t k) override;
     std::shared_ptr<io::BufferedFrame2DI<T>> readBufferedFrame(uint64_t k);
+    /**
+     * Frame from the process wide FrameCache shared by all readers of the same file, read by
+     * readBufferedFrame when it is not cached.
+     */
+    std::shared_ptr<const io::BufferedFrame2DI<T>> readSharedFrame(uint64_t k) override;
     void
     readFrameIntoBuffer(uint64_t flatFrameIndex, T* outside_buffer, bool XMajorAlignment = true);
+    /**
+     * Read count consecutive frames by a single read when no conversion is needed, otherwise by
+     * reads of multiple frames into the staging buffer.
+     */
+    void readFramesIntoBuffer(uint64_t fromFrame,
+                              uint64_t count,
+                              T* outside_buffer,
+                              bool XMajorAlignment = true) override;
+    /**
+     * Read frames given by (frame index, destination buffer) pairs.
+     *
+     * Frames are sorted by their position in the file and the frames adjacent in the file or
+     * separated by gaps up to getMaxCoalescedGapFrames frames are read by a single preadv call, so
+     * that reversed or every k-th frame lists are read sequentially.
+     */
+    void readFramesIntoBuffers(const std::vector<std::pair<uint64_t, T*>>& frames,
+                               bool XMajorAlignment = true) override;
+    using Frame2DReaderI<T>::readFramesIntoBuffer;
     uint32_t dimx() const override;
     uint32_t dimy() const override;
     uint64_t getFrameCount() const override;
@@ -52,6 +96,33 @@ public:
     std::string getFileName() const;
     /**Returns file name of the underlying DEN file.**/
     DenSupportedType getDataType() const;
+    /**Returns true if the frames are read with O_DIRECT.**/
+    bool isDirectIO() const;
+    /**Returns handle shared with other readers of the same file.**/
+    std::shared_ptr<DenFileHandle> getFileHandle() const;
+    /**
+     * Borrow the memory of the frames returned by readBufferedFrame and readFrame from the pool,
+     * so that reading in the steady state does not allocate. The buffers of the pool must hold at
+     * least getFrameSize() elements, nullptr restores allocation per frame.
+     */
+    void setFramePool(std::shared_ptr<FramePool<T>> pool);
+    std::shared_ptr<FramePool<T>> getFramePool() const;
+    /**
+     * Maximum number of frames between two requested frames that are read and discarded to
+     * coalesce their reads, at least MAX_COALESCED_GAP_FRAMES and more for frames smaller than
+     * MAX_COALESCED_GAP / MAX_COALESCED_GAP_FRAMES bytes.
+     */
+    uint64_t getMaxCoalescedGapFrames() const;
+
+    /// Maximum gap between frames in bytes that is read and discarded to coalesce reads
+    static constexpr uint64_t MAX_COALESCED_GAP = 256 * 1024;
+    /// Gap in frames that is always coalesced, so that every k-th frame lists up to k = 4 of
+    /// frames of any size are read sequentially
+    static constexpr uint64_t MAX_COALESCED_GAP_FRAMES = 3;
+    /// Size of the buffer the gaps are read into, longer gaps reuse it by multiple iovecs
+    static constexpr uint64_t MAX_GAP_BUFFER_BYTES = 1024 * 1024;
+    /// Maximum size of the staging buffer when the frames have to be converted
+    static constexpr uint64_t MAX_STAGING_BYTES = 64 * 1024 * 1024;
 
 protected:
     // protected: // Visible in inheritance structure
@@ -64,22 +135,44 @@ protected:
     uint64_t frameCount;
     DenSupportedType dataType;
     uint64_t elementByteSize;
-
-private:
-    mutable std::mutex* consistencyMutexes;
-    uint8_t** buffers;
-    uint32_t additionalBufferNum;
+    std::shared_ptr<DenFileHandle> fileHandle;
+    // Descriptor held for the whole lifetime of the reader, pread is used so it is thread safe
+    std::shared_ptr<RawFile> rawFile;
+    std::shared_ptr<FramePool<T>> framePool;
     bool littleEndianArchitecture;
     bool elementTypeMatchesFile;
+    /**
+     * True if the frame bytes in the file can be copied directly into the buffer of the given
+     * alignment without any conversion.
+     */
+    bool isDirectReadable(bool XMajorAlignment) const;
+    /**
+     * Convert raw frame bytes as they are stored in the file into the outside_buffer.
+     *
+     * @param buffer Raw frame data of frameByteSize bytes.
+     * @param outside_buffer Buffer of frameSize elements to fill.
+     * @param XMajorAlignment Alignment of the outside_buffer.
+     */
+    void convertRawFrame(uint8_t* buffer, T* outside_buffer, bool XMajorAlignment) const;
 };
 
 template <typename T>
-DenFrame2DReader<T>::DenFrame2DReader(std::string denFile, uint32_t additionalBufferNum)
-    : denFile(denFile)
-    , additionalBufferNum(additionalBufferNum)
+DenFrame2DReader<T>::DenFrame2DReader(std::string denFile,
+                                      uint32_t additionalBufferNum,
+                                      bool directIO)
+    : DenFrame2DReader(DenFileHandle::open(denFile, directIO), additionalBufferNum)
+{
+}
+
+template <typename T>
+DenFrame2DReader<T>::DenFrame2DReader(std::shared_ptr<DenFileHandle> handle,
+                                      uint32_t additionalBufferNum)
+    : denFile(handle->getFileName())
+    , fileHandle(handle)
 {
     std::string ERR;
-    DenFileInfo pi = DenFileInfo(this->denFile);
+    const DenFileInfo& pi = fileHandle->getInfo();
+    this->rawFile = fileHandle->getRawFile();
     this->dataType = pi.getElementType();
     DenSupportedType readerDataType = getDenSupportedTypeByTypeID(typeid(T));
     if(dataType != readerDataType)
@@ -101,43 +194,12 @@ DenFrame2DReader<T>::DenFrame2DReader(std::string denFile, uint32_t additionalBu
     this->frameSize = pi.getFrameSize();
     this->frameByteSize = pi.getFrameByteSize();
     this->XMajorAlignment = pi.hasXMajorAlignment();
-    this->consistencyMutexes = new std::mutex[1 + additionalBufferNum];
-    this->buffers = new uint8_t*[1 + additionalBufferNum];
     int num = 1;
     this->littleEndianArchitecture = (*(char*)&num == 1);
-    for(uint32_t i = 0; i != 1 + additionalBufferNum; i++)
-    {
-        this->buffers[i] = new uint8_t[elementByteSize * sizex * sizey];
-    }
-    // Buffers are used for the alocation of new frames. Since this class uses the
-    // instance that copies memory, this memory might me reused.
 }
 
-// This mumbo jumbo is for correctly deleting object after move assignment operation was
-// performed to be able to delete such object with stealed internals where its buffers are
-// nullptr.
 template <typename T>
-DenFrame2DReader<T>::~DenFrame2DReader()
-{
-    if(consistencyMutexes != nullptr)
-    {
-        delete[] consistencyMutexes;
-    }
-    consistencyMutexes = nullptr;
-    if(buffers != nullptr)
-    {
-        for(uint32_t i = 0; i != 1 + additionalBufferNum; i++)
-        {
-            if(buffers[i] != nullptr)
-            {
-                delete buffers[i];
-            }
-            buffers[i] = nullptr;
-        }
-        delete[] buffers;
-    }
-    buffers = nullptr;
-}
+DenFrame2DReader<T>::~DenFrame2DReader() = default;
 
 template <typename T>
 std::string DenFrame2DReader<T>::getFileName() const
@@ -185,8 +247,16 @@ std::shared_ptr<io::Frame2DI<T>> DenFrame2DReader<T>::readFrame(uint64_t k)
 template <typename T>
 std::shared_ptr<io::BufferedFrame2DI<T>> DenFrame2DReader<T>::readBufferedFrame(uint64_t k)
 {
-    // Allocate a new frame to be returned, triggers memory allocation.
-    std::shared_ptr<BufferedFrame2DI<T>> f = std::make_shared<BufferedFrame2D<T>>(sizex, sizey);
+    // Allocate a new frame to be returned, triggers memory allocation unless pooled.
+    std::shared_ptr<BufferedFrame2DI<T>> f;
+    if(framePool != nullptr)
+    {
+        f = std::make_shared<BufferedFrame2D<T>>(sizex, sizey, framePool);
+    } else
+    {
+        std::size_t alignment = rawFile->isDirectIO() ? DIRECT_IO_ALIGNMENT : alignof(T);
+        f = std::make_shared<BufferedFrame2D<T>>(nullptr, sizex, sizey, alignment);
+    }
     // Get naked memory.
     T* frameArray = f->data();
     // Frames are X major by design, do not use this->XMajorAlignment as this represents the
@@ -195,74 +265,203 @@ std::shared_ptr<io::BufferedFrame2DI<T>> DenFrame2DReader<T>::readBufferedFrame(
     return f;
 }
 
+template <typename T>
+void DenFrame2DReader<T>::setFramePool(std::shared_ptr<FramePool<T>> pool)
+{
+    if(pool != nullptr && pool->getElementCount() < frameSize)
+    {
+        KCTERR(io::xprintf("Buffers of the pool of %lu elements can not hold frames of %lu "
+                           "elements of the file %s.",
+                           pool->getElementCount(), frameSize, denFile.c_str()));
+    }
+    framePool = pool;
+}
+
+template <typename T>
+std::shared_ptr<FramePool<T>> DenFrame2DReader<T>::getFramePool() const
+{
+    return framePool;
+}
+
+template <typename T>
+std::shared_ptr<const io::BufferedFrame2DI<T>> DenFrame2DReader<T>::readSharedFrame(uint64_t k)
+{
+    FrameCacheKey key;
+    key.file = fileHandle->getIdentity();
+    key.frame = k;
+    key.elementType = getDenSupportedTypeByTypeID(typeid(T));
+    return FrameCache::instance().getOrLoad<T>(
+        key, [this, k]() -> std::shared_ptr<const BufferedFrame2DI<T>> {
+            return readBufferedFrame(k);
+        });
+}
+
+template <typename T>
+uint64_t DenFrame2DReader<T>::getMaxCoalescedGapFrames() const
+{
+    return std::max(MAX_COALESCED_GAP / std::max(frameByteSize, (uint64_t)1),
+                    MAX_COALESCED_GAP_FRAMES);
+}
+
+template <typename T>
+bool DenFrame2DReader<T>::isDirectReadable(bool XMajorAlignment) const
+{
+    return XMajorAlignment == this->XMajorAlignment && this->littleEndianArchitecture
+        && this->elementTypeMatchesFile;
+}
+
 template <typename T>
 void DenFrame2DReader<T>::readFrameIntoBuffer(uint64_t k, T* outside_buffer, bool XMajorAlignment)
 {
-    if(XMajorAlignment == this->XMajorAlignment && this->littleEndianArchitecture
-       && this->elementTypeMatchesFile)
+    if(isDirectReadable(XMajorAlignment))
     {
         // Fast path, read the data directly into the output buffer.
         uint64_t position = this->offset + k * frameByteSize;
-        io::readBytesFrom(this->denFile, position, (uint8_t*)outside_buffer, frameByteSize);
+        rawFile->readBytesFrom(position, (uint8_t*)outside_buffer, frameByteSize);
         return;
     }
-    std::unique_lock<std::mutex> l;
-    bool locked = false;
-    uint32_t mutexnum = 0;
-    for(uint32_t i = 0; i != 1 + additionalBufferNum; i++)
+    // Each thread converts in its own buffer, aligned so that O_DIRECT needs no bounce buffer
+    uint8_t* buffer = threadScratchBuffer(frameByteSize);
+    uint64_t position = this->offset + k * frameByteSize;
+    rawFile->readBytesFrom(position, buffer, frameByteSize);
+    convertRawFrame(buffer, outside_buffer, XMajorAlignment);
+}
+
+template <typename T>
+void DenFrame2DReader<T>::readFramesIntoBuffer(uint64_t fromFrame,
+                                               uint64_t count,
+                                               T* outside_buffer,
+                                               bool XMajorAlignment)
+{
+    if(fromFrame + count > frameCount)
     {
-        l = std::unique_lock<std::mutex>(consistencyMutexes[i], std::try_to_lock);
-        if(l.owns_lock())
-        {
-            locked = true;
-            mutexnum = i;
-            break;
-        }
+        KCTERR(io::xprintf("Frames [%lu, %lu) out of range of %lu frames in %s.", fromFrame,
+                           fromFrame + count, frameCount, denFile.c_str()));
     }
-    if(!locked)
+    if(isDirectReadable(XMajorAlignment))
     {
-        l = std::unique_lock<std::mutex>(consistencyMutexes[0]);
-        mutexnum = 0;
+        uint64_t position = this->offset + fromFrame * frameByteSize;
+        rawFile->readBytesFrom(position, (uint8_t*)outside_buffer, count * frameByteSize);
+        return;
     }
-    // Mutex will be released as this goes out of scope.
-    // To protect calling this method from another thread using the same block of memory
-    uint8_t* buffer = buffers[mutexnum];
-    uint64_t position = this->offset + k * frameByteSize;
-    io::readBytesFrom(this->denFile, position, buffer, elementByteSize * frameSize);
-    if(XMajorAlignment == this->XMajorAlignment)
+    std::vector<std::pair<uint64_t, T*>> frames(count);
+    for(uint64_t i = 0; i != count; i++)
+    {
+        frames[i] = { fromFrame + i, outside_buffer + i * frameSize };
+    }
+    readFramesIntoBuffers(frames, XMajorAlignment);
+}
+
+template <typename T>
+void DenFrame2DReader<T>::readFramesIntoBuffers(const std::vector<std::pair<uint64_t, T*>>& frames,
+                                                bool XMajorAlignment)
+{
+    std::vector<std::pair<uint64_t, T*>> sorted(frames);
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const std::pair<uint64_t, T*>& a, const std::pair<uint64_t, T*>& b) {
+                         return a.first < b.first;
+                     });
+    if(!sorted.empty() && sorted.back().first >= frameCount)
     {
-        for(uint64_t a = 0; a != frameSize; a++)
+        KCTERR(io::xprintf("Frame %lu out of range of %lu frames in %s.", sorted.back().first,
+                           frameCount, denFile.c_str()));
+    }
+    bool direct = isDirectReadable(XMajorAlignment);
+    uint64_t maxGapFrames = getMaxCoalescedGapFrames();
+    uint64_t maxSpanFrames = std::max(MAX_STAGING_BYTES / frameByteSize, (uint64_t)1);
+    std::vector<uint8_t, AlignedAllocator<uint8_t>> staging;
+    // Skipped frames are read into the thread scratch buffer and discarded, taken at the first gap
+    const uint64_t gapBufferBytes = std::min(maxGapFrames * frameByteSize, MAX_GAP_BUFFER_BYTES);
+    uint8_t* gapBuffer = nullptr;
+    std::vector<struct iovec> iov;
+    std::size_t i = 0;
+    while(i != sorted.size())
+    {
+        // Extend the run while the next frame follows closely and is not a duplicate
+        uint64_t first = sorted[i].first;
+        std::size_t j = i + 1;
+        while(j != sorted.size() && sorted[j].first > sorted[j - 1].first
+              && sorted[j].first - sorted[j - 1].first - 1 <= maxGapFrames
+              && (direct || sorted[j].first - first < maxSpanFrames))
         {
-            outside_buffer[a] = util::getNextElement<T>(&buffer[a * elementByteSize], dataType);
+            j++;
         }
-    } else
-    {
-        uint64_t innerIndex, outerIndex;
-        for(uint64_t x = 0; x != sizex; x++)
+        uint64_t spanFrames = sorted[j - 1].first - first + 1;
+        uint64_t position = this->offset + first * frameByteSize;
+        if(direct)
         {
-            for(uint64_t y = 0; y != sizey; y++)
+            iov.clear();
+            for(std::size_t r = i; r != j; r++)
             {
-                if(this->XMajorAlignment)
-                {
-                    innerIndex = x + sizex * y;
-                } else
+                if(r != i && sorted[r].first != sorted[r - 1].first + 1)
                 {
-                    innerIndex = y + sizey * x;
+                    uint64_t gapBytes = (sorted[r].first - sorted[r - 1].first - 1) * frameByteSize;
+                    if(gapBuffer == nullptr)
+                    {
+                        gapBuffer = threadScratchBuffer(gapBufferBytes);
+                    }
+                    while(gapBytes != 0)
+                    {
+                        uint64_t len = std::min<uint64_t>(gapBytes, gapBufferBytes);
+                        iov.push_back({ gapBuffer, len });
+                        gapBytes -= len;
+                    }
                 }
-                if(XMajorAlignment)
-                {
-                    outerIndex = x + sizex * y;
-                } else
-                {
-                    outerIndex = y + sizey * x;
-                }
-                outside_buffer[outerIndex]
-                    = util::getNextElement<T>(&buffer[innerIndex * elementByteSize], dataType);
+                iov.push_back({ sorted[r].second, frameByteSize });
+            }
+            rawFile->readvBytesFrom(position, iov);
+        } else
+        {
+            staging.resize(spanFrames * frameByteSize);
+            rawFile->readBytesFrom(position, staging.data(), spanFrames * frameByteSize);
+            for(std::size_t r = i; r != j; r++)
+            {
+                convertRawFrame(staging.data() + (sorted[r].first - first) * frameByteSize,
+                                sorted[r].second, XMajorAlignment);
             }
         }
+        i = j;
     }
 }
 
+template <typename T>
+void DenFrame2DReader<T>::convertRawFrame(uint8_t* buffer,
+                                          T* outside_buffer,
+                                          bool XMajorAlignment) const
+{
+    if(XMajorAlignment == this->XMajorAlignment)
+    {
+        util::convertElements<T>(buffer, dataType, outside_buffer, frameSize);
+    } else
+    {
+        // Frame stored XMajor is the matrix of sizey rows and sizex columns
+        uint64_t rows = this->XMajorAlignment ? sizey : sizex;
+        uint64_t cols = this->XMajorAlignment ? sizex : sizey;
+        if(this->littleEndianArchitecture && this->elementTypeMatchesFile)
+        {
+            transposeElements(buffer, cols, outside_buffer, rows, rows, cols, elementByteSize);
+        } else
+        {
+            // Transpose the raw elements, then convert them in the output order
+            uint8_t* transposed = threadTransposeBuffer(frameByteSize);
+            transposeElements(buffer, cols, transposed, rows, rows, cols, elementByteSize);
+            util::convertElements<T>(transposed, dataType, outside_buffer, frameSize);
+        }
+    }
+}
+
+template <typename T>
+bool DenFrame2DReader<T>::isDirectIO() const
+{
+    return rawFile->isDirectIO();
+}
+
+template <typename T>
+std::shared_ptr<DenFileHandle> DenFrame2DReader<T>::getFileHandle() const
+{
+    return fileHandle;
+}
+
 template <typename T>
 DenSupportedType DenFrame2DReader<T>::getDataType() const
 {
@@ -14,6 +14,10 @@
 
 namespace KCT::util {
 
+/**
+ * Element of the dataType stored in the buffer converted to T. Frames are converted by
+ * convertElements of DenElementConversion.hpp, that selects the kernel once per frame.
+ */
 template <typename T>
 T getNextElement(uint8_t* buffer, io::DenSupportedType dataType)
 {
@@ -21,6 +25,18 @@ T getNextElement(uint8_t* buffer, io::DenSupportedType dataType)
     {
     case io::DenSupportedType::UINT16:
         return static_cast<T>(nextUint16(buffer));
+    case io::DenSupportedType::INT16:
+        return static_cast<T>(nextInt16(buffer));
+    case io::DenSupportedType::UINT32:
+        return static_cast<T>(nextUint32(buffer));
+    case io::DenSupportedType::INT32:
+        return static_cast<T>(nextInt32(buffer));
+    case io::DenSupportedType::UINT64:
+        return static_cast<T>(nextUint64(buffer));
+    case io::DenSupportedType::INT64:
+        return static_cast<T>(nextInt64(buffer));
+    case io::DenSupportedType::UINT8:
+        return static_cast<T>(nextUint8(buffer));
     case io::DenSupportedType::FLOAT32:
         return static_cast<T>(nextFloat(buffer));
     case io::DenSupportedType::FLOAT64:
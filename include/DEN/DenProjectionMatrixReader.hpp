@@ -1,10 +1,13 @@
 #pragma once
 // External libraries
+#include <memory>
 
 // Internal libraries
 //#include "MATRIX/ProjectionMatrix.hpp"
+#include "DEN/DenFileHandle.hpp"
 #include "DEN/DenFileInfo.hpp"
 #include "ProjectionMatrixReaderI.hpp"
+#include "RawFile.hpp"
 
 namespace KCT::io {
 /**
@@ -20,9 +23,13 @@ private:
     std::string projectionMatrixFile;
     uint32_t countMatrices;
     uint64_t offset;
+    std::shared_ptr<DenFileHandle> fileHandle;
+    std::shared_ptr<RawFile> rawFile;
 
 public:
     DenProjectionMatrixReader(std::string projectionMatrixFile);
+    /**Construct reader from the shared handle, the header is not parsed again.*/
+    DenProjectionMatrixReader(std::shared_ptr<DenFileHandle> handle);
 
     /*Returns i-th projection slice in the source.*/
     matrix::ProjectionMatrix readMatrix(int i) override;
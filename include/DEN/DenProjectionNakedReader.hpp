@@ -1,15 +1,19 @@
 #pragma once
 // External
+#include <memory>
 #include <mutex>
 #include <string>
 
 // Internal
+#include "DEN/DenElementConversion.hpp"
+#include "DEN/DenFileHandle.hpp"
 #include "DEN/DenFileInfo.hpp"
 #include "DEN/DenSupportedType.hpp"
 #include "Frame2DI.hpp"
 #include "FrameMemoryViewer2D.hpp"
 #include "MATRIX/ProjectionMatrix.hpp"
 #include "ProjectionReaderI.hpp"
+#include "RawFile.hpp"
 #include "stringFormatter.h"
 
 namespace KCT::io {
@@ -40,6 +44,10 @@ public:
     DenProjectionNakedReader(std::string projectionsFile,
                              std::string projectionMatrixFile,
                              T* bufferToFill = NULL);
+    /**Construct reader from shared handles, the headers are not parsed again.*/
+    DenProjectionNakedReader(std::shared_ptr<DenFileHandle> projectionsHandle,
+                             std::shared_ptr<DenFileHandle> projectionMatrixHandle,
+                             T* bufferToFill = NULL);
 
     /**Atomic reading into the buffer
      *
@@ -79,28 +87,47 @@ private:
     T* buffer;
     uint64_t offsetMatrix = 6;
     uint64_t offsetProjections = 6;
+    std::shared_ptr<DenFileHandle> projectionsHandle;
+    std::shared_ptr<DenFileHandle> projectionMatrixHandle;
+    std::shared_ptr<RawFile> projectionsRawFile;
+    std::shared_ptr<RawFile> projectionMatrixRawFile;
 };
 
 template <typename T>
 DenProjectionNakedReader<T>::DenProjectionNakedReader(std::string projectionsFile,
                                                       std::string projectionMatrixFile,
                                                       T* buffer)
+    : DenProjectionNakedReader(DenFileHandle::open(projectionsFile),
+                               DenFileHandle::open(projectionMatrixFile),
+                               buffer)
 {
-    this->projectionsFile = projectionsFile;
-    this->projectionMatrixFile = projectionMatrixFile;
-    DenFileInfo pi = DenFileInfo(this->projectionsFile);
-    DenFileInfo mi = DenFileInfo(this->projectionMatrixFile);
+}
+
+template <typename T>
+DenProjectionNakedReader<T>::DenProjectionNakedReader(
+    std::shared_ptr<DenFileHandle> projectionsHandle,
+    std::shared_ptr<DenFileHandle> projectionMatrixHandle,
+    T* buffer)
+    : projectionsHandle(projectionsHandle)
+    , projectionMatrixHandle(projectionMatrixHandle)
+{
+    this->projectionsFile = projectionsHandle->getFileName();
+    this->projectionMatrixFile = projectionMatrixHandle->getFileName();
+    const DenFileInfo& pi = projectionsHandle->getInfo();
+    const DenFileInfo& mi = projectionMatrixHandle->getInfo();
+    this->projectionsRawFile = projectionsHandle->getRawFile();
+    this->projectionMatrixRawFile = projectionMatrixHandle->getRawFile();
     this->sizey = pi.getNumRows();
     this->sizex = pi.getNumCols();
     this->sizez = pi.getNumSlices();
     this->offsetMatrix = mi.getOffset();
-    this->offsetProjections = mi.getOffset();
+    this->offsetProjections = pi.getOffset();
     int cols, rows, matCount;
     cols = mi.getNumCols(); // Its matrix, dealing with strange data format considerations
     rows = mi.getNumRows(); // Its matrix, dealing with strange data format considerations
     matCount = mi.getNumSlices();
-    this->dataType = pi.getDataType();
-    this->elementByteSize = pi.elementByteSize();
+    this->dataType = pi.getElementType();
+    this->elementByteSize = pi.getElementByteSize();
     if(rows != 3 || cols != 4)
     {
         std::string errMsg
@@ -164,7 +191,7 @@ DenProjectionNakedReader<T>::readProjectionMatrix(int sliceNum)
 {
     uint8_t buffer[8 * 3 * 4];
     uint64_t position = this->offsetMatrix + ((uint64_t)sliceNum) * 3 * 4 * 8;
-    io::readBytesFrom(this->projectionMatrixFile, position, buffer, 8 * 3 * 4);
+    projectionMatrixRawFile->readBytesFrom(position, buffer, 8 * 3 * 4);
     double matrixData[3 * 4];
     for(int a = 0; a != 3 * 4; a++)
     {
@@ -184,11 +211,8 @@ std::shared_ptr<io::Frame2DI<T>> DenProjectionNakedReader<T>::readProjectionSlic
     uint64_t position
         = this->offsetProjections + uint64_t(sliceNum) * elementByteSize * sizex * sizey;
     uint8_t* tmp = new uint8_t[elementByteSize * sizex * sizey];
-    io::readBytesFrom(this->projectionsFile, position, tmp, elementByteSize * sizex * sizey);
-    for(int a = 0; a != sizex * sizey; a++)
-    {
-        buffer[a] = util::getNextElement<T>(&tmp[a * elementByteSize], dataType);
-    }
+    projectionsRawFile->readBytesFrom(position, tmp, elementByteSize * sizex * sizey);
+    util::convertElements<T>(tmp, dataType, buffer, uint64_t(sizex) * sizey);
     std::shared_ptr<Frame2DI<T>> ps
         = std::make_shared<FrameMemoryViewer2D<T>>(buffer, sizex, sizey);
     delete[] tmp;
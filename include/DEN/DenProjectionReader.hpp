@@ -1,16 +1,19 @@
 #pragma once
 
 // External
-#include <mutex>
+#include <memory>
 #include <string>
 
 // Internal
 #include "BufferedFrame2D.hpp"
+#include "DEN/DenElementConversion.hpp"
+#include "DEN/DenFileHandle.hpp"
 #include "DEN/DenFileInfo.hpp"
 #include "DEN/DenSupportedType.hpp"
 #include "Frame2DI.hpp"
 #include "MATRIX/ProjectionMatrix.hpp"
 #include "ProjectionReaderI.hpp"
+#include "RawFile.hpp"
 
 namespace KCT::io {
 /**
@@ -29,9 +32,16 @@ protected: // Visible in inheritance structure
     uint32_t elementByteSize;
     uint64_t offsetMatrix = 6;
     uint64_t offsetProjections = 6;
+    std::shared_ptr<DenFileHandle> projectionsHandle;
+    std::shared_ptr<DenFileHandle> projectionMatrixHandle;
+    std::shared_ptr<RawFile> projectionsRawFile;
+    std::shared_ptr<RawFile> projectionMatrixRawFile;
 
 public:
     DenProjectionReader(std::string projectionsFile, std::string projectionMatrixFile);
+    /**Construct reader from shared handles, the headers are not parsed again.*/
+    DenProjectionReader(std::shared_ptr<DenFileHandle> projectionsHandle,
+                        std::shared_ptr<DenFileHandle> projectionMatrixHandle);
     /**For the reader is necessery to provide file, where the projections are stored
      * (projectionsFile) and file where the projectionMatrices are stored
      * (projectionMatrixFile).
@@ -46,19 +56,28 @@ public:
     uint32_t dimx() const override;
     uint32_t dimy() const override;
     uint32_t dimz() const override;
-
-private:
-    mutable std::mutex matrixReadMutex;
 };
 
 template <typename T>
 DenProjectionReader<T>::DenProjectionReader(std::string projectionsFile,
                                             std::string projectionMatrixFile)
+    : DenProjectionReader(DenFileHandle::open(projectionsFile),
+                          DenFileHandle::open(projectionMatrixFile))
 {
-    this->projectionsFile = projectionsFile;
-    this->projectionMatrixFile = projectionMatrixFile;
-    DenFileInfo pi = DenFileInfo(this->projectionsFile);
-    DenFileInfo mi = DenFileInfo(this->projectionMatrixFile);
+}
+
+template <typename T>
+DenProjectionReader<T>::DenProjectionReader(std::shared_ptr<DenFileHandle> projectionsHandle,
+                                            std::shared_ptr<DenFileHandle> projectionMatrixHandle)
+    : projectionsHandle(projectionsHandle)
+    , projectionMatrixHandle(projectionMatrixHandle)
+{
+    this->projectionsFile = projectionsHandle->getFileName();
+    this->projectionMatrixFile = projectionMatrixHandle->getFileName();
+    const DenFileInfo& pi = projectionsHandle->getInfo();
+    const DenFileInfo& mi = projectionMatrixHandle->getInfo();
+    this->projectionsRawFile = projectionsHandle->getRawFile();
+    this->projectionMatrixRawFile = projectionMatrixHandle->getRawFile();
     this->sizex = pi.dimx();
     this->sizey = pi.dimy();
     this->sizez = pi.dimz();
@@ -120,16 +139,15 @@ def getProjMatrix(file, i):
         data = np.fromfile(f, np.dtype('<f8'), 12)
         newdata = data.reshape((3, 4))
         return(newdata)
-            There was errors when multiple threads was reading the same part of memory.
-Therefore I place mutex here
+Reading is done by pread on the descriptor held by the object, so no locking is needed when
+multiple threads read matrices concurrently.
 */
 template <typename T>
 std::shared_ptr<matrix::ProjectionMatrix> DenProjectionReader<T>::readProjectionMatrix(int sliceNum)
 {
-    const std::lock_guard<std::mutex> lock(matrixReadMutex);
     uint8_t buffer[8 * 3 * 4];
     uint64_t position = this->offsetMatrix + ((uint64_t)sliceNum) * 3 * 4 * 8;
-    io::readBytesFrom(this->projectionMatrixFile, position, buffer, 8 * 3 * 4);
+    projectionMatrixRawFile->readBytesFrom(position, buffer, 8 * 3 * 4);
     double matrixData[3 * 4];
     for(uint32_t a = 0; a != 3 * 4; a++)
     {
@@ -146,12 +164,9 @@ std::shared_ptr<io::Frame2DI<T>> DenProjectionReader<T>::readProjectionSlice(int
     uint8_t* buffer = new uint8_t[elementByteSize * sizex * sizey];
     uint64_t position
         = this->offsetProjections + ((uint64_t)sliceNum) * elementByteSize * sizex * sizey;
-    io::readBytesFrom(this->projectionsFile, position, buffer, elementByteSize * sizex * sizey);
+    projectionsRawFile->readBytesFrom(position, buffer, elementByteSize * sizex * sizey);
     T* buffer_copy = new T[sizex * sizey];
-    for(uint32_t a = 0; a != sizex * sizey; a++)
-    {
-        buffer_copy[a] = util::getNextElement<T>(&buffer[a * elementByteSize], dataType);
-    }
+    util::convertElements<T>(buffer, dataType, buffer_copy, uint64_t(sizex) * sizey);
     std::shared_ptr<Frame2DI<T>> ps
         = std::make_shared<BufferedFrame2D<T>>(buffer_copy, sizex, sizey);
     delete[] buffer_copy; // Constructor creates new copy of the data
@@ -165,7 +180,7 @@ void* DenProjectionReader<T>::readNakedMemory(int sliceNum)
     uint8_t* buffer = new uint8_t[elementByteSize * sizex * sizey];
     uint64_t position
         = this->offsetProjections + ((uint64_t)sliceNum) * elementByteSize * sizex * sizey;
-    io::readBytesFrom(this->projectionsFile, position, buffer, elementByteSize * sizex * sizey);
+    projectionsRawFile->readBytesFrom(position, buffer, elementByteSize * sizex * sizey);
     return buffer;
 }
 
@@ -0,0 +1,67 @@
+#pragma once
+
+// Standard libraries
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace KCT::io {
+
+/**
+ * Options of resliceDenFile.
+ */
+struct DenResliceOptions
+{
+    /**
+     * Output dimension i is the input dimension axisOrder[i], 0 for x, 1 for y and 2 for z. The
+     * identity {0, 1, 2} with the XMajor flag changed only flips the alignment of the frames.
+     */
+    std::array<uint32_t, 3> axisOrder = { 0, 1, 2 };
+    /// Alignment of the frames of the output
+    bool XMajor = true;
+    /// Memory used for the input block and two output blocks
+    uint64_t memoryBytes = 1024 * 1024 * 1024;
+    /// Number of threads shuffling the blocks, 0 means std::thread::hardware_concurrency()
+    uint32_t numThreads = 0;
+};
+
+/**
+ * Counters of resliceDenFile.
+ */
+struct DenResliceStatistics
+{
+    /// Passes over the data, two when the fastest axis of the input becomes the slowest one
+    uint32_t passes = 0;
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+    /// Number of pread calls
+    uint64_t reads = 0;
+    /// Number of pwrite calls
+    uint64_t writes = 0;
+};
+
+/**
+ * Parse the axis order given as the input axes of the output dimensions, e.g. xzy or zxy.
+ */
+std::array<uint32_t, 3> parseAxisOrder(const std::string& order);
+
+/**
+ * Write the 3D DEN file with the axes of the input reordered, in bounded memory.
+ *
+ * The output is produced in blocks of consecutive output frames, each written by one write while
+ * the next block is being prepared. When the slowest axis in the memory of the output is the
+ * frame axis of the input, the block is read by one read of consecutive frames. When it is the
+ * slower axis within the input frames, the block is gathered by one read of consecutive rows from
+ * each input frame. The remaining case, when it is the fastest axis of the input, is done in two
+ * passes through the intermediate file output + ".tmp" with the input frames transposed. The
+ * elements are moved bitwise, the threads transpose the tiles of the block by the kernels of
+ * Transpose.hpp.
+ *
+ * @param input 2D or 3D DEN file.
+ * @param output File to create, overwritten when it exists.
+ * @param opts Options.
+ */
+DenResliceStatistics
+resliceDenFile(const std::string& input, const std::string& output, const DenResliceOptions& opts);
+
+} // namespace KCT::io
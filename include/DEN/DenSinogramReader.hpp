@@ -0,0 +1,391 @@
+#pragma once
+
+// External
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Internal
+#include "AlignedAllocator.hpp"
+#include "BufferedFrame2D.hpp"
+#include "DEN/DenElementConversion.hpp"
+#include "DEN/DenFileHandle.hpp"
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "Frame2DI.hpp"
+#include "Frame2DReaderI.hpp"
+#include "RawFile.hpp"
+#include "ShardedCache.hpp"
+#include "Transpose.hpp"
+
+namespace KCT::io {
+
+/**
+ * Counters of DenSinogramReader.
+ */
+struct SinogramReadStatistics
+{
+    /// Number of bands read from the file
+    uint64_t bandLoads = 0;
+    /// Number of pread calls
+    uint64_t reads = 0;
+    /// Bytes read from the file including the gaps read to coalesce reads
+    uint64_t bytesRead = 0;
+};
+
+/**
+ * Reader of the sinograms of the stack of projections stored in the den file.
+ *
+ * Frame y of the reader is the sinogram of the detector row y, the frame of dimx() = dimx of the
+ * projections and dimy() = number of projections, its element (x, k) is the element (x, y) of the
+ * projection k. The number of frames is the dimy of the projections.
+ *
+ * Sinograms are served from the LRU cache of bands of getBandRows() consecutive detector rows of
+ * all projections. The band is read from each projection by one read of its rows when the
+ * projections are XMajor, by one read of the run of its rows in each detector column when they are
+ * YMajor. Runs separated by gaps up to MAX_COALESCED_GAP, that are not longer than the runs, are
+ * read together by reads of up to MAX_SPAN_BYTES, so that a sweep over all the sinograms reads each
+ * byte of the file about once and at most twice. Runs shorter than MIN_RUN_BYTES are coalesced
+ * with longer gaps as well, YMajor stacks of many rows give such runs and are better resliced to
+ * XMajor first by resliceDenFile. Concurrent requests of the band, that is not cached, are served
+ * by a single load.
+ */
+template <typename T>
+class DenSinogramReader : virtual public Frame2DReaderI<T>
+// Frame2DReaderI<T> will be only once in the family tree
+{
+public:
+    /**Constructs DenSinogramReader from file name.
+     *
+     * @param projectionFile File in a DEN format with the projections as frames.
+     * @param cacheBytes Maximum number of bytes of cached bands.
+     * @param bandRows Number of detector rows in the band, 0 selects it so that four bands fit into
+     * cacheBytes.
+     */
+    DenSinogramReader(std::string projectionFile,
+                      uint64_t cacheBytes = DEFAULT_CACHE_BYTES,
+                      uint32_t bandRows = 0);
+    /**Constructs DenSinogramReader from the shared handle, the header is not parsed again.
+     *
+     * @param handle Handle obtained by DenFileHandle::open.
+     * @param cacheBytes Maximum number of bytes of cached bands.
+     * @param bandRows Number of detector rows in the band, 0 selects it automatically.
+     */
+    DenSinogramReader(std::shared_ptr<DenFileHandle> handle,
+                      uint64_t cacheBytes = DEFAULT_CACHE_BYTES,
+                      uint32_t bandRows = 0);
+    ~DenSinogramReader() = default;
+    DenSinogramReader(const DenSinogramReader<T>& b) = delete;
+    DenSinogramReader<T>& operator=(const DenSinogramReader<T>& b) = delete;
+    DenSinogramReader(DenSinogramReader<T>&& b) = delete;
+    DenSinogramReader<T>& operator=(DenSinogramReader<T>&& other) = delete;
+    std::shared_ptr<io::Frame2DI<T>> readFrame(uint64_t k) override;
+    std::shared_ptr<io::BufferedFrame2DI<T>> readBufferedFrame(uint64_t k) override;
+    void readFrameIntoBuffer(uint64_t flatFrameIndex,
+                             T* outside_buffer,
+                             bool XMajorAlignment = true) override;
+    uint32_t dimx() const override;
+    uint32_t dimy() const override;
+    uint64_t getFrameCount() const override;
+    uint64_t getFrameSize() const override;
+    uint64_t getFrameByteSize() const override;
+    std::string getFileName() const;
+    uint32_t getBandRows() const;
+    /**Hits, misses and evictions of the band cache.**/
+    CacheStatistics getCacheStatistics() const;
+    SinogramReadStatistics getStatistics() const;
+
+    /// Default budget of the band cache
+    static constexpr uint64_t DEFAULT_CACHE_BYTES = 256 * 1024 * 1024;
+    /// Maximum gap between runs in bytes that is read and discarded to coalesce reads
+    static constexpr uint64_t MAX_COALESCED_GAP = DenFrame2DReader<T>::MAX_COALESCED_GAP;
+    /// Maximum size of the coalesced read
+    static constexpr uint64_t MAX_SPAN_BYTES = DenFrame2DReader<T>::MAX_STAGING_BYTES;
+    /// Runs shorter than this are coalesced with the gaps longer than the runs
+    static constexpr uint64_t MIN_RUN_BYTES = 4096;
+
+private:
+    using Band = std::vector<T, AlignedAllocator<T>>;
+    std::string projectionFile;
+    std::shared_ptr<DenFileHandle> fileHandle;
+    std::shared_ptr<RawFile> rawFile;
+    uint64_t offset;
+    bool XMajorAlignment;
+    // Dimensions of the projections
+    uint32_t sizex, sizey;
+    uint64_t projectionCount;
+    DenSupportedType dataType;
+    uint64_t elementByteSize;
+    bool directConversion;
+    // Elements of one sinogram
+    uint64_t frameSize;
+    uint32_t bandRows;
+    std::unique_ptr<ShardedCache<uint64_t, std::shared_ptr<const Band>>> cache;
+    std::atomic<uint64_t> bandLoads{ 0 };
+    std::atomic<uint64_t> reads{ 0 };
+    std::atomic<uint64_t> bytesRead{ 0 };
+    /**
+     * Band containing the sinogram k and the index of the sinogram within it.
+     */
+    std::shared_ptr<const Band> getBand(uint64_t k, uint64_t& indexInBand);
+    std::shared_ptr<const Band> loadBand(uint64_t b);
+};
+
+template <typename T>
+DenSinogramReader<T>::DenSinogramReader(std::string projectionFile,
+                                        uint64_t cacheBytes,
+                                        uint32_t bandRows)
+    : DenSinogramReader(DenFileHandle::open(projectionFile), cacheBytes, bandRows)
+{
+}
+
+template <typename T>
+DenSinogramReader<T>::DenSinogramReader(std::shared_ptr<DenFileHandle> handle,
+                                        uint64_t cacheBytes,
+                                        uint32_t bandRows)
+    : projectionFile(handle->getFileName())
+    , fileHandle(handle)
+{
+    const DenFileInfo& pi = fileHandle->getInfo();
+    this->rawFile = fileHandle->getRawFile();
+    this->dataType = pi.getElementType();
+    DenSupportedType readerDataType = getDenSupportedTypeByTypeID(typeid(T));
+    if(dataType != readerDataType)
+    {
+        LOGW << io::xprintf("The file %s of the type %s is to be read by reader of type %s!",
+                            projectionFile.c_str(), DenSupportedTypeToString(dataType).c_str(),
+                            DenSupportedTypeToString(readerDataType).c_str());
+    }
+    int num = 1;
+    bool littleEndianArchitecture = (*(char*)&num == 1);
+    this->directConversion = dataType == readerDataType && littleEndianArchitecture;
+    this->offset = pi.getOffset();
+    this->XMajorAlignment = pi.hasXMajorAlignment();
+    this->sizex = pi.dimx();
+    this->sizey = pi.dimy();
+    this->projectionCount = pi.getFrameCount();
+    this->elementByteSize = pi.getElementByteSize();
+    this->frameSize = uint64_t(sizex) * projectionCount;
+    uint64_t sinogramBytes = std::max<uint64_t>(frameSize * sizeof(T), 1);
+    if(bandRows == 0)
+    {
+        bandRows = std::min<uint64_t>(cacheBytes / 4 / sinogramBytes, sizey);
+    } else if(uint64_t(bandRows) * sinogramBytes > cacheBytes)
+    {
+        LOGW << io::xprintf("Band of %u sinograms of %lu bytes does not fit into the cache of %lu "
+                            "bytes, bands will not be cached.",
+                            bandRows, sinogramBytes, cacheBytes);
+    }
+    this->bandRows = std::max<uint32_t>(std::min<uint32_t>(bandRows, sizey), 1);
+    // Bands are large and few, single shard keeps the exact LRU order over the whole budget
+    cache = std::make_unique<ShardedCache<uint64_t, std::shared_ptr<const Band>>>(
+        cacheBytes, CachePolicy::LRU, 1);
+}
+
+template <typename T>
+std::shared_ptr<const typename DenSinogramReader<T>::Band>
+DenSinogramReader<T>::getBand(uint64_t k, uint64_t& indexInBand)
+{
+    if(k >= sizey)
+    {
+        KCTERR(io::xprintf("Sinogram %lu out of range of %u sinograms of the file %s.", k, sizey,
+                           projectionFile.c_str()));
+    }
+    uint64_t b = k / bandRows;
+    indexInBand = k % bandRows;
+    return cache->getOrLoad(b, [this, b]() {
+        std::shared_ptr<const Band> band = loadBand(b);
+        return std::make_pair(band, uint64_t(band->size() * sizeof(T)));
+    });
+}
+
+template <typename T>
+std::shared_ptr<const typename DenSinogramReader<T>::Band>
+DenSinogramReader<T>::loadBand(uint64_t b)
+{
+    const uint64_t e = elementByteSize;
+    uint64_t y0 = b * bandRows;
+    uint64_t n = std::min<uint64_t>(bandRows, sizey - y0);
+    // Runs of the same length L follow in the file with the stride S, the run i is stored in raw
+    // at i * L
+    uint64_t L, S, runCount, firstPosition;
+    if(XMajorAlignment)
+    {
+        L = n * sizex * e;
+        S = uint64_t(sizey) * sizex * e;
+        runCount = projectionCount;
+        firstPosition = offset + y0 * sizex * e;
+    } else
+    {
+        L = n * e;
+        S = sizey * e;
+        runCount = projectionCount * sizex;
+        firstPosition = offset + y0 * e;
+    }
+    uint64_t gap = S - L;
+    std::vector<uint8_t, AlignedAllocator<uint8_t>> raw(runCount * L);
+    uint64_t readCount = 0, readBytes = 0;
+    if(gap == 0)
+    {
+        // Whole frames, one contiguous range
+        rawFile->readBytesFrom(firstPosition, raw.data(), runCount * L);
+        readCount++;
+        readBytes += runCount * L;
+    } else if(gap <= MAX_COALESCED_GAP && (gap <= L || L < MIN_RUN_BYTES))
+    {
+        uint64_t runsPerSpan = std::max<uint64_t>(MAX_SPAN_BYTES / S, 1);
+        for(uint64_t i = 0; i < runCount; i += runsPerSpan)
+        {
+            uint64_t m = std::min(runsPerSpan, runCount - i);
+            uint64_t spanBytes = (m - 1) * S + L;
+            uint8_t* span = threadScratchBuffer(spanBytes);
+            rawFile->readBytesFrom(firstPosition + i * S, span, spanBytes);
+            for(uint64_t j = 0; j != m; j++)
+            {
+                std::memcpy(raw.data() + (i + j) * L, span + j * S, L);
+            }
+            readCount++;
+            readBytes += spanBytes;
+        }
+    } else
+    {
+        for(uint64_t i = 0; i != runCount; i++)
+        {
+            rawFile->readBytesFrom(firstPosition + i * S, raw.data() + i * L, L);
+        }
+        readCount += runCount;
+        readBytes += runCount * L;
+    }
+    reads += readCount;
+    bytesRead += readBytes;
+    bandLoads++;
+    // Band stores the sinograms y0, ..., y0 + n - 1 one after another
+    std::shared_ptr<Band> band = std::make_shared<Band>(n * frameSize);
+    uint64_t projectionRawBytes = n * sizex * e;
+    for(uint64_t k = 0; k != projectionCount; k++)
+    {
+        uint8_t* p = raw.data() + k * projectionRawBytes;
+        T* o = band->data() + k * sizex;
+        if(directConversion)
+        {
+            if(XMajorAlignment)
+            {
+                for(uint64_t r = 0; r != n; r++)
+                {
+                    std::memcpy(o + r * frameSize, p + r * sizex * e, sizex * e);
+                }
+            } else
+            {
+                transposeElements(p, n, o, frameSize, sizex, n, e);
+            }
+            continue;
+        }
+        if(!XMajorAlignment)
+        {
+            // Rows of the projection put one after another before the conversion
+            uint8_t* transposed = threadTransposeBuffer(projectionRawBytes);
+            transposeElements(p, n, transposed, sizex, sizex, n, e);
+            p = transposed;
+        }
+        for(uint64_t r = 0; r != n; r++)
+        {
+            util::convertElements<T>(p + r * sizex * e, dataType, o + r * frameSize, sizex);
+        }
+    }
+    return band;
+}
+
+template <typename T>
+std::shared_ptr<io::Frame2DI<T>> DenSinogramReader<T>::readFrame(uint64_t k)
+{
+    std::shared_ptr<Frame2DI<T>> f = readBufferedFrame(k);
+    return f;
+}
+
+template <typename T>
+std::shared_ptr<io::BufferedFrame2DI<T>> DenSinogramReader<T>::readBufferedFrame(uint64_t k)
+{
+    uint64_t indexInBand;
+    std::shared_ptr<const Band> band = getBand(k, indexInBand);
+    return std::make_shared<BufferedFrame2D<T>>(band->data() + indexInBand * frameSize, sizex,
+                                                projectionCount);
+}
+
+template <typename T>
+void DenSinogramReader<T>::readFrameIntoBuffer(uint64_t k, T* outside_buffer, bool XMajorAlignment)
+{
+    uint64_t indexInBand;
+    std::shared_ptr<const Band> band = getBand(k, indexInBand);
+    const T* sinogram = band->data() + indexInBand * frameSize;
+    if(XMajorAlignment)
+    {
+        std::copy(sinogram, sinogram + frameSize, outside_buffer);
+    } else
+    {
+        transpose<T>(sinogram, outside_buffer, projectionCount, sizex);
+    }
+}
+
+template <typename T>
+uint32_t DenSinogramReader<T>::dimx() const
+{
+    return sizex;
+}
+
+template <typename T>
+uint32_t DenSinogramReader<T>::dimy() const
+{
+    return projectionCount;
+}
+
+template <typename T>
+uint64_t DenSinogramReader<T>::getFrameCount() const
+{
+    return sizey;
+}
+
+template <typename T>
+uint64_t DenSinogramReader<T>::getFrameSize() const
+{
+    return frameSize;
+}
+
+template <typename T>
+uint64_t DenSinogramReader<T>::getFrameByteSize() const
+{
+    return frameSize * elementByteSize;
+}
+
+template <typename T>
+std::string DenSinogramReader<T>::getFileName() const
+{
+    return projectionFile;
+}
+
+template <typename T>
+uint32_t DenSinogramReader<T>::getBandRows() const
+{
+    return bandRows;
+}
+
+template <typename T>
+CacheStatistics DenSinogramReader<T>::getCacheStatistics() const
+{
+    return cache->getStatistics();
+}
+
+template <typename T>
+SinogramReadStatistics DenSinogramReader<T>::getStatistics() const
+{
+    SinogramReadStatistics s;
+    s.bandLoads = bandLoads;
+    s.reads = reads;
+    s.bytesRead = bytesRead;
+    return s;
+}
+
+} // namespace KCT::io
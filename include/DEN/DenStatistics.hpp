@@ -0,0 +1,78 @@
+#pragma once
+
+// Standard libraries
+#include <cstdint>
+#include <vector>
+
+// Internal libraries
+#include "DEN/DenSupportedType.hpp"
+#include "RawFile.hpp"
+
+namespace KCT::io {
+
+/**
+ * Options of DenFileInfo::computeStatistics.
+ */
+struct DenStatisticsOptions
+{
+    /// Number of threads scanning the file, 0 means std::thread::hardware_concurrency()
+    uint32_t numThreads = 0;
+    /// Percentiles to compute from the range [0, 100], empty means no histogram is collected
+    std::vector<double> percentiles;
+    /// Size of the block of data read by one pread and processed by one thread
+    uint64_t blockByteSize = 8 * 1024 * 1024;
+    /// Read the data with O_DIRECT not to pollute the page cache by the volume scanned once
+    bool directIO = false;
+};
+
+/**
+ * Statistics of the elements of a DEN file.
+ *
+ * NaN and infinite elements of the floating point files are only counted, all the other statistics
+ * are computed over finite elements. When there is no finite element, min, max, mean and variance
+ * are NaN.
+ */
+struct DenStatistics
+{
+    /// Number of finite elements
+    uint64_t count = 0;
+    uint64_t nanCount = 0;
+    uint64_t posInfCount = 0;
+    uint64_t negInfCount = 0;
+    double min;
+    double max;
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    double mean;
+    /// Population variance, the sum of squared deviations divided by count
+    double variance;
+    /// Values of DenStatisticsOptions::percentiles in the same order
+    std::vector<double> percentiles;
+    /**
+     * True for UINT8, UINT16 and INT16 files, where percentiles are computed from the exact
+     * histogram. For other types the histogram has 2^16 logarithmically spaced bins, with linear
+     * interpolation inside the bin the relative error is below 2^-7.
+     */
+    bool exactPercentiles = false;
+};
+
+/**
+ * Single pass parallel computation of the statistics of the elements stored in the file.
+ *
+ * The data part is split into blocks processed by the pool of threads. Each block is summarized by
+ * count, mean and the sum of squared deviations and blocks are merged by the formula of Chan et
+ * al. in the order of the file, so that the result does not depend on the scheduling.
+ *
+ * @param rawFile File to read.
+ * @param elementType Type of the elements.
+ * @param offset Position of the first element.
+ * @param elementCount Number of elements.
+ * @param opts Options.
+ */
+DenStatistics computeDenStatistics(const RawFile& rawFile,
+                                   DenSupportedType elementType,
+                                   uint64_t offset,
+                                   uint64_t elementCount,
+                                   const DenStatisticsOptions& opts);
+
+} // namespace KCT::io
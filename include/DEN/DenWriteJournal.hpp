@@ -0,0 +1,150 @@
+#pragma once
+
+// Standard libraries
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Internal libraries
+#include "RawFile.hpp"
+
+namespace KCT::io {
+
+/**
+ * When DenWriteJournal persists the bitmap automatically.
+ *
+ * NONE persists it only by checkpoint and on destruction. EVERY_N_FRAMES after each
+ * DenWriteJournalPolicy::frames written frames, EVERY_T_SECONDS after the first frame written
+ * DenWriteJournalPolicy::seconds after the last checkpoint.
+ */
+enum class JournalDurability { NONE, EVERY_N_FRAMES, EVERY_T_SECONDS };
+
+/**
+ * How the data file and the journal are synchronized at the checkpoint.
+ *
+ * FDATASYNC survives the power loss. SYNC_FILE_RANGE only waits for the writeback of the dirty
+ * pages, it is cheaper but does not flush the disk cache nor the metadata, so it protects against
+ * the crash of the process or kernel only.
+ */
+enum class JournalSyncMethod { FDATASYNC, SYNC_FILE_RANGE };
+
+struct DenWriteJournalPolicy
+{
+    JournalDurability durability = JournalDurability::EVERY_T_SECONDS;
+    uint64_t frames = 1024;
+    double seconds = 5.0;
+    JournalSyncMethod method = JournalSyncMethod::FDATASYNC;
+};
+
+/**
+ * Counters of DenWriteJournal, the time spent in the checkpoints is their durability cost.
+ */
+struct DenWriteJournalStatistics
+{
+    /// Checkpoints that persisted some new frames
+    uint64_t checkpoints = 0;
+    /// Time spent by the checkpoints including the synchronization of the data file
+    double checkpointSeconds = 0.0;
+};
+
+/**
+ * Sidecar journal of the frames of the DEN file that were completely written.
+ *
+ * The journal file getJournalPath(denFile) holds a 56 byte header identifying the layout of the
+ * frames and the data file by its device, inode and modification time at the last checkpoint,
+ * followed by the bitmap of the written frames in little endian 64 bit words. Frames are
+ * marked by markWritten after their write returned, without lock. The checkpoint first
+ * synchronizes the data file and only then writes and synchronizes the changed words of the
+ * bitmap, so that the frame is in the journal only when its data are durable. After the crash
+ * pendingFrames lists the frames to write again, marks lost since the last checkpoint only cause
+ * their frames to be rewritten. The automatic checkpoints are done by the thread of markWritten
+ * that crosses the threshold while other threads continue writing.
+ */
+class DenWriteJournal
+{
+public:
+    /**
+     * @param dataFile Writable DEN file.
+     * @param offset Position of the frame 0 in the data file.
+     * @param frameByteSize Size of each frame in bytes.
+     * @param frameCount Number of frames.
+     * @param resume Keep the frames of existing journal with the same layout, that belongs to the
+     * data file, otherwise the journal starts empty. The journal belongs to the data file with the
+     * same device and inode, that was not modified before its last checkpoint.
+     * @param policy When and how are the checkpoints done.
+     */
+    DenWriteJournal(std::shared_ptr<RawFile> dataFile,
+                    uint64_t offset,
+                    uint64_t frameByteSize,
+                    uint64_t frameCount,
+                    bool resume = true,
+                    DenWriteJournalPolicy policy = DenWriteJournalPolicy());
+    /**
+     * Checkpoint, the errors are logged.
+     */
+    ~DenWriteJournal();
+    DenWriteJournal(const DenWriteJournal& b) = delete;
+    DenWriteJournal& operator=(const DenWriteJournal& b) = delete;
+
+    static std::string getJournalPath(std::string denFile);
+
+    /**
+     * Record that the frame k was written to the data file, checkpoint according to the policy.
+     */
+    void markWritten(uint64_t k);
+    bool isWritten(uint64_t k) const;
+
+    /**
+     * Frames not marked as written, including the frames written before resume.
+     */
+    std::vector<uint64_t> pendingFrames() const;
+
+    /**
+     * Persist the frames marked so far.
+     */
+    void checkpoint();
+
+    /**
+     * Checkpoint and when all the frames are written, remove the journal file, so that the next
+     * run writing the same file does not take its frames as written.
+     *
+     * @return True when the journal file was removed.
+     */
+    bool complete();
+
+    std::string getFileName() const;
+    DenWriteJournalStatistics getStatistics() const;
+
+private:
+    static constexpr uint64_t HEADER_BYTES = 56;
+    void writeHeader();
+    bool readJournal();
+    void synchronize(const RawFile& f) const;
+    void persist();
+    void putIdentity(uint8_t* out) const;
+
+    std::shared_ptr<RawFile> dataFile;
+    std::string journalFile;
+    uint64_t offset;
+    uint64_t frameByteSize;
+    uint64_t frameCount;
+    uint64_t words;
+    DenWriteJournalPolicy policy;
+    std::shared_ptr<RawFile> journal;
+    std::unique_ptr<std::atomic<uint64_t>[]> bitmap;
+    std::atomic<uint64_t> markedSinceCheckpoint{ 0 };
+    std::atomic<int64_t> lastCheckpointNsec;
+
+    // Held by the thread doing the checkpoint
+    mutable std::mutex checkpointMutex;
+    std::vector<uint64_t> persisted;
+    // Journal file was removed by complete
+    bool removed = false;
+    DenWriteJournalStatistics statistics;
+};
+
+} // namespace KCT::io
@@ -1,5 +1,8 @@
 #pragma once
 // External libraries
+#include <memory>
+#include <utility>
+#include <vector>
 
 // Internal libraries
 #include "BufferedFrame2DI.hpp"
@@ -24,12 +27,63 @@ namespace io {
         /*Returns k-th frame in the source as BufferedFrame2D object.*/
         virtual std::shared_ptr<io::BufferedFrame2DI<T>> readBufferedFrame(uint64_t k) = 0;
 
+        /*Returns k-th frame in the source that might be shared with other readers and must not
+         * be modified. Implementations might serve it from the process wide FrameCache, the
+         * default reads a new frame.*/
+        virtual std::shared_ptr<const io::BufferedFrame2DI<T>> readSharedFrame(uint64_t k)
+        {
+            return readBufferedFrame(k);
+        }
+
         /*Reads k-th frame in the source into provided buffer. The buffer should be large enough to
          * hold the frame data. If XMajorAlignment is true, the data will be read in row-major
          * order, otherwise in column-major order.*/
         virtual void readFrameIntoBuffer(uint64_t flatFrameIndex,
                                          T* outside_buffer,
-                                         bool XMajorAlignment = true) = 0; 
+                                         bool XMajorAlignment = true) = 0;
+
+        /*Reads count consecutive frames starting at fromFrame into the buffer of count *
+         * getFrameSize() elements. Implementations might read the whole range at once, the default
+         * reads frame by frame.*/
+        virtual void readFramesIntoBuffer(uint64_t fromFrame,
+                                          uint64_t count,
+                                          T* outside_buffer,
+                                          bool XMajorAlignment = true)
+        {
+            uint64_t frameSize = getFrameSize();
+            for(uint64_t i = 0; i != count; i++)
+            {
+                readFrameIntoBuffer(fromFrame + i, outside_buffer + i * frameSize, XMajorAlignment);
+            }
+        }
+
+        /*Reads frames given by the list of (frame index, destination buffer) pairs in any order.
+         * Implementations might coalesce reads of the frames adjacent in the source, the default
+         * reads frame by frame.*/
+        virtual void readFramesIntoBuffers(const std::vector<std::pair<uint64_t, T*>>& frames,
+                                           bool XMajorAlignment = true)
+        {
+            for(const std::pair<uint64_t, T*>& f : frames)
+            {
+                readFrameIntoBuffer(f.first, f.second, XMajorAlignment);
+            }
+        }
+
+        /*Reads frames given by frameIndices, e.g. ArgumentsFramespec::frames, into the buffer of
+         * frameIndices.size() * getFrameSize() elements in the order of the list.*/
+        void readFramesIntoBuffer(const std::vector<uint64_t>& frameIndices,
+                                  T* outside_buffer,
+                                  bool XMajorAlignment = true)
+        {
+            uint64_t frameSize = getFrameSize();
+            std::vector<std::pair<uint64_t, T*>> frames;
+            frames.reserve(frameIndices.size());
+            for(std::size_t i = 0; i != frameIndices.size(); i++)
+            {
+                frames.emplace_back(frameIndices[i], outside_buffer + i * frameSize);
+            }
+            readFramesIntoBuffers(frames, XMajorAlignment);
+        }
 
         /**Returns x dimension.*/
         virtual uint32_t dimx() const = 0;
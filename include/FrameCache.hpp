@@ -0,0 +1,172 @@
+#pragma once
+
+// Standard libraries
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+
+// Internal libraries
+#include "BufferedFrame2DI.hpp"
+#include "DEN/DenSupportedType.hpp"
+#include "RawFile.hpp"
+#include "ShardedCache.hpp"
+
+namespace KCT::io {
+
+/**
+ * Key of the frame in FrameCache.
+ */
+struct FrameCacheKey
+{
+    FileIdentity file;
+    uint64_t frame = 0;
+    /// Element type of the cached frame, that is the type of the reader, not of the file
+    DenSupportedType elementType = DenSupportedType::FLOAT32;
+    bool XMajorAlignment = true;
+    bool operator==(const FrameCacheKey& b) const;
+};
+
+struct FrameCacheKeyHash
+{
+    std::size_t operator()(const FrameCacheKey& k) const;
+};
+
+/**
+ * Process wide cache of immutable frames with the single memory budget shared by all readers.
+ *
+ * Readers opt in by Frame2DReaderI::readSharedFrame, so that readers of the same file in different
+ * threads or in different parts of the program share one copy of each frame and one read. Frames
+ * are keyed by the identity of the file, index of the frame, element type and alignment, the
+ * rewritten file has a new identity and its stale frames are evicted as any other frames.
+ *
+ * The budget is 0 until configure is called, then frames are loaded on each request and not
+ * retained. Concurrent requests of the frame, that is not cached, are served by a single load.
+ */
+class FrameCache
+{
+public:
+    static FrameCache& instance();
+
+    /**
+     * Replace the cache by the empty cache with the given budget, pins are released.
+     *
+     * @param byteBudget Maximum number of bytes of cached frames, 0 disables caching.
+     * @param policy Replacement policy.
+     * @param shardCount Number of independently locked shards.
+     */
+    void configure(uint64_t byteBudget,
+                   CachePolicy policy = CachePolicy::LRU,
+                   uint32_t shardCount = 16);
+    uint64_t getByteBudget() const;
+
+    template <typename T>
+    std::shared_ptr<const BufferedFrame2DI<T>> lookup(const FrameCacheKey& key);
+
+    /**
+     * @return True if the frame is cached after the call.
+     */
+    template <typename T>
+    bool insert(const FrameCacheKey& key, std::shared_ptr<const BufferedFrame2DI<T>> frame);
+
+    /**
+     * Get the cached frame or load it by the loader and cache it.
+     *
+     * When other thread loads the same frame, waits for its result instead of loading it again.
+     * Exception of the loader is propagated to all waiting threads.
+     */
+    template <typename T>
+    std::shared_ptr<const BufferedFrame2DI<T>>
+    getOrLoad(const FrameCacheKey& key,
+              const std::function<std::shared_ptr<const BufferedFrame2DI<T>>()>& loader);
+
+    /**
+     * Keep the cached frame resident until unpin, pins are counted.
+     *
+     * @return False if the frame is not cached.
+     */
+    bool pin(const FrameCacheKey& key);
+    bool unpin(const FrameCacheKey& key);
+    bool erase(const FrameCacheKey& key);
+    void clear();
+
+    /**
+     * Statistics of the whole cache.
+     */
+    CacheStatistics getStatistics() const;
+
+    /**
+     * Hits, misses, insertions, evictions and resident entries and bytes of the frames of the
+     * file, pinned is not tracked per file.
+     */
+    CacheStatistics getFileStatistics(const FileIdentity& file) const;
+    std::map<FileIdentity, CacheStatistics> getFileStatistics() const;
+    /**
+     * Reset the hits, misses, insertions and evictions. Files without resident frames are no
+     * longer tracked, so that the files replaced on disk do not accumulate.
+     */
+    void resetStatistics();
+
+private:
+    using Erased = std::shared_ptr<const void>;
+    using Cache = ShardedCache<FrameCacheKey, Erased, FrameCacheKeyHash>;
+    struct FileCounters
+    {
+        std::atomic<uint64_t> hits{ 0 };
+        std::atomic<uint64_t> misses{ 0 };
+        std::atomic<uint64_t> insertions{ 0 };
+        std::atomic<uint64_t> evictions{ 0 };
+        std::atomic<uint64_t> entries{ 0 };
+        std::atomic<uint64_t> bytes{ 0 };
+    };
+
+    FrameCache();
+    FrameCache(const FrameCache& b) = delete;
+    FrameCache& operator=(const FrameCache& b) = delete;
+
+    std::shared_ptr<Cache> getCache() const;
+    // Counters of the file, lock is held while they are updated so that they are not pruned
+    FileCounters& countersOf(const FileIdentity& file, std::shared_lock<std::shared_mutex>& lock);
+    Erased lookupErased(const FrameCacheKey& key);
+    bool insertErased(const FrameCacheKey& key, Erased frame, uint64_t bytes);
+    Erased getOrLoadErased(const FrameCacheKey& key,
+                           const std::function<std::pair<Erased, uint64_t>()>& loader);
+
+    // Replaced by configure while other threads hold the previous cache
+    std::shared_ptr<Cache> cache;
+    mutable std::mutex configureMutex;
+    mutable std::shared_mutex filesMutex;
+    std::map<FileIdentity, std::unique_ptr<FileCounters>> files;
+};
+
+template <typename T>
+std::shared_ptr<const BufferedFrame2DI<T>> FrameCache::lookup(const FrameCacheKey& key)
+{
+    return std::static_pointer_cast<const BufferedFrame2DI<T>>(lookupErased(key));
+}
+
+template <typename T>
+bool FrameCache::insert(const FrameCacheKey& key, std::shared_ptr<const BufferedFrame2DI<T>> frame)
+{
+    uint64_t bytes = uint64_t(frame->dimx()) * frame->dimy() * sizeof(T);
+    return insertErased(key, std::move(frame), bytes);
+}
+
+template <typename T>
+std::shared_ptr<const BufferedFrame2DI<T>>
+FrameCache::getOrLoad(const FrameCacheKey& key,
+                      const std::function<std::shared_ptr<const BufferedFrame2DI<T>>()>& loader)
+{
+    Erased f = getOrLoadErased(key, [&loader]() {
+        std::shared_ptr<const BufferedFrame2DI<T>> frame = loader();
+        uint64_t bytes = uint64_t(frame->dimx()) * frame->dimy() * sizeof(T);
+        return std::pair<Erased, uint64_t>(std::move(frame), bytes);
+    });
+    return std::static_pointer_cast<const BufferedFrame2DI<T>>(f);
+}
+
+} // namespace KCT::io
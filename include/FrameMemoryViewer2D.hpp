@@ -7,21 +7,28 @@ namespace KCT {
 namespace io {
     /** Provide view of the memory in the form of Frame2DI. Do not manage the memory.
      *
+     * The memory is x major by default, that is the element (x, y) is at y * sizex + x. With
+     * XMajorAlignment false it is at x * sizey + y as in the frames of the DEN files with the y
+     * major alignment.
      */
     template <typename T>
     class FrameMemoryViewer2D : public Frame2DI<T>
     {
     public:
-        FrameMemoryViewer2D(T* frameDataPointer, uint32_t sizex, uint32_t sizey)
+        FrameMemoryViewer2D(T* frameDataPointer,
+                            uint32_t sizex,
+                            uint32_t sizey,
+                            bool XMajorAlignment = true)
             : frameDataPointer(frameDataPointer)
             , sizex(sizex)
             , sizey(sizey)
+            , XMajorAlignment(XMajorAlignment)
         {
             this->frameSize = (uint64_t)sizex * (uint64_t)sizey;
         }
 
         FrameMemoryViewer2D(const FrameMemoryViewer2D& b)
-            : FrameMemoryViewer2D(b.frameDataPointer, b.sizex, b.sizey)
+            : FrameMemoryViewer2D(b.frameDataPointer, b.sizex, b.sizey, b.XMajorAlignment)
         {
         } // copy constructor
 
@@ -36,10 +43,10 @@ namespace io {
         FrameMemoryViewer2D& operator=(FrameMemoryViewer2D&& other) = delete;
 
         /**Get the value at coordinates x, y.*/
-        T get(uint32_t x, uint32_t y) const override { return frameDataPointer[y * sizex + x]; }
+        T get(uint32_t x, uint32_t y) const override { return frameDataPointer[index(x, y)]; }
 
         /**Set the value at coordinates x, y.*/
-        void set(T val, uint32_t x, uint32_t y) override { frameDataPointer[y * sizex + x] = val; }
+        void set(T val, uint32_t x, uint32_t y) override { frameDataPointer[index(x, y)] = val; }
 
         /**Returns x dimension.*/
         uint32_t dimx() const override { return sizex; }
@@ -50,9 +57,21 @@ namespace io {
         /**Returns frameSize.*/
         uint64_t getFrameSize() const override { return frameSize; }
 
+        /**Pointer to the viewed memory, const view gives read only access.*/
+        T* data() { return frameDataPointer; }
+        const T* data() const { return frameDataPointer; }
+
+        bool hasXMajorAlignment() const { return XMajorAlignment; }
+
     private:
+        uint64_t index(uint32_t x, uint32_t y) const
+        {
+            return XMajorAlignment ? uint64_t(y) * sizex + x : uint64_t(x) * sizey + y;
+        }
+
         T* frameDataPointer;
         uint32_t sizex, sizey;
+        bool XMajorAlignment;
         uint64_t frameSize;
     };
 } // namespace io
@@ -0,0 +1,257 @@
+#pragma once
+
+// Standard libraries
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sys/mman.h>
+#include <vector>
+
+// Internal libraries
+#include "AlignedAllocator.hpp"
+
+namespace KCT::io {
+
+template <typename T>
+class FramePool;
+
+/**
+ * Deleter of the frame buffers, returns the buffer to its pool or frees it when there is no pool.
+ *
+ * The deleter holds the pool, so that the pool outlives all the buffers borrowed from it.
+ */
+template <typename T>
+struct FrameBufferDeleter
+{
+    std::shared_ptr<FramePool<T>> pool;
+    void operator()(T* p) const;
+};
+
+/**
+ * Counters of FramePool.
+ */
+struct FramePoolStatistics
+{
+    /// Buffers allocated from the system
+    uint64_t allocations = 0;
+    /// Buffers handed out by acquire
+    uint64_t acquisitions = 0;
+    /// Buffers released to the system because the pool was full
+    uint64_t deallocations = 0;
+    /// Buffers held by the pool ready to be reused
+    uint64_t idle = 0;
+    /// Buffers borrowed and not yet returned
+    uint64_t outstanding = 0;
+};
+
+/**
+ * Thread safe pool of fixed size frame buffers.
+ *
+ * Reading frames at high rates allocates and frees buffers of the same size over and over, the
+ * allocator serializes the threads and large buffers are returned to the system and faulted in
+ * again. The pool keeps released buffers and reuses them, so that in the steady state no memory is
+ * allocated per frame. Buffers are returned by FrameBufferDeleter, e.g. when the BufferedFrame2D
+ * holding them is destroyed.
+ *
+ * Construct the pool by std::make_shared, buffers keep the pool alive.
+ */
+template <typename T>
+class FramePool : public std::enable_shared_from_this<FramePool<T>>
+{
+public:
+    /// Alignment of the transparent huge pages on x86_64
+    static constexpr std::size_t HUGE_PAGE_ALIGNMENT = 2 * 1024 * 1024;
+    using Buffer = std::unique_ptr<T[], FrameBufferDeleter<T>>;
+
+    /**
+     * @param elementCount Number of elements of each buffer.
+     * @param alignment Alignment of the buffers in bytes, use DIRECT_IO_ALIGNMENT for O_DIRECT.
+     * @param hugePages Align the buffers to HUGE_PAGE_ALIGNMENT and advise the kernel to back them
+     * by transparent huge pages, for the frames of several megabytes.
+     * @param maxIdle Maximum number of buffers kept by the pool, further released buffers are
+     * freed.
+     */
+    FramePool(uint64_t elementCount,
+              std::size_t alignment = 64,
+              bool hugePages = false,
+              uint32_t maxIdle = 64);
+    ~FramePool();
+    FramePool(const FramePool& b) = delete;
+    FramePool& operator=(const FramePool& b) = delete;
+
+    /**
+     * Get the buffer of getElementCount() uninitialized elements.
+     */
+    Buffer acquire();
+
+    /**
+     * Allocate count buffers in advance, so that even the first reads do not allocate.
+     */
+    void reserve(uint32_t count);
+
+    /**
+     * Free the idle buffers.
+     */
+    void shrink();
+
+    uint64_t getElementCount() const;
+    std::size_t getAlignment() const;
+    FramePoolStatistics getStatistics() const;
+
+private:
+    friend struct FrameBufferDeleter<T>;
+    void release(T* p);
+    T* allocate();
+
+    uint64_t elementCount;
+    std::size_t alignment;
+    bool hugePages;
+    uint32_t maxIdle;
+    mutable std::mutex mutex;
+    std::vector<T*> idle;
+    FramePoolStatistics statistics;
+};
+
+template <typename T>
+void FrameBufferDeleter<T>::operator()(T* p) const
+{
+    if(pool != nullptr)
+    {
+        pool->release(p);
+    } else
+    {
+        alignedFree(p);
+    }
+}
+
+template <typename T>
+FramePool<T>::FramePool(uint64_t elementCount,
+                        std::size_t alignment,
+                        bool hugePages,
+                        uint32_t maxIdle)
+    : elementCount(elementCount)
+    , alignment(hugePages ? std::max(alignment, HUGE_PAGE_ALIGNMENT) : alignment)
+    , hugePages(hugePages)
+    , maxIdle(maxIdle)
+{
+}
+
+template <typename T>
+FramePool<T>::~FramePool()
+{
+    shrink();
+}
+
+template <typename T>
+T* FramePool<T>::allocate()
+{
+    T* p = alignedAllocate<T>(elementCount, alignment);
+#ifdef MADV_HUGEPAGE
+    if(hugePages)
+    {
+        // Only advice, ignore the failure when transparent huge pages are disabled
+        uint64_t byteSize = elementCount * sizeof(T);
+        madvise(p, (byteSize + HUGE_PAGE_ALIGNMENT - 1) / HUGE_PAGE_ALIGNMENT * HUGE_PAGE_ALIGNMENT,
+                MADV_HUGEPAGE);
+    }
+#endif
+    return p;
+}
+
+template <typename T>
+typename FramePool<T>::Buffer FramePool<T>::acquire()
+{
+    T* p = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        statistics.acquisitions++;
+        statistics.outstanding++;
+        if(!idle.empty())
+        {
+            p = idle.back();
+            idle.pop_back();
+        } else
+        {
+            statistics.allocations++;
+        }
+    }
+    if(p == nullptr)
+    {
+        try
+        {
+            p = allocate();
+        } catch(...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            statistics.outstanding--;
+            throw;
+        }
+    }
+    return Buffer(p, FrameBufferDeleter<T>{ this->shared_from_this() });
+}
+
+template <typename T>
+void FramePool<T>::release(T* p)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        statistics.outstanding--;
+        if(idle.size() < maxIdle)
+        {
+            idle.push_back(p);
+            return;
+        }
+        statistics.deallocations++;
+    }
+    alignedFree(p);
+}
+
+template <typename T>
+void FramePool<T>::reserve(uint32_t count)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    while(idle.size() < std::min(count, maxIdle))
+    {
+        idle.push_back(allocate());
+        statistics.allocations++;
+    }
+}
+
+template <typename T>
+void FramePool<T>::shrink()
+{
+    std::vector<T*> freed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freed.swap(idle);
+        statistics.deallocations += freed.size();
+    }
+    for(T* p : freed)
+    {
+        alignedFree(p);
+    }
+}
+
+template <typename T>
+uint64_t FramePool<T>::getElementCount() const
+{
+    return elementCount;
+}
+
+template <typename T>
+std::size_t FramePool<T>::getAlignment() const
+{
+    return alignment;
+}
+
+template <typename T>
+FramePoolStatistics FramePool<T>::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    FramePoolStatistics s = statistics;
+    s.idle = idle.size();
+    return s;
+}
+
+} // namespace KCT::io
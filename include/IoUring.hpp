@@ -0,0 +1,103 @@
+#pragma once
+// Logging
+#include <plog/Log.h>
+
+// Standard libraries
+#include <cstdint>
+#include <string>
+#include <sys/uio.h>
+
+// Internal libraries
+#include "PROG/KCTException.hpp"
+#include "stringFormatter.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define KCT_HAVE_IO_URING 1
+#endif
+
+namespace KCT::io {
+/**
+ * Minimal io_uring submission/completion queue pair implemented by raw system calls.
+ *
+ * Only vectored reads are supported, which is what is needed to keep many frame reads in flight
+ * from a single thread. The object is not thread safe, submissions and completions shall be
+ * processed by one thread. When the kernel or the platform does not provide io_uring, the
+ * constructor throws KCTException, use isAvailable() to test it beforehand.
+ */
+class IoUring
+{
+public:
+    /**
+     * Setup the ring.
+     *
+     * @param queueDepth Requested number of submission queue entries.
+     */
+    IoUring(uint32_t queueDepth);
+    ~IoUring();
+    IoUring(const IoUring& b) = delete;
+    IoUring& operator=(const IoUring& b) = delete;
+    IoUring(IoUring&& b) = delete;
+    IoUring& operator=(IoUring&& b) = delete;
+
+    /**
+     * Test if io_uring can be used on the running kernel.
+     */
+    static bool isAvailable();
+
+    /**
+     * Put vectored read into the submission queue, it is passed to the kernel by submit().
+     *
+     * @param fd File descriptor to read from.
+     * @param iov Pointer to the iovec that must be valid until the completion is reaped.
+     * @param offset Position in the file.
+     * @param userData Value returned with the completion.
+     *
+     * @return False if the submission queue is full.
+     */
+    bool prepareReadv(int fd, const struct iovec* iov, uint64_t offset, uint64_t userData);
+
+    /**
+     * Pass all prepared submissions to the kernel.
+     *
+     * @param waitCompletions Block until at least this number of completions is available.
+     */
+    void submit(uint32_t waitCompletions = 0);
+
+    /**
+     * Reap one completion if available.
+     *
+     * @param userData Value passed to prepareReadv.
+     * @param result Number of bytes transferred or negative errno.
+     *
+     * @return False if there is no completion available.
+     */
+    bool peekCompletion(uint64_t& userData, int32_t& result);
+
+    /**
+     * Block until one completion is available and reap it.
+     */
+    void waitCompletion(uint64_t& userData, int32_t& result);
+
+    uint32_t getQueueDepth() const;
+
+private:
+    int ringFd = -1;
+    uint32_t sqEntries = 0;
+    uint32_t toSubmit = 0;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    void* sqes = nullptr;
+    uint64_t sqRingSize = 0;
+    uint64_t cqRingSize = 0;
+    uint64_t sqesSize = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    void* cqes = nullptr;
+    void release();
+};
+} // namespace KCT::io
@@ -0,0 +1,70 @@
+#pragma once
+// Logging
+#include <plog/Log.h>
+
+// Standard libraries
+#include <cstdint>
+#include <string>
+
+// Internal libraries
+#include "PROG/KCTException.hpp"
+#include "RawFile.hpp"
+#include "stringFormatter.h"
+
+namespace KCT::io {
+
+/**
+ * Expected access pattern passed to the kernel by madvise.
+ */
+enum class MemoryAdvice { NORMAL, SEQUENTIAL, RANDOM, WILLNEED, DONTNEED };
+
+/**
+ * Read only view of the whole file mapped into memory.
+ *
+ * The mapping is private and writable, so that the pages might be exposed as T* to the code that
+ * expects mutable frames. Modifications trigger copy on write of the affected page and never
+ * reach the file.
+ */
+class MappedFile
+{
+public:
+    /**
+     * Map the file opened by RawFile, the mapping stays valid after the RawFile is closed.
+     *
+     * @param file Opened file.
+     * @param populate Prefault the whole mapping by MAP_POPULATE.
+     * @param hugePages Ask for transparent huge pages by MADV_HUGEPAGE, might be ignored for the
+     * file systems that do not support it.
+     */
+    MappedFile(const RawFile& file, bool populate = false, bool hugePages = false);
+    MappedFile(std::string fileName, bool populate = false, bool hugePages = false);
+    ~MappedFile();
+    MappedFile(const MappedFile& b) = delete;
+    MappedFile& operator=(const MappedFile& b) = delete;
+    MappedFile(MappedFile&& b) = delete;
+    MappedFile& operator=(MappedFile&& b) = delete;
+
+    /**
+     * Pass the access pattern hint for the byte range of the mapping to the kernel.
+     *
+     * The range is extended to the page boundaries. Failure is logged but not reported as the
+     * advice does not influence correctness. Note that DONTNEED discards the modifications made
+     * through the private mapping.
+     *
+     * @param advice Access pattern.
+     * @param fromPosition Start of the range in bytes.
+     * @param numBytes Length of the range, 0 for the rest of the file.
+     */
+    void advise(MemoryAdvice advice, uint64_t fromPosition = 0, uint64_t numBytes = 0) const;
+
+    uint8_t* data() const;
+    uint64_t size() const;
+    std::string getFileName() const;
+
+private:
+    std::string fileName;
+    uint8_t* mappedData = nullptr;
+    uint64_t mappedSize = 0;
+    void map(int fd, bool populate, bool hugePages);
+};
+} // namespace KCT::io
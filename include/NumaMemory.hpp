@@ -0,0 +1,58 @@
+#pragma once
+
+// Standard libraries
+#include <cstdint>
+#include <vector>
+
+namespace KCT::io {
+
+/**
+ * Placement of the memory on the NUMA nodes.
+ *
+ * FIRST_TOUCH leaves the kernel default, the page is placed on the node of the thread that first
+ * writes it. INTERLEAVE spreads the pages round robin over all the nodes, that balances the
+ * bandwidth when all the threads access all the data. BIND places all the pages on one node.
+ */
+enum class NumaPolicy { FIRST_TOUCH, INTERLEAVE, BIND };
+
+/**
+ * Number of the NUMA nodes with memory, 1 on the systems without NUMA.
+ */
+uint32_t numaNodeCount();
+
+/**
+ * Ids of the NUMA nodes with memory in ascending order, { 0 } on the systems without NUMA.
+ *
+ * Ids are not necessarily contiguous, e.g. nodes without memory are not listed.
+ */
+std::vector<uint32_t> numaNodes();
+
+/**
+ * CPUs of the node as listed in /sys/devices/system/node/node<node>/cpulist, empty when unknown.
+ */
+std::vector<uint32_t> numaNodeCpus(uint32_t node);
+
+/**
+ * Restrict the calling thread to the CPUs of the node.
+ *
+ * @return False when the node has no known CPUs or the affinity can not be set.
+ */
+bool bindThreadToNumaNode(uint32_t node);
+
+/**
+ * Set the policy of the pages fully inside [p, p + numBytes) by mbind before they are touched.
+ *
+ * Pages already faulted in are not moved. Failure, e.g. when mbind is not permitted in the
+ * container, is logged but not reported as the placement does not influence correctness.
+ *
+ * @param node Target node of BIND, ignored otherwise.
+ */
+void applyNumaPolicy(void* p, uint64_t numBytes, NumaPolicy policy, uint32_t node = 0);
+
+/**
+ * Nodes of the pages containing the given addresses queried by move_pages without faulting them
+ * in, -1 for the pages not present in memory or when the node can not be determined.
+ */
+std::vector<int> numaNodesOfAddresses(const std::vector<const void*>& addresses);
+
+} // namespace KCT::io
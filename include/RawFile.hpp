@@ -0,0 +1,121 @@
+#pragma once
+// Logging
+#include <plog/Log.h>
+
+// Standard libraries
+#include <cstdint>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+// Internal libraries
+#include "AlignedAllocator.hpp"
+#include "PROG/KCTException.hpp"
+#include "stringFormatter.h"
+
+namespace KCT::io {
+/**
+ * Identity of the content of the file within the process, the file given by device and inode
+ * together with its size and modification time, so that the rewritten file has a new identity.
+ */
+struct FileIdentity
+{
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    uint64_t size = 0;
+    int64_t mtimeNsec = 0;
+    bool operator==(const FileIdentity& b) const;
+    bool operator!=(const FileIdentity& b) const;
+    bool operator<(const FileIdentity& b) const;
+};
+
+/**
+ * Persistent handle to the file for positional raw reads and writes.
+ *
+ * File descriptor is opened in the constructor and closed in the destructor. All transfers are
+ * performed by pread/pwrite so that there is no shared seek pointer and one object might be used
+ * concurrently from multiple threads without locking.
+ *
+ * In the direct I/O mode, the file is in addition opened with O_DIRECT to bypass the page cache.
+ * The part of each transfer that is aligned to DIRECT_IO_ALIGNMENT in the file is performed through
+ * the O_DIRECT descriptor, directly from the user buffer when it is aligned as well, otherwise
+ * through a thread local aligned bounce buffer. Unaligned head and tail bytes, e.g. after 6 byte
+ * header of legacy DEN files, are transferred through the buffered descriptor. When the file system
+ * rejects O_DIRECT (tmpfs and some network file systems), the object falls back to buffered I/O.
+ */
+class RawFile
+{
+public:
+    /**
+     * Open existing file.
+     *
+     * @param fileName Path to the file.
+     * @param writable Open for reading and writing, otherwise read only.
+     * @param directIO Bypass the page cache using O_DIRECT where possible.
+     */
+    RawFile(std::string fileName, bool writable = false, bool directIO = false);
+    ~RawFile();
+    RawFile(const RawFile& b) = delete;
+    RawFile& operator=(const RawFile& b) = delete;
+    RawFile(RawFile&& b) = delete;
+    RawFile& operator=(RawFile&& b) = delete;
+
+    /**
+     * Read numBytes from the fromPosition into the buffer.
+     *
+     * Throws KCTException when less than numBytes could be read.
+     */
+    void readBytesFrom(uint64_t fromPosition, uint8_t* buffer, uint64_t numBytes) const;
+
+    /**
+     * Read contiguous range of the file starting at fromPosition into the buffers described by
+     * iov using as few preadv calls as possible.
+     *
+     * Throws KCTException when the whole range could not be read.
+     */
+    void readvBytesFrom(uint64_t fromPosition, std::vector<struct iovec> iov) const;
+
+    /**
+     * Write numBytes from the buffer to the file starting at fromPosition.
+     *
+     * Throws KCTException when the file is not writable or when the write fails.
+     */
+    void writeBytesFrom(uint64_t fromPosition, const uint8_t* buffer, uint64_t numBytes) const;
+
+    /**
+     * Write the buffers described by iov to the contiguous range of the file starting at
+     * fromPosition using as few pwritev calls as possible.
+     *
+     * Throws KCTException when the file is not writable or when the write fails.
+     */
+    void writevBytesFrom(uint64_t fromPosition, std::vector<struct iovec> iov) const;
+
+    /**
+     * @return Current size of the underlying file in bytes.
+     */
+    uint64_t getFileSize() const;
+
+    /**
+     * @return Identity of the file obtained by fstat.
+     */
+    FileIdentity getIdentity() const;
+    std::string getFileName() const;
+    bool isWritable() const;
+    int getFileDescriptor() const;
+    /**
+     * @return True if the file was successfully opened with O_DIRECT.
+     */
+    bool isDirectIO() const;
+
+private:
+    std::string fileName;
+    bool writable;
+    int fd = -1;
+    int directFd = -1;
+    void readFully(int descriptor, uint64_t fromPosition, uint8_t* buffer, uint64_t numBytes) const;
+    void writeFully(int descriptor,
+                    uint64_t fromPosition,
+                    const uint8_t* buffer,
+                    uint64_t numBytes) const;
+};
+} // namespace KCT::io
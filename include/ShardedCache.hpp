@@ -0,0 +1,674 @@
+#pragma once
+
+// Standard libraries
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace KCT::io {
+
+/**
+ * Replacement policy of ShardedCache.
+ *
+ * FIFO evicts in the order of insertion. LRU evicts the least recently used entry. CLOCK is the
+ * second chance approximation of LRU that does not reorder entries on hits. ARC is the Adaptive
+ * Replacement Cache of Megiddo and Modha balancing recency and frequency by the history of
+ * recently evicted keys, it resists the cyclic access patterns on which LRU and FIFO thrash.
+ */
+enum class CachePolicy { FIFO, LRU, CLOCK, ARC };
+
+/**
+ * Counters of ShardedCache summed over all shards.
+ */
+struct CacheStatistics
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t insertions = 0;
+    uint64_t evictions = 0;
+    /// Number of resident entries
+    uint64_t entries = 0;
+    /// Bytes of resident entries
+    uint64_t bytes = 0;
+    /// Number of resident entries excluded from the eviction by pin
+    uint64_t pinned = 0;
+};
+
+/**
+ * Thread safe key value cache with the budget in bytes and a replaceable eviction policy.
+ *
+ * Keys are distributed by the mixed hash into shards, each with its own lock, replacement state
+ * and byteBudget / shardCount bytes of the budget, so that concurrent threads contend only when
+ * they access the same shard. The hash is mixed since std::hash of integers is the identity and
+ * the keys of a strided access would otherwise share one shard. Values are copied out of the
+ * cache, use std::shared_ptr to share large objects. Entries larger than the budget of a shard are
+ * not cached.
+ *
+ * Pinned entries count against the budget but are not eviction candidates until unpinned. When
+ * the pinned entries of a shard leave no room for a new entry, the entry is not cached.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ShardedCache
+{
+public:
+    /**
+     * @param byteBudget Maximum number of bytes of resident entries.
+     * @param policy Replacement policy.
+     * @param shardCount Number of independently locked shards.
+     */
+    ShardedCache(uint64_t byteBudget,
+                 CachePolicy policy = CachePolicy::LRU,
+                 uint32_t shardCount = 16);
+    ShardedCache(const ShardedCache& b) = delete;
+    ShardedCache& operator=(const ShardedCache& b) = delete;
+
+    /**
+     * Find the entry and update the replacement state.
+     *
+     * @return True on hit, then value is set.
+     */
+    bool lookup(const Key& key, Value& value);
+
+    /**
+     * Find the entry without updating the replacement state and the statistics.
+     *
+     * @return True if the entry is resident, then value is set.
+     */
+    bool peek(const Key& key, Value& value) const;
+
+    /**
+     * Insert or replace the entry, evicts other entries of the shard to fit the budget. Replaced
+     * entry keeps its pins.
+     *
+     * @param bytes Size of the entry accounted against the budget.
+     *
+     * @return True if the entry is resident after the call.
+     */
+    bool insert(const Key& key, Value value, uint64_t bytes);
+
+    /**
+     * Get the resident entry or load it by the loader and insert it.
+     *
+     * Concurrent calls for the same key that is not resident are served by a single call of the
+     * loader, other threads wait for its result. Exception of the loader is propagated to all
+     * waiting threads and the key is not inserted.
+     *
+     * @param loader Returns the value and its size accounted against the budget.
+     * @param hit If not nullptr, set to true when the entry was resident.
+     */
+    Value getOrLoad(const Key& key,
+                    const std::function<std::pair<Value, uint64_t>()>& loader,
+                    bool* hit = nullptr);
+
+    /**
+     * Exclude the resident entry from the eviction, pins are counted.
+     *
+     * @return False if the entry is not resident.
+     */
+    bool pin(const Key& key);
+
+    /**
+     * Release one pin of the entry, the entry without pins is the most recent eviction
+     * candidate.
+     *
+     * @return False if the entry is not pinned.
+     */
+    bool unpin(const Key& key);
+
+    /**
+     * Set the function called under the lock of the shard whenever a resident entry leaves the
+     * cache, evicted is false for erase, replacement and clear. The listener must not call
+     * methods of the cache.
+     */
+    void setRemovalListener(std::function<void(const Key&, uint64_t bytes, bool evicted)> listener);
+
+    /**
+     * Set the function called under the lock of the shard whenever an entry becomes resident,
+     * including the replacement. The listener must not call methods of the cache.
+     */
+    void setInsertionListener(std::function<void(const Key&, uint64_t bytes)> listener);
+
+    /**
+     * Remove the entry.
+     *
+     * @return True if the entry was resident.
+     */
+    bool erase(const Key& key);
+
+    void clear();
+    CacheStatistics getStatistics() const;
+    void resetStatistics();
+    uint64_t getByteBudget() const;
+    CachePolicy getPolicy() const;
+    uint32_t getShardCount() const;
+
+private:
+    // FIFO, LRU and CLOCK keep resident entries in T1, ARC uses T1 and T2 for resident entries
+    // and B1 and B2 for the keys of recently evicted entries. Pinned entries are moved to PINNED.
+    enum ListID : uint8_t { T1 = 0, T2 = 1, B1 = 2, B2 = 3, PINNED = 4 };
+    struct Entry
+    {
+        Value value;
+        uint64_t bytes;
+        ListID list;
+        bool referenced;
+        uint32_t pins = 0;
+        // List to return to after the last unpin
+        ListID unpinnedList = T1;
+        typename std::list<Key>::iterator position;
+    };
+    // Lists are ordered from the eviction candidate at the front to the most recent at the back
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<Key, Entry, Hash> entries;
+        std::list<Key> lists[5];
+        uint64_t listBytes[5] = { 0, 0, 0, 0, 0 };
+        uint64_t budget = 0;
+        // ARC target size of T1 in bytes
+        double p = 0.0;
+        CacheStatistics statistics;
+        // Keys being loaded by getOrLoad
+        std::unordered_map<Key, std::shared_future<Value>, Hash> loading;
+    };
+    uint64_t byteBudget;
+    CachePolicy policy;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::function<void(const Key&, uint64_t, bool)> removalListener;
+    std::function<void(const Key&, uint64_t)> insertionListener;
+
+    static bool isResident(const Entry& e);
+    uint64_t shardIndex(const Key& key) const;
+    Shard& shardOf(const Key& key);
+    uint64_t residentBytes(const Shard& s) const;
+    void moveTo(Shard& s, Entry& e, const Key& key, ListID list);
+    void remove(Shard& s, typename std::unordered_map<Key, Entry, Hash>::iterator it);
+    void notifyRemoval(const Key& key, const Entry& e, bool evicted);
+    void notifyInsertion(const Key& key, uint64_t bytes);
+    void touch(Entry& e, Shard& s, const Key& key);
+    void evictOne(Shard& s, bool ghostHitInB2);
+    void makeRoom(Shard& s, uint64_t bytes, bool ghostHitInB2);
+};
+
+template <typename Key, typename Value, typename Hash>
+ShardedCache<Key, Value, Hash>::ShardedCache(uint64_t byteBudget,
+                                             CachePolicy policy,
+                                             uint32_t shardCount)
+    : byteBudget(byteBudget)
+    , policy(policy)
+{
+    shardCount = std::max(shardCount, 1u);
+    for(uint32_t i = 0; i != shardCount; i++)
+    {
+        shards.emplace_back(std::make_unique<Shard>());
+        shards.back()->budget = byteBudget / shardCount;
+    }
+}
+
+template <typename Key, typename Value, typename Hash>
+uint64_t ShardedCache<Key, Value, Hash>::shardIndex(const Key& key) const
+{
+    // Finalizer of splitmix64
+    uint64_t h = Hash{}(key);
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    return (h ^ (h >> 31)) % shards.size();
+}
+
+template <typename Key, typename Value, typename Hash>
+typename ShardedCache<Key, Value, Hash>::Shard&
+ShardedCache<Key, Value, Hash>::shardOf(const Key& key)
+{
+    return *shards[shardIndex(key)];
+}
+
+template <typename Key, typename Value, typename Hash>
+bool ShardedCache<Key, Value, Hash>::isResident(const Entry& e)
+{
+    return e.list == T1 || e.list == T2 || e.list == PINNED;
+}
+
+template <typename Key, typename Value, typename Hash>
+uint64_t ShardedCache<Key, Value, Hash>::residentBytes(const Shard& s) const
+{
+    return s.listBytes[T1] + s.listBytes[T2] + s.listBytes[PINNED];
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedCache<Key, Value, Hash>::notifyRemoval(const Key& key, const Entry& e, bool evicted)
+{
+    if(removalListener && isResident(e))
+    {
+        removalListener(key, e.bytes, evicted);
+    }
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedCache<Key, Value, Hash>::notifyInsertion(const Key& key, uint64_t bytes)
+{
+    if(insertionListener)
+    {
+        insertionListener(key, bytes);
+    }
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedCache<Key, Value, Hash>::moveTo(Shard& s, Entry& e, const Key& key, ListID list)
+{
+    s.listBytes[e.list] -= e.bytes;
+    s.lists[e.list].erase(e.position);
+    e.list = list;
+    e.position = s.lists[list].insert(s.lists[list].end(), key);
+    s.listBytes[list] += e.bytes;
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedCache<Key, Value, Hash>::remove(
+    Shard& s, typename std::unordered_map<Key, Entry, Hash>::iterator it)
+{
+    Entry& e = it->second;
+    s.listBytes[e.list] -= e.bytes;
+    s.lists[e.list].erase(e.position);
+    s.entries.erase(it);
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedCache<Key, Value, Hash>::touch(Entry& e, Shard& s, const Key& key)
+{
+    switch(policy)
+    {
+    case CachePolicy::FIFO:
+        break;
+    case CachePolicy::LRU:
+        moveTo(s, e, key, T1);
+        break;
+    case CachePolicy::CLOCK:
+        e.referenced = true;
+        break;
+    case CachePolicy::ARC:
+        moveTo(s, e, key, T2);
+        break;
+    }
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedCache<Key, Value, Hash>::evictOne(Shard& s, bool ghostHitInB2)
+{
+    if(policy == CachePolicy::ARC)
+    {
+        double t1 = double(s.listBytes[T1]);
+        bool fromT1 = !s.lists[T1].empty()
+            && (t1 > s.p || (ghostHitInB2 && t1 == s.p) || s.lists[T2].empty());
+        ListID from = fromT1 ? T1 : T2;
+        Key key = s.lists[from].front();
+        Entry& e = s.entries.find(key)->second;
+        notifyRemoval(key, e, true);
+        // Keep the key in the history, release the value
+        e.value = Value();
+        moveTo(s, e, key, fromT1 ? B1 : B2);
+    } else
+    {
+        while(policy == CachePolicy::CLOCK)
+        {
+            Entry& e = s.entries.find(s.lists[T1].front())->second;
+            if(!e.referenced)
+            {
+                break;
+            }
+            // Second chance
+            e.referenced = false;
+            s.lists[T1].splice(s.lists[T1].end(), s.lists[T1], e.position);
+        }
+        auto it = s.entries.find(s.lists[T1].front());
+        notifyRemoval(it->first, it->second, true);
+        remove(s, it);
+    }
+    s.statistics.evictions++;
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedCache<Key, Value, Hash>::makeRoom(Shard& s, uint64_t bytes, bool ghostHitInB2)
+{
+    while((!s.lists[T1].empty() || !s.lists[T2].empty()) && residentBytes(s) + bytes > s.budget)
+    {
+        evictOne(s, ghostHitInB2);
+    }
+    if(policy == CachePolicy::ARC)
+    {
+        // History is bounded by the budget in each direction
+        while(!s.lists[B1].empty() && s.listBytes[T1] + s.listBytes[B1] + bytes > s.budget)
+        {
+            remove(s, s.entries.find(s.lists[B1].front()));
+        }
+        while(!s.lists[B2].empty()
+              && residentBytes(s) + s.listBytes[B1] + s.listBytes[B2] + bytes > 2 * s.budget)
+        {
+            remove(s, s.entries.find(s.lists[B2].front()));
+        }
+    }
+}
+
+template <typename Key, typename Value, typename Hash>
+bool ShardedCache<Key, Value, Hash>::lookup(const Key& key, Value& value)
+{
+    Shard& s = shardOf(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.entries.find(key);
+    if(it == s.entries.end() || !isResident(it->second))
+    {
+        s.statistics.misses++;
+        return false;
+    }
+    s.statistics.hits++;
+    if(it->second.list != PINNED)
+    {
+        touch(it->second, s, key);
+    }
+    value = it->second.value;
+    return true;
+}
+
+template <typename Key, typename Value, typename Hash>
+bool ShardedCache<Key, Value, Hash>::peek(const Key& key, Value& value) const
+{
+    const Shard& s = *shards[shardIndex(key)];
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.entries.find(key);
+    if(it == s.entries.end() || !isResident(it->second))
+    {
+        return false;
+    }
+    value = it->second.value;
+    return true;
+}
+
+template <typename Key, typename Value, typename Hash>
+bool ShardedCache<Key, Value, Hash>::insert(const Key& key, Value value, uint64_t bytes)
+{
+    Shard& s = shardOf(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.entries.find(key);
+    bool ghostHitInB2 = false;
+    ListID target = T1;
+    if(it != s.entries.end())
+    {
+        Entry& e = it->second;
+        if(e.list == PINNED)
+        {
+            // Pinned entry is replaced in place, it is not an eviction candidate
+            notifyRemoval(key, e, false);
+            s.listBytes[PINNED] -= e.bytes;
+            if(residentBytes(s) + bytes > s.budget)
+            {
+                makeRoom(s, bytes, false);
+            }
+            e.value = std::move(value);
+            e.bytes = bytes;
+            s.listBytes[PINNED] += bytes;
+            s.statistics.insertions++;
+            notifyInsertion(key, bytes);
+            return true;
+        }
+        if(e.list == B1 || e.list == B2)
+        {
+            // ARC adapts the target size of T1 towards the list the key was evicted from
+            double b1 = double(std::max(s.listBytes[B1], (uint64_t)1));
+            double b2 = double(std::max(s.listBytes[B2], (uint64_t)1));
+            if(e.list == B1)
+            {
+                s.p = std::min(s.p + std::max(b2 / b1, 1.0) * double(bytes), double(s.budget));
+            } else
+            {
+                s.p = std::max(s.p - std::max(b1 / b2, 1.0) * double(bytes), 0.0);
+                ghostHitInB2 = true;
+            }
+            target = T2;
+        } else if(policy == CachePolicy::ARC)
+        {
+            target = T2;
+        } else if(policy == CachePolicy::FIFO || policy == CachePolicy::CLOCK)
+        {
+            // Replacement keeps the position in the queue
+            target = e.list;
+        }
+        notifyRemoval(key, e, false);
+        remove(s, it);
+    }
+    if(bytes > s.budget)
+    {
+        return false;
+    }
+    makeRoom(s, bytes, ghostHitInB2);
+    if(residentBytes(s) + bytes > s.budget)
+    {
+        // Pinned entries occupy the budget
+        return false;
+    }
+    Entry e;
+    e.value = std::move(value);
+    e.bytes = bytes;
+    e.list = target;
+    e.referenced = false;
+    e.position = s.lists[target].insert(s.lists[target].end(), key);
+    s.listBytes[target] += bytes;
+    s.entries.emplace(key, std::move(e));
+    s.statistics.insertions++;
+    notifyInsertion(key, bytes);
+    return true;
+}
+
+template <typename Key, typename Value, typename Hash>
+Value ShardedCache<Key, Value, Hash>::getOrLoad(
+    const Key& key, const std::function<std::pair<Value, uint64_t>()>& loader, bool* hit)
+{
+    Value value;
+    bool resident = lookup(key, value);
+    if(hit != nullptr)
+    {
+        *hit = resident;
+    }
+    if(resident)
+    {
+        return value;
+    }
+    Shard& s = shardOf(key);
+    std::promise<Value> promise;
+    std::shared_future<Value> pending;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.loading.find(key);
+        if(it != s.loading.end())
+        {
+            pending = it->second;
+        } else
+        {
+            s.loading.emplace(key, promise.get_future().share());
+        }
+    }
+    if(pending.valid())
+    {
+        // Other thread is loading the entry
+        return pending.get();
+    }
+    try
+    {
+        // The entry might have been inserted by the thread that finished loading it after the
+        // lookup above
+        if(!peek(key, value))
+        {
+            std::pair<Value, uint64_t> loaded = loader();
+            insert(key, loaded.first, loaded.second);
+            value = std::move(loaded.first);
+        }
+        promise.set_value(value);
+    } catch(...)
+    {
+        promise.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.loading.erase(key);
+        throw;
+    }
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.loading.erase(key);
+    return value;
+}
+
+template <typename Key, typename Value, typename Hash>
+bool ShardedCache<Key, Value, Hash>::pin(const Key& key)
+{
+    Shard& s = shardOf(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.entries.find(key);
+    if(it == s.entries.end() || !isResident(it->second))
+    {
+        return false;
+    }
+    Entry& e = it->second;
+    if(e.pins == 0)
+    {
+        e.unpinnedList = e.list;
+        moveTo(s, e, key, PINNED);
+    }
+    e.pins++;
+    return true;
+}
+
+template <typename Key, typename Value, typename Hash>
+bool ShardedCache<Key, Value, Hash>::unpin(const Key& key)
+{
+    Shard& s = shardOf(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.entries.find(key);
+    if(it == s.entries.end() || it->second.list != PINNED)
+    {
+        return false;
+    }
+    Entry& e = it->second;
+    e.pins--;
+    if(e.pins == 0)
+    {
+        moveTo(s, e, key, e.unpinnedList);
+    }
+    return true;
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedCache<Key, Value, Hash>::setRemovalListener(
+    std::function<void(const Key&, uint64_t bytes, bool evicted)> listener)
+{
+    for(std::unique_ptr<Shard>& s : shards)
+    {
+        s->mutex.lock();
+    }
+    removalListener = std::move(listener);
+    for(std::unique_ptr<Shard>& s : shards)
+    {
+        s->mutex.unlock();
+    }
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedCache<Key, Value, Hash>::setInsertionListener(
+    std::function<void(const Key&, uint64_t bytes)> listener)
+{
+    for(std::unique_ptr<Shard>& s : shards)
+    {
+        s->mutex.lock();
+    }
+    insertionListener = std::move(listener);
+    for(std::unique_ptr<Shard>& s : shards)
+    {
+        s->mutex.unlock();
+    }
+}
+
+template <typename Key, typename Value, typename Hash>
+bool ShardedCache<Key, Value, Hash>::erase(const Key& key)
+{
+    Shard& s = shardOf(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.entries.find(key);
+    if(it == s.entries.end())
+    {
+        return false;
+    }
+    bool resident = isResident(it->second);
+    notifyRemoval(key, it->second, false);
+    remove(s, it);
+    return resident;
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedCache<Key, Value, Hash>::clear()
+{
+    for(std::unique_ptr<Shard>& s : shards)
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        for(const auto& e : s->entries)
+        {
+            notifyRemoval(e.first, e.second, false);
+        }
+        s->entries.clear();
+        for(uint32_t i = 0; i != 5; i++)
+        {
+            s->lists[i].clear();
+            s->listBytes[i] = 0;
+        }
+        s->p = 0.0;
+    }
+}
+
+template <typename Key, typename Value, typename Hash>
+CacheStatistics ShardedCache<Key, Value, Hash>::getStatistics() const
+{
+    CacheStatistics total;
+    for(const std::unique_ptr<Shard>& s : shards)
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        total.hits += s->statistics.hits;
+        total.misses += s->statistics.misses;
+        total.insertions += s->statistics.insertions;
+        total.evictions += s->statistics.evictions;
+        total.entries += s->lists[T1].size() + s->lists[T2].size() + s->lists[PINNED].size();
+        total.bytes += residentBytes(*s);
+        total.pinned += s->lists[PINNED].size();
+    }
+    return total;
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedCache<Key, Value, Hash>::resetStatistics()
+{
+    for(std::unique_ptr<Shard>& s : shards)
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->statistics = CacheStatistics();
+    }
+}
+
+template <typename Key, typename Value, typename Hash>
+uint64_t ShardedCache<Key, Value, Hash>::getByteBudget() const
+{
+    return byteBudget;
+}
+
+template <typename Key, typename Value, typename Hash>
+CachePolicy ShardedCache<Key, Value, Hash>::getPolicy() const
+{
+    return policy;
+}
+
+template <typename Key, typename Value, typename Hash>
+uint32_t ShardedCache<Key, Value, Hash>::getShardCount() const
+{
+    return shards.size();
+}
+
+} // namespace KCT::io
@@ -0,0 +1,60 @@
+#pragma once
+
+// Standard libraries
+#include <cstdint>
+
+namespace KCT::io {
+
+/**
+ * Transpose the row major matrix of rows x cols elements of elementByteSize bytes, so that
+ * out[c * outStride + r] = in[r * inStride + c].
+ *
+ * Frame stored XMajor, index x + dimx * y, is the matrix of dimy rows and dimx columns, its
+ * transposition is the same frame stored YMajor. The matrix is split recursively along its longer
+ * side, so that the blocks fit the caches of any size, the blocks of 64 x 64 elements are
+ * transposed by in-register kernels. On x86 the kernels are chosen at runtime, AVX2 8x8 kernel for
+ * 4 byte and 4x4 kernel for 8 byte elements, SSE2 4x4 for 4 byte, 8x8 for 2 byte and 2x2 for 8
+ * byte elements. The elements are moved bitwise, 1, 2, 4 and 8 byte elements are supported. The
+ * input and output must not overlap.
+ */
+void transposeElements(const void* in,
+                       uint64_t inStride,
+                       void* out,
+                       uint64_t outStride,
+                       uint64_t rows,
+                       uint64_t cols,
+                       uint32_t elementByteSize);
+
+/**
+ * Transpose the square matrix of n x n elements of elementByteSize bytes in place.
+ *
+ * The pairs of blocks symmetric along the diagonal are swapped through a block sized buffer on the
+ * stack.
+ */
+void transposeSquareInPlace(void* data, uint64_t n, uint32_t elementByteSize);
+
+/**
+ * Name of the kernels selected for this CPU, avx2, sse2 or scalar.
+ */
+const char* transposeKernelName();
+
+/**
+ * Transpose the dense row major matrix of rows x cols elements, out[c * rows + r] = in[r * cols +
+ * c].
+ */
+template <typename T>
+void transpose(const T* in, T* out, uint64_t rows, uint64_t cols)
+{
+    transposeElements(in, cols, out, rows, rows, cols, sizeof(T));
+}
+
+/**
+ * Transpose the square matrix of n x n elements in place.
+ */
+template <typename T>
+void transposeInPlace(T* data, uint64_t n)
+{
+    transposeSquareInPlace(data, n, sizeof(T));
+}
+
+} // namespace KCT::io
@@ -0,0 +1,145 @@
+#pragma once
+
+// Standard libraries
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Internal libraries
+#include "FramePool.hpp"
+#include "RawFile.hpp"
+
+namespace KCT::io {
+
+/**
+ * What the producer does when the queue of WriteBehindQueue is full.
+ *
+ * BLOCK waits until a queued write completes. DROP discards the frame and counts it. GROW queues
+ * the frame anyway while the total size of the queued frames fits into the byte budget, then
+ * blocks.
+ */
+enum class BackpressurePolicy { BLOCK, DROP, GROW };
+
+/**
+ * Counters of WriteBehindQueue.
+ */
+struct WriteBehindStatistics
+{
+    /// Frames accepted by acquire
+    uint64_t queued = 0;
+    /// Frames written to the file
+    uint64_t written = 0;
+    /// Frames discarded by the DROP policy
+    uint64_t dropped = 0;
+    /// Number of acquire calls that had to wait for the queue
+    uint64_t blocked = 0;
+    /// Maximum number of frames in the queue at once
+    uint64_t peakFrames = 0;
+};
+
+/**
+ * Bounded queue of frame sized writes performed by background I/O threads.
+ *
+ * The producer takes the buffer by acquire, fills it with the bytes to be written and passes it
+ * to submit together with the file position, then continues while the I/O threads write it.
+ * Buffers are recycled through FramePool. The first I/O error is kept and thrown by each acquire
+ * until flush or close reports it. Thread safe, any number of producers may use the queue.
+ */
+class WriteBehindQueue
+{
+public:
+    using Buffer = FramePool<uint8_t>::Buffer;
+
+    /**
+     * @param file Writable file.
+     * @param byteSize Size of each write in bytes.
+     * @param queueFrames Number of frames that might be queued or being written at once.
+     * @param policy Behavior of acquire when queueFrames frames are queued.
+     * @param ioThreads Number of background threads issuing the writes.
+     * @param growByteBudget Maximum bytes of the queued frames under the GROW policy.
+     */
+    WriteBehindQueue(std::shared_ptr<RawFile> file,
+                     uint64_t byteSize,
+                     uint32_t queueFrames = 16,
+                     BackpressurePolicy policy = BackpressurePolicy::BLOCK,
+                     uint32_t ioThreads = 1,
+                     uint64_t growByteBudget = 0);
+    /**
+     * Writes the queued frames, the errors are logged.
+     */
+    ~WriteBehindQueue();
+    WriteBehindQueue(const WriteBehindQueue& b) = delete;
+    WriteBehindQueue& operator=(const WriteBehindQueue& b) = delete;
+
+    /**
+     * Get the buffer of getByteSize() bytes for the next write, waits according to the policy.
+     *
+     * @return Empty buffer when the frame shall be dropped.
+     */
+    Buffer acquire();
+
+    /**
+     * Queue the write of the buffer from acquire to the position of the file, each non empty
+     * buffer from acquire must be submitted.
+     */
+    void submit(uint64_t position, Buffer buffer);
+
+    /**
+     * Wait until all the submitted writes complete and throw the first error since the last
+     * flush.
+     */
+    void flush();
+
+    /**
+     * Flush and stop the I/O threads, subsequent acquire throws.
+     */
+    void close();
+
+    /**
+     * Function called with the position of each successfully written buffer by the thread that
+     * wrote it, set before the first submit.
+     */
+    void setCompletionListener(std::function<void(uint64_t position)> listener);
+
+    uint64_t getByteSize() const;
+    WriteBehindStatistics getStatistics() const;
+
+private:
+    struct Write
+    {
+        uint64_t position;
+        Buffer buffer;
+    };
+    void ioLoop();
+    // Throw the kept error, reported errors are cleared so that flush and close see each once
+    void rethrowError(bool reported);
+
+    std::shared_ptr<RawFile> file;
+    uint64_t byteSize;
+    uint32_t queueFrames;
+    BackpressurePolicy policy;
+    uint64_t growFrames;
+    std::shared_ptr<FramePool<uint8_t>> pool;
+    std::function<void(uint64_t position)> completionListener;
+
+    mutable std::mutex mutex;
+    std::condition_variable queueCondition;
+    std::condition_variable spaceCondition;
+    std::deque<Write> queue;
+    // Acquired and not yet written
+    uint64_t pending = 0;
+    // Submitted and not yet written
+    uint64_t inFlight = 0;
+    bool closed = false;
+    std::exception_ptr error;
+    WriteBehindStatistics statistics;
+    std::vector<std::thread> threads;
+};
+
+} // namespace KCT::io
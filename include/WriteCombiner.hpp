@@ -0,0 +1,156 @@
+#pragma once
+
+// Standard libraries
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Internal libraries
+#include "FramePool.hpp"
+#include "RawFile.hpp"
+
+namespace KCT::io {
+
+/**
+ * Process wide budget of the bytes held by all WriteCombiner objects.
+ */
+class WriteCombiningBudget
+{
+public:
+    /// Budget until configure is called
+    static constexpr uint64_t DEFAULT_BYTES = 256 * 1024 * 1024;
+
+    static WriteCombiningBudget& instance();
+
+    /**
+     * Set the maximum number of bytes buffered by all the combiners, the bytes already buffered
+     * are not released.
+     */
+    void configure(uint64_t byteBudget);
+    uint64_t getByteBudget() const;
+    uint64_t getUsedBytes() const;
+
+    /**
+     * @return False when the bytes do not fit into the budget.
+     */
+    bool tryReserve(uint64_t bytes);
+    void release(uint64_t bytes);
+
+private:
+    WriteCombiningBudget() = default;
+    std::atomic<uint64_t> byteBudget{ DEFAULT_BYTES };
+    std::atomic<uint64_t> usedBytes{ 0 };
+};
+
+/**
+ * Counters of WriteCombiner.
+ */
+struct WriteCombinerStatistics
+{
+    /// Frames passed to add
+    uint64_t frames = 0;
+    /// Write calls issued
+    uint64_t writes = 0;
+    /// Frames written without buffering because the budget was exhausted
+    uint64_t bypassed = 0;
+    /// Runs written before they were complete to make room in the budget
+    uint64_t evictions = 0;
+    /// Frames buffered at the moment
+    uint64_t buffered = 0;
+};
+
+/**
+ * Buffer of the frames of the file arriving in any order that writes them in long sequential
+ * runs.
+ *
+ * The frames are held until their run of consecutive frames is complete, that is it is adjacent
+ * on both sides to the frames already written or to the ends of the file, or until it reaches
+ * maxRunBytes. Each run is written by a single pwritev. When the process wide
+ * WriteCombiningBudget is exhausted, the longest buffered run of this combiner is written
+ * prematurely, frames that do not fit even then are written directly. Thread safe, the writes are
+ * issued outside of the lock.
+ */
+class WriteCombiner
+{
+public:
+    using Buffer = FramePool<uint8_t>::Buffer;
+
+    /**
+     * @param file Writable file.
+     * @param offset Position of the frame 0 in the file.
+     * @param frameByteSize Size of each frame in bytes.
+     * @param frameCount Number of frames of the file.
+     * @param maxRunBytes Maximum size of one write.
+     */
+    WriteCombiner(std::shared_ptr<RawFile> file,
+                  uint64_t offset,
+                  uint64_t frameByteSize,
+                  uint64_t frameCount,
+                  uint64_t maxRunBytes = 64 * 1024 * 1024);
+    /**
+     * Writes the buffered frames, errors are logged.
+     */
+    ~WriteCombiner();
+    WriteCombiner(const WriteCombiner& b) = delete;
+    WriteCombiner& operator=(const WriteCombiner& b) = delete;
+
+    /**
+     * Get the buffer of frameByteSize bytes to fill with the frame to be added.
+     */
+    Buffer acquire();
+
+    /**
+     * Add the content of the frame k, writes the run of k if it is complete. Frame added twice
+     * before it is written is replaced.
+     */
+    void add(uint64_t k, Buffer frame);
+
+    /**
+     * Write all the buffered frames.
+     */
+    void flush();
+
+    /**
+     * Function called with the index of each successfully written frame by the thread that wrote
+     * it, set before the first add.
+     */
+    void setCompletionListener(std::function<void(uint64_t k)> listener);
+
+    WriteCombinerStatistics getStatistics() const;
+
+private:
+    struct Run
+    {
+        uint64_t first;
+        std::vector<Buffer> frames;
+    };
+    /**
+     * Remove the run of consecutive buffered frames containing k from the buffer, mutex held.
+     */
+    Run takeRun(uint64_t k);
+    /**
+     * First frame of the longest buffered run, mutex held, buffer must not be empty.
+     */
+    uint64_t longestRun() const;
+    void writeRun(Run& run);
+    void writeRuns(std::vector<Run>& runs);
+
+    std::shared_ptr<RawFile> file;
+    uint64_t offset;
+    uint64_t frameByteSize;
+    uint64_t frameCount;
+    uint64_t maxRunFrames;
+    std::shared_ptr<FramePool<uint8_t>> pool;
+    std::function<void(uint64_t k)> completionListener;
+
+    mutable std::mutex mutex;
+    std::map<uint64_t, Buffer> buffered;
+    std::vector<bool> written;
+    WriteCombinerStatistics statistics;
+};
+
+} // namespace KCT::io
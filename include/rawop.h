@@ -19,7 +19,22 @@
 
 namespace KCT {
 namespace io {
+    /**
+     * Policy how the data part of the newly created file is allocated on the disk.
+     *
+     * SPARSE only sets the file size, blocks are allocated when written. RESERVE allocates all
+     * blocks by fallocate up front, so that out of order writes from many threads do not fragment
+     * the file and ENOSPC is reported at creation. ZERO_RANGE allocates the range by
+     * FALLOC_FL_ZERO_RANGE. When the file system does not support fallocate, RESERVE and
+     * ZERO_RANGE fall back to SPARSE with a warning.
+     */
+    enum class FileAllocation { SPARSE, RESERVE, ZERO_RANGE };
+
     void readFirstBytes(std::string fileName, uint8_t* buffer, uint64_t numBytes);
+    /**
+     * Positional read and write by file name, the file is opened for each call. Use RawFile to
+     * transfer repeatedly from the same file.
+     */
     void
     readBytesFrom(std::string fileName, uint64_t fromPosition, uint8_t* buffer, uint64_t numBytes);
     void readBytesFrom(std::shared_ptr<std::ifstream> fileName,
@@ -34,7 +49,31 @@ namespace io {
     void
     writeBytesFrom(std::string fileName, uint64_t fromPosition, uint8_t* buffer, uint64_t numBytes);
     void appendBytes(std::string fileName, uint8_t* buffer, uint64_t numBytes);
-    void createEmptyFile(std::string fileName, uint64_t numBytes, bool overwrite);
+    void createEmptyFile(std::string fileName,
+                         uint64_t numBytes,
+                         bool overwrite,
+                         FileAllocation allocation = FileAllocation::SPARSE);
+    /**
+     * Create file of totalBytes starting with the header using single open.
+     *
+     * The data part after the header reads as zeros and is allocated according to the allocation
+     * policy. Throws KCTException when the file exists and overwrite is false or when the space
+     * can not be reserved, in which case the file is removed.
+     *
+     * @param fileName File to create.
+     * @param header Bytes to be written at the beginning of the file, might be nullptr if
+     * headerBytes is 0.
+     * @param headerBytes Size of the header.
+     * @param totalBytes Total size of the file including header.
+     * @param overwrite Overwrite existing file.
+     * @param allocation Allocation policy of the data part.
+     */
+    void createFileWithHeader(std::string fileName,
+                              const uint8_t* header,
+                              uint64_t headerBytes,
+                              uint64_t totalBytes,
+                              bool overwrite,
+                              FileAllocation allocation = FileAllocation::SPARSE);
     bool pathExists(std::string fileName);
     bool isDirectory(const std::experimental::filesystem::path& p);
     bool isRegularFile(const std::experimental::filesystem::path& p);
@@ -0,0 +1,151 @@
+#include "DEN/DenElementConversion.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KCT_CONVERSION_X86
+#endif
+
+namespace KCT::util {
+
+namespace {
+    using WideningFunction = void (*)(const uint8_t*, float*, uint64_t);
+
+    /**
+     * Widening of count elements, the body converts blocks of B elements and the tail is
+     * converted by the scalar kernel.
+     */
+    template <typename S, uint64_t B, void (*Block)(const uint8_t*, float*)>
+    void widen(const uint8_t* in, float* out, uint64_t count)
+    {
+        uint64_t i = 0;
+        for(; i + B <= count; i += B)
+        {
+            Block(in + i * sizeof(S), out + i);
+        }
+        detail::convertKernel<S, float, false>(in + i * sizeof(S), out + i, count - i);
+    }
+
+#ifdef KCT_CONVERSION_X86
+    void sse2Uint8(const uint8_t* in, float* out)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        _mm_storeu_ps(out, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_ps(out + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_ps(out + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_ps(out + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+    }
+
+    void sse2Uint16(const uint8_t* in, float* out)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        _mm_storeu_ps(out, _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)));
+        _mm_storeu_ps(out + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)));
+    }
+
+    void sse2Int16(const uint8_t* in, float* out)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        // Element in the upper half of the 32 bit lane, arithmetic shift extends its sign
+        _mm_storeu_ps(out, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)));
+        _mm_storeu_ps(out + 4, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)));
+    }
+
+    void sse2Int32(const uint8_t* in, float* out)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        _mm_storeu_ps(out, _mm_cvtepi32_ps(v));
+    }
+
+    __attribute__((target("avx2"))) void avx2Uint8(const uint8_t* in, float* out)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        _mm256_storeu_ps(out, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v)));
+        _mm256_storeu_ps(out + 8,
+                         _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8))));
+    }
+
+    __attribute__((target("avx2"))) void avx2Uint16(const uint8_t* in, float* out)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16));
+        _mm256_storeu_ps(out, _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(a)));
+        _mm256_storeu_ps(out + 8, _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(b)));
+    }
+
+    __attribute__((target("avx2"))) void avx2Int16(const uint8_t* in, float* out)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16));
+        _mm256_storeu_ps(out, _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a)));
+        _mm256_storeu_ps(out + 8, _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b)));
+    }
+
+    __attribute__((target("avx2"))) void avx2Int32(const uint8_t* in, float* out)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        _mm256_storeu_ps(out, _mm256_cvtepi32_ps(v));
+    }
+#endif
+
+    struct ConversionKernels
+    {
+        const char* name;
+        // Indexed by the DenSupportedType of the source, nullptr without the kernel
+        WideningFunction toFloat[9];
+    };
+
+    const ConversionKernels& kernels()
+    {
+        using io::DenSupportedType;
+        static const ConversionKernels selected = []() -> ConversionKernels {
+            ConversionKernels k = { "scalar", {} };
+#ifdef KCT_CONVERSION_X86
+            if(__builtin_cpu_supports("avx2"))
+            {
+                k.name = "avx2";
+                k.toFloat[DenSupportedType::UINT8] = widen<uint8_t, 16, avx2Uint8>;
+                k.toFloat[DenSupportedType::UINT16] = widen<uint16_t, 16, avx2Uint16>;
+                k.toFloat[DenSupportedType::INT16] = widen<int16_t, 16, avx2Int16>;
+                k.toFloat[DenSupportedType::INT32] = widen<int32_t, 8, avx2Int32>;
+            } else
+            {
+                k.name = "sse2";
+                k.toFloat[DenSupportedType::UINT8] = widen<uint8_t, 16, sse2Uint8>;
+                k.toFloat[DenSupportedType::UINT16] = widen<uint16_t, 8, sse2Uint16>;
+                k.toFloat[DenSupportedType::INT16] = widen<int16_t, 8, sse2Int16>;
+                k.toFloat[DenSupportedType::INT32] = widen<int32_t, 4, sse2Int32>;
+            }
+#endif
+            return k;
+        }();
+        return selected;
+    }
+} // namespace
+
+namespace detail {
+    bool convertToFloatSIMD(const uint8_t* in,
+                            io::DenSupportedType dataType,
+                            float* out,
+                            uint64_t count)
+    {
+        if(static_cast<uint32_t>(dataType) >= 9)
+        {
+            return false;
+        }
+        WideningFunction f = kernels().toFloat[dataType];
+        if(f == nullptr)
+        {
+            return false;
+        }
+        f(in, out, count);
+        return true;
+    }
+} // namespace detail
+
+const char* conversionKernelName() { return kernels().name; }
+
+} // namespace KCT::util
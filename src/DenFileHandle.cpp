@@ -0,0 +1,159 @@
+#include "DEN/DenFileHandle.hpp"
+
+// Standard libraries
+#include <cerrno>
+#include <cstring>
+#include <future>
+#include <map>
+#include <mutex>
+#include <sys/stat.h>
+#include <tuple>
+
+namespace KCT::io {
+
+namespace {
+    struct RegistryKey
+    {
+        uint64_t device;
+        uint64_t inode;
+        bool directIO;
+        bool operator<(const RegistryKey& b) const
+        {
+            return std::tie(device, inode, directIO) < std::tie(b.device, b.inode, b.directIO);
+        }
+    };
+
+    struct RegistryEntry
+    {
+        std::weak_ptr<DenFileHandle> handle;
+        // Valid while the handle is being opened, the header is parsed outside of the lock
+        std::shared_future<std::shared_ptr<DenFileHandle>> opening;
+        // Identifies the open that owns the placeholder
+        uint64_t ticket;
+        uint64_t size;
+        int64_t mtimeSec;
+        int64_t mtimeNsec;
+    };
+
+    std::mutex registryMutex;
+    uint64_t nextTicket = 0;
+    std::map<RegistryKey, RegistryEntry>& registry()
+    {
+        static std::map<RegistryKey, RegistryEntry> r;
+        return r;
+    }
+} // namespace
+
+DenFileHandle::DenFileHandle(std::string fileName, bool directIO)
+    : rawFile(std::make_shared<RawFile>(fileName, false, directIO))
+    , info(*rawFile)
+    , identity(rawFile->getIdentity())
+{
+}
+
+std::shared_ptr<DenFileHandle> DenFileHandle::open(std::string fileName, bool directIO)
+{
+    struct stat st;
+    if(::stat(fileName.c_str(), &st) != 0)
+    {
+        KCTERR(io::xprintf("Can not stat file %s, strerror message :%s.", fileName.c_str(),
+                           strerror(errno)));
+    }
+    RegistryKey id{ (uint64_t)st.st_dev, (uint64_t)st.st_ino, directIO };
+    std::promise<std::shared_ptr<DenFileHandle>> promise;
+    uint64_t ticket;
+    {
+        std::unique_lock<std::mutex> lock(registryMutex);
+        std::map<RegistryKey, RegistryEntry>& r = registry();
+        auto it = r.find(id);
+        if(it != r.end() && it->second.size == (uint64_t)st.st_size
+           && it->second.mtimeSec == st.st_mtim.tv_sec
+           && it->second.mtimeNsec == st.st_mtim.tv_nsec)
+        {
+            if(it->second.opening.valid())
+            {
+                // Other thread is parsing the header
+                std::shared_future<std::shared_ptr<DenFileHandle>> opening = it->second.opening;
+                lock.unlock();
+                return opening.get();
+            }
+            std::shared_ptr<DenFileHandle> h = it->second.handle.lock();
+            if(h != nullptr)
+            {
+                return h;
+            }
+        }
+        // Drop expired entries so that the registry does not grow with the number of files seen
+        for(auto e = r.begin(); e != r.end();)
+        {
+            if(!e->second.opening.valid() && e->second.handle.expired())
+            {
+                e = r.erase(e);
+            } else
+            {
+                ++e;
+            }
+        }
+        ticket = nextTicket++;
+        r[id] = RegistryEntry{ std::weak_ptr<DenFileHandle>(), promise.get_future().share(),
+                               ticket, (uint64_t)st.st_size, st.st_mtim.tv_sec,
+                               st.st_mtim.tv_nsec };
+    }
+    std::shared_ptr<DenFileHandle> h;
+    try
+    {
+        h = std::make_shared<DenFileHandle>(fileName, directIO);
+    } catch(...)
+    {
+        promise.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto it = registry().find(id);
+        if(it != registry().end() && it->second.ticket == ticket)
+        {
+            registry().erase(it);
+        }
+        throw;
+    }
+    promise.set_value(h);
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto it = registry().find(id);
+    // The file might have been changed and opened again in the meantime
+    if(it != registry().end() && it->second.ticket == ticket)
+    {
+        it->second.handle = h;
+        it->second.opening = std::shared_future<std::shared_ptr<DenFileHandle>>();
+    }
+    return h;
+}
+
+uint64_t DenFileHandle::registeredHandles()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    uint64_t count = 0;
+    for(const auto& e : registry())
+    {
+        if(!e.second.handle.expired())
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+const DenFileInfo& DenFileHandle::getInfo() const { return info; }
+
+std::shared_ptr<RawFile> DenFileHandle::getRawFile() const { return rawFile; }
+
+FileIdentity DenFileHandle::getIdentity() const { return identity; }
+
+std::string DenFileHandle::getFileName() const { return info.getFileName(); }
+
+uint64_t DenFileHandle::getOffset() const { return info.getOffset(); }
+
+uint64_t DenFileHandle::getFrameSize() const { return info.getFrameSize(); }
+
+uint64_t DenFileHandle::getFrameByteSize() const { return info.getFrameByteSize(); }
+
+uint64_t DenFileHandle::getFrameCount() const { return info.getFrameCount(); }
+
+} // namespace KCT::io
@@ -5,10 +5,22 @@ namespace io {
     /**Constructor*/
     DenFileInfo::DenFileInfo(std::string fileName, bool exceptInvalid)
         : fileName(fileName)
+    {
+        RawFile rawFile(this->fileName);
+        parseHeader(rawFile, exceptInvalid);
+    }
+
+    DenFileInfo::DenFileInfo(const RawFile& rawFile, bool exceptInvalid)
+        : fileName(rawFile.getFileName())
+    {
+        parseHeader(rawFile, exceptInvalid);
+    }
+
+    void DenFileInfo::parseHeader(const RawFile& rawFile, bool exceptInvalid)
     {
         std::string ERR;
         valid = true;
-        fileSize = getFileSize();
+        fileSize = rawFile.getFileSize();
         if(fileSize < 6)
         {
             if(exceptInvalid)
@@ -23,13 +35,13 @@ namespace io {
         }
         uint16_t h0, h1, h2, h3, h4;
         std::array<uint8_t, 74> buffer;
-        readBytesFrom(this->fileName, 0, std::begin(buffer), 6);
+        rawFile.readBytesFrom(0, std::begin(buffer), 6);
         h0 = util::nextUint16(std::begin(buffer));
         h1 = util::nextUint16(std::begin(buffer) + 2);
         h2 = util::nextUint16(std::begin(buffer) + 4);
         if(h0 == 0 && fileSize > 4095)
         {
-            readBytesFrom(this->fileName, 0, std::begin(buffer), 74);
+            rawFile.readBytesFrom(6, std::begin(buffer) + 6, 68);
             h3 = util::nextUint16(std::begin(buffer) + 6);
             h4 = util::nextUint16(std::begin(buffer) + 8);
             extended = true;
@@ -272,6 +284,85 @@ namespace io {
         return false;
     }
 
+    DenFileInfo::RoiReadPlan DenFileInfo::planRoiRead(uint32_t x_from,
+                                                      uint32_t x_count,
+                                                      uint32_t y_from,
+                                                      uint32_t y_count) const
+    {
+        bool admissibleDimensions = true;
+        admissibleDimensions &= isAdmissibleDimension(x_from, 0);
+        admissibleDimensions &= isAdmissibleDimension(y_from, 1);
+        if(x_count == 0)
+        {
+            x_count = _dim[0] - x_from;
+        }
+        if(y_count == 0)
+        {
+            y_count = _dim[1] - y_from;
+        }
+        admissibleDimensions &= isAdmissibleDimension(x_from + x_count, 0, true);
+        admissibleDimensions &= isAdmissibleDimension(y_from + y_count, 1, true);
+        if(!admissibleDimensions)
+        {
+            std::string ERR = io::xprintf("File %s wrong dimensions specified.", fileName.c_str());
+            KCTERR(ERR);
+        }
+        RoiReadPlan plan;
+        if(XMajorAlignment)
+        {
+            plan.innerFrom = x_from;
+            plan.innerCount = x_count;
+            plan.innerDim = _dim[0];
+            plan.outerFrom = y_from;
+            plan.outerCount = y_count;
+        } else
+        {
+            plan.innerFrom = y_from;
+            plan.innerCount = y_count;
+            plan.innerDim = _dim[1];
+            plan.outerFrom = x_from;
+            plan.outerCount = x_count;
+        }
+        uint64_t rowBytes = plan.innerCount * elementByteSize;
+        uint64_t spanBytes
+            = ((plan.outerCount - 1) * plan.innerDim + plan.innerCount) * elementByteSize;
+        uint64_t perRowCost = plan.outerCount * (ROI_REQUEST_COST + rowBytes);
+        uint64_t spanCost = ROI_REQUEST_COST + spanBytes;
+        plan.perRow = plan.innerCount != plan.innerDim && perRowCost < spanCost;
+        plan.cost = plan.perRow ? perRowCost : spanCost;
+        return plan;
+    }
+
+    const uint8_t* DenFileInfo::readRoi(const RawFile& rawFile,
+                                        uint64_t flatZIndex,
+                                        const RoiReadPlan& plan,
+                                        uint8_t* tmpbuffer,
+                                        uint64_t& rowStride) const
+    {
+        uint64_t framePosition = offset + flatZIndex * frameByteSize;
+        uint64_t rowBytes = plan.innerCount * elementByteSize;
+        if(plan.perRow)
+        {
+            // Rows are packed in tmpbuffer
+            for(uint64_t o = 0; o != plan.outerCount; o++)
+            {
+                uint64_t position = framePosition
+                    + ((plan.outerFrom + o) * plan.innerDim + plan.innerFrom) * elementByteSize;
+                rawFile.readBytesFrom(position, tmpbuffer + o * rowBytes, rowBytes);
+            }
+            rowStride = plan.innerCount;
+        } else
+        {
+            uint64_t position = framePosition
+                + (plan.outerFrom * plan.innerDim + plan.innerFrom) * elementByteSize;
+            uint64_t spanBytes
+                = ((plan.outerCount - 1) * plan.innerDim + plan.innerCount) * elementByteSize;
+            rawFile.readBytesFrom(position, tmpbuffer, spanBytes);
+            rowStride = plan.innerDim;
+        }
+        return tmpbuffer;
+    }
+
     uint16_t DenFileInfo::getDimCount() const { return dimCount; }
 
     uint64_t DenFileInfo::getFileSize() const
@@ -290,6 +381,12 @@ namespace io {
 
     uint16_t DenFileInfo::getElementByteSize() const { return elementByteSize; }
 
+    DenStatistics DenFileInfo::computeStatistics(const DenStatisticsOptions& opts) const
+    {
+        RawFile rawFile(fileName, false, opts.directIO);
+        return computeDenStatistics(rawFile, elementType, offset, elementCount, opts);
+    }
+
     void DenFileInfo::createLegacyDenHeader(std::string fileName,
                                             uint16_t dimx,
                                             uint16_t dimy,
@@ -297,11 +394,10 @@ namespace io {
     {
         // uint32_t uint16max = 65535;
         std::array<uint8_t, 6> buf;
-        io::createEmptyFile(fileName, 0, true);
         util::putUint16((uint16_t)dimy, std::begin(buf));
         util::putUint16((uint16_t)dimx, std::begin(buf) + 2);
         util::putUint16((uint16_t)dimz, std::begin(buf) + 4);
-        io::appendBytes(fileName, std::begin(buf), (uint64_t)6);
+        io::createFileWithHeader(fileName, std::begin(buf), 6, 6, true);
     }
 
     void DenFileInfo::create3DDenHeader(std::string fileName,
@@ -326,8 +422,7 @@ namespace io {
         util::putUint32(dimx, std::begin(buf) + 10);
         util::putUint32(dimy, std::begin(buf) + 14);
         util::putUint32(dimz, std::begin(buf) + 18);
-        io::createEmptyFile(fileName, 0, true);
-        io::appendBytes(fileName, std::begin(buf), (uint64_t)4096);
+        io::createFileWithHeader(fileName, std::begin(buf), 4096, 4096, true);
     }
 
     void DenFileInfo::createDenHeader(std::string fileName,
@@ -358,12 +453,15 @@ namespace io {
         {
             util::putUint32(dim[i], std::begin(buf) + 10 + 4 * i);
         }
-        io::createEmptyFile(fileName, 0, true);
-        io::appendBytes(fileName, std::begin(buf), (uint64_t)4096);
+        io::createFileWithHeader(fileName, std::begin(buf), 4096, 4096, true);
     }
 
-    void DenFileInfo::createEmptyLegacyDenFile(
-        std::string fileName, DenSupportedType dst, uint16_t dimx, uint16_t dimy, uint16_t dimz)
+    void DenFileInfo::createEmptyLegacyDenFile(std::string fileName,
+                                               DenSupportedType dst,
+                                               uint16_t dimx,
+                                               uint16_t dimy,
+                                               uint16_t dimz,
+                                               FileAllocation allocation)
     {
         uint64_t totalElementCount = uint64_t(dimx) * uint64_t(dimy) * uint64_t(dimz);
         if(dst != DenSupportedType::UINT16 && dst != DenSupportedType::FLOAT32
@@ -379,8 +477,7 @@ namespace io {
         util::putUint16((uint16_t)dimy, std::begin(buf));
         util::putUint16((uint16_t)dimx, std::begin(buf) + 2);
         util::putUint16((uint16_t)dimz, std::begin(buf) + 4);
-        io::createEmptyFile(fileName, totalFileSize, true);
-        io::writeFirstBytes(fileName, std::begin(buf), 6);
+        io::createFileWithHeader(fileName, std::begin(buf), 6, totalFileSize, true, allocation);
     }
 
     void DenFileInfo::createEmpty3DDenFile(std::string fileName,
@@ -388,12 +485,13 @@ namespace io {
                                            uint32_t dimx,
                                            uint32_t dimy,
                                            uint32_t dimz,
-                                           bool XMajorAlignment)
+                                           bool XMajorAlignment,
+                                           FileAllocation allocation)
     {
         uint64_t totalElementCount = uint64_t(dimx) * uint64_t(dimy) * uint64_t(dimz);
         uint64_t elementSize = DenSupportedTypeElementByteSize(dst);
         uint64_t totalFileSize = 4096 + totalElementCount * elementSize;
-        std::array<uint8_t, 4096> buf;
+        std::array<uint8_t, 4096> buf = {}; // Zero initialize
         util::putUint16(0, std::begin(buf));
         util::putUint16(3, std::begin(buf) + 2); // 3D
         util::putUint16(DenSupportedTypeElementByteSize(dst), std::begin(buf) + 4); // 3D
@@ -408,15 +506,16 @@ namespace io {
         util::putUint32(dimx, std::begin(buf) + 10);
         util::putUint32(dimy, std::begin(buf) + 14);
         util::putUint32(dimz, std::begin(buf) + 18);
-        io::createEmptyFile(fileName, totalFileSize, true);
-        io::writeFirstBytes(fileName, std::begin(buf), 4096);
+        io::createFileWithHeader(fileName, std::begin(buf), 4096, totalFileSize, true,
+                                 allocation);
     }
 
     void DenFileInfo::createEmptyDenFile(std::string fileName,
                                          DenSupportedType dst,
                                          uint16_t dimCount,
                                          uint32_t* dim,
-                                         bool XMajorAlignment)
+                                         bool XMajorAlignment,
+                                         FileAllocation allocation)
     {
         uint64_t totalElementCount = 1;
         if(dimCount == 0)
@@ -446,8 +545,8 @@ namespace io {
         {
             util::putUint32(dim[i], std::begin(buf) + 10 + 4 * i);
         }
-        io::createEmptyFile(fileName, totalFileSize, true);
-        io::writeFirstBytes(fileName, std::begin(buf), 4096);
+        io::createFileWithHeader(fileName, std::begin(buf), 4096, totalFileSize, true,
+                                 allocation);
     }
 
 } // namespace io
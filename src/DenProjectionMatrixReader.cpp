@@ -2,9 +2,16 @@
 
 namespace KCT::io {
 DenProjectionMatrixReader::DenProjectionMatrixReader(std::string projectionMatrixFile)
+    : DenProjectionMatrixReader(DenFileHandle::open(projectionMatrixFile))
 {
-    this->projectionMatrixFile = projectionMatrixFile;
-    DenFileInfo mi = DenFileInfo(this->projectionMatrixFile);
+}
+
+DenProjectionMatrixReader::DenProjectionMatrixReader(std::shared_ptr<DenFileHandle> handle)
+    : fileHandle(handle)
+{
+    this->projectionMatrixFile = handle->getFileName();
+    const DenFileInfo& mi = handle->getInfo();
+    this->rawFile = handle->getRawFile();
     this->offset = mi.getOffset();
     uint32_t cols, rows;
     cols = mi.getNumCols(); // Its matrix, dealing with strange data format considerations
@@ -32,7 +39,7 @@ matrix::ProjectionMatrix DenProjectionMatrixReader::readMatrix(int i)
 {
     uint8_t buffer[8 * 3 * 4];
     uint64_t position = this->offset + ((uint64_t)i) * 3 * 4 * 8;
-    io::readBytesFrom(this->projectionMatrixFile, position, buffer, 8 * 3 * 4);
+    rawFile->readBytesFrom(position, buffer, 8 * 3 * 4);
     double matrixData[3 * 4];
     for(int a = 0; a != 3 * 4; a++)
     {
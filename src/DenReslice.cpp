@@ -0,0 +1,297 @@
+#include "DEN/DenReslice.hpp"
+
+// Logging
+#include <plog/Log.h>
+
+// Standard libraries
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+// Internal libraries
+#include "AlignedAllocator.hpp"
+#include "DEN/DenFileInfo.hpp"
+#include "PROG/KCTException.hpp"
+#include "PROG/ThreadPool.hpp"
+#include "RawFile.hpp"
+#include "Transpose.hpp"
+#include "rawop.h"
+#include "stringFormatter.h"
+
+namespace KCT::io {
+
+namespace {
+    /**
+     * Order of the axes of the data in the memory.
+     */
+    struct Layout
+    {
+        /// Input axis of the memory axis i, fastest first
+        std::array<uint32_t, 3> axis;
+        /// Number of elements along the memory axis i
+        std::array<uint64_t, 3> size;
+    };
+
+    /**
+     * @param logical Input axes of the x, y and z dimensions.
+     * @param inputSize Dimensions of the input.
+     * @param XMajor Alignment of the frames.
+     */
+    Layout
+    layoutOf(std::array<uint32_t, 3> logical, std::array<uint64_t, 3> inputSize, bool XMajor)
+    {
+        Layout l;
+        if(XMajor)
+        {
+            l.axis = { logical[0], logical[1], logical[2] };
+        } else
+        {
+            l.axis = { logical[1], logical[0], logical[2] };
+        }
+        for(int i = 0; i != 3; i++)
+        {
+            l.size[i] = inputSize[l.axis[i]];
+        }
+        return l;
+    }
+
+    /**
+     * Call f(j) for j in [0, count) by the threads of the pool, by the calling thread without
+     * the pool.
+     */
+    void parallelFor(ThreadPool<>* pool,
+                     uint32_t threads,
+                     uint64_t count,
+                     const std::function<void(uint64_t)>& f)
+    {
+        if(pool == nullptr)
+        {
+            for(uint64_t j = 0; j != count; j++)
+            {
+                f(j);
+            }
+            return;
+        }
+        std::atomic<uint64_t> next(0);
+        auto work = [&]() {
+            uint64_t j;
+            try
+            {
+                while((j = next++) < count)
+                {
+                    f(j);
+                }
+            } catch(...)
+            {
+                // Stop the other threads
+                next = count;
+                throw;
+            }
+        };
+        std::vector<std::future<void>> futures;
+        for(uint32_t t = 0; t != threads; t++)
+        {
+            futures.emplace_back(pool->submit(
+                [&work](std::shared_ptr<typename ThreadPool<>::ThreadInfo>) {
+                    work();
+                }));
+        }
+        for(std::future<void>& future : futures)
+        {
+            future.get();
+        }
+    }
+
+    /**
+     * One pass from the layout a to the layout b, the slowest axis of b must be one of the two
+     * slower axes of a.
+     */
+    void reslicePass(const RawFile& in,
+                     uint64_t inOffset,
+                     const Layout& a,
+                     const RawFile& out,
+                     uint64_t outOffset,
+                     const Layout& b,
+                     uint64_t elementByteSize,
+                     const DenResliceOptions& opts,
+                     DenResliceStatistics& stats)
+    {
+        const uint64_t e = elementByteSize;
+        // Otherwise the slowest axis of b is the slower axis within the frames of a
+        bool byFrames = b.axis[2] == a.axis[2];
+        uint64_t frameBytes = b.size[0] * b.size[1] * e;
+        uint64_t rowBytes = a.size[0] * e;
+        if(opts.memoryBytes / 3 < frameBytes)
+        {
+            LOGW << io::xprintf("Memory of %lu bytes does not fit three output frames of %lu "
+                                "bytes, using more.",
+                                opts.memoryBytes, frameBytes);
+        }
+        uint64_t blockFrames = std::max<uint64_t>(opts.memoryBytes / 3 / frameBytes, 1);
+        blockFrames = std::min<uint64_t>(blockFrames, b.size[2]);
+        uint32_t threads = opts.numThreads != 0 ? opts.numThreads
+                                                : std::max(std::thread::hardware_concurrency(), 1u);
+        std::unique_ptr<ThreadPool<>> pool;
+        if(threads > 1)
+        {
+            pool = std::make_unique<ThreadPool<>>(threads);
+        }
+        std::vector<uint8_t, AlignedAllocator<uint8_t>> input(blockFrames * frameBytes);
+        std::vector<uint8_t, AlignedAllocator<uint8_t>> blocks[2]
+            = { std::vector<uint8_t, AlignedAllocator<uint8_t>>(blockFrames * frameBytes),
+                std::vector<uint8_t, AlignedAllocator<uint8_t>>(blockFrames * frameBytes) };
+        // Declared after the buffers, so that the pending write ends before they are freed
+        std::future<void> pendingWrite;
+        uint64_t blockIndex = 0;
+        for(uint64_t from = 0; from < b.size[2]; from += blockFrames, blockIndex++)
+        {
+            uint64_t n = std::min(blockFrames, b.size[2] - from);
+            if(byFrames)
+            {
+                in.readBytesFrom(inOffset + from * frameBytes, input.data(), n * frameBytes);
+                stats.reads++;
+            } else
+            {
+                // Rows [from, from + n) of each input frame
+                for(uint64_t z = 0; z != a.size[2]; z++)
+                {
+                    in.readBytesFrom(inOffset + (z * a.size[1] + from) * rowBytes,
+                                     input.data() + z * n * rowBytes, n * rowBytes);
+                }
+                stats.reads += a.size[2];
+            }
+            stats.bytesRead += n * frameBytes;
+            // Written two blocks ago, that write was waited for before the last one started
+            uint8_t* block = blocks[blockIndex % 2].data();
+            parallelFor(pool.get(), threads, n, [&](uint64_t j) {
+                uint8_t* o = block + j * frameBytes;
+                if(byFrames)
+                {
+                    const uint8_t* f = input.data() + j * frameBytes;
+                    if(b.axis[0] == a.axis[0])
+                    {
+                        std::memcpy(o, f, frameBytes);
+                    } else
+                    {
+                        transposeElements(f, a.size[0], o, a.size[1], a.size[1], a.size[0], e);
+                    }
+                } else
+                {
+                    // Row j of the first input frame, the rows of the next frames follow by n
+                    const uint8_t* r = input.data() + j * rowBytes;
+                    if(b.axis[0] == a.axis[0])
+                    {
+                        for(uint64_t z = 0; z != a.size[2]; z++)
+                        {
+                            std::memcpy(o + z * rowBytes, r + z * n * rowBytes, rowBytes);
+                        }
+                    } else
+                    {
+                        transposeElements(r, n * a.size[0], o, a.size[2], a.size[2], a.size[0], e);
+                    }
+                }
+            });
+            if(pendingWrite.valid())
+            {
+                pendingWrite.get();
+            }
+            uint64_t position = outOffset + from * frameBytes;
+            pendingWrite = std::async(std::launch::async, [&out, block, position, n, frameBytes]() {
+                out.writeBytesFrom(position, block, n * frameBytes);
+            });
+            stats.writes++;
+            stats.bytesWritten += n * frameBytes;
+        }
+        if(pendingWrite.valid())
+        {
+            pendingWrite.get();
+        }
+    }
+} // namespace
+
+std::array<uint32_t, 3> parseAxisOrder(const std::string& order)
+{
+    std::array<uint32_t, 3> axisOrder;
+    bool used[3] = { false, false, false };
+    if(order.size() != 3)
+    {
+        KCTERR(io::xprintf("Axis order %s is not a permutation of xyz.", order.c_str()));
+    }
+    for(int i = 0; i != 3; i++)
+    {
+        char c = order[i];
+        if(c < 'x' || c > 'z' || used[c - 'x'])
+        {
+            KCTERR(io::xprintf("Axis order %s is not a permutation of xyz.", order.c_str()));
+        }
+        axisOrder[i] = c - 'x';
+        used[c - 'x'] = true;
+    }
+    return axisOrder;
+}
+
+DenResliceStatistics
+resliceDenFile(const std::string& input, const std::string& output, const DenResliceOptions& opts)
+{
+    std::array<uint32_t, 3> p = opts.axisOrder;
+    if(p[0] > 2 || p[1] > 2 || p[2] > 2 || p[0] == p[1] || p[0] == p[2] || p[1] == p[2])
+    {
+        KCTERR(io::xprintf("Axis order (%u, %u, %u) is not a permutation of (0, 1, 2).", p[0],
+                           p[1], p[2]));
+    }
+    if(input == output)
+    {
+        KCTERR(io::xprintf("Can not reslice %s in place.", input.c_str()));
+    }
+    DenFileInfo info(input);
+    if(!info.isValid() || info.getDimCount() > 3)
+    {
+        KCTERR(io::xprintf("File %s is not valid 2D or 3D DEN file.", input.c_str()));
+    }
+    std::array<uint64_t, 3> size = { info.dimx(), info.dimy(), info.getFrameCount() };
+    uint64_t e = info.getElementByteSize();
+    Layout a = layoutOf({ 0, 1, 2 }, size, info.hasXMajorAlignment());
+    Layout b = layoutOf(p, size, opts.XMajor);
+    DenFileInfo::createEmpty3DDenFile(output, info.getElementType(), size[p[0]], size[p[1]],
+                                      size[p[2]], opts.XMajor);
+    uint64_t outOffset = DenFileInfo(output).getOffset();
+    DenResliceStatistics stats;
+    if(size[0] * size[1] * size[2] == 0)
+    {
+        return stats;
+    }
+    RawFile in(input);
+    RawFile out(output, true);
+    if(b.axis[2] != a.axis[0])
+    {
+        reslicePass(in, info.getOffset(), a, out, outOffset, b, e, opts, stats);
+        stats.passes = 1;
+        return stats;
+    }
+    // Transposing the input frames makes the fastest axis the slower axis within the frames
+    Layout m;
+    m.axis = { a.axis[1], a.axis[0], a.axis[2] };
+    m.size = { a.size[1], a.size[0], a.size[2] };
+    std::string tmp = output + ".tmp";
+    io::createFileWithHeader(tmp, nullptr, 0, size[0] * size[1] * size[2] * e, true);
+    try
+    {
+        RawFile t(tmp, true);
+        reslicePass(in, info.getOffset(), a, t, 0, m, e, opts, stats);
+        reslicePass(t, 0, m, out, outOffset, b, e, opts, stats);
+    } catch(...)
+    {
+        std::remove(tmp.c_str());
+        throw;
+    }
+    std::remove(tmp.c_str());
+    stats.passes = 2;
+    return stats;
+}
+
+} // namespace KCT::io
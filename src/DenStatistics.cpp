@@ -0,0 +1,468 @@
+#include "DEN/DenStatistics.hpp"
+
+// Standard libraries
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <thread>
+#include <type_traits>
+
+// Internal libraries
+#include "AlignedAllocator.hpp"
+#include "DEN/DenElementConversion.hpp"
+#include "PROG/ThreadPool.hpp"
+
+namespace KCT::io {
+
+namespace {
+    // Independent accumulators so that the compiler can keep them in vector registers
+    constexpr uint32_t LANES = 8;
+    // Elements processed by the two pass kernel while they are still in the cache
+    constexpr uint64_t SUBBLOCK_ELEMENTS = 16384;
+    constexpr uint64_t HISTOGRAM_BINS = 65536;
+
+    struct Moments
+    {
+        uint64_t count = 0;
+        uint64_t nanCount = 0;
+        uint64_t posInfCount = 0;
+        uint64_t negInfCount = 0;
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+        double sum = 0.0;
+        double sumSquares = 0.0;
+        double mean = 0.0;
+        // Sum of squared deviations from the mean
+        double M2 = 0.0;
+
+        // Parallel variance algorithm by Chan, Golub and LeVeque
+        void merge(const Moments& b)
+        {
+            nanCount += b.nanCount;
+            posInfCount += b.posInfCount;
+            negInfCount += b.negInfCount;
+            if(b.count == 0)
+            {
+                return;
+            }
+            if(count == 0)
+            {
+                count = b.count;
+                min = b.min;
+                max = b.max;
+                sum = b.sum;
+                sumSquares = b.sumSquares;
+                mean = b.mean;
+                M2 = b.M2;
+                return;
+            }
+            double n = double(count + b.count);
+            double delta = b.mean - mean;
+            mean += delta * double(b.count) / n;
+            M2 += b.M2 + delta * delta * double(count) * double(b.count) / n;
+            count += b.count;
+            min = std::min(min, b.min);
+            max = std::max(max, b.max);
+            sum += b.sum;
+            sumSquares += b.sumSquares;
+        }
+    };
+
+    // Maps float to the unsigned integer of the same ordering
+    uint32_t orderedFloatKey(float f)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+
+    float floatFromOrderedKey(uint32_t key)
+    {
+        uint32_t bits = (key & 0x80000000u) ? (key & 0x7FFFFFFFu) : ~key;
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    template <typename S>
+    constexpr bool hasExactHistogram()
+    {
+        return std::is_same<S, uint8_t>::value || std::is_same<S, uint16_t>::value
+            || std::is_same<S, int16_t>::value;
+    }
+
+    template <typename S>
+    uint32_t histogramBin(S v)
+    {
+        if constexpr(std::is_same<S, int16_t>::value)
+        {
+            return uint16_t(v) ^ 0x8000u;
+        } else if constexpr(hasExactHistogram<S>())
+        {
+            return v;
+        } else
+        {
+            // Upper half of the key is the sign, exponent and 7 bits of mantissa
+            return orderedFloatKey(static_cast<float>(v)) >> 16;
+        }
+    }
+
+    template <typename S>
+    double histogramBinLow(uint32_t bin)
+    {
+        if constexpr(std::is_same<S, int16_t>::value)
+        {
+            return double(int16_t(uint16_t(bin ^ 0x8000u)));
+        } else if constexpr(hasExactHistogram<S>())
+        {
+            return double(bin);
+        } else
+        {
+            return double(floatFromOrderedKey(bin << 16));
+        }
+    }
+
+    template <typename S>
+    double histogramBinHigh(uint32_t bin)
+    {
+        if constexpr(hasExactHistogram<S>())
+        {
+            return histogramBinLow<S>(bin);
+        } else
+        {
+            return double(floatFromOrderedKey((bin << 16) | 0xFFFFu));
+        }
+    }
+
+    // Scalar path for the subblocks containing NaN or infinite values
+    template <typename S>
+    void nonFiniteMoments(const S* x, uint64_t n, Moments& m, uint64_t* histogram)
+    {
+        Moments b;
+        for(uint64_t i = 0; i != n; i++)
+        {
+            double v = double(x[i]);
+            if(std::isnan(v))
+            {
+                b.nanCount++;
+            } else if(std::isinf(v))
+            {
+                if(v > 0)
+                {
+                    b.posInfCount++;
+                } else
+                {
+                    b.negInfCount++;
+                }
+            } else
+            {
+                b.count++;
+                b.min = std::min(b.min, v);
+                b.max = std::max(b.max, v);
+                b.sum += v;
+                b.sumSquares += v * v;
+                if(histogram != nullptr)
+                {
+                    histogram[histogramBin<S>(x[i])]++;
+                }
+            }
+        }
+        if(b.count != 0)
+        {
+            b.mean = b.sum / double(b.count);
+            for(uint64_t i = 0; i != n; i++)
+            {
+                double v = double(x[i]);
+                if(std::isfinite(v))
+                {
+                    b.M2 += (v - b.mean) * (v - b.mean);
+                }
+            }
+        }
+        m.merge(b);
+    }
+
+    template <typename S>
+    void subblockMoments(const S* x, uint64_t n, Moments& m, uint64_t* histogram)
+    {
+        S lmin[LANES], lmax[LANES];
+        double lsum[LANES], lsq[LANES], lcheck[LANES];
+        for(uint32_t j = 0; j != LANES; j++)
+        {
+            lmin[j] = x[0];
+            lmax[j] = x[0];
+            lsum[j] = 0.0;
+            lsq[j] = 0.0;
+            lcheck[j] = 0.0;
+        }
+        uint64_t i = 0;
+        for(; i + LANES <= n; i += LANES)
+        {
+            for(uint32_t j = 0; j != LANES; j++)
+            {
+                S v = x[i + j];
+                lmin[j] = v < lmin[j] ? v : lmin[j];
+                lmax[j] = v > lmax[j] ? v : lmax[j];
+                double d = double(v);
+                lsum[j] += d;
+                lsq[j] += d * d;
+                if constexpr(std::is_floating_point<S>::value)
+                {
+                    // Zero for finite values, NaN otherwise
+                    lcheck[j] += d - d;
+                }
+            }
+        }
+        for(; i != n; i++)
+        {
+            S v = x[i];
+            lmin[0] = v < lmin[0] ? v : lmin[0];
+            lmax[0] = v > lmax[0] ? v : lmax[0];
+            double d = double(v);
+            lsum[0] += d;
+            lsq[0] += d * d;
+            if constexpr(std::is_floating_point<S>::value)
+            {
+                lcheck[0] += d - d;
+            }
+        }
+        Moments b;
+        double check = 0.0;
+        S smin = lmin[0], smax = lmax[0];
+        for(uint32_t j = 0; j != LANES; j++)
+        {
+            smin = std::min(smin, lmin[j]);
+            smax = std::max(smax, lmax[j]);
+            b.sum += lsum[j];
+            b.sumSquares += lsq[j];
+            check += lcheck[j];
+        }
+        if(check != 0.0)
+        {
+            nonFiniteMoments<S>(x, n, m, histogram);
+            return;
+        }
+        b.count = n;
+        b.min = double(smin);
+        b.max = double(smax);
+        b.mean = b.sum / double(n);
+        double lM2[LANES] = {};
+        i = 0;
+        for(; i + LANES <= n; i += LANES)
+        {
+            for(uint32_t j = 0; j != LANES; j++)
+            {
+                double d = double(x[i + j]) - b.mean;
+                lM2[j] += d * d;
+            }
+        }
+        for(; i != n; i++)
+        {
+            double d = double(x[i]) - b.mean;
+            lM2[0] += d * d;
+        }
+        for(uint32_t j = 0; j != LANES; j++)
+        {
+            b.M2 += lM2[j];
+        }
+        if(histogram != nullptr)
+        {
+            for(i = 0; i != n; i++)
+            {
+                histogram[histogramBin<S>(x[i])]++;
+            }
+        }
+        m.merge(b);
+    }
+
+    template <typename S>
+    double valueAtRank(const std::vector<uint64_t>& histogram, uint64_t rank)
+    {
+        uint64_t before = 0;
+        for(uint32_t bin = 0; bin != HISTOGRAM_BINS; bin++)
+        {
+            uint64_t c = histogram[bin];
+            if(rank < before + c)
+            {
+                double lo = histogramBinLow<S>(bin);
+                double hi = histogramBinHigh<S>(bin);
+                if(lo == hi)
+                {
+                    return lo;
+                }
+                // Elements assumed to be evenly spread within the bin
+                double fraction = (double(rank - before) + 0.5) / double(c);
+                return lo + fraction * (hi - lo);
+            }
+            before += c;
+        }
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    template <typename S>
+    DenStatistics computeTypedStatistics(const RawFile& rawFile,
+                                         uint64_t offset,
+                                         uint64_t elementCount,
+                                         const DenStatisticsOptions& opts)
+    {
+        bool collectHistogram = !opts.percentiles.empty();
+        uint64_t blockElements = std::max<uint64_t>(opts.blockByteSize / sizeof(S), 1);
+        uint64_t blockCount = (elementCount + blockElements - 1) / blockElements;
+        uint64_t threads = opts.numThreads != 0 ? opts.numThreads
+                                                : std::max(std::thread::hardware_concurrency(), 1u);
+        threads = std::max<uint64_t>(std::min(threads, blockCount), 1);
+        // Merged in the order of the file at the end to get reproducible results
+        std::vector<Moments> blockMoments(blockCount);
+        std::vector<std::vector<uint64_t>> histograms(threads);
+        std::atomic<uint64_t> nextBlock(0);
+        auto work = [&](uint64_t threadID) {
+            std::vector<uint8_t, AlignedAllocator<uint8_t>> buffer(blockElements * sizeof(S));
+            const S* x = reinterpret_cast<const S*>(buffer.data());
+            uint64_t* histogram = nullptr;
+            if(collectHistogram)
+            {
+                histograms[threadID].assign(HISTOGRAM_BINS, 0);
+                histogram = histograms[threadID].data();
+            }
+            try
+            {
+                uint64_t b;
+                while((b = nextBlock++) < blockCount)
+                {
+                    uint64_t from = b * blockElements;
+                    uint64_t n = std::min(blockElements, elementCount - from);
+                    rawFile.readBytesFrom(offset + from * sizeof(S), buffer.data(), n * sizeof(S));
+                    util::convertByteOrderInPlace(buffer.data(), sizeof(S), n);
+                    for(uint64_t s = 0; s < n; s += SUBBLOCK_ELEMENTS)
+                    {
+                        subblockMoments<S>(x + s, std::min(SUBBLOCK_ELEMENTS, n - s),
+                                           blockMoments[b], histogram);
+                    }
+                }
+            } catch(...)
+            {
+                // Stop the other threads
+                nextBlock = blockCount;
+                throw;
+            }
+        };
+        if(threads == 1)
+        {
+            work(0);
+        } else
+        {
+            ThreadPool<> pool(threads);
+            std::vector<std::future<void>> futures;
+            for(uint64_t t = 0; t != threads; t++)
+            {
+                futures.emplace_back(pool.submit(
+                    [&work, t](std::shared_ptr<typename ThreadPool<>::ThreadInfo>) {
+                        work(t);
+                    }));
+            }
+            for(std::future<void>& f : futures)
+            {
+                f.get();
+            }
+        }
+        Moments total;
+        for(const Moments& b : blockMoments)
+        {
+            total.merge(b);
+        }
+        DenStatistics stats;
+        double nan = std::numeric_limits<double>::quiet_NaN();
+        stats.count = total.count;
+        stats.nanCount = total.nanCount;
+        stats.posInfCount = total.posInfCount;
+        stats.negInfCount = total.negInfCount;
+        stats.sum = total.sum;
+        stats.sumSquares = total.sumSquares;
+        stats.exactPercentiles = hasExactHistogram<S>();
+        if(total.count == 0)
+        {
+            stats.min = nan;
+            stats.max = nan;
+            stats.mean = nan;
+            stats.variance = nan;
+            stats.percentiles.assign(opts.percentiles.size(), nan);
+            return stats;
+        }
+        stats.min = total.min;
+        stats.max = total.max;
+        stats.mean = total.mean;
+        stats.variance = total.M2 / double(total.count);
+        if(collectHistogram)
+        {
+            std::vector<uint64_t> histogram(HISTOGRAM_BINS, 0);
+            for(const std::vector<uint64_t>& h : histograms)
+            {
+                for(uint64_t bin = 0; bin != h.size(); bin++)
+                {
+                    histogram[bin] += h[bin];
+                }
+            }
+            for(double p : opts.percentiles)
+            {
+                // Linear interpolation between the closest ranks
+                double rank = p / 100.0 * double(total.count - 1);
+                uint64_t r0 = uint64_t(std::floor(rank));
+                uint64_t r1 = std::min(r0 + 1, total.count - 1);
+                double v0 = valueAtRank<S>(histogram, r0);
+                double v1 = r1 == r0 ? v0 : valueAtRank<S>(histogram, r1);
+                double v = v0 + (rank - double(r0)) * (v1 - v0);
+                if(std::isnan(v))
+                {
+                    // Bins containing infinity have undefined width, value is at the edge
+                    v = p < 50.0 ? total.min : total.max;
+                }
+                stats.percentiles.push_back(std::min(std::max(v, total.min), total.max));
+            }
+        }
+        return stats;
+    }
+} // namespace
+
+DenStatistics computeDenStatistics(const RawFile& rawFile,
+                                   DenSupportedType elementType,
+                                   uint64_t offset,
+                                   uint64_t elementCount,
+                                   const DenStatisticsOptions& opts)
+{
+    for(double p : opts.percentiles)
+    {
+        if(!(p >= 0.0 && p <= 100.0))
+        {
+            KCTERR(io::xprintf("Percentile %f is out of the range [0, 100].", p));
+        }
+    }
+    switch(elementType)
+    {
+    case DenSupportedType::UINT8:
+        return computeTypedStatistics<uint8_t>(rawFile, offset, elementCount, opts);
+    case DenSupportedType::UINT16:
+        return computeTypedStatistics<uint16_t>(rawFile, offset, elementCount, opts);
+    case DenSupportedType::INT16:
+        return computeTypedStatistics<int16_t>(rawFile, offset, elementCount, opts);
+    case DenSupportedType::UINT32:
+        return computeTypedStatistics<uint32_t>(rawFile, offset, elementCount, opts);
+    case DenSupportedType::INT32:
+        return computeTypedStatistics<int32_t>(rawFile, offset, elementCount, opts);
+    case DenSupportedType::UINT64:
+        return computeTypedStatistics<uint64_t>(rawFile, offset, elementCount, opts);
+    case DenSupportedType::INT64:
+        return computeTypedStatistics<int64_t>(rawFile, offset, elementCount, opts);
+    case DenSupportedType::FLOAT32:
+        return computeTypedStatistics<float>(rawFile, offset, elementCount, opts);
+    case DenSupportedType::FLOAT64:
+        return computeTypedStatistics<double>(rawFile, offset, elementCount, opts);
+    default:
+        KCTERR(io::xprintf("Unsupported data type %s.",
+                           DenSupportedTypeToString(elementType).c_str()));
+    }
+}
+
+} // namespace KCT::io
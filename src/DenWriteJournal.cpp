@@ -0,0 +1,312 @@
+#include "DEN/DenWriteJournal.hpp"
+
+// Logging
+#include <plog/Log.h>
+
+// Standard libraries
+#include <algorithm>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+// Internal libraries
+#include "PROG/KCTException.hpp"
+#include "rawop.h"
+#include "stringFormatter.h"
+
+namespace KCT::io {
+
+namespace {
+    const char JOURNAL_MAGIC[8] = { 'D', 'E', 'N', 'J', 'R', 'N', 'L', '2' };
+    // Position of the identity of the data file in the header
+    const uint64_t IDENTITY_POSITION = 32;
+    const uint64_t IDENTITY_BYTES = 24;
+
+    int64_t nowNsec()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void putWord(uint64_t value, uint8_t* out)
+    {
+        for(int i = 0; i != 8; i++)
+        {
+            out[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    uint64_t getWord(const uint8_t* in)
+    {
+        uint64_t value = 0;
+        for(int i = 0; i != 8; i++)
+        {
+            value |= static_cast<uint64_t>(in[i]) << (8 * i);
+        }
+        return value;
+    }
+} // namespace
+
+DenWriteJournal::DenWriteJournal(std::shared_ptr<RawFile> dataFile,
+                                 uint64_t offset,
+                                 uint64_t frameByteSize,
+                                 uint64_t frameCount,
+                                 bool resume,
+                                 DenWriteJournalPolicy policy)
+    : dataFile(dataFile)
+    , journalFile(getJournalPath(dataFile->getFileName()))
+    , offset(offset)
+    , frameByteSize(frameByteSize)
+    , frameCount(frameCount)
+    , words((frameCount + 63) / 64)
+    , policy(policy)
+    , lastCheckpointNsec(nowNsec())
+    , persisted(words, 0)
+{
+    bitmap = std::make_unique<std::atomic<uint64_t>[]>(words);
+    for(uint64_t i = 0; i != words; i++)
+    {
+        bitmap[i].store(0);
+    }
+    if(!resume || !readJournal())
+    {
+        writeHeader();
+    }
+}
+
+DenWriteJournal::~DenWriteJournal()
+{
+    try
+    {
+        checkpoint();
+    } catch(const std::exception& e)
+    {
+        LOGE << io::xprintf("Checkpoint of the journal %s failed: %s", journalFile.c_str(),
+                            e.what());
+    }
+}
+
+std::string DenWriteJournal::getJournalPath(std::string denFile) { return denFile + ".journal"; }
+
+void DenWriteJournal::writeHeader()
+{
+    std::ofstream(journalFile, std::ios::binary | std::ios::trunc).close();
+    journal = std::make_shared<RawFile>(journalFile, true);
+    std::vector<uint8_t> content(HEADER_BYTES + words * 8, 0);
+    std::memcpy(content.data(), JOURNAL_MAGIC, 8);
+    putWord(frameCount, &content[8]);
+    putWord(frameByteSize, &content[16]);
+    putWord(offset, &content[24]);
+    putIdentity(&content[IDENTITY_POSITION]);
+    journal->writeBytesFrom(0, content.data(), content.size());
+    synchronize(*journal);
+}
+
+bool DenWriteJournal::readJournal()
+{
+    if(!io::pathExists(journalFile))
+    {
+        return false;
+    }
+    journal = std::make_shared<RawFile>(journalFile, true);
+    if(journal->getFileSize() != HEADER_BYTES + words * 8)
+    {
+        LOGW << io::xprintf("Journal %s has unexpected size, starting with no written frames.",
+                            journalFile.c_str());
+        return false;
+    }
+    std::vector<uint8_t> content(HEADER_BYTES + words * 8);
+    journal->readBytesFrom(0, content.data(), content.size());
+    if(std::memcmp(content.data(), JOURNAL_MAGIC, 8) != 0 || getWord(&content[8]) != frameCount
+       || getWord(&content[16]) != frameByteSize || getWord(&content[24]) != offset)
+    {
+        LOGW << io::xprintf("Journal %s does not match the layout of %s, starting with no written "
+                            "frames.",
+                            journalFile.c_str(), dataFile->getFileName().c_str());
+        return false;
+    }
+    FileIdentity id = dataFile->getIdentity();
+    const uint8_t* stored = &content[IDENTITY_POSITION];
+    if(getWord(stored) != id.device || getWord(stored + 8) != id.inode
+       || id.mtimeNsec < static_cast<int64_t>(getWord(stored + 16)))
+    {
+        LOGW << io::xprintf("Journal %s belongs to other file than %s, starting with no written "
+                            "frames.",
+                            journalFile.c_str(), dataFile->getFileName().c_str());
+        return false;
+    }
+    for(uint64_t i = 0; i != words; i++)
+    {
+        persisted[i] = getWord(&content[HEADER_BYTES + i * 8]);
+        bitmap[i].store(persisted[i]);
+    }
+    return true;
+}
+
+void DenWriteJournal::putIdentity(uint8_t* out) const
+{
+    FileIdentity id = dataFile->getIdentity();
+    putWord(id.device, out);
+    putWord(id.inode, out + 8);
+    putWord(static_cast<uint64_t>(id.mtimeNsec), out + 16);
+}
+
+void DenWriteJournal::synchronize(const RawFile& f) const
+{
+    int result;
+#ifdef SYNC_FILE_RANGE_WRITE
+    if(policy.method == JournalSyncMethod::SYNC_FILE_RANGE)
+    {
+        result = ::sync_file_range(f.getFileDescriptor(), 0, 0,
+                                   SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE
+                                       | SYNC_FILE_RANGE_WAIT_AFTER);
+    } else
+#endif
+    {
+        result = ::fdatasync(f.getFileDescriptor());
+    }
+    if(result != 0)
+    {
+        KCTERR(io::xprintf("Can not synchronize file %s, strerror message :%s.",
+                           f.getFileName().c_str(), strerror(errno)));
+    }
+}
+
+void DenWriteJournal::markWritten(uint64_t k)
+{
+    if(k >= frameCount)
+    {
+        KCTERR(io::xprintf("Frame %lu out of range of %lu frames of %s.", k, frameCount,
+                           journalFile.c_str()));
+    }
+    uint64_t bit = uint64_t(1) << (k % 64);
+    if(bitmap[k / 64].fetch_or(bit) & bit)
+    {
+        return;
+    }
+    uint64_t marked = markedSinceCheckpoint.fetch_add(1) + 1;
+    bool due = false;
+    if(policy.durability == JournalDurability::EVERY_N_FRAMES)
+    {
+        due = marked >= policy.frames;
+    } else if(policy.durability == JournalDurability::EVERY_T_SECONDS)
+    {
+        due = nowNsec() - lastCheckpointNsec.load() >= static_cast<int64_t>(policy.seconds * 1e9);
+    }
+    if(due)
+    {
+        // Other threads continue writing while one of them does the checkpoint
+        std::unique_lock<std::mutex> lock(checkpointMutex, std::try_to_lock);
+        if(lock.owns_lock())
+        {
+            persist();
+        }
+    }
+}
+
+bool DenWriteJournal::isWritten(uint64_t k) const
+{
+    return k < frameCount && ((bitmap[k / 64].load() >> (k % 64)) & 1);
+}
+
+std::vector<uint64_t> DenWriteJournal::pendingFrames() const
+{
+    std::vector<uint64_t> pending;
+    for(uint64_t k = 0; k != frameCount; k++)
+    {
+        if(!isWritten(k))
+        {
+            pending.push_back(k);
+        }
+    }
+    return pending;
+}
+
+void DenWriteJournal::checkpoint()
+{
+    std::lock_guard<std::mutex> lock(checkpointMutex);
+    persist();
+}
+
+bool DenWriteJournal::complete()
+{
+    std::lock_guard<std::mutex> lock(checkpointMutex);
+    persist();
+    if(removed)
+    {
+        return true;
+    }
+    for(uint64_t k = 0; k != frameCount; k++)
+    {
+        if(!isWritten(k))
+        {
+            return false;
+        }
+    }
+    if(std::remove(journalFile.c_str()) != 0)
+    {
+        KCTERR(io::xprintf("Can not remove journal %s, strerror message :%s.",
+                           journalFile.c_str(), strerror(errno)));
+    }
+    journal.reset();
+    removed = true;
+    return true;
+}
+
+void DenWriteJournal::persist()
+{
+    if(removed)
+    {
+        return;
+    }
+    int64_t start = nowNsec();
+    // Marks from now on count towards the next checkpoint
+    markedSinceCheckpoint.store(0);
+    lastCheckpointNsec.store(start);
+    std::vector<uint64_t> snapshot(words);
+    uint64_t first = words, last = 0;
+    for(uint64_t i = 0; i != words; i++)
+    {
+        snapshot[i] = bitmap[i].load();
+        if(snapshot[i] != persisted[i])
+        {
+            first = std::min(first, i);
+            last = i;
+        }
+    }
+    if(first == words)
+    {
+        return;
+    }
+    // Frames of the snapshot were written before it was taken, make them durable first
+    synchronize(*dataFile);
+    std::vector<uint8_t> content((last - first + 1) * 8);
+    for(uint64_t i = first; i <= last; i++)
+    {
+        putWord(snapshot[i], &content[(i - first) * 8]);
+    }
+    journal->writeBytesFrom(HEADER_BYTES + first * 8, content.data(), content.size());
+    // Data file modified after this point is newer than the journal records
+    uint8_t identity[IDENTITY_BYTES];
+    putIdentity(identity);
+    journal->writeBytesFrom(IDENTITY_POSITION, identity, IDENTITY_BYTES);
+    synchronize(*journal);
+    std::copy(snapshot.begin() + first, snapshot.begin() + last + 1, persisted.begin() + first);
+    statistics.checkpoints++;
+    statistics.checkpointSeconds += (nowNsec() - start) * 1e-9;
+}
+
+std::string DenWriteJournal::getFileName() const { return journalFile; }
+
+DenWriteJournalStatistics DenWriteJournal::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(checkpointMutex);
+    return statistics;
+}
+
+} // namespace KCT::io
@@ -0,0 +1,193 @@
+#include "FrameCache.hpp"
+
+namespace KCT::io {
+
+bool FrameCacheKey::operator==(const FrameCacheKey& b) const
+{
+    return file == b.file && frame == b.frame && elementType == b.elementType
+        && XMajorAlignment == b.XMajorAlignment;
+}
+
+std::size_t FrameCacheKeyHash::operator()(const FrameCacheKey& k) const
+{
+    // Frames of one file must spread over the shards, mix the frame index last
+    uint64_t h = k.file.inode * 0x9E3779B97F4A7C15ull;
+    h ^= k.file.device + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    h ^= uint64_t(k.file.mtimeNsec) + (h << 6) + (h >> 2);
+    h ^= (uint64_t(k.elementType) << 1 | uint64_t(k.XMajorAlignment)) + (h << 6) + (h >> 2);
+    h ^= k.frame + (h << 6) + (h >> 2);
+    h *= 0xBF58476D1CE4E5B9ull;
+    return std::size_t(h ^ (h >> 31));
+}
+
+FrameCache& FrameCache::instance()
+{
+    static FrameCache c;
+    return c;
+}
+
+FrameCache::FrameCache() { configure(0); }
+
+void FrameCache::configure(uint64_t byteBudget, CachePolicy policy, uint32_t shardCount)
+{
+    std::lock_guard<std::mutex> lock(configureMutex);
+    if(cache != nullptr)
+    {
+        // Resident bytes of the files are released by the listener
+        cache->clear();
+    }
+    std::shared_ptr<Cache> c = std::make_shared<Cache>(byteBudget, policy, shardCount);
+    c->setInsertionListener([this](const FrameCacheKey& key, uint64_t bytes) {
+        std::shared_lock<std::shared_mutex> lock;
+        FileCounters& f = countersOf(key.file, lock);
+        f.entries++;
+        f.bytes += bytes;
+        f.insertions++;
+    });
+    c->setRemovalListener([this](const FrameCacheKey& key, uint64_t bytes, bool evicted) {
+        std::shared_lock<std::shared_mutex> lock;
+        FileCounters& f = countersOf(key.file, lock);
+        f.entries--;
+        f.bytes -= bytes;
+        if(evicted)
+        {
+            f.evictions++;
+        }
+    });
+    std::atomic_store(&cache, c);
+}
+
+std::shared_ptr<FrameCache::Cache> FrameCache::getCache() const
+{
+    return std::atomic_load(&cache);
+}
+
+uint64_t FrameCache::getByteBudget() const { return getCache()->getByteBudget(); }
+
+FrameCache::FileCounters& FrameCache::countersOf(const FileIdentity& file,
+                                                 std::shared_lock<std::shared_mutex>& lock)
+{
+    while(true)
+    {
+        lock = std::shared_lock<std::shared_mutex>(filesMutex);
+        auto it = files.find(file);
+        if(it != files.end())
+        {
+            return *it->second;
+        }
+        lock.unlock();
+        std::unique_lock<std::shared_mutex> ulock(filesMutex);
+        std::unique_ptr<FileCounters>& f = files[file];
+        if(f == nullptr)
+        {
+            f = std::make_unique<FileCounters>();
+        }
+    }
+}
+
+FrameCache::Erased FrameCache::lookupErased(const FrameCacheKey& key)
+{
+    Erased f;
+    bool hit = getCache()->lookup(key, f);
+    std::shared_lock<std::shared_mutex> lock;
+    FileCounters& c = countersOf(key.file, lock);
+    if(hit)
+    {
+        c.hits++;
+        return f;
+    }
+    c.misses++;
+    return nullptr;
+}
+
+bool FrameCache::insertErased(const FrameCacheKey& key, Erased frame, uint64_t bytes)
+{
+    // Resident entries and bytes of the file are counted by the insertion listener
+    return getCache()->insert(key, std::move(frame), bytes);
+}
+
+FrameCache::Erased
+FrameCache::getOrLoadErased(const FrameCacheKey& key,
+                            const std::function<std::pair<Erased, uint64_t>()>& loader)
+{
+    bool hit;
+    Erased f = getCache()->getOrLoad(key, loader, &hit);
+    std::shared_lock<std::shared_mutex> lock;
+    FileCounters& c = countersOf(key.file, lock);
+    if(hit)
+    {
+        c.hits++;
+    } else
+    {
+        c.misses++;
+    }
+    return f;
+}
+
+bool FrameCache::pin(const FrameCacheKey& key) { return getCache()->pin(key); }
+
+bool FrameCache::unpin(const FrameCacheKey& key) { return getCache()->unpin(key); }
+
+bool FrameCache::erase(const FrameCacheKey& key) { return getCache()->erase(key); }
+
+void FrameCache::clear() { getCache()->clear(); }
+
+CacheStatistics FrameCache::getStatistics() const { return getCache()->getStatistics(); }
+
+CacheStatistics FrameCache::getFileStatistics(const FileIdentity& file) const
+{
+    std::shared_lock<std::shared_mutex> lock(filesMutex);
+    CacheStatistics s;
+    auto it = files.find(file);
+    if(it != files.end())
+    {
+        const FileCounters& f = *it->second;
+        s.hits = f.hits;
+        s.misses = f.misses;
+        s.insertions = f.insertions;
+        s.evictions = f.evictions;
+        s.entries = f.entries;
+        s.bytes = f.bytes;
+    }
+    return s;
+}
+
+std::map<FileIdentity, CacheStatistics> FrameCache::getFileStatistics() const
+{
+    std::map<FileIdentity, CacheStatistics> m;
+    {
+        std::shared_lock<std::shared_mutex> lock(filesMutex);
+        for(const auto& f : files)
+        {
+            m[f.first];
+        }
+    }
+    for(auto& s : m)
+    {
+        s.second = getFileStatistics(s.first);
+    }
+    return m;
+}
+
+void FrameCache::resetStatistics()
+{
+    getCache()->resetStatistics();
+    // Counters are updated under the shared lock, entries can not change while it is excluded
+    std::unique_lock<std::shared_mutex> lock(filesMutex);
+    for(auto it = files.begin(); it != files.end();)
+    {
+        FileCounters& f = *it->second;
+        if(f.entries == 0)
+        {
+            it = files.erase(it);
+            continue;
+        }
+        f.hits = 0;
+        f.misses = 0;
+        f.insertions = 0;
+        f.evictions = 0;
+        ++it;
+    }
+}
+
+} // namespace KCT::io
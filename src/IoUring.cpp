@@ -0,0 +1,236 @@
+#include "IoUring.hpp"
+
+// Standard libraries
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef KCT_HAVE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+namespace KCT::io {
+
+#ifdef KCT_HAVE_IO_URING
+namespace {
+    int io_uring_setup(uint32_t entries, struct io_uring_params* p)
+    {
+        return (int)syscall(__NR_io_uring_setup, entries, p);
+    }
+
+    int io_uring_enter(int fd, uint32_t toSubmit, uint32_t minComplete, uint32_t flags)
+    {
+        return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+    }
+} // namespace
+
+IoUring::IoUring(uint32_t queueDepth)
+{
+    std::string ERR;
+    struct io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    ringFd = io_uring_setup(std::max(queueDepth, 1u), &p);
+    if(ringFd < 0)
+    {
+        ERR = io::xprintf("io_uring_setup failed, strerror message :%s.", strerror(errno));
+        KCTERR(ERR);
+    }
+    sqEntries = p.sq_entries;
+    sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if(singleMmap)
+    {
+        sqRingSize = std::max(sqRingSize, cqRingSize);
+        cqRingSize = sqRingSize;
+    }
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                  IORING_OFF_SQ_RING);
+    if(sqRing == MAP_FAILED)
+    {
+        sqRing = nullptr;
+        release();
+        KCTERR(io::xprintf("Can not map io_uring SQ ring, strerror message :%s.", strerror(errno)));
+    }
+    if(singleMmap)
+    {
+        cqRing = sqRing;
+    } else
+    {
+        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ringFd, IORING_OFF_CQ_RING);
+        if(cqRing == MAP_FAILED)
+        {
+            cqRing = nullptr;
+            release();
+            KCTERR(io::xprintf("Can not map io_uring CQ ring, strerror message :%s.",
+                               strerror(errno)));
+        }
+    }
+    sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                IORING_OFF_SQES);
+    if(sqes == MAP_FAILED)
+    {
+        sqes = nullptr;
+        release();
+        KCTERR(io::xprintf("Can not map io_uring SQEs, strerror message :%s.", strerror(errno)));
+    }
+    uint8_t* sq = (uint8_t*)sqRing;
+    uint8_t* cq = (uint8_t*)cqRing;
+    sqHead = (unsigned*)(sq + p.sq_off.head);
+    sqTail = (unsigned*)(sq + p.sq_off.tail);
+    sqMask = (unsigned*)(sq + p.sq_off.ring_mask);
+    sqArray = (unsigned*)(sq + p.sq_off.array);
+    cqHead = (unsigned*)(cq + p.cq_off.head);
+    cqTail = (unsigned*)(cq + p.cq_off.tail);
+    cqMask = (unsigned*)(cq + p.cq_off.ring_mask);
+    cqes = cq + p.cq_off.cqes;
+}
+
+void IoUring::release()
+{
+    if(sqes != nullptr)
+    {
+        munmap(sqes, sqesSize);
+        sqes = nullptr;
+    }
+    if(cqRing != nullptr && cqRing != sqRing)
+    {
+        munmap(cqRing, cqRingSize);
+    }
+    cqRing = nullptr;
+    if(sqRing != nullptr)
+    {
+        munmap(sqRing, sqRingSize);
+        sqRing = nullptr;
+    }
+    if(ringFd >= 0)
+    {
+        close(ringFd);
+        ringFd = -1;
+    }
+}
+
+IoUring::~IoUring() { release(); }
+
+bool IoUring::isAvailable()
+{
+    struct io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    int fd = io_uring_setup(1, &p);
+    if(fd < 0)
+    {
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+bool IoUring::prepareReadv(int fd, const struct iovec* iov, uint64_t offset, uint64_t userData)
+{
+    unsigned tail = *sqTail;
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    if(tail - head >= sqEntries)
+    {
+        return false;
+    }
+    unsigned index = tail & *sqMask;
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*)sqes + index;
+    std::memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)iov;
+    sqe->len = 1;
+    sqe->off = offset;
+    sqe->user_data = userData;
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    toSubmit++;
+    return true;
+}
+
+void IoUring::submit(uint32_t waitCompletions)
+{
+    uint32_t flags = waitCompletions > 0 ? IORING_ENTER_GETEVENTS : 0;
+    while(toSubmit > 0 || waitCompletions > 0)
+    {
+        int ret = io_uring_enter(ringFd, toSubmit, waitCompletions, flags);
+        if(ret < 0)
+        {
+            if(errno == EINTR || errno == EAGAIN)
+            {
+                continue;
+            }
+            KCTERR(io::xprintf("io_uring_enter failed, strerror message :%s.", strerror(errno)));
+        }
+        toSubmit -= std::min((uint32_t)ret, toSubmit);
+        waitCompletions = 0;
+        flags = 0;
+    }
+}
+
+bool IoUring::peekCompletion(uint64_t& userData, int32_t& result)
+{
+    unsigned head = *cqHead;
+    unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    if(head == tail)
+    {
+        return false;
+    }
+    struct io_uring_cqe* cqe = (struct io_uring_cqe*)cqes + (head & *cqMask);
+    userData = cqe->user_data;
+    result = cqe->res;
+    __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void IoUring::waitCompletion(uint64_t& userData, int32_t& result)
+{
+    while(!peekCompletion(userData, result))
+    {
+        submit(1);
+    }
+}
+
+#else
+
+IoUring::IoUring(uint32_t queueDepth)
+{
+    KCTERR("io_uring is not supported on this platform.");
+}
+
+void IoUring::release() {}
+
+IoUring::~IoUring() {}
+
+bool IoUring::isAvailable() { return false; }
+
+bool IoUring::prepareReadv(int fd, const struct iovec* iov, uint64_t offset, uint64_t userData)
+{
+    KCTERR("io_uring is not supported on this platform.");
+}
+
+void IoUring::submit(uint32_t waitCompletions)
+{
+    KCTERR("io_uring is not supported on this platform.");
+}
+
+bool IoUring::peekCompletion(uint64_t& userData, int32_t& result)
+{
+    KCTERR("io_uring is not supported on this platform.");
+}
+
+void IoUring::waitCompletion(uint64_t& userData, int32_t& result)
+{
+    KCTERR("io_uring is not supported on this platform.");
+}
+
+#endif
+
+uint32_t IoUring::getQueueDepth() const { return sqEntries; }
+
+} // namespace KCT::io
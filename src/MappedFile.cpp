@@ -0,0 +1,119 @@
+#include "MappedFile.hpp"
+
+// Standard libraries
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace KCT::io {
+
+MappedFile::MappedFile(const RawFile& file, bool populate, bool hugePages)
+    : fileName(file.getFileName())
+{
+    mappedSize = file.getFileSize();
+    map(file.getFileDescriptor(), populate, hugePages);
+}
+
+MappedFile::MappedFile(std::string fileName, bool populate, bool hugePages)
+    : fileName(fileName)
+{
+    RawFile file(fileName);
+    mappedSize = file.getFileSize();
+    map(file.getFileDescriptor(), populate, hugePages);
+}
+
+void MappedFile::map(int fd, bool populate, bool hugePages)
+{
+    std::string ERR;
+    if(mappedSize == 0)
+    {
+        ERR = io::xprintf("Can not map empty file %s.", fileName.c_str());
+        KCTERR(ERR);
+    }
+    int flags = MAP_PRIVATE;
+    if(populate)
+    {
+        flags |= MAP_POPULATE;
+    }
+    void* p = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if(p == MAP_FAILED)
+    {
+        ERR = io::xprintf("Can not map %lu bytes of the file %s, strerror message :%s.", mappedSize,
+                          fileName.c_str(), strerror(errno));
+        KCTERR(ERR);
+    }
+    mappedData = static_cast<uint8_t*>(p);
+    if(hugePages)
+    {
+#ifdef MADV_HUGEPAGE
+        if(madvise(mappedData, mappedSize, MADV_HUGEPAGE) != 0)
+        {
+            LOGD << io::xprintf("MADV_HUGEPAGE not applied to %s, strerror message :%s.",
+                                fileName.c_str(), strerror(errno));
+        }
+#else
+        LOGD << "MADV_HUGEPAGE is not supported on this platform.";
+#endif
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if(mappedData != nullptr)
+    {
+        if(munmap(mappedData, mappedSize) != 0)
+        {
+            LOGE << io::xprintf("Error unmapping file %s, strerror message :%s.", fileName.c_str(),
+                                strerror(errno));
+        }
+    }
+    mappedData = nullptr;
+}
+
+void MappedFile::advise(MemoryAdvice advice, uint64_t fromPosition, uint64_t numBytes) const
+{
+    if(fromPosition >= mappedSize)
+    {
+        return;
+    }
+    if(numBytes == 0 || fromPosition + numBytes > mappedSize)
+    {
+        numBytes = mappedSize - fromPosition;
+    }
+    uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    uint64_t alignedFrom = fromPosition / pageSize * pageSize;
+    numBytes += fromPosition - alignedFrom;
+    int adv;
+    switch(advice)
+    {
+    case MemoryAdvice::SEQUENTIAL:
+        adv = MADV_SEQUENTIAL;
+        break;
+    case MemoryAdvice::RANDOM:
+        adv = MADV_RANDOM;
+        break;
+    case MemoryAdvice::WILLNEED:
+        adv = MADV_WILLNEED;
+        break;
+    case MemoryAdvice::DONTNEED:
+        adv = MADV_DONTNEED;
+        break;
+    default:
+        adv = MADV_NORMAL;
+    }
+    if(madvise(mappedData + alignedFrom, numBytes, adv) != 0)
+    {
+        LOGD << io::xprintf("madvise on %s failed, strerror message :%s.", fileName.c_str(),
+                            strerror(errno));
+    }
+}
+
+uint8_t* MappedFile::data() const { return mappedData; }
+
+uint64_t MappedFile::size() const { return mappedSize; }
+
+std::string MappedFile::getFileName() const { return fileName; }
+
+} // namespace KCT::io
@@ -0,0 +1,195 @@
+#include "NumaMemory.hpp"
+
+// Logging
+#include <plog/Log.h>
+
+// Standard libraries
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Internal libraries
+#include "stringFormatter.h"
+
+// Constants of <numaif.h>, libnuma is not a dependency
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+
+namespace KCT::io {
+
+namespace {
+    const std::string NODE_DIRECTORY = "/sys/devices/system/node/";
+
+    /**
+     * Parse the list of the form 0-3,8,10-11.
+     */
+    std::vector<uint32_t> parseList(const std::string& list)
+    {
+        std::vector<uint32_t> values;
+        std::size_t pos = 0;
+        while(pos < list.size())
+        {
+            std::size_t end = list.find(',', pos);
+            if(end == std::string::npos)
+            {
+                end = list.size();
+            }
+            std::string item = list.substr(pos, end - pos);
+            pos = end + 1;
+            if(item.empty() || !std::isdigit(static_cast<unsigned char>(item[0])))
+            {
+                continue;
+            }
+            std::size_t dash = item.find('-');
+            uint32_t from = std::stoul(item.substr(0, dash));
+            uint32_t to = dash == std::string::npos ? from : std::stoul(item.substr(dash + 1));
+            for(uint32_t v = from; v <= to; v++)
+            {
+                values.push_back(v);
+            }
+        }
+        return values;
+    }
+
+    std::vector<uint32_t> memoryNodes()
+    {
+        std::ifstream f(NODE_DIRECTORY + "has_memory");
+        std::string list;
+        if(!std::getline(f, list))
+        {
+            return {};
+        }
+        return parseList(list);
+    }
+} // namespace
+
+uint32_t numaNodeCount() { return static_cast<uint32_t>(numaNodes().size()); }
+
+std::vector<uint32_t> numaNodes()
+{
+    static const std::vector<uint32_t> nodes = [] {
+        std::vector<uint32_t> n = memoryNodes();
+        return n.empty() ? std::vector<uint32_t>{ 0 } : n;
+    }();
+    return nodes;
+}
+
+std::vector<uint32_t> numaNodeCpus(uint32_t node)
+{
+    std::ifstream f(NODE_DIRECTORY + io::xprintf("node%u/cpulist", node));
+    std::string list;
+    if(!std::getline(f, list))
+    {
+        return {};
+    }
+    return parseList(list);
+}
+
+bool bindThreadToNumaNode(uint32_t node)
+{
+    std::vector<uint32_t> cpus = numaNodeCpus(node);
+    if(cpus.empty())
+    {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(uint32_t cpu : cpus)
+    {
+        if(cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+void applyNumaPolicy(void* p, uint64_t numBytes, NumaPolicy policy, uint32_t node)
+{
+    if(policy == NumaPolicy::FIRST_TOUCH || numBytes == 0)
+    {
+        return;
+    }
+    uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    uint64_t from = (reinterpret_cast<uint64_t>(p) + pageSize - 1) / pageSize * pageSize;
+    uint64_t to = (reinterpret_cast<uint64_t>(p) + numBytes) / pageSize * pageSize;
+    if(to <= from)
+    {
+        return;
+    }
+    std::vector<uint32_t> nodes;
+    int mode;
+    if(policy == NumaPolicy::INTERLEAVE)
+    {
+        nodes = memoryNodes();
+        mode = MPOL_INTERLEAVE;
+    } else
+    {
+        nodes.push_back(node);
+        mode = MPOL_BIND;
+    }
+    if(nodes.empty())
+    {
+        return;
+    }
+    const uint64_t bitsPerWord = 8 * sizeof(unsigned long);
+    uint32_t maxNode = *std::max_element(nodes.begin(), nodes.end());
+    std::vector<unsigned long> mask(maxNode / bitsPerWord + 1, 0);
+    for(uint32_t n : nodes)
+    {
+        mask[n / bitsPerWord] |= 1ul << (n % bitsPerWord);
+    }
+    // The kernel expects maxnode one greater than the number of bits it reads
+    long result = syscall(SYS_mbind, from, to - from, mode, mask.data(),
+                          mask.size() * bitsPerWord + 1, 0u);
+    if(result != 0)
+    {
+        LOGW << io::xprintf("Can not set NUMA policy of %lu bytes, strerror message :%s.",
+                            to - from, strerror(errno));
+    }
+}
+
+std::vector<int> numaNodesOfAddresses(const std::vector<const void*>& addresses)
+{
+    std::vector<int> status(addresses.size(), -1);
+    if(addresses.empty())
+    {
+        return status;
+    }
+    uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    std::vector<void*> pages(addresses.size());
+    for(std::size_t i = 0; i != addresses.size(); i++)
+    {
+        pages[i] = reinterpret_cast<void*>(reinterpret_cast<uint64_t>(addresses[i]) / pageSize
+                                           * pageSize);
+    }
+    // With nodes == nullptr move_pages only reports the node of each page in status
+    long result = syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0);
+    if(result != 0)
+    {
+        std::fill(status.begin(), status.end(), -1);
+        return status;
+    }
+    for(int& s : status)
+    {
+        // Negative errno such as -ENOENT for the pages not present
+        if(s < 0)
+        {
+            s = -1;
+        }
+    }
+    return status;
+}
+
+} // namespace KCT::io
@@ -0,0 +1,368 @@
+#include "RawFile.hpp"
+
+// Standard libraries
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+namespace KCT::io {
+
+namespace {
+    // Size of the bounce buffer used for O_DIRECT transfers from and to unaligned user memory
+    constexpr uint64_t DIRECT_IO_CHUNK = 4 * 1024 * 1024;
+
+    uint8_t* bounceBuffer()
+    {
+        thread_local std::vector<uint8_t, AlignedAllocator<uint8_t>> buffer(DIRECT_IO_CHUNK);
+        return buffer.data();
+    }
+} // namespace
+
+bool FileIdentity::operator==(const FileIdentity& b) const
+{
+    return device == b.device && inode == b.inode && size == b.size && mtimeNsec == b.mtimeNsec;
+}
+
+bool FileIdentity::operator!=(const FileIdentity& b) const { return !(*this == b); }
+
+bool FileIdentity::operator<(const FileIdentity& b) const
+{
+    return std::tie(device, inode, size, mtimeNsec)
+        < std::tie(b.device, b.inode, b.size, b.mtimeNsec);
+}
+
+RawFile::RawFile(std::string fileName, bool writable, bool directIO)
+    : fileName(fileName)
+    , writable(writable)
+{
+    std::string ERR;
+    int flags = writable ? O_RDWR : O_RDONLY;
+    fd = ::open(fileName.c_str(), flags | O_CLOEXEC);
+    if(fd < 0)
+    {
+        ERR = io::xprintf("Can not open file %s, strerror message :%s.", fileName.c_str(),
+                          strerror(errno));
+        KCTERR(ERR);
+    }
+    if(directIO)
+    {
+#ifdef O_DIRECT
+        directFd = ::open(fileName.c_str(), flags | O_CLOEXEC | O_DIRECT);
+        if(directFd < 0)
+        {
+            LOGW << io::xprintf("Can not open file %s with O_DIRECT, falling back to buffered "
+                                "I/O, strerror message :%s.",
+                                fileName.c_str(), strerror(errno));
+        }
+#else
+        LOGW << io::xprintf("O_DIRECT is not supported on this platform, reading %s buffered.",
+                            fileName.c_str());
+#endif
+    }
+}
+
+RawFile::~RawFile()
+{
+    if(directFd >= 0)
+    {
+        ::close(directFd);
+    }
+    directFd = -1;
+    if(fd >= 0)
+    {
+        if(::close(fd) != 0)
+        {
+            LOGE << io::xprintf("Error closing file %s, strerror message :%s.", fileName.c_str(),
+                                strerror(errno));
+        }
+    }
+    fd = -1;
+}
+
+void RawFile::readFully(int descriptor,
+                        uint64_t fromPosition,
+                        uint8_t* buffer,
+                        uint64_t numBytes) const
+{
+    std::string ERR;
+    uint64_t done = 0;
+    while(done != numBytes)
+    {
+        ssize_t num = ::pread(descriptor, buffer + done, numBytes - done, fromPosition + done);
+        if(num < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            ERR = io::xprintf("Can not read %lu bytes from the position %lu in file %s, strerror "
+                              "message :%s.",
+                              numBytes, fromPosition, fileName.c_str(), strerror(errno));
+            KCTERR(ERR);
+        } else if(num == 0)
+        {
+            ERR = io::xprintf(
+                "Can not read %lu bytes from the position %lu in file %s, only %lu bytes read.",
+                numBytes, fromPosition, fileName.c_str(), done);
+            KCTERR(ERR);
+        }
+        done += num;
+    }
+}
+
+void RawFile::writeFully(int descriptor,
+                         uint64_t fromPosition,
+                         const uint8_t* buffer,
+                         uint64_t numBytes) const
+{
+    std::string ERR;
+    uint64_t done = 0;
+    while(done != numBytes)
+    {
+        ssize_t num = ::pwrite(descriptor, buffer + done, numBytes - done, fromPosition + done);
+        if(num < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            ERR = io::xprintf("Instead of %lu bytes to be written from position %lu to the file %s "
+                              "only %lu bytes was written, strerror message :%s.",
+                              numBytes, fromPosition, fileName.c_str(), done, strerror(errno));
+            KCTERR(ERR);
+        }
+        done += num;
+    }
+}
+
+void RawFile::readBytesFrom(uint64_t fromPosition, uint8_t* buffer, uint64_t numBytes) const
+{
+    uint64_t alignedFrom
+        = (fromPosition + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+    uint64_t alignedTo = (fromPosition + numBytes) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+    if(directFd < 0 || alignedTo <= alignedFrom)
+    {
+        readFully(fd, fromPosition, buffer, numBytes);
+        return;
+    }
+    // Unaligned head and tail through the page cache
+    readFully(fd, fromPosition, buffer, alignedFrom - fromPosition);
+    readFully(fd, alignedTo, buffer + (alignedTo - fromPosition),
+              fromPosition + numBytes - alignedTo);
+    uint8_t* target = buffer + (alignedFrom - fromPosition);
+    uint64_t directBytes = alignedTo - alignedFrom;
+    if(isAligned(target, DIRECT_IO_ALIGNMENT))
+    {
+        readFully(directFd, alignedFrom, target, directBytes);
+    } else
+    {
+        uint8_t* bounce = bounceBuffer();
+        for(uint64_t done = 0; done < directBytes; done += DIRECT_IO_CHUNK)
+        {
+            uint64_t chunk = std::min(DIRECT_IO_CHUNK, directBytes - done);
+            readFully(directFd, alignedFrom + done, bounce, chunk);
+            std::memcpy(target + done, bounce, chunk);
+        }
+    }
+}
+
+void RawFile::readvBytesFrom(uint64_t fromPosition, std::vector<struct iovec> iov) const
+{
+    std::string ERR;
+    if(directFd >= 0)
+    {
+        // Alignment is handled per buffer
+        for(const struct iovec& v : iov)
+        {
+            readBytesFrom(fromPosition, static_cast<uint8_t*>(v.iov_base), v.iov_len);
+            fromPosition += v.iov_len;
+        }
+        return;
+    }
+    uint64_t numBytes = 0;
+    for(const struct iovec& v : iov)
+    {
+        numBytes += v.iov_len;
+    }
+    uint64_t done = 0;
+    std::size_t first = 0;
+    while(done != numBytes)
+    {
+        int count = static_cast<int>(std::min<std::size_t>(iov.size() - first, IOV_MAX));
+        ssize_t num = ::preadv(fd, iov.data() + first, count, fromPosition + done);
+        if(num < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            ERR = io::xprintf("Can not read %lu bytes from the position %lu in file %s, strerror "
+                              "message :%s.",
+                              numBytes, fromPosition, fileName.c_str(), strerror(errno));
+            KCTERR(ERR);
+        } else if(num == 0)
+        {
+            ERR = io::xprintf(
+                "Can not read %lu bytes from the position %lu in file %s, only %lu bytes read.",
+                numBytes, fromPosition, fileName.c_str(), done);
+            KCTERR(ERR);
+        }
+        done += num;
+        // Skip filled buffers and advance the partially filled one
+        uint64_t rest = num;
+        while(first != iov.size() && rest >= iov[first].iov_len)
+        {
+            rest -= iov[first].iov_len;
+            first++;
+        }
+        if(rest > 0)
+        {
+            iov[first].iov_base = static_cast<uint8_t*>(iov[first].iov_base) + rest;
+            iov[first].iov_len -= rest;
+        }
+    }
+}
+
+void RawFile::writeBytesFrom(uint64_t fromPosition, const uint8_t* buffer, uint64_t numBytes) const
+{
+    std::string ERR;
+    if(!writable)
+    {
+        ERR = io::xprintf("File %s is not opened for writing.", fileName.c_str());
+        KCTERR(ERR);
+    }
+    uint64_t alignedFrom
+        = (fromPosition + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+    uint64_t alignedTo = (fromPosition + numBytes) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+    if(directFd < 0 || alignedTo <= alignedFrom)
+    {
+        writeFully(fd, fromPosition, buffer, numBytes);
+        return;
+    }
+    // Partial blocks are shared with the neighboring transfers, write them through the page cache
+    writeFully(fd, fromPosition, buffer, alignedFrom - fromPosition);
+    writeFully(fd, alignedTo, buffer + (alignedTo - fromPosition),
+               fromPosition + numBytes - alignedTo);
+    const uint8_t* source = buffer + (alignedFrom - fromPosition);
+    uint64_t directBytes = alignedTo - alignedFrom;
+    if(isAligned(source, DIRECT_IO_ALIGNMENT))
+    {
+        writeFully(directFd, alignedFrom, source, directBytes);
+    } else
+    {
+        uint8_t* bounce = bounceBuffer();
+        for(uint64_t done = 0; done < directBytes; done += DIRECT_IO_CHUNK)
+        {
+            uint64_t chunk = std::min(DIRECT_IO_CHUNK, directBytes - done);
+            std::memcpy(bounce, source + done, chunk);
+            writeFully(directFd, alignedFrom + done, bounce, chunk);
+        }
+    }
+}
+
+void RawFile::writevBytesFrom(uint64_t fromPosition, std::vector<struct iovec> iov) const
+{
+    std::string ERR;
+    if(!writable)
+    {
+        ERR = io::xprintf("File %s is not opened for writing.", fileName.c_str());
+        KCTERR(ERR);
+    }
+    if(directFd >= 0)
+    {
+        // Alignment is handled per buffer
+        for(const struct iovec& v : iov)
+        {
+            writeBytesFrom(fromPosition, static_cast<const uint8_t*>(v.iov_base), v.iov_len);
+            fromPosition += v.iov_len;
+        }
+        return;
+    }
+    uint64_t numBytes = 0;
+    for(const struct iovec& v : iov)
+    {
+        numBytes += v.iov_len;
+    }
+    uint64_t done = 0;
+    std::size_t first = 0;
+    while(done != numBytes)
+    {
+        int count = static_cast<int>(std::min<std::size_t>(iov.size() - first, IOV_MAX));
+        ssize_t num = ::pwritev(fd, iov.data() + first, count, fromPosition + done);
+        if(num < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            ERR = io::xprintf("Can not write %lu bytes to the position %lu in file %s, strerror "
+                              "message :%s.",
+                              numBytes, fromPosition, fileName.c_str(), strerror(errno));
+            KCTERR(ERR);
+        } else if(num == 0)
+        {
+            ERR = io::xprintf(
+                "Can not write %lu bytes to the position %lu in file %s, only %lu bytes written.",
+                numBytes, fromPosition, fileName.c_str(), done);
+            KCTERR(ERR);
+        }
+        done += num;
+        // Skip written buffers and advance the partially written one
+        uint64_t rest = num;
+        while(first != iov.size() && rest >= iov[first].iov_len)
+        {
+            rest -= iov[first].iov_len;
+            first++;
+        }
+        if(rest > 0)
+        {
+            iov[first].iov_base = static_cast<uint8_t*>(iov[first].iov_base) + rest;
+            iov[first].iov_len -= rest;
+        }
+    }
+}
+
+uint64_t RawFile::getFileSize() const
+{
+    struct stat stat_buf;
+    if(::fstat(fd, &stat_buf) != 0)
+    {
+        std::string ERR = io::xprintf("Can not stat file %s, strerror message :%s.",
+                                      fileName.c_str(), strerror(errno));
+        KCTERR(ERR);
+    }
+    return stat_buf.st_size;
+}
+
+FileIdentity RawFile::getIdentity() const
+{
+    struct stat stat_buf;
+    if(::fstat(fd, &stat_buf) != 0)
+    {
+        std::string ERR = io::xprintf("Can not stat file %s, strerror message :%s.",
+                                      fileName.c_str(), strerror(errno));
+        KCTERR(ERR);
+    }
+    FileIdentity id;
+    id.device = stat_buf.st_dev;
+    id.inode = stat_buf.st_ino;
+    id.size = stat_buf.st_size;
+    id.mtimeNsec = int64_t(stat_buf.st_mtim.tv_sec) * 1000000000 + stat_buf.st_mtim.tv_nsec;
+    return id;
+}
+
+std::string RawFile::getFileName() const { return fileName; }
+
+bool RawFile::isWritable() const { return writable; }
+
+int RawFile::getFileDescriptor() const { return fd; }
+
+bool RawFile::isDirectIO() const { return directFd >= 0; }
+
+} // namespace KCT::io
@@ -0,0 +1,312 @@
+#include "Transpose.hpp"
+
+// Standard libraries
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KCT_TRANSPOSE_X86
+#endif
+
+// Internal libraries
+#include "PROG/KCTException.hpp"
+#include "stringFormatter.h"
+
+namespace KCT::io {
+
+namespace {
+    // Side of the block transposed without further splitting, 64 x 64 x 8 bytes fit into L1
+    constexpr uint64_t TILE = 64;
+
+    using BlockFunction = void (*)(const void* in,
+                                   uint64_t inStride,
+                                   void* out,
+                                   uint64_t outStride,
+                                   uint64_t rows,
+                                   uint64_t cols);
+
+    template <typename E, uint64_t K>
+    void scalarKernel(const E* in, uint64_t inStride, E* out, uint64_t outStride)
+    {
+        for(uint64_t r = 0; r != K; r++)
+        {
+            for(uint64_t c = 0; c != K; c++)
+            {
+                out[c * outStride + r] = in[r * inStride + c];
+            }
+        }
+    }
+
+    template <typename E>
+    void scalarRange(const E* in,
+                     uint64_t inStride,
+                     E* out,
+                     uint64_t outStride,
+                     uint64_t rowFrom,
+                     uint64_t rowTo,
+                     uint64_t colFrom,
+                     uint64_t colTo)
+    {
+        for(uint64_t r = rowFrom; r < rowTo; r++)
+        {
+            for(uint64_t c = colFrom; c < colTo; c++)
+            {
+                out[c * outStride + r] = in[r * inStride + c];
+            }
+        }
+    }
+
+    /**
+     * Block of at most TILE x TILE elements by K x K kernels, the edges element by element.
+     */
+    template <typename E, uint64_t K, void (*Kernel)(const E*, uint64_t, E*, uint64_t)>
+    void transposeTile(
+        const E* in, uint64_t inStride, E* out, uint64_t outStride, uint64_t rows, uint64_t cols)
+    {
+        uint64_t rowsK = rows / K * K, colsK = cols / K * K;
+        for(uint64_t r = 0; r != rowsK; r += K)
+        {
+            for(uint64_t c = 0; c != colsK; c += K)
+            {
+                Kernel(in + r * inStride + c, inStride, out + c * outStride + r, outStride);
+            }
+        }
+        scalarRange(in, inStride, out, outStride, 0, rowsK, colsK, cols);
+        scalarRange(in, inStride, out, outStride, rowsK, rows, 0, cols);
+    }
+
+    template <typename E, uint64_t K, void (*Kernel)(const E*, uint64_t, E*, uint64_t)>
+    void transposeRecursive(
+        const E* in, uint64_t inStride, E* out, uint64_t outStride, uint64_t rows, uint64_t cols)
+    {
+        if(rows <= TILE && cols <= TILE)
+        {
+            transposeTile<E, K, Kernel>(in, inStride, out, outStride, rows, cols);
+        } else if(rows >= cols)
+        {
+            // Split at the multiple of K not to create the edges inside the matrix
+            uint64_t half = rows / 2 / K * K;
+            transposeRecursive<E, K, Kernel>(in, inStride, out, outStride, half, cols);
+            transposeRecursive<E, K, Kernel>(in + half * inStride, inStride, out + half,
+                                             outStride, rows - half, cols);
+        } else
+        {
+            uint64_t half = cols / 2 / K * K;
+            transposeRecursive<E, K, Kernel>(in, inStride, out, outStride, rows, half);
+            transposeRecursive<E, K, Kernel>(in + half, inStride, out + half * outStride,
+                                             outStride, rows, cols - half);
+        }
+    }
+
+    template <typename E, uint64_t K, void (*Kernel)(const E*, uint64_t, E*, uint64_t)>
+    void transposeBlock(const void* in,
+                        uint64_t inStride,
+                        void* out,
+                        uint64_t outStride,
+                        uint64_t rows,
+                        uint64_t cols)
+    {
+        transposeRecursive<E, K, Kernel>(static_cast<const E*>(in), inStride, static_cast<E*>(out),
+                                         outStride, rows, cols);
+    }
+
+#ifdef KCT_TRANSPOSE_X86
+    void sse2Kernel16(const uint16_t* in, uint64_t inStride, uint16_t* out, uint64_t outStride)
+    {
+        __m128i a[8], b[8], c[8];
+        for(int i = 0; i != 8; i++)
+        {
+            a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * inStride));
+        }
+        for(int i = 0; i != 4; i++)
+        {
+            b[2 * i] = _mm_unpacklo_epi16(a[2 * i], a[2 * i + 1]);
+            b[2 * i + 1] = _mm_unpackhi_epi16(a[2 * i], a[2 * i + 1]);
+        }
+        c[0] = _mm_unpacklo_epi32(b[0], b[2]);
+        c[1] = _mm_unpackhi_epi32(b[0], b[2]);
+        c[2] = _mm_unpacklo_epi32(b[1], b[3]);
+        c[3] = _mm_unpackhi_epi32(b[1], b[3]);
+        c[4] = _mm_unpacklo_epi32(b[4], b[6]);
+        c[5] = _mm_unpackhi_epi32(b[4], b[6]);
+        c[6] = _mm_unpacklo_epi32(b[5], b[7]);
+        c[7] = _mm_unpackhi_epi32(b[5], b[7]);
+        for(int i = 0; i != 4; i++)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i * outStride),
+                             _mm_unpacklo_epi64(c[i], c[i + 4]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + (2 * i + 1) * outStride),
+                             _mm_unpackhi_epi64(c[i], c[i + 4]));
+        }
+    }
+
+    void sse2Kernel32(const uint32_t* in, uint64_t inStride, uint32_t* out, uint64_t outStride)
+    {
+        // Shuffles move the bits of the elements unchanged
+        __m128 r0 = _mm_loadu_ps(reinterpret_cast<const float*>(in));
+        __m128 r1 = _mm_loadu_ps(reinterpret_cast<const float*>(in + inStride));
+        __m128 r2 = _mm_loadu_ps(reinterpret_cast<const float*>(in + 2 * inStride));
+        __m128 r3 = _mm_loadu_ps(reinterpret_cast<const float*>(in + 3 * inStride));
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(reinterpret_cast<float*>(out), r0);
+        _mm_storeu_ps(reinterpret_cast<float*>(out + outStride), r1);
+        _mm_storeu_ps(reinterpret_cast<float*>(out + 2 * outStride), r2);
+        _mm_storeu_ps(reinterpret_cast<float*>(out + 3 * outStride), r3);
+    }
+
+    void sse2Kernel64(const uint64_t* in, uint64_t inStride, uint64_t* out, uint64_t outStride)
+    {
+        __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + inStride));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi64(r0, r1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + outStride), _mm_unpackhi_epi64(r0, r1));
+    }
+
+    __attribute__((target("avx2"))) void
+    avx2Kernel32(const uint32_t* in, uint64_t inStride, uint32_t* out, uint64_t outStride)
+    {
+        __m256 r[8], t[8], s[8];
+        for(int i = 0; i != 8; i++)
+        {
+            r[i] = _mm256_loadu_ps(reinterpret_cast<const float*>(in + i * inStride));
+        }
+        for(int i = 0; i != 4; i++)
+        {
+            t[2 * i] = _mm256_unpacklo_ps(r[2 * i], r[2 * i + 1]);
+            t[2 * i + 1] = _mm256_unpackhi_ps(r[2 * i], r[2 * i + 1]);
+        }
+        for(int i = 0; i != 2; i++)
+        {
+            s[4 * i] = _mm256_shuffle_ps(t[4 * i], t[4 * i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+            s[4 * i + 1] = _mm256_shuffle_ps(t[4 * i], t[4 * i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+            s[4 * i + 2] = _mm256_shuffle_ps(t[4 * i + 1], t[4 * i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+            s[4 * i + 3] = _mm256_shuffle_ps(t[4 * i + 1], t[4 * i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+        }
+        for(int i = 0; i != 4; i++)
+        {
+            _mm256_storeu_ps(reinterpret_cast<float*>(out + i * outStride),
+                             _mm256_permute2f128_ps(s[i], s[i + 4], 0x20));
+            _mm256_storeu_ps(reinterpret_cast<float*>(out + (i + 4) * outStride),
+                             _mm256_permute2f128_ps(s[i], s[i + 4], 0x31));
+        }
+    }
+
+    __attribute__((target("avx2"))) void
+    avx2Kernel64(const uint64_t* in, uint64_t inStride, uint64_t* out, uint64_t outStride)
+    {
+        __m256d r[4];
+        for(int i = 0; i != 4; i++)
+        {
+            r[i] = _mm256_loadu_pd(reinterpret_cast<const double*>(in + i * inStride));
+        }
+        __m256d t0 = _mm256_unpacklo_pd(r[0], r[1]);
+        __m256d t1 = _mm256_unpackhi_pd(r[0], r[1]);
+        __m256d t2 = _mm256_unpacklo_pd(r[2], r[3]);
+        __m256d t3 = _mm256_unpackhi_pd(r[2], r[3]);
+        _mm256_storeu_pd(reinterpret_cast<double*>(out), _mm256_permute2f128_pd(t0, t2, 0x20));
+        _mm256_storeu_pd(reinterpret_cast<double*>(out + outStride),
+                         _mm256_permute2f128_pd(t1, t3, 0x20));
+        _mm256_storeu_pd(reinterpret_cast<double*>(out + 2 * outStride),
+                         _mm256_permute2f128_pd(t0, t2, 0x31));
+        _mm256_storeu_pd(reinterpret_cast<double*>(out + 3 * outStride),
+                         _mm256_permute2f128_pd(t1, t3, 0x31));
+    }
+#endif
+
+    struct TransposeKernels
+    {
+        const char* name;
+        // Indexed by log2 of the element byte size
+        BlockFunction block[4];
+    };
+
+    const TransposeKernels& kernels()
+    {
+        static const TransposeKernels selected = []() -> TransposeKernels {
+#ifdef KCT_TRANSPOSE_X86
+            if(__builtin_cpu_supports("avx2"))
+            {
+                return { "avx2",
+                         { transposeBlock<uint8_t, 8, scalarKernel<uint8_t, 8>>,
+                           transposeBlock<uint16_t, 8, sse2Kernel16>,
+                           transposeBlock<uint32_t, 8, avx2Kernel32>,
+                           transposeBlock<uint64_t, 4, avx2Kernel64> } };
+            }
+            return { "sse2",
+                     { transposeBlock<uint8_t, 8, scalarKernel<uint8_t, 8>>,
+                       transposeBlock<uint16_t, 8, sse2Kernel16>,
+                       transposeBlock<uint32_t, 4, sse2Kernel32>,
+                       transposeBlock<uint64_t, 2, sse2Kernel64> } };
+#else
+            return { "scalar",
+                     { transposeBlock<uint8_t, 8, scalarKernel<uint8_t, 8>>,
+                       transposeBlock<uint16_t, 4, scalarKernel<uint16_t, 4>>,
+                       transposeBlock<uint32_t, 4, scalarKernel<uint32_t, 4>>,
+                       transposeBlock<uint64_t, 4, scalarKernel<uint64_t, 4>> } };
+#endif
+        }();
+        return selected;
+    }
+
+    BlockFunction blockFunction(uint32_t elementByteSize)
+    {
+        switch(elementByteSize)
+        {
+        case 1:
+            return kernels().block[0];
+        case 2:
+            return kernels().block[1];
+        case 4:
+            return kernels().block[2];
+        case 8:
+            return kernels().block[3];
+        default:
+            KCTERR(io::xprintf("Transposition of %u byte elements is not supported.",
+                               elementByteSize));
+        }
+    }
+} // namespace
+
+void transposeElements(const void* in,
+                       uint64_t inStride,
+                       void* out,
+                       uint64_t outStride,
+                       uint64_t rows,
+                       uint64_t cols,
+                       uint32_t elementByteSize)
+{
+    blockFunction(elementByteSize)(in, inStride, out, outStride, rows, cols);
+}
+
+void transposeSquareInPlace(void* data, uint64_t n, uint32_t elementByteSize)
+{
+    BlockFunction block = blockFunction(elementByteSize);
+    uint8_t* a = static_cast<uint8_t*>(data);
+    alignas(64) uint8_t tmp[TILE * TILE * 8];
+    for(uint64_t i = 0; i < n; i += TILE)
+    {
+        uint64_t h = std::min(TILE, n - i);
+        for(uint64_t j = i; j < n; j += TILE)
+        {
+            uint64_t w = std::min(TILE, n - j);
+            uint8_t* upper = a + (i * n + j) * elementByteSize;
+            uint8_t* lower = a + (j * n + i) * elementByteSize;
+            // Upper block of h x w elements to the buffer with the row stride w
+            for(uint64_t r = 0; r != h; r++)
+            {
+                std::memcpy(tmp + r * w * elementByteSize, upper + r * n * elementByteSize,
+                            w * elementByteSize);
+            }
+            if(i != j)
+            {
+                block(lower, n, upper, n, w, h);
+            }
+            block(tmp, w, lower, n, h, w);
+        }
+    }
+}
+
+const char* transposeKernelName() { return kernels().name; }
+
+} // namespace KCT::io
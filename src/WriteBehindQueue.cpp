@@ -0,0 +1,231 @@
+#include "WriteBehindQueue.hpp"
+
+// Logging
+#include <plog/Log.h>
+
+// Standard libraries
+#include <algorithm>
+
+// Internal libraries
+#include "PROG/KCTException.hpp"
+#include "stringFormatter.h"
+
+namespace KCT::io {
+
+WriteBehindQueue::WriteBehindQueue(std::shared_ptr<RawFile> file,
+                                   uint64_t byteSize,
+                                   uint32_t queueFrames,
+                                   BackpressurePolicy policy,
+                                   uint32_t ioThreads,
+                                   uint64_t growByteBudget)
+    : file(file)
+    , byteSize(byteSize)
+    , queueFrames(std::max<uint32_t>(queueFrames, 1))
+    , policy(policy)
+{
+    growFrames = this->queueFrames;
+    if(policy == BackpressurePolicy::GROW)
+    {
+        growFrames
+            = std::max<uint64_t>(growFrames, growByteBudget / std::max<uint64_t>(byteSize, 1));
+    }
+    // Buffers beyond queueFrames are freed when returned
+    pool = std::make_shared<FramePool<uint8_t>>(byteSize, DIRECT_IO_ALIGNMENT, false,
+                                                this->queueFrames);
+    for(uint32_t i = 0; i != std::max<uint32_t>(ioThreads, 1); i++)
+    {
+        threads.emplace_back(&WriteBehindQueue::ioLoop, this);
+    }
+}
+
+WriteBehindQueue::~WriteBehindQueue()
+{
+    try
+    {
+        close();
+    } catch(const std::exception& e)
+    {
+        LOGE << io::xprintf("Write behind to %s failed: %s", file->getFileName().c_str(),
+                            e.what());
+    }
+}
+
+WriteBehindQueue::Buffer WriteBehindQueue::acquire()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if(closed)
+        {
+            KCTERR(io::xprintf("Write behind queue of %s is closed.", file->getFileName().c_str()));
+        }
+        rethrowError(false);
+        uint64_t limit = policy == BackpressurePolicy::GROW ? growFrames : queueFrames;
+        if(pending >= limit)
+        {
+            if(policy == BackpressurePolicy::DROP)
+            {
+                statistics.dropped++;
+                return Buffer();
+            }
+            statistics.blocked++;
+            spaceCondition.wait(lock, [this, limit]() { return pending < limit || error; });
+            rethrowError(false);
+        }
+        pending++;
+        statistics.queued++;
+        statistics.peakFrames = std::max(statistics.peakFrames, pending);
+    }
+    try
+    {
+        return pool->acquire();
+    } catch(...)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending--;
+        spaceCondition.notify_one();
+        throw;
+    }
+}
+
+void WriteBehindQueue::submit(uint64_t position, Buffer buffer)
+{
+    if(buffer == nullptr)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!closed)
+        {
+            inFlight++;
+            queue.push_back(Write{ position, std::move(buffer) });
+            queueCondition.notify_one();
+            return;
+        }
+    }
+    // Acquired before close, the I/O threads are gone
+    std::exception_ptr e;
+    try
+    {
+        file->writeBytesFrom(position, buffer.get(), byteSize);
+        if(completionListener)
+        {
+            completionListener(position);
+        }
+    } catch(...)
+    {
+        e = std::current_exception();
+    }
+    buffer.reset();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending--;
+        if(!e)
+        {
+            statistics.written++;
+        }
+    }
+    if(e)
+    {
+        std::rethrow_exception(e);
+    }
+}
+
+void WriteBehindQueue::ioLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true)
+    {
+        queueCondition.wait(lock, [this]() { return closed || !queue.empty(); });
+        if(queue.empty())
+        {
+            return;
+        }
+        Write w = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        std::exception_ptr e;
+        try
+        {
+            file->writeBytesFrom(w.position, w.buffer.get(), byteSize);
+            if(completionListener)
+            {
+                completionListener(w.position);
+            }
+        } catch(...)
+        {
+            e = std::current_exception();
+        }
+        // Return the buffer to the pool before the slot is released
+        w.buffer.reset();
+        lock.lock();
+        if(e && !error)
+        {
+            error = e;
+        }
+        if(!e)
+        {
+            statistics.written++;
+        }
+        pending--;
+        inFlight--;
+        spaceCondition.notify_all();
+    }
+}
+
+void WriteBehindQueue::rethrowError(bool reported)
+{
+    if(error)
+    {
+        std::exception_ptr e = error;
+        if(reported)
+        {
+            error = nullptr;
+        }
+        std::rethrow_exception(e);
+    }
+}
+
+void WriteBehindQueue::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    // Acquired buffers not yet submitted by other producers are not waited for
+    spaceCondition.wait(lock, [this]() { return inFlight == 0; });
+    rethrowError(true);
+}
+
+void WriteBehindQueue::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(closed)
+        {
+            return;
+        }
+        closed = true;
+    }
+    queueCondition.notify_all();
+    for(std::thread& t : threads)
+    {
+        t.join();
+    }
+    threads.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    rethrowError(true);
+}
+
+void WriteBehindQueue::setCompletionListener(std::function<void(uint64_t position)> listener)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    completionListener = std::move(listener);
+}
+
+uint64_t WriteBehindQueue::getByteSize() const { return byteSize; }
+
+WriteBehindStatistics WriteBehindQueue::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+} // namespace KCT::io
@@ -0,0 +1,256 @@
+#include "WriteCombiner.hpp"
+
+// Logging
+#include <plog/Log.h>
+
+// Standard libraries
+#include <algorithm>
+#include <exception>
+#include <sys/uio.h>
+
+// Internal libraries
+#include "PROG/KCTException.hpp"
+#include "stringFormatter.h"
+
+namespace KCT::io {
+
+WriteCombiningBudget& WriteCombiningBudget::instance()
+{
+    static WriteCombiningBudget b;
+    return b;
+}
+
+void WriteCombiningBudget::configure(uint64_t byteBudget) { this->byteBudget.store(byteBudget); }
+
+uint64_t WriteCombiningBudget::getByteBudget() const { return byteBudget.load(); }
+
+uint64_t WriteCombiningBudget::getUsedBytes() const { return usedBytes.load(); }
+
+bool WriteCombiningBudget::tryReserve(uint64_t bytes)
+{
+    uint64_t used = usedBytes.load();
+    do
+    {
+        if(used + bytes > byteBudget.load())
+        {
+            return false;
+        }
+    } while(!usedBytes.compare_exchange_weak(used, used + bytes));
+    return true;
+}
+
+void WriteCombiningBudget::release(uint64_t bytes) { usedBytes.fetch_sub(bytes); }
+
+WriteCombiner::WriteCombiner(std::shared_ptr<RawFile> file,
+                             uint64_t offset,
+                             uint64_t frameByteSize,
+                             uint64_t frameCount,
+                             uint64_t maxRunBytes)
+    : file(file)
+    , offset(offset)
+    , frameByteSize(frameByteSize)
+    , frameCount(frameCount)
+    , written(frameCount, false)
+{
+    maxRunFrames = std::max<uint64_t>(1, maxRunBytes / std::max<uint64_t>(frameByteSize, 1));
+    pool = std::make_shared<FramePool<uint8_t>>(frameByteSize, DIRECT_IO_ALIGNMENT, false,
+                                                std::min<uint64_t>(maxRunFrames, 16));
+}
+
+WriteCombiner::~WriteCombiner()
+{
+    try
+    {
+        flush();
+    } catch(const std::exception& e)
+    {
+        LOGE << io::xprintf("Combined write to %s failed: %s", file->getFileName().c_str(),
+                            e.what());
+    }
+}
+
+WriteCombiner::Buffer WriteCombiner::acquire() { return pool->acquire(); }
+
+WriteCombiner::Run WriteCombiner::takeRun(uint64_t k)
+{
+    uint64_t first = k;
+    while(first != 0 && buffered.count(first - 1) != 0)
+    {
+        first--;
+    }
+    Run run{ first, {} };
+    auto it = buffered.find(first);
+    while(it != buffered.end() && it->first == first + run.frames.size())
+    {
+        written[it->first] = true;
+        run.frames.push_back(std::move(it->second));
+        it = buffered.erase(it);
+    }
+    statistics.buffered -= run.frames.size();
+    WriteCombiningBudget::instance().release(run.frames.size() * frameByteSize);
+    return run;
+}
+
+uint64_t WriteCombiner::longestRun() const
+{
+    uint64_t bestFirst = buffered.begin()->first, bestLength = 0;
+    uint64_t first = bestFirst, length = 0;
+    uint64_t previous = bestFirst;
+    for(const auto& f : buffered)
+    {
+        if(length != 0 && f.first == previous + 1)
+        {
+            length++;
+        } else
+        {
+            first = f.first;
+            length = 1;
+        }
+        previous = f.first;
+        if(length > bestLength)
+        {
+            bestFirst = first;
+            bestLength = length;
+        }
+    }
+    return bestFirst;
+}
+
+void WriteCombiner::writeRun(Run& run)
+{
+    uint64_t writes = 0;
+    for(uint64_t from = 0; from < run.frames.size(); from += maxRunFrames)
+    {
+        uint64_t to = std::min<uint64_t>(from + maxRunFrames, run.frames.size());
+        std::vector<struct iovec> iov(to - from);
+        for(uint64_t i = from; i != to; i++)
+        {
+            iov[i - from].iov_base = run.frames[i].get();
+            iov[i - from].iov_len = frameByteSize;
+        }
+        file->writevBytesFrom(offset + (run.first + from) * frameByteSize, std::move(iov));
+        writes++;
+        if(completionListener)
+        {
+            for(uint64_t i = from; i != to; i++)
+            {
+                completionListener(run.first + i);
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    statistics.writes += writes;
+}
+
+void WriteCombiner::writeRuns(std::vector<Run>& runs)
+{
+    // Write all the runs taken from the buffer even when some write fails
+    std::exception_ptr error;
+    for(Run& run : runs)
+    {
+        try
+        {
+            writeRun(run);
+        } catch(...)
+        {
+            if(!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+    if(error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void WriteCombiner::add(uint64_t k, Buffer frame)
+{
+    if(k >= frameCount)
+    {
+        KCTERR(io::xprintf("Frame %lu out of range of %lu frames of %s.", k, frameCount,
+                           file->getFileName().c_str()));
+    }
+    std::vector<Run> runs;
+    bool bypass = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        statistics.frames++;
+        auto it = buffered.find(k);
+        if(it != buffered.end())
+        {
+            it->second = std::move(frame);
+            return;
+        }
+        // Make room by writing the longest runs prematurely
+        while(!WriteCombiningBudget::instance().tryReserve(frameByteSize))
+        {
+            if(buffered.empty())
+            {
+                bypass = true;
+                break;
+            }
+            runs.push_back(takeRun(longestRun()));
+            statistics.evictions++;
+        }
+        if(bypass)
+        {
+            statistics.bypassed++;
+            written[k] = true;
+        } else
+        {
+            buffered.emplace(k, std::move(frame));
+            statistics.buffered++;
+            uint64_t first = k, last = k;
+            while(first != 0 && buffered.count(first - 1) != 0)
+            {
+                first--;
+            }
+            while(last + 1 != frameCount && buffered.count(last + 1) != 0)
+            {
+                last++;
+            }
+            bool complete = (first == 0 || written[first - 1])
+                && (last + 1 == frameCount || written[last + 1]);
+            if(complete || last - first + 1 >= maxRunFrames)
+            {
+                runs.push_back(takeRun(k));
+            }
+        }
+    }
+    if(bypass)
+    {
+        Run run{ k, {} };
+        run.frames.push_back(std::move(frame));
+        runs.push_back(std::move(run));
+    }
+    writeRuns(runs);
+}
+
+void WriteCombiner::flush()
+{
+    std::vector<Run> runs;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while(!buffered.empty())
+        {
+            runs.push_back(takeRun(buffered.begin()->first));
+        }
+    }
+    writeRuns(runs);
+}
+
+void WriteCombiner::setCompletionListener(std::function<void(uint64_t k)> listener)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    completionListener = std::move(listener);
+}
+
+WriteCombinerStatistics WriteCombiner::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+} // namespace KCT::io
@@ -1,5 +1,11 @@
 // Logging on the top
 #include "rawop.h"
+#include "RawFile.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace KCT {
 namespace io {
@@ -39,35 +45,7 @@ namespace io {
     void
     readBytesFrom(std::string fileName, uint64_t fromPosition, uint8_t* buffer, uint64_t numBytes)
     {
-        // LOGD << io::xprintf("Reading %d bytes from pos %lu.", numBytes, fromPosition);
-        std::string ERR;
-        if(CHAR_BIT != 8)
-        {
-            ERR = io::xprintf("Can not use this platform since CHAR_BIT=%d is not 8!", CHAR_BIT);
-            KCTERR(ERR);
-        }
-        std::ifstream file(fileName.c_str(),
-                           std::ios::binary | std::ios::in); // binary for input
-        if(!file.is_open()) // cannot open file
-        {
-#ifdef __linux__
-            ERR = io::xprintf("Can not open file %s, strerror message :%s.", fileName.c_str(),
-                              strerror(errno));
-#else
-            ERR = io::xprintf("Can not open file %s.", fileName.c_str());
-#endif
-            KCTERR(ERR);
-        }
-        file.seekg(fromPosition);
-        file.read((char*)buffer, numBytes);
-        auto num = file.gcount();
-        file.close();
-        if(num != (int64_t)numBytes)
-        {
-            ERR = io::xprintf("Can not read first %lu bytes from the position %ld in file %s.",
-                              numBytes, fromPosition, fileName.c_str());
-            KCTERR(ERR);
-        }
+        RawFile(fileName).readBytesFrom(fromPosition, buffer, numBytes);
     }
 
     void readBytesFrom(std::shared_ptr<std::ifstream> ifstream,
@@ -162,38 +140,7 @@ namespace io {
     void
     writeBytesFrom(std::string fileName, uint64_t fromPosition, uint8_t* buffer, uint64_t numBytes)
     {
-        std::string ERR;
-        if(CHAR_BIT != 8)
-        {
-            ERR = io::xprintf("Can not use this platform since CHAR_BIT=%d is not 8!", CHAR_BIT);
-            KCTERR(ERR);
-        }
-        std::ofstream file(fileName.c_str(),
-                           std::ios::binary | std::ios::out
-                               | std::ios::in); // Open binary, for output, for input
-        if(!file.is_open()) // cannot open file
-        {
-#ifdef __linux__
-            ERR = io::xprintf("Can not open file %s, strerror message :%s.", fileName.c_str(),
-                              strerror(errno));
-#else
-            ERR = io::xprintf("Can not open file %s.", fileName.c_str());
-#endif
-            KCTERR(ERR);
-        }
-        file.seekp(fromPosition); // put pointer
-        std::streampos cur = file.tellp();
-        file.write((char*)buffer, numBytes);
-        auto pos = file.tellp();
-        auto num = pos - cur;
-        file.close();
-        if(num != (int64_t)numBytes)
-        {
-            ERR = io::xprintf("Instead of %lu bytes to be written from position %lu to the file %s "
-                              "only %ld bytes was written.",
-                              numBytes, fromPosition, fileName.c_str(), num);
-            KCTERR(ERR);
-        }
+        RawFile(fileName, true).writeBytesFrom(fromPosition, buffer, numBytes);
     }
 
     void appendBytes(std::string fileName, uint8_t* buffer, uint64_t numBytes)
@@ -278,9 +225,28 @@ namespace io {
         return rc == 0 ? stat_buf.st_size : -1;
     }
 
-    void createEmptyFile(std::string fileName, uint64_t numBytes, bool overwrite)
+    void createEmptyFile(std::string fileName,
+                         uint64_t numBytes,
+                         bool overwrite,
+                         FileAllocation allocation)
+    {
+        createFileWithHeader(fileName, nullptr, 0, numBytes, overwrite, allocation);
+    }
+
+    void createFileWithHeader(std::string fileName,
+                              const uint8_t* header,
+                              uint64_t headerBytes,
+                              uint64_t totalBytes,
+                              bool overwrite,
+                              FileAllocation allocation)
     {
         std::string ERR;
+        if(headerBytes > totalBytes)
+        {
+            ERR = io::xprintf("Header of %lu bytes does not fit into the file %s of %lu bytes.",
+                              headerBytes, fileName.c_str(), totalBytes);
+            KCTERR(ERR);
+        }
         if(pathExists(fileName))
         {
             if(overwrite)
@@ -288,7 +254,7 @@ namespace io {
                 std::remove(fileName.c_str());
                 if(pathExists(fileName))
                 {
-                    ERR = io::xprintf("Can not delete %f", fileName.c_str());
+                    ERR = io::xprintf("Can not delete %s", fileName.c_str());
                     KCTERR(ERR);
                 }
             } else
@@ -298,18 +264,78 @@ namespace io {
                 KCTERR(ERR);
             }
         }
-        if(!pathExists(fileName) || overwrite)
+        int fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if(fd < 0)
         {
-            std::ofstream ofs(
-                fileName,
-                std::ios::binary | std::ios::out
-                    | std::ios::trunc); // Open binary, for output, truncate when opening
-            if(numBytes > 0)
+            ERR = io::xprintf("Can not create file %s, strerror message :%s.", fileName.c_str(),
+                              strerror(errno));
+            KCTERR(ERR);
+        }
+        auto fail = [&](std::string msg) {
+            ERR = io::xprintf("%s %s, strerror message :%s.", msg.c_str(), fileName.c_str(),
+                              strerror(errno));
+            ::close(fd);
+            std::remove(fileName.c_str());
+            KCTERR(ERR);
+        };
+        uint64_t done = 0;
+        while(done != headerBytes)
+        {
+            ssize_t num = ::pwrite(fd, header + done, headerBytes - done, done);
+            if(num < 0)
             {
-                ofs.seekp(numBytes - 1);
-                ofs.write("", 1);
+                if(errno == EINTR)
+                {
+                    continue;
+                }
+                fail("Can not write header of");
             }
-            ofs.close();
+            done += num;
+        }
+        uint64_t dataBytes = totalBytes - headerBytes;
+        bool allocated = false;
+#ifdef __linux__
+        if(dataBytes > 0 && allocation != FileAllocation::SPARSE)
+        {
+            int mode = 0;
+            if(allocation == FileAllocation::ZERO_RANGE)
+            {
+                // Zeroing range requires the file to have its size
+                if(::ftruncate(fd, totalBytes) != 0)
+                {
+                    fail("Can not set size of");
+                }
+                mode = FALLOC_FL_ZERO_RANGE;
+            }
+            if(::fallocate(fd, mode, headerBytes, dataBytes) == 0)
+            {
+                allocated = true;
+            } else if(errno == ENOSPC || errno == EFBIG || errno == EDQUOT)
+            {
+                fail(io::xprintf("Can not reserve %lu bytes for", dataBytes));
+            } else
+            {
+                LOGW << io::xprintf("Can not preallocate %s, using sparse file, strerror message "
+                                    ":%s.",
+                                    fileName.c_str(), strerror(errno));
+            }
+        }
+#else
+        if(allocation != FileAllocation::SPARSE)
+        {
+            LOGW << io::xprintf("Preallocation is not supported on this platform, %s is sparse.",
+                                fileName.c_str());
+        }
+#endif
+        if(!allocated && ::ftruncate(fd, totalBytes) != 0)
+        {
+            fail("Can not set size of");
+        }
+        if(::close(fd) != 0)
+        {
+            ERR = io::xprintf("Error closing file %s, strerror message :%s.", fileName.c_str(),
+                              strerror(errno));
+            KCTERR(ERR);
         }
     }
 
@@ -0,0 +1,130 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Internal libs
+#include "BufferedFrame2D.hpp"
+#include "DEN/DenAsyncFrame2DWritter.hpp"
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "stringFormatter.h"
+
+using namespace KCT;
+
+namespace {
+void writeSlices(io::DenAsyncFrame2DWritter<float>& w, uint32_t threads, uint64_t skipFrame)
+{
+    std::vector<std::thread> writers;
+    for(uint32_t t = 0; t != threads; t++)
+    {
+        writers.emplace_back([&w, t, threads, skipFrame]() {
+            io::BufferedFrame2D<float> f(0.0f, w.dimx(), w.dimy());
+            for(uint64_t k = t; k < w.getFrameCount(); k += threads)
+            {
+                if(k == skipFrame)
+                {
+                    continue;
+                }
+                std::fill(f.data(), f.data() + w.getFrameSize(), static_cast<float>(k));
+                w.writeBufferedFrame(f, k);
+            }
+        });
+    }
+    for(std::thread& t : writers)
+    {
+        t.join();
+    }
+}
+} // namespace
+
+TEST_CASE("DenAsyncFrame2DWritter concurrent writes with completion tracking",
+          "[DenAsyncFrame2DWritter]")
+{
+    const uint32_t dimx = 33, dimy = 17, dimz = 100;
+    std::string fileName = "/tmp/DenAsyncFrame2DWritterCompletion.den";
+    for(bool writeBehind : { false, true })
+    {
+        io::DenAsyncFrame2DWritter<float> w(fileName, dimx, dimy, dimz);
+        REQUIRE(w.getMissingFrames().empty());
+        w.enableCompletionTracking();
+        if(writeBehind)
+        {
+            w.enableWriteBehind(8, io::BackpressurePolicy::BLOCK, 3);
+        }
+        writeSlices(w, 16, 70);
+        w.flush();
+        REQUIRE(w.getWrittenFrameCount() == dimz - 1);
+        REQUIRE_FALSE(w.isWritten(70));
+        REQUIRE(w.getMissingFrames() == std::vector<uint64_t>{ 70 });
+        REQUIRE_THROWS(w.finalize());
+        // Out of range frames are rejected before anything is written
+        std::vector<float> outside(dimx * dimy, -1.0f);
+        REQUIRE_THROWS_AS(w.writeBuffer(outside.data(), dimz), util::KCTException);
+        REQUIRE_THROWS_AS(w.writeFrame(io::BufferedFrame2D<float>(-1.0f, dimx, dimy), 64 * dimz),
+                          util::KCTException);
+        w.writeFrame(io::BufferedFrame2D<float>(70.0f, dimx, dimy), 70);
+        w.finalize();
+        REQUIRE(w.getWrittenFrameCount() == dimz);
+    }
+    io::DenFrame2DReader<float> r(fileName);
+    for(uint64_t k = 0; k != dimz; k++)
+    {
+        REQUIRE(r.readFrame(k)->get(dimx - 1, dimy - 1) == static_cast<float>(k));
+    }
+}
+
+TEST_CASE("DenAsyncFrame2DWritter reserves space of created files", "[DenAsyncFrame2DWritter]")
+{
+    const uint32_t dimx = 16, dimy = 8, dimz = 5;
+    std::string fileName = "/tmp/DenAsyncFrame2DWritterReserve.den";
+    std::remove(fileName.c_str());
+    {
+        io::DenAsyncFrame2DWritter<float> w(fileName, dimx, dimy, dimz, false, false,
+                                            io::FileAllocation::RESERVE);
+        w.writeFrame(io::BufferedFrame2D<float>(3.0f, dimx, dimy), 3);
+    }
+    io::DenFileInfo inf(fileName);
+    REQUIRE(inf.getFileSize() == 4096 + dimx * dimy * dimz * sizeof(float));
+    REQUIRE(!inf.hasXMajorAlignment());
+    io::DenFrame2DReader<float> r(fileName);
+    REQUIRE(r.readFrame(3)->get(dimx - 1, dimy - 1) == 3.0f);
+    REQUIRE(r.readFrame(4)->get(0, 0) == 0.0f);
+    uint32_t dim[4] = { dimx, dimy, dimz, 2 };
+    std::remove(fileName.c_str());
+    {
+        io::DenAsyncFrame2DWritter<float> w(fileName, 4, dim, true, false,
+                                            io::FileAllocation::ZERO_RANGE);
+        REQUIRE(w.getFrameCount() == dimz * 2);
+    }
+    REQUIRE(io::DenFileInfo(fileName).getFileSize()
+            == 4096 + dimx * dimy * dimz * 2 * sizeof(float));
+    std::remove(fileName.c_str());
+}
+
+TEST_CASE("DenAsyncFrame2DWritter write throughput scaling",
+          "[.][benchmark][DenAsyncFrame2DWritter]")
+{
+    const uint32_t dimx = 1024, dimy = 1024, dimz = 256;
+    std::string fileName = "/tmp/DenAsyncFrame2DWritterBenchmark.den";
+    const double gigabytes = double(dimx) * dimy * dimz * sizeof(float) / 1e9;
+    for(uint32_t threads : { 1u, 2u, 4u, 8u, 16u, 32u, 64u })
+    {
+        io::DenAsyncFrame2DWritter<float> w(fileName, dimx, dimy, dimz);
+        w.enableCompletionTracking();
+        auto start = std::chrono::steady_clock::now();
+        writeSlices(w, threads, dimz);
+        w.finalize();
+        double seconds
+            = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        LOGI << io::xprintf("%u threads: %.2f GB/s", threads, gigabytes / seconds);
+    }
+    std::remove(fileName.c_str());
+}
@@ -0,0 +1,167 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Internal libs
+#include "BufferedFrame2D.hpp"
+#include "DEN/DenAsyncFrame2DWritter.hpp"
+#include "DEN/DenElementConversion.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "DEN/DenNextElement.h"
+#include "stringFormatter.h"
+
+using namespace KCT;
+
+namespace {
+template <typename S>
+std::vector<uint8_t> sourceBuffer(uint64_t count)
+{
+    std::vector<uint8_t> buffer(count * sizeof(S));
+    for(uint64_t i = 0; i != count; i++)
+    {
+        S v;
+        if constexpr(std::is_floating_point<S>::value)
+        {
+            v = static_cast<S>(0.5 * i - 3.25);
+        } else
+        {
+            // Whole range of the type including the sign bit
+            v = static_cast<S>(i * 2654435761u);
+        }
+        std::memcpy(buffer.data() + i * sizeof(S), &v, sizeof(S));
+    }
+    return buffer;
+}
+
+template <typename S, typename T>
+void checkConversion()
+{
+    io::DenSupportedType dataType = io::getDenSupportedTypeByTypeID(typeid(S));
+    // Block sizes of the SIMD kernels and their tails
+    for(uint64_t count : { 0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 31, 33, 1001 })
+    {
+        std::vector<uint8_t> buffer = sourceBuffer<S>(count);
+        std::vector<T> out(count + 1, T(77));
+        util::convertElements<T>(buffer.data(), dataType, out.data(), count);
+        for(uint64_t i = 0; i != count; i++)
+        {
+            REQUIRE(out[i] == util::getNextElement<T>(buffer.data() + i * sizeof(S), dataType));
+        }
+        REQUIRE(out[count] == T(77));
+    }
+}
+
+template <typename S>
+void checkSource()
+{
+    checkConversion<S, float>();
+    checkConversion<S, double>();
+    checkConversion<S, S>();
+}
+
+template <typename S>
+void checkReader(bool XMajor)
+{
+    const uint32_t dimx = 21, dimy = 11, dimz = 3;
+    std::string fileName = "/tmp/DenElementConversion.den";
+    io::BufferedFrame2D<S> f(S(0), dimx, dimy);
+    for(uint32_t y = 0; y != dimy; y++)
+    {
+        for(uint32_t x = 0; x != dimx; x++)
+        {
+            f.set(S(x + 11 * y), x, y);
+        }
+    }
+    {
+        io::DenAsyncFrame2DWritter<S> w(fileName, dimx, dimy, dimz, XMajor);
+        for(uint32_t k = 0; k != dimz; k++)
+        {
+            w.writeBufferedFrame(f, k);
+        }
+    }
+    io::DenFrame2DReader<float> r(fileName);
+    std::vector<float> xmajor(dimx * dimy), ymajor(dimx * dimy);
+    for(uint32_t k = 0; k != dimz; k++)
+    {
+        r.readFrameIntoBuffer(k, xmajor.data(), true);
+        r.readFrameIntoBuffer(k, ymajor.data(), false);
+        for(uint32_t y = 0; y != dimy; y++)
+        {
+            for(uint32_t x = 0; x != dimx; x++)
+            {
+                REQUIRE(xmajor[x + dimx * y] == float(x + 11 * y));
+                REQUIRE(ymajor[y + dimy * x] == float(x + 11 * y));
+            }
+        }
+    }
+    std::remove(fileName.c_str());
+}
+} // namespace
+
+TEST_CASE("Conversion of all DEN types", "[DenElementConversion]")
+{
+    LOGD << io::xprintf("Conversion kernels %s.", util::conversionKernelName());
+    checkSource<uint8_t>();
+    checkSource<uint16_t>();
+    checkSource<int16_t>();
+    checkSource<uint32_t>();
+    checkSource<int32_t>();
+    checkSource<uint64_t>();
+    checkSource<int64_t>();
+    checkSource<float>();
+    checkSource<double>();
+    checkConversion<uint8_t, uint16_t>();
+    // Stored and converted back
+    std::vector<double> values(100);
+    for(uint64_t i = 0; i != values.size(); i++)
+    {
+        values[i] = double(i);
+    }
+    for(io::DenSupportedType t :
+        { io::DenSupportedType::UINT8, io::DenSupportedType::UINT16, io::DenSupportedType::INT16,
+          io::DenSupportedType::UINT32, io::DenSupportedType::INT32, io::DenSupportedType::UINT64,
+          io::DenSupportedType::INT64, io::DenSupportedType::FLOAT32,
+          io::DenSupportedType::FLOAT64 })
+    {
+        std::vector<uint8_t> buffer(values.size() * io::DenSupportedTypeElementByteSize(t));
+        std::vector<double> back(values.size());
+        util::storeElements<double>(values.data(), t, buffer.data(), values.size());
+        util::convertElements<double>(buffer.data(), t, back.data(), values.size());
+        REQUIRE(back == values);
+    }
+}
+
+TEST_CASE("Reading integer files as float", "[DenElementConversion]")
+{
+    for(bool XMajor : { true, false })
+    {
+        checkReader<uint8_t>(XMajor);
+        checkReader<int16_t>(XMajor);
+        checkReader<int32_t>(XMajor);
+        checkReader<uint64_t>(XMajor);
+    }
+}
+
+TEST_CASE("UINT16 to float conversion throughput", "[.][benchmark][DenElementConversion]")
+{
+    const uint64_t count = 1 << 26;
+    std::vector<uint8_t> buffer = sourceBuffer<uint16_t>(count);
+    std::vector<float> out(count);
+    for(int repeat = 0; repeat != 3; repeat++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        util::convertElements<float>(buffer.data(), io::DenSupportedType::UINT16, out.data(),
+                                     count);
+        double seconds
+            = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        LOGI << io::xprintf("UINT16 to float with %s kernels: %.2f Gelements/s",
+                            util::conversionKernelName(), count / seconds / 1e9);
+    }
+}
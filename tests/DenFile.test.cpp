@@ -0,0 +1,306 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Internal libs
+#include "DEN/DenFile.hpp"
+#include "DEN/DenFileInfo.hpp"
+#include "FrameMemoryViewer2D.hpp"
+#include "NumaMemory.hpp"
+#include "RawFile.hpp"
+#include "denfixtures.test.hpp"
+#include "stringFormatter.h"
+
+using namespace KCT;
+
+namespace {
+bool waitForResidency(io::DenFile<float>& d, uint64_t frames)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while(d.getResidentFrameCount() != frames)
+    {
+        if(std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+} // namespace
+
+TEST_CASE("DenFile lazy loading reads frames on access", "[DenFile]")
+{
+    const uint32_t dimx = 31, dimy = 9, dimz = 70;
+    std::string fileName = createRampDenFile("/tmp/DenFileLazy.den", dimx, dimy, dimz);
+    const uint64_t frameSize = dimx * dimy;
+
+    io::DenFile<float> eager(fileName, 4);
+    REQUIRE(eager.getResidentFrameCount() == dimz);
+    REQUIRE(eager.isResident(dimz - 1));
+
+    io::DenFile<float> lazy(fileName, 4, false, io::DenFileLoading::LAZY);
+    REQUIRE(lazy.getResidentFrameCount() == 0);
+    REQUIRE(lazy.getFramePointer(65)[3] == static_cast<float>(65 * frameSize + 3));
+    REQUIRE(*lazy.beginFrame(2) == static_cast<float>(2 * frameSize));
+    REQUIRE(lazy.getFrame(7)->get(1, 2) == static_cast<float>(7 * frameSize + 2 * dimx + 1));
+    REQUIRE(lazy.getResidentFrameCount() == 3);
+    std::vector<uint64_t> residency = lazy.getResidency();
+    REQUIRE(residency.size() == 2);
+    REQUIRE(residency[0] == ((uint64_t(1) << 2) | (uint64_t(1) << 7)));
+    REQUIRE(residency[1] == (uint64_t(1) << 1));
+    REQUIRE_THROWS(lazy.ensureResident(0, dimz + 1));
+
+    // Concurrent accesses read each frame once
+    std::vector<std::thread> threads;
+    std::atomic<bool> mismatch{ false };
+    for(uint32_t t = 0; t != 8; t++)
+    {
+        threads.emplace_back([&, t]() {
+            for(uint64_t i = 0; i != dimz; i++)
+            {
+                uint64_t k = (i + 7 * t) % dimz;
+                if(lazy.getFramePointer(k)[5] != static_cast<float>(k * frameSize + 5))
+                {
+                    mismatch = true;
+                }
+            }
+        });
+    }
+    for(std::thread& t : threads)
+    {
+        t.join();
+    }
+    REQUIRE_FALSE(mismatch);
+    REQUIRE(lazy.getResidentFrameCount() == dimz);
+
+    // Whole data accessors read all the frames
+    io::DenFile<float> whole(fileName, 1, false, io::DenFileLoading::LAZY);
+    REQUIRE(whole.getDataPointer()[dimz * frameSize - 1]
+            == static_cast<float>(dimz * frameSize - 1));
+    REQUIRE(whole.getResidentFrameCount() == dimz);
+}
+
+TEST_CASE("DenFile prefetch and background loading", "[DenFile]")
+{
+    const uint32_t dimx = 64, dimy = 16, dimz = 130;
+    std::string fileName = createRampDenFile("/tmp/DenFileBackground.den", dimx, dimy, dimz);
+    const uint64_t frameSize = dimx * dimy;
+
+    io::DenFile<float> lazy(fileName, 3, false, io::DenFileLoading::LAZY);
+    lazy.prefetch(10, 20);
+    REQUIRE(waitForResidency(lazy, 10));
+    for(uint64_t k = 10; k != 20; k++)
+    {
+        REQUIRE(lazy.isResident(k));
+    }
+    REQUIRE_FALSE(lazy.isResident(20));
+
+    io::DenFile<float> background(fileName, 2, false, io::DenFileLoading::BACKGROUND);
+    REQUIRE(background.getFramePointer(129)[0] == static_cast<float>(129 * frameSize));
+    REQUIRE(waitForResidency(background, dimz));
+    REQUIRE(std::equal(background.begin(), background.end(), lazy.begin()));
+    std::string copy = "/tmp/DenFileBackgroundCopy.den";
+    background.writeFile(copy, true);
+    io::DenFile<float> written(copy, 2, false, io::DenFileLoading::LAZY);
+    REQUIRE(written.getFramePointer(77)[1] == static_cast<float>(77 * frameSize + 1));
+
+    // Destruction with pending background work does not wait for the whole file
+    {
+        io::DenFile<float> abandoned(fileName, 2, false, io::DenFileLoading::BACKGROUND);
+    }
+}
+
+TEST_CASE("DenFile frame views and flush of dirty frames", "[DenFile]")
+{
+    const uint32_t dimx = 40, dimy = 30, dimz = 12;
+    std::string fileName = createRampDenFile("/tmp/DenFileFlush.den", dimx, dimy, dimz);
+    const uint64_t frameSize = dimx * dimy;
+    io::DenFile<float> d(fileName, 3);
+    REQUIRE(d.getDirtyFrameCount() == 0);
+    std::shared_ptr<const io::FrameMemoryViewer2D<float>> c = d.getConstFrameView(4);
+    REQUIRE(c->get(3, 2) == static_cast<float>(4 * frameSize + 2 * dimx + 3));
+    REQUIRE(c->data() == d.getConstFramePointer(4));
+    // Const view can not modify the frame behind the dirty tracking
+    static_assert(std::is_same<decltype(c->data()), const float*>::value,
+                  "Const view exposes mutable data");
+    REQUIRE(d.getDirtyFrameCount() == 0);
+    REQUIRE(d.flush() == 0);
+
+    // Frame 0 changed on disk behind the object is not overwritten by the flush
+    {
+        io::RawFile f(fileName, true);
+        float v = -7.0f;
+        f.writeBytesFrom(d.getFrameByteSize() * 0 + io::DenFileInfo(fileName).getOffset(),
+                         (const uint8_t*)&v, sizeof(float));
+    }
+    std::shared_ptr<io::FrameMemoryViewer2D<float>> v5 = d.getFrameView(5);
+    v5->set(-1.0f, 1, 1);
+    d.getFramePointer(6)[0] = -2.0f;
+    *d.beginFrame(10) = -3.0f;
+    REQUIRE(d.isDirty(5));
+    REQUIRE(d.isDirty(6));
+    REQUIRE_FALSE(d.isDirty(7));
+    REQUIRE(d.getDirtyFrameCount() == 3);
+    REQUIRE(d.flush() == 3);
+    REQUIRE(d.getDirtyFrameCount() == 0);
+    REQUIRE(d.flush() == 0);
+    {
+        io::DenFile<float> r(fileName, 1, false, io::DenFileLoading::LAZY);
+        REQUIRE(r.getConstFramePointer(0)[0] == -7.0f);
+        REQUIRE(r.getFrame(5)->get(1, 1) == -1.0f);
+        REQUIRE(r.getConstFramePointer(6)[0] == -2.0f);
+        REQUIRE(r.getConstFramePointer(10)[0] == -3.0f);
+        REQUIRE(r.getConstFramePointer(11)[0] == static_cast<float>(11 * frameSize));
+        // Frames marked dirty before they are accessed are read, not flushed uninitialized
+        REQUIRE_FALSE(r.isResident(8));
+        r.markDirty(8, 10);
+        REQUIRE(r.isResident(9));
+        REQUIRE(r.flush() == 2);
+        REQUIRE_THROWS_AS(r.markDirty(0, dimz + 100), util::KCTException);
+        REQUIRE_THROWS_AS(r.markDirty(3, 2), util::KCTException);
+        REQUIRE_THROWS_AS(r.isDirty(dimz), util::KCTException);
+    }
+    {
+        io::DenFile<float> r(fileName, 1, false, io::DenFileLoading::LAZY);
+        REQUIRE(r.getConstFramePointer(8)[0] == static_cast<float>(8 * frameSize));
+        // Failed flush keeps the frames dirty
+        r.getFramePointer(1)[0] = -4.0f;
+        r.getFramePointer(3)[0] = -5.0f;
+        std::remove(fileName.c_str());
+        REQUIRE_THROWS_AS(r.flush(), util::KCTException);
+        REQUIRE(r.getDirtyFrameCount() == 2);
+        REQUIRE(r.isDirty(1));
+        REQUIRE(r.isDirty(3));
+    }
+
+    // Views follow the alignment of the file
+    std::vector<float> data(frameSize * 2);
+    for(uint64_t i = 0; i != data.size(); i++)
+    {
+        data[i] = static_cast<float>(i);
+    }
+    std::string yMajor = "/tmp/DenFileYMajor.den";
+    io::DenFileInfo::create3DDenFileFromArray<float>(data.data(), true, yMajor,
+                                                     io::DenSupportedType::FLOAT32, dimx, dimy, 2,
+                                                     false);
+    io::DenFile<float> y(yMajor, 1);
+    std::shared_ptr<io::Frame2DI<float>> copy = y.getFrame(1);
+    std::shared_ptr<const io::FrameMemoryViewer2D<float>> view = y.getConstFrameView(1);
+    REQUIRE_FALSE(view->hasXMajorAlignment());
+    REQUIRE(view->get(7, 3) == copy->get(7, 3));
+    REQUIRE(view->get(7, 3) == static_cast<float>(frameSize + 3 * dimx + 7));
+}
+
+TEST_CASE("DenFile reports NUMA placement of the frames", "[DenFile]")
+{
+    const uint32_t dimx = 256, dimy = 64, dimz = 20;
+    std::string fileName = createRampDenFile("/tmp/DenFileNuma.den", dimx, dimy, dimz);
+    const uint64_t frameSize = dimx * dimy;
+    const std::vector<uint32_t> nodes = io::numaNodes();
+    REQUIRE(nodes.size() == io::numaNodeCount());
+    auto isNode = [&nodes](int n) {
+        return std::find(nodes.begin(), nodes.end(), static_cast<uint32_t>(n)) != nodes.end();
+    };
+
+    io::DenFile<float> lazy(fileName, 2, false, io::DenFileLoading::LAZY);
+    REQUIRE(lazy.getFrameNumaNode(3) == -1);
+    REQUIRE(lazy.getFramePointer(3)[0] == static_cast<float>(3 * frameSize));
+    REQUIRE(isNode(lazy.getFrameNumaNode(3)));
+    std::vector<io::DenFileNumaRange> ranges = lazy.getNumaPlacement();
+    REQUIRE(ranges.front().fromFrame == 0);
+    REQUIRE(ranges.back().toFrame == dimz);
+    for(const io::DenFileNumaRange& r : ranges)
+    {
+        bool resident = r.fromFrame <= 3 && 3 < r.toFrame;
+        REQUIRE((resident ? isNode(r.node) : r.node == -1));
+    }
+    // The query does not fault in the frames
+    REQUIRE(lazy.getResidentFrameCount() == 1);
+
+    for(io::NumaPolicy policy :
+        { io::NumaPolicy::FIRST_TOUCH, io::NumaPolicy::INTERLEAVE, io::NumaPolicy::BIND })
+    {
+        io::DenFile<float> d(fileName, 4, false, io::DenFileLoading::EAGER, policy,
+                             nodes.front());
+        REQUIRE(d.getNumaPolicy() == policy);
+        REQUIRE(d.getFramePointer(19)[7] == static_cast<float>(19 * frameSize + 7));
+        for(const io::DenFileNumaRange& r : d.getNumaPlacement())
+        {
+            REQUIRE((r.node == -1 || isNode(r.node)));
+            if(policy == io::NumaPolicy::BIND && r.node >= 0)
+            {
+                REQUIRE(r.node == static_cast<int>(nodes.front()));
+            }
+        }
+    }
+}
+
+TEST_CASE("DenFile NUMA load and compute scaling", "[.][benchmark][DenFile]")
+{
+    const uint32_t dimx = 2048, dimy = 1024, dimz = 128;
+    std::string fileName = createRampDenFile("/tmp/DenFileNumaBenchmark.den", dimx, dimy, dimz);
+    const uint32_t threads = std::thread::hardware_concurrency();
+    const uint64_t frameSize = dimx * dimy;
+    const double gigabytes = double(frameSize) * dimz * sizeof(float) / 1e9;
+    LOGI << io::xprintf("%u NUMA nodes, %u threads", io::numaNodeCount(), threads);
+    for(io::NumaPolicy policy : { io::NumaPolicy::FIRST_TOUCH, io::NumaPolicy::INTERLEAVE })
+    {
+        auto start = std::chrono::steady_clock::now();
+        io::DenFile<float> d(fileName, threads, false, io::DenFileLoading::EAGER, policy);
+        double loadSeconds
+            = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        // Same partition of the frames as the load, then the partition shifted by half so that on
+        // two sockets each thread reads the frames placed on the other node
+        for(uint32_t shift : { 0u, threads / 2 })
+        {
+            uint64_t framesPerThread = (dimz + threads - 1) / threads;
+            std::vector<double> sums(threads);
+            std::vector<std::thread> workers;
+            start = std::chrono::steady_clock::now();
+            for(uint32_t i = 0; i != threads; i++)
+            {
+                workers.emplace_back([&, i]() {
+                    uint32_t chunk = (i + shift) % threads;
+                    if(io::numaNodeCount() > 1)
+                    {
+                        io::bindThreadToNumaNode(
+                            io::numaNodes()[i * io::numaNodeCount() / threads]);
+                    }
+                    uint64_t from = std::min<uint64_t>(chunk * framesPerThread, dimz);
+                    uint64_t to = std::min<uint64_t>(from + framesPerThread, dimz);
+                    double sum = 0.0;
+                    for(uint32_t pass = 0; pass != 4; pass++)
+                    {
+                        for(uint64_t k = from; k != to; k++)
+                        {
+                            const float* f = d.getFramePointer(k);
+                            sum += std::accumulate(f, f + frameSize, 0.0f);
+                        }
+                    }
+                    sums[i] = sum;
+                });
+            }
+            for(std::thread& w : workers)
+            {
+                w.join();
+            }
+            double computeSeconds
+                = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            LOGI << io::xprintf("%s, shift %u: load %.2f GB/s, compute %.2f GB/s",
+                                policy == io::NumaPolicy::FIRST_TOUCH ? "first touch"
+                                                                      : "interleave",
+                                shift, gigabytes / loadSeconds, 4 * gigabytes / computeSeconds);
+        }
+    }
+}
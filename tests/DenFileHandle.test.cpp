@@ -0,0 +1,103 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Internal libs
+#include "DEN/DenAsyncFrame2DWritter.hpp"
+#include "DEN/DenFileHandle.hpp"
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenFrame2DCachedReader.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "denfixtures.test.hpp"
+
+using namespace KCT;
+
+TEST_CASE("DenFileHandle shared by readers", "[DenFileHandle]")
+{
+    std::string fileName = "/tmp/DenFileHandle.den";
+    const uint32_t dimx = 11, dimy = 5, dimz = 4;
+    createRampDenFile(fileName, dimx, dimy, dimz);
+    uint64_t registered = io::DenFileHandle::registeredHandles();
+    {
+        std::shared_ptr<io::DenFileHandle> a = io::DenFileHandle::open(fileName);
+        std::shared_ptr<io::DenFileHandle> b = io::DenFileHandle::open(fileName);
+        REQUIRE(a == b);
+        REQUIRE(io::DenFileHandle::registeredHandles() == registered + 1);
+        REQUIRE(a->getFrameCount() == dimz);
+        REQUIRE(a->getFrameSize() == dimx * dimy);
+        REQUIRE(a->getFrameByteSize() == dimx * dimy * sizeof(float));
+        REQUIRE(a->getOffset() == a->getInfo().getOffset());
+        io::DenFrame2DReader<float> r1(fileName);
+        io::DenFrame2DReader<float> r2(a);
+        io::DenFrame2DCachedReader<float> r3(a, 0, 2);
+        REQUIRE(r1.getFileHandle() == a);
+        REQUIRE(r2.getFileHandle() == a);
+        std::vector<float> buf1(dimx * dimy), buf2(dimx * dimy);
+        for(uint64_t k = 0; k != dimz; k++)
+        {
+            r1.readFrameIntoBuffer(k, buf1.data());
+            r2.readFrameIntoBuffer(k, buf2.data());
+            REQUIRE(buf1 == buf2);
+            REQUIRE(buf1[0] == static_cast<float>(k * dimx * dimy));
+            std::shared_ptr<io::Frame2DI<float>> f = r3.readFrame(k);
+            REQUIRE(f->get(3, 2) == buf1[2 * dimx + 3]);
+        }
+    }
+    REQUIRE(io::DenFileHandle::registeredHandles() == registered);
+}
+
+TEST_CASE("DenFileHandle reopened after file change", "[DenFileHandle]")
+{
+    std::string fileName = "/tmp/DenFileHandle_change.den";
+    std::vector<uint16_t> data(6 * 4 * 3, 7);
+    io::DenFileInfo::create3DDenFileFromArray<uint16_t>(data.data(), true, fileName,
+                                                        io::DenSupportedType::UINT16, 6, 4, 3);
+    std::shared_ptr<io::DenFileHandle> a = io::DenFileHandle::open(fileName);
+    REQUIRE(a->getFrameCount() == 3);
+    // Different size forces new header parse
+    data.resize(6 * 4 * 5, 9);
+    io::DenFileInfo::create3DDenFileFromArray<uint16_t>(data.data(), true, fileName,
+                                                        io::DenSupportedType::UINT16, 6, 4, 5);
+    std::shared_ptr<io::DenFileHandle> b = io::DenFileHandle::open(fileName);
+    REQUIRE(a != b);
+    REQUIRE(b->getFrameCount() == 5);
+    REQUIRE(a->getFrameCount() == 3);
+    std::shared_ptr<io::DenFileHandle> direct = io::DenFileHandle::open(fileName, true);
+    REQUIRE(direct != b);
+    io::DenFrame2DReader<uint16_t> r(b);
+    std::vector<uint16_t> buf(6 * 4);
+    r.readFrameIntoBuffer(4, buf.data());
+    REQUIRE(buf[0] == 9);
+    io::DenAsyncFrame2DWritter<uint16_t> w(b);
+    REQUIRE(w.getFrameCount() == 5);
+}
+
+TEST_CASE("DenFileHandle concurrent opens share one handle", "[DenFileHandle]")
+{
+    std::string fileName = "/tmp/DenFileHandle_concurrent.den";
+    std::vector<float> data(8 * 8 * 2, 1.0f);
+    io::DenFileInfo::create3DDenFileFromArray<float>(data.data(), true, fileName,
+                                                     io::DenSupportedType::FLOAT32, 8, 8, 2);
+    std::vector<std::shared_ptr<io::DenFileHandle>> handles(8);
+    std::vector<std::thread> threads;
+    for(uint32_t t = 0; t != handles.size(); t++)
+    {
+        threads.emplace_back(
+            [&handles, &fileName, t] { handles[t] = io::DenFileHandle::open(fileName); });
+    }
+    for(std::thread& t : threads)
+    {
+        t.join();
+    }
+    for(std::shared_ptr<io::DenFileHandle>& h : handles)
+    {
+        REQUIRE(h == handles[0]);
+    }
+    REQUIRE_THROWS(io::DenFileHandle::open("/tmp/DenFileHandle_missing.den"));
+    std::remove(fileName.c_str());
+}
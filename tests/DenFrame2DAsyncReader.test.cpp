@@ -0,0 +1,106 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Internal libs
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenFrame2DAsyncReader.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "IoUring.hpp"
+#include "denfixtures.test.hpp"
+
+using namespace KCT;
+
+template <typename S, typename T>
+void compareAsyncWithSynchronous(std::string fileName, bool fileXMajor, io::AsyncReadEngine engine)
+{
+    const uint32_t dimx = 33, dimy = 17, dimz = 150;
+    createPatternDenFile<S>(fileName, dimx, dimy, dimz, fileXMajor);
+    io::DenFrame2DReader<T> syncReader(fileName);
+    io::DenFrame2DAsyncReader<T> asyncReader(fileName, 16, engine);
+    if(engine != io::AsyncReadEngine::AUTO)
+    {
+        REQUIRE(asyncReader.getEngine() == engine);
+    }
+    uint64_t frameSize = syncReader.getFrameSize();
+    std::vector<T> expected(frameSize * dimz);
+    std::vector<T> result(frameSize * dimz, T(0));
+    for(uint64_t k = 0; k != dimz; k++)
+    {
+        syncReader.readFrameIntoBuffer(k, expected.data() + k * frameSize);
+    }
+    // Reversed order to make sure that completions are matched to the right buffers
+    uint32_t completed = 0;
+    for(uint64_t k = dimz; k-- != 0;)
+    {
+        asyncReader.submitRead(k, result.data() + k * frameSize);
+        completed += asyncReader.poll();
+    }
+    completed += asyncReader.waitAll();
+    REQUIRE(completed == dimz);
+    REQUIRE(asyncReader.inFlight() == 0);
+    REQUIRE(std::memcmp(expected.data(), result.data(), expected.size() * sizeof(T)) == 0);
+    std::remove(fileName.c_str());
+}
+
+TEST_CASE("DenFrame2DAsyncReader: byte equality with DenFrame2DReader", "[denasyncreader]")
+{
+    std::vector<io::AsyncReadEngine> engines = { io::AsyncReadEngine::THREAD_POOL };
+    if(io::IoUring::isAvailable())
+    {
+        engines.push_back(io::AsyncReadEngine::IO_URING);
+    }
+    for(io::AsyncReadEngine engine : engines)
+    {
+        compareAsyncWithSynchronous<float, float>("/tmp/denasync_float.den", true, engine);
+        compareAsyncWithSynchronous<float, float>("/tmp/denasync_float_ymajor.den", false, engine);
+        compareAsyncWithSynchronous<uint16_t, float>("/tmp/denasync_uint16.den", true, engine);
+        compareAsyncWithSynchronous<double, double>("/tmp/denasync_double.den", true, engine);
+    }
+}
+
+TEST_CASE("DenFrame2DAsyncReader: out of range frame", "[denasyncreader]")
+{
+    std::string fileName = "/tmp/denasync_range.den";
+    std::vector<float> data(4 * 3 * 2, 1.0f);
+    io::DenFileInfo::create3DDenFileFromArray<float>(data.data(), true, fileName,
+                                                     io::DenSupportedType::FLOAT32, 4, 3, 2);
+    io::DenFrame2DAsyncReader<float> r(fileName);
+    std::vector<float> buf(12);
+    REQUIRE_THROWS_AS(r.submitRead(2, buf.data()), util::KCTException);
+    std::remove(fileName.c_str());
+}
+
+TEST_CASE("DenFrame2DAsyncReader: reads in flight bounded by queue depth", "[denasyncreader]")
+{
+    std::string fileName = "/tmp/denasync_depth.den";
+    const uint32_t dimx = 8, dimy = 4, dimz = 20;
+    std::vector<float> data(dimx * dimy * dimz, 2.0f);
+    io::DenFileInfo::create3DDenFileFromArray<float>(data.data(), true, fileName,
+                                                     io::DenSupportedType::FLOAT32, dimx, dimy,
+                                                     dimz);
+    std::vector<io::AsyncReadEngine> engines = { io::AsyncReadEngine::THREAD_POOL };
+    if(io::IoUring::isAvailable())
+    {
+        engines.push_back(io::AsyncReadEngine::IO_URING);
+    }
+    for(io::AsyncReadEngine engine : engines)
+    {
+        io::DenFrame2DAsyncReader<float> r(fileName, 3, engine);
+        std::vector<float> result(data.size(), 0.0f);
+        for(uint64_t k = 0; k != dimz; k++)
+        {
+            r.submitRead(k, result.data() + k * dimx * dimy);
+            REQUIRE(r.inFlight() <= 3);
+        }
+        // Reads reaped by submitRead are reported later
+        REQUIRE(r.waitAll() == dimz);
+        REQUIRE(result == data);
+    }
+    std::remove(fileName.c_str());
+}
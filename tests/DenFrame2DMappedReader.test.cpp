@@ -0,0 +1,109 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <memory>
+#include <vector>
+
+// Internal libs
+#include "DEN/DenAsyncFrame2DWritter.hpp"
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenFrame2DMappedReader.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "denfixtures.test.hpp"
+
+using namespace KCT;
+
+template <typename S, typename T>
+void compareMappedWithSynchronous(std::string fileName, bool fileXMajor, bool expectZeroCopy)
+{
+    const uint32_t dimx = 13, dimy = 9, dimz = 7;
+    std::vector<S> data = createPatternDenFile<S>(fileName, dimx, dimy, dimz, fileXMajor);
+    std::shared_ptr<io::Frame2DI<T>> lastFrame;
+    {
+        io::DenFrame2DReader<T> syncReader(fileName);
+        io::DenFrame2DMappedReader<T> mappedReader(fileName, true);
+        REQUIRE(mappedReader.isZeroCopy() == expectZeroCopy);
+        mappedReader.advise(io::MemoryAdvice::SEQUENTIAL);
+        mappedReader.adviseFrames(2, 100, io::MemoryAdvice::WILLNEED);
+        std::vector<T> expected(dimx * dimy), buffer(dimx * dimy);
+        for(uint64_t k = 0; k != dimz; k++)
+        {
+            syncReader.readFrameIntoBuffer(k, expected.data());
+            mappedReader.readFrameIntoBuffer(k, buffer.data());
+            REQUIRE(expected == buffer);
+            syncReader.readFrameIntoBuffer(k, expected.data(), false);
+            mappedReader.readFrameIntoBuffer(k, buffer.data(), false);
+            REQUIRE(expected == buffer);
+            std::shared_ptr<io::Frame2DI<T>> f = mappedReader.readFrame(k);
+            std::shared_ptr<io::Frame2DI<T>> g = syncReader.readFrame(k);
+            for(uint32_t y = 0; y != dimy; y++)
+            {
+                for(uint32_t x = 0; x != dimx; x++)
+                {
+                    REQUIRE(f->get(x, y) == g->get(x, y));
+                }
+            }
+            if(expectZeroCopy)
+            {
+                REQUIRE(mappedReader.getFramePointer(k) != nullptr);
+                REQUIRE(std::dynamic_pointer_cast<io::FrameMemoryViewer2D<T>>(f) != nullptr);
+            } else
+            {
+                REQUIRE(mappedReader.getFramePointer(k) == nullptr);
+            }
+        }
+        lastFrame = mappedReader.readFrame(dimz - 1);
+        // Private mapping, modification shall not reach the file
+        lastFrame->set(T(1), 0, 0);
+    }
+    // View keeps the mapping alive after the reader is destroyed
+    REQUIRE(lastFrame->get(0, 0) == T(1));
+    REQUIRE(lastFrame->get(1, 0) == T(data[(dimz - 1) * dimx * dimy + 1]));
+    io::DenFrame2DReader<T> reread(fileName);
+    std::shared_ptr<io::Frame2DI<T>> f = reread.readFrame(dimz - 1);
+    REQUIRE(f->get(0, 0) == T(data[(dimz - 1) * dimx * dimy]));
+    std::remove(fileName.c_str());
+}
+
+TEST_CASE("DenFrame2DMappedReader: equality with DenFrame2DReader", "[denmappedreader]")
+{
+    compareMappedWithSynchronous<float, float>("/tmp/denmapped_float.den", true, true);
+    compareMappedWithSynchronous<float, float>("/tmp/denmapped_float_ymajor.den", false, false);
+    compareMappedWithSynchronous<uint16_t, float>("/tmp/denmapped_uint16.den", true, false);
+    compareMappedWithSynchronous<double, double>("/tmp/denmapped_double.den", true, true);
+}
+
+TEST_CASE("DenFrame2DMappedReader: legacy header", "[denmappedreader]")
+{
+    std::string fileName = "/tmp/denmapped_legacy.den";
+    const uint32_t dimx = 5, dimy = 4, dimz = 3;
+    io::DenFileInfo::createEmptyLegacyDenFile(fileName, io::DenSupportedType::FLOAT32, dimx, dimy,
+                                              dimz);
+    {
+        io::DenAsyncFrame2DWritter<float> w(fileName);
+        std::vector<float> frame(dimx * dimy);
+        for(uint32_t k = 0; k != dimz; k++)
+        {
+            for(uint32_t i = 0; i != dimx * dimy; i++)
+            {
+                frame[i] = k * 100.0f + i;
+            }
+            w.writeBuffer(frame.data(), k);
+        }
+    }
+    // Frames start at the offset 6 so that floats are misaligned and have to be copied
+    io::DenFrame2DMappedReader<float> r(fileName);
+    REQUIRE(!r.isZeroCopy());
+    for(uint32_t k = 0; k != dimz; k++)
+    {
+        std::shared_ptr<io::Frame2DI<float>> f = r.readFrame(k);
+        for(uint32_t i = 0; i != dimx * dimy; i++)
+        {
+            REQUIRE(f->get(i % dimx, i / dimx) == k * 100.0f + i);
+        }
+    }
+    REQUIRE_THROWS_AS(r.readFrame(dimz), util::KCTException);
+    std::remove(fileName.c_str());
+}
@@ -0,0 +1,107 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Internal libs
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenFrame2DPrefetchReader.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "denfixtures.test.hpp"
+
+using namespace KCT;
+
+namespace {
+// Reader that is slower than the consumer so that it stalls
+template <typename T>
+class SlowReader : public io::DenFrame2DReader<T>
+{
+public:
+    SlowReader(std::string denFile)
+        : io::DenFrame2DReader<T>(denFile)
+    {
+    }
+    void readFrameIntoBuffer(uint64_t k, T* outside_buffer, bool XMajorAlignment = true) override
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        io::DenFrame2DReader<T>::readFrameIntoBuffer(k, outside_buffer, XMajorAlignment);
+    }
+};
+} // namespace
+
+TEST_CASE("DenFrame2DPrefetchReader schedules", "[DenFrame2DPrefetchReader]")
+{
+    const uint32_t dimx = 17, dimy = 11, dimz = 40;
+    std::string fileName = createRampDenFile("/tmp/DenFrame2DPrefetchReader.den", dimx, dimy, dimz);
+    using PR = io::DenFrame2DPrefetchReader<float>;
+    std::vector<std::vector<uint64_t>> schedules
+        = { PR::sequentialSchedule(dimz), PR::reversedSchedule(dimz),
+            PR::stridedSchedule(dimz, 3, 7), { 5, 5, 0, 39, 12, 13 } };
+    REQUIRE(PR::stridedSchedule(dimz, 3, 7) == std::vector<uint64_t>({ 3, 10, 17, 24, 31, 38 }));
+    for(const std::vector<uint64_t>& schedule : schedules)
+    {
+        for(uint32_t threads : { 1u, 3u })
+        {
+            PR r(fileName, schedule, 4, threads);
+            for(uint64_t k : schedule)
+            {
+                std::shared_ptr<io::BufferedFrame2DI<float>> f = r.readBufferedFrame(k);
+                REQUIRE(f->get(0, 0) == static_cast<float>(k * dimx * dimy));
+                REQUIRE(f->get(3, 2) == static_cast<float>(k * dimx * dimy + 2 * dimx + 3));
+            }
+            io::PrefetchStatistics s = r.getStatistics();
+            REQUIRE(s.hits == schedule.size());
+            REQUIRE(s.misses == 0);
+        }
+    }
+}
+
+TEST_CASE("DenFrame2DPrefetchReader skips and misses", "[DenFrame2DPrefetchReader]")
+{
+    const uint32_t dimx = 9, dimy = 6, dimz = 30;
+    std::string fileName = createRampDenFile("/tmp/DenFrame2DPrefetchReader.den", dimx, dimy, dimz);
+    using PR = io::DenFrame2DPrefetchReader<float>;
+    PR r(fileName, PR::sequentialSchedule(dimz), 4, 2);
+    std::vector<float> buf(dimx * dimy);
+    // Within the window, frames 0 and 1 are dropped
+    r.readFrameIntoBuffer(2, buf.data());
+    REQUIRE(buf[0] == static_cast<float>(2 * dimx * dimy));
+    // Out of the window, the window is moved behind frame 20
+    r.readFrameIntoBuffer(20, buf.data(), false);
+    REQUIRE(buf[1] == static_cast<float>(20 * dimx * dimy + dimx));
+    r.readFrameIntoBuffer(21, buf.data(), false);
+    REQUIRE(buf[1] == static_cast<float>(21 * dimx * dimy + dimx));
+    REQUIRE(buf[dimy] == static_cast<float>(21 * dimx * dimy + 1));
+    // Frame before the window is read synchronously and the window stays
+    r.readFrameIntoBuffer(3, buf.data());
+    REQUIRE(buf[0] == static_cast<float>(3 * dimx * dimy));
+    r.readFrameIntoBuffer(22, buf.data());
+    REQUIRE(buf[0] == static_cast<float>(22 * dimx * dimy));
+    io::PrefetchStatistics s = r.getStatistics();
+    REQUIRE(s.hits == 3);
+    REQUIRE(s.misses == 2);
+    REQUIRE_THROWS(PR(fileName, { 0, 30 }));
+}
+
+TEST_CASE("DenFrame2DPrefetchReader reports stalls", "[DenFrame2DPrefetchReader]")
+{
+    const uint32_t dimx = 8, dimy = 8, dimz = 10;
+    std::string fileName = createRampDenFile("/tmp/DenFrame2DPrefetchReader.den", dimx, dimy, dimz);
+    using PR = io::DenFrame2DPrefetchReader<float>;
+    std::shared_ptr<io::Frame2DReaderI<float>> slow = std::make_shared<SlowReader<float>>(fileName);
+    PR r(slow, PR::sequentialSchedule(dimz), 2, 1);
+    for(uint64_t k = 0; k != dimz; k++)
+    {
+        std::shared_ptr<io::Frame2DI<float>> f = r.readFrame(k);
+        REQUIRE(f->get(1, 1) == static_cast<float>(k * dimx * dimy + dimx + 1));
+    }
+    io::PrefetchStatistics s = r.getStatistics();
+    REQUIRE(s.hits == dimz);
+    REQUIRE(s.stalls > 0);
+    REQUIRE(s.stallSeconds > 0.0);
+}
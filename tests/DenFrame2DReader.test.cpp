@@ -0,0 +1,247 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Internal libs
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "denfixtures.test.hpp"
+#include "stringFormatter.h"
+
+using namespace KCT;
+
+template <typename S, typename T>
+void compareMultiFrameReads(std::string fileName, bool fileXMajor)
+{
+    const uint32_t dimx = 31, dimy = 17, dimz = 40;
+    createPatternDenFile<S>(fileName, dimx, dimy, dimz, fileXMajor);
+    io::DenFrame2DReader<T> r(fileName);
+    uint64_t frameSize = r.getFrameSize();
+    for(bool XMajor : { true, false })
+    {
+        std::vector<T> expected(frameSize * dimz);
+        for(uint64_t k = 0; k != dimz; k++)
+        {
+            r.readFrameIntoBuffer(k, expected.data() + k * frameSize, XMajor);
+        }
+        // Contiguous range
+        std::vector<T> range(frameSize * 25);
+        r.readFramesIntoBuffer(7, 25, range.data(), XMajor);
+        REQUIRE(std::equal(range.begin(), range.end(), expected.begin() + 7 * frameSize));
+        // Reversed, every 3rd and duplicate frames as produced by the frame specifications
+        std::vector<uint64_t> frameLists[]
+            = { { 39, 38, 37, 36, 10, 9, 8 }, { 0, 3, 6, 9, 12, 15, 39 }, { 5, 5, 6, 0, 5 } };
+        for(const std::vector<uint64_t>& frames : frameLists)
+        {
+            std::vector<T> out(frameSize * frames.size());
+            r.readFramesIntoBuffer(frames, out.data(), XMajor);
+            for(std::size_t i = 0; i != frames.size(); i++)
+            {
+                REQUIRE(std::equal(out.begin() + i * frameSize, out.begin() + (i + 1) * frameSize,
+                                   expected.begin() + frames[i] * frameSize));
+            }
+        }
+    }
+    std::vector<T> out(frameSize);
+    REQUIRE_THROWS_AS(r.readFramesIntoBuffer(dimz - 1, 2, out.data()), util::KCTException);
+    REQUIRE_THROWS_AS(r.readFramesIntoBuffer(std::vector<uint64_t>{ dimz }, out.data()),
+                      util::KCTException);
+    std::remove(fileName.c_str());
+}
+
+TEST_CASE("DenFrame2DReader: multi frame reads", "[denframe2dreader]")
+{
+    compareMultiFrameReads<float, float>("/tmp/denreader_multi_float.den", true);
+    compareMultiFrameReads<float, float>("/tmp/denreader_multi_float_ymajor.den", false);
+    compareMultiFrameReads<uint16_t, float>("/tmp/denreader_multi_uint16.den", true);
+}
+
+TEST_CASE("DenFrame2DReader: strided reads of large frames", "[denframe2dreader]")
+{
+    std::string fileName = "/tmp/denreader_multi_large.den";
+    // Frames of 1.2 MiB, larger than MAX_COALESCED_GAP and the gap buffer
+    const uint32_t dimx = 640, dimy = 480, dimz = 13;
+    std::vector<float> data(uint64_t(dimx) * dimy * dimz);
+    for(uint64_t i = 0; i != data.size(); i++)
+    {
+        data[i] = static_cast<float>(i % 65521);
+    }
+    io::DenFileInfo::create3DDenFileFromArray<float>(data.data(), true, fileName,
+                                                     io::DenSupportedType::FLOAT32, dimx, dimy,
+                                                     dimz);
+    io::DenFrame2DReader<float> r(fileName);
+    uint64_t frameSize = r.getFrameSize();
+    // Every 4th frame is coalesced irrespective of the frame size
+    REQUIRE(r.getMaxCoalescedGapFrames() == io::DenFrame2DReader<float>::MAX_COALESCED_GAP_FRAMES);
+    std::vector<uint64_t> frames = { 12, 0, 4, 8 };
+    std::vector<float> out(frameSize * frames.size());
+    r.readFramesIntoBuffer(frames, out.data());
+    for(std::size_t i = 0; i != frames.size(); i++)
+    {
+        REQUIRE(std::equal(out.begin() + i * frameSize, out.begin() + (i + 1) * frameSize,
+                           data.begin() + frames[i] * frameSize));
+    }
+    std::remove(fileName.c_str());
+}
+
+TEST_CASE("DenFileInfo: readIntoArray matches frame reads", "[denframe2dreader][denfileinfo]")
+{
+    std::string fileName = "/tmp/denreader_readintoarray.den";
+    const uint32_t dimx = 9, dimy = 6, dimz = 12;
+    std::vector<uint16_t> data(dimx * dimy * dimz);
+    for(uint64_t i = 0; i != data.size(); i++)
+    {
+        data[i] = static_cast<uint16_t>(i * 13);
+    }
+    io::DenFileInfo::create3DDenFileFromArray<uint16_t>(data.data(), true, fileName,
+                                                        io::DenSupportedType::UINT16, dimx, dimy,
+                                                        dimz);
+    io::DenFileInfo inf(fileName);
+    std::vector<uint16_t> all(data.size());
+    inf.readIntoArray<uint16_t>(all.data());
+    REQUIRE(all == data);
+    // Subvolume x in [2, 7), y in [1, 4), z in [3, 10) in Y major order
+    std::vector<uint16_t> sub(5 * 3 * 7);
+    inf.readIntoArray<uint16_t>(sub.data(), false, 2, 5, 1, 3, 3, 7);
+    for(uint32_t z = 0; z != 7; z++)
+    {
+        for(uint32_t y = 0; y != 3; y++)
+        {
+            for(uint32_t x = 0; x != 5; x++)
+            {
+                REQUIRE(sub[z * 15 + x * 3 + y]
+                        == data[(z + 3) * dimx * dimy + (y + 1) * dimx + (x + 2)]);
+            }
+        }
+    }
+    std::remove(fileName.c_str());
+}
+
+template <typename T>
+void compareRoiReads(std::string fileName, bool fileXMajor)
+{
+    const uint32_t dimx = 1500, dimy = 40, dimz = 3;
+    std::vector<T> data = createPatternDenFile<T>(fileName, dimx, dimy, dimz, fileXMajor);
+    io::DenFileInfo inf(fileName);
+    std::vector<uint8_t> tmp(inf.getFrameByteSize());
+    // Narrow and wide regions to exercise both per row and spanning reads
+    std::vector<std::array<uint32_t, 4>> rois
+        = { { 700, 25, 3, 30 }, { 10, 1400, 5, 20 }, { 0, 1500, 7, 2 }, { 1499, 1, 0, 40 } };
+    for(const std::array<uint32_t, 4>& r : rois)
+    {
+        uint32_t xf = r[0], xc = r[1], yf = r[2], yc = r[3];
+        for(bool fillXMajor : { true, false })
+        {
+            std::vector<T> frame(xc * yc), volume(xc * yc * 2);
+            inf.readFlatFrameIntoBuffer<T>(1, frame.data(), fillXMajor, tmp.data(), xf, xc, yf, yc);
+            inf.readIntoArray<T>(volume.data(), fillXMajor, xf, xc, yf, yc, 1, 2);
+            for(uint32_t z = 0; z != 2; z++)
+            {
+                for(uint32_t y = 0; y != yc; y++)
+                {
+                    for(uint32_t x = 0; x != xc; x++)
+                    {
+                        uint64_t i = fillXMajor ? x + xc * y : y + yc * x;
+                        T expected = data[(z + 1) * dimx * dimy + (y + yf) * dimx + (x + xf)];
+                        REQUIRE(volume[z * xc * yc + i] == expected);
+                        if(z == 0)
+                        {
+                            REQUIRE(frame[i] == expected);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    std::remove(fileName.c_str());
+}
+
+TEST_CASE("DenFileInfo: region of interest reads", "[denframe2dreader][denfileinfo]")
+{
+    compareRoiReads<float>("/tmp/denreader_roi_float.den", true);
+    compareRoiReads<float>("/tmp/denreader_roi_float_ymajor.den", false);
+    compareRoiReads<uint16_t>("/tmp/denreader_roi_uint16.den", true);
+    compareRoiReads<double>("/tmp/denreader_roi_double_ymajor.den", false);
+}
+
+namespace {
+// Reads every frame of the uint16_t file as float by numThreads threads sharing one reader
+double
+convertingReadsPerSecond(io::DenFrame2DReader<float>& r, uint32_t numThreads, uint32_t passes)
+{
+    std::atomic<bool> mismatch{ false };
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t t = 0; t != numThreads; t++)
+    {
+        threads.emplace_back([&, t]() {
+            std::vector<float> buf(r.getFrameSize());
+            for(uint64_t i = 0; i != passes * r.getFrameCount(); i++)
+            {
+                uint64_t k = (i + t) % r.getFrameCount();
+                r.readFrameIntoBuffer(k, buf.data(), i % 2 == 0);
+                if(buf[0] != static_cast<float>(k % 60000))
+                {
+                    mismatch = true;
+                }
+            }
+        });
+    }
+    for(std::thread& t : threads)
+    {
+        t.join();
+    }
+    REQUIRE_FALSE(mismatch);
+    double seconds
+        = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return numThreads * passes * r.getFrameCount() / seconds;
+}
+
+std::string
+createConversionFile(std::string fileName, uint32_t dimx, uint32_t dimy, uint32_t dimz)
+{
+    std::vector<uint16_t> data(uint64_t(dimx) * dimy * dimz);
+    for(uint64_t k = 0; k != dimz; k++)
+    {
+        std::fill(data.begin() + k * dimx * dimy, data.begin() + (k + 1) * dimx * dimy,
+                  static_cast<uint16_t>(k % 60000));
+    }
+    io::DenFileInfo::create3DDenFileFromArray<uint16_t>(data.data(), true, fileName,
+                                                        io::DenSupportedType::UINT16, dimx, dimy,
+                                                        dimz);
+    return fileName;
+}
+} // namespace
+
+TEST_CASE("DenFrame2DReader: concurrent converting reads", "[denframe2dreader]")
+{
+    std::string fileName = createConversionFile("/tmp/denconcurrent_uint16.den", 64, 48, 32);
+    io::DenFrame2DReader<float> r(fileName);
+    convertingReadsPerSecond(r, 16, 4);
+}
+
+TEST_CASE("DenFrame2DReader: converting read scaling", "[.][benchmark][denframe2dreader]")
+{
+    std::string fileName = createConversionFile("/tmp/denscaling_uint16.den", 1024, 1024, 64);
+    io::DenFrame2DReader<float> r(fileName);
+    double single = 0.0;
+    for(uint32_t numThreads = 1; numThreads <= std::thread::hardware_concurrency();
+        numThreads *= 2)
+    {
+        double rate = convertingReadsPerSecond(r, numThreads, 4);
+        if(numThreads == 1)
+        {
+            single = rate;
+        }
+        LOGI << io::xprintf("%u threads: %.1f frames/s, speedup %.2f", numThreads, rate,
+                            rate / single);
+    }
+}
@@ -0,0 +1,112 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Internal libs
+#include "BufferedFrame2D.hpp"
+#include "DEN/DenAsyncFrame2DWritter.hpp"
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "DEN/DenReslice.hpp"
+#include "stringFormatter.h"
+
+using namespace KCT;
+
+namespace {
+template <typename T>
+void checkReslice(bool inputXMajor, uint64_t memoryBytes, uint32_t numThreads)
+{
+    const uint32_t dim[3] = { 13, 7, 5 };
+    std::string input = "/tmp/DenResliceInput.den";
+    std::string output = "/tmp/DenResliceOutput.den";
+    {
+        io::DenAsyncFrame2DWritter<T> w(input, dim[0], dim[1], dim[2], inputXMajor);
+        io::BufferedFrame2D<T> f(T(0), dim[0], dim[1]);
+        for(uint32_t z = 0; z != dim[2]; z++)
+        {
+            for(uint32_t y = 0; y != dim[1]; y++)
+            {
+                for(uint32_t x = 0; x != dim[0]; x++)
+                {
+                    f.set(T(x + 100 * y + 10000 * z), x, y);
+                }
+            }
+            w.writeBufferedFrame(f, z);
+        }
+    }
+    for(std::string order : { "xyz", "yxz", "xzy", "zxy", "yzx", "zyx" })
+    {
+        for(bool XMajor : { true, false })
+        {
+            io::DenResliceOptions opts;
+            opts.axisOrder = io::parseAxisOrder(order);
+            opts.XMajor = XMajor;
+            opts.memoryBytes = memoryBytes;
+            opts.numThreads = numThreads;
+            io::DenResliceStatistics stats = io::resliceDenFile(input, output, opts);
+            const std::array<uint32_t, 3>& p = opts.axisOrder;
+            io::DenFileInfo info(output);
+            REQUIRE(info.dimx() == dim[p[0]]);
+            REQUIRE(info.dimy() == dim[p[1]]);
+            REQUIRE(info.getFrameCount() == dim[p[2]]);
+            REQUIRE(info.hasXMajorAlignment() == XMajor);
+            // Two passes iff the fastest input axis becomes the slowest output axis
+            uint32_t fastest = inputXMajor ? 0 : 1;
+            uint32_t slowest = p[2];
+            REQUIRE(stats.passes == (slowest == fastest ? 2 : 1));
+            REQUIRE(stats.bytesWritten == stats.passes * dim[0] * dim[1] * dim[2] * sizeof(T));
+            io::DenFrame2DReader<T> r(output);
+            std::vector<T> frame(info.dimx() * info.dimy());
+            for(uint32_t k = 0; k != info.getFrameCount(); k++)
+            {
+                r.readFrameIntoBuffer(k, frame.data(), true);
+                for(uint32_t j = 0; j != info.dimy(); j++)
+                {
+                    for(uint32_t i = 0; i != info.dimx(); i++)
+                    {
+                        uint32_t in[3];
+                        in[p[0]] = i;
+                        in[p[1]] = j;
+                        in[p[2]] = k;
+                        REQUIRE(frame[i + info.dimx() * j]
+                                == T(in[0] + 100 * in[1] + 10000 * in[2]));
+                    }
+                }
+            }
+        }
+    }
+    REQUIRE_FALSE(io::pathExists(output + ".tmp"));
+    std::remove(input.c_str());
+    std::remove(output.c_str());
+}
+} // namespace
+
+TEST_CASE("Reslicing into all axis orders and alignments", "[DenReslice]")
+{
+    for(bool inputXMajor : { true, false })
+    {
+        // Single frame blocks, blocks of several frames and the whole volume in one block
+        checkReslice<float>(inputXMajor, 1, 1);
+        checkReslice<float>(inputXMajor, 3 * 3 * 13 * 7 * sizeof(float), 3);
+        checkReslice<double>(inputXMajor, 1 << 20, 0);
+        checkReslice<uint16_t>(inputXMajor, 4 * 13 * 7 * sizeof(uint16_t), 2);
+    }
+}
+
+TEST_CASE("Reslicing errors", "[DenReslice]")
+{
+    REQUIRE(io::parseAxisOrder("zxy") == std::array<uint32_t, 3>{ 2, 0, 1 });
+    REQUIRE_THROWS(io::parseAxisOrder("xxy"));
+    REQUIRE_THROWS(io::parseAxisOrder("xy"));
+    REQUIRE_THROWS(io::parseAxisOrder("abc"));
+    io::DenResliceOptions opts;
+    opts.axisOrder = { 0, 0, 1 };
+    REQUIRE_THROWS(io::resliceDenFile("/tmp/a.den", "/tmp/b.den", opts));
+    opts.axisOrder = { 0, 1, 2 };
+    REQUIRE_THROWS(io::resliceDenFile("/tmp/a.den", "/tmp/a.den", opts));
+}
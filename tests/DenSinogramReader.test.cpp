@@ -0,0 +1,130 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Internal libs
+#include "BufferedFrame2D.hpp"
+#include "DEN/DenAsyncFrame2DWritter.hpp"
+#include "DEN/DenSinogramReader.hpp"
+
+using namespace KCT;
+
+namespace {
+template <typename F>
+std::string createProjections(uint32_t dimx, uint32_t dimy, uint32_t dimz, bool XMajor)
+{
+    std::string fileName = "/tmp/DenSinogramReader.den";
+    io::DenAsyncFrame2DWritter<F> w(fileName, dimx, dimy, dimz, XMajor);
+    io::BufferedFrame2D<F> f(F(0), dimx, dimy);
+    for(uint32_t k = 0; k != dimz; k++)
+    {
+        for(uint32_t y = 0; y != dimy; y++)
+        {
+            for(uint32_t x = 0; x != dimx; x++)
+            {
+                f.set(F(x + 100 * y + 1000 * k), x, y);
+            }
+        }
+        w.writeBufferedFrame(f, k);
+    }
+    return fileName;
+}
+
+template <typename T>
+void checkSinograms(io::DenSinogramReader<T>& r, uint32_t dimx, uint32_t dimy, uint32_t dimz)
+{
+    REQUIRE(r.dimx() == dimx);
+    REQUIRE(r.dimy() == dimz);
+    REQUIRE(r.getFrameCount() == dimy);
+    std::vector<T> xmajor(dimx * dimz), ymajor(dimx * dimz);
+    for(uint32_t y = 0; y != dimy; y++)
+    {
+        r.readFrameIntoBuffer(y, xmajor.data(), true);
+        r.readFrameIntoBuffer(y, ymajor.data(), false);
+        std::shared_ptr<io::BufferedFrame2DI<T>> f = r.readBufferedFrame(y);
+        for(uint32_t k = 0; k != dimz; k++)
+        {
+            for(uint32_t x = 0; x != dimx; x++)
+            {
+                T v = T(x + 100 * y + 1000 * k);
+                REQUIRE(xmajor[x + dimx * k] == v);
+                REQUIRE(ymajor[k + dimz * x] == v);
+                REQUIRE(f->get(x, k) == v);
+            }
+        }
+    }
+}
+} // namespace
+
+TEST_CASE("DenSinogramReader of XMajor and YMajor projections", "[DenSinogramReader]")
+{
+    const uint32_t dimx = 19, dimy = 23, dimz = 11;
+    const uint64_t sinogramBytes = dimx * dimz * sizeof(float);
+    for(bool XMajor : { true, false })
+    {
+        std::string fileName = createProjections<float>(dimx, dimy, dimz, XMajor);
+        for(uint32_t bandRows : { 1, 5, 23, 40 })
+        {
+            io::DenSinogramReader<float> r(fileName, 4 * 23 * sinogramBytes, bandRows);
+            REQUIRE(r.getBandRows() == std::min(bandRows, dimy));
+            checkSinograms(r, dimx, dimy, dimz);
+            // Sinograms read three times, each band loaded once
+            uint64_t bands = (dimy + r.getBandRows() - 1) / r.getBandRows();
+            REQUIRE(r.getStatistics().bandLoads == bands);
+            REQUIRE(r.getCacheStatistics().misses == bands);
+            REQUIRE(r.getStatistics().bytesRead >= dimx * dimy * dimz * sizeof(float));
+        }
+        // Four bands in the default size
+        io::DenSinogramReader<float> r(fileName, 4 * 6 * sinogramBytes);
+        REQUIRE(r.getBandRows() == 6);
+        checkSinograms(r, dimx, dimy, dimz);
+        REQUIRE_THROWS(r.readBufferedFrame(dimy));
+        std::remove(fileName.c_str());
+    }
+}
+
+TEST_CASE("DenSinogramReader converts and reads bands once", "[DenSinogramReader]")
+{
+    // Conversion of UINT16 file to float
+    std::string fileName = createProjections<uint16_t>(13, 7, 5, true);
+    {
+        io::DenSinogramReader<float> r(fileName, 0);
+        REQUIRE(r.getBandRows() == 1);
+        checkSinograms(r, 13, 7, 5);
+        // Nothing is cached with zero budget
+        REQUIRE(r.getStatistics().bandLoads == 3 * 7);
+    }
+    std::remove(fileName.c_str());
+    // Rows of 4096 bytes, rows of each projection read by one pread without the gaps
+    const uint32_t dimx = 1024, dimy = 8, dimz = 10;
+    fileName = createProjections<float>(dimx, dimy, dimz, true);
+    io::DenSinogramReader<float> r(fileName, 1 << 20, 2);
+    std::vector<std::thread> threads;
+    for(int t = 0; t != 4; t++)
+    {
+        threads.emplace_back([&r]() {
+            std::vector<float> buffer(r.getFrameSize());
+            for(uint64_t y = 0; y != r.getFrameCount(); y++)
+            {
+                r.readFrameIntoBuffer(y, buffer.data());
+            }
+        });
+    }
+    for(std::thread& t : threads)
+    {
+        t.join();
+    }
+    io::SinogramReadStatistics s = r.getStatistics();
+    REQUIRE(s.bandLoads == 4);
+    REQUIRE(s.reads == 4 * dimz);
+    REQUIRE(s.bytesRead == uint64_t(dimx) * dimy * dimz * sizeof(float));
+    checkSinograms(r, dimx, dimy, dimz);
+    std::remove(fileName.c_str());
+}
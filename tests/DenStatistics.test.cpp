@@ -0,0 +1,175 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Internal libs
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenStatistics.hpp"
+
+using namespace KCT;
+
+template <typename T>
+double naivePercentile(std::vector<T> v, double p)
+{
+    std::sort(v.begin(), v.end());
+    double rank = p / 100.0 * (v.size() - 1);
+    uint64_t r0 = uint64_t(std::floor(rank));
+    uint64_t r1 = std::min<uint64_t>(r0 + 1, v.size() - 1);
+    return double(v[r0]) + (rank - r0) * (double(v[r1]) - double(v[r0]));
+}
+
+TEST_CASE("DenFileInfo computeStatistics FLOAT32", "[DenStatistics]")
+{
+    std::string fileName = "/tmp/DenStatistics_float.den";
+    const uint32_t dimx = 37, dimy = 23, dimz = 19;
+    std::vector<float> data(dimx * dimy * dimz);
+    for(uint64_t i = 0; i != data.size(); i++)
+    {
+        data[i] = 1000.0f + 10.0f * std::sin(0.37f * i) + 0.001f * i;
+    }
+    io::DenFileInfo::create3DDenFileFromArray<float>(data.data(), true, fileName,
+                                                     io::DenSupportedType::FLOAT32, dimx, dimy,
+                                                     dimz);
+    double sum = 0.0, sumSquares = 0.0;
+    for(float v : data)
+    {
+        sum += v;
+        sumSquares += double(v) * v;
+    }
+    double mean = sum / data.size();
+    double M2 = 0.0;
+    for(float v : data)
+    {
+        M2 += (v - mean) * (v - mean);
+    }
+    io::DenFileInfo di(fileName);
+    io::DenStatisticsOptions opts;
+    opts.numThreads = 4;
+    opts.blockByteSize = 4096;
+    opts.percentiles = { 0.0, 25.0, 50.0, 99.0, 100.0 };
+    io::DenStatistics s = di.computeStatistics(opts);
+    REQUIRE(s.count == data.size());
+    REQUIRE(s.nanCount == 0);
+    REQUIRE(s.min == *std::min_element(data.begin(), data.end()));
+    REQUIRE(s.max == *std::max_element(data.begin(), data.end()));
+    REQUIRE(s.sum == Approx(sum).epsilon(1e-12));
+    REQUIRE(s.sumSquares == Approx(sumSquares).epsilon(1e-12));
+    REQUIRE(s.mean == Approx(mean).epsilon(1e-12));
+    REQUIRE(s.variance == Approx(M2 / data.size()).epsilon(1e-9));
+    REQUIRE(!s.exactPercentiles);
+    for(uint32_t i = 0; i != opts.percentiles.size(); i++)
+    {
+        REQUIRE(s.percentiles[i]
+                == Approx(naivePercentile(data, opts.percentiles[i])).epsilon(1.0 / 128));
+    }
+    // Reproducible irrespective of the number of threads
+    opts.numThreads = 1;
+    io::DenStatistics s1 = di.computeStatistics(opts);
+    REQUIRE(s1.sum == s.sum);
+    REQUIRE(s1.mean == s.mean);
+    REQUIRE(s1.variance == s.variance);
+    REQUIRE(s1.percentiles == s.percentiles);
+    REQUIRE(di.getMaxVal<float>() == (float)s.max);
+    REQUIRE(di.getMinVal<float>() == (float)s.min);
+    REQUIRE(di.getl2Square<float>() == Approx(sumSquares).epsilon(1e-12));
+    REQUIRE(di.getMean<double>() == Approx(mean).epsilon(1e-12));
+    REQUIRE(di.getVariance<double>() == Approx(M2 / data.size()).epsilon(1e-9));
+}
+
+TEST_CASE("DenFileInfo computeStatistics non finite values", "[DenStatistics]")
+{
+    std::string fileName = "/tmp/DenStatistics_nonfinite.den";
+    std::vector<double> data(10 * 10 * 3);
+    for(uint64_t i = 0; i != data.size(); i++)
+    {
+        data[i] = double(i % 7);
+    }
+    data[5] = std::numeric_limits<double>::quiet_NaN();
+    data[77] = std::numeric_limits<double>::infinity();
+    data[78] = -std::numeric_limits<double>::infinity();
+    data[201] = std::numeric_limits<double>::quiet_NaN();
+    io::DenFileInfo::create3DDenFileFromArray<double>(data.data(), true, fileName,
+                                                      io::DenSupportedType::FLOAT64, 10, 10, 3);
+    std::vector<double> finite;
+    for(double v : data)
+    {
+        if(std::isfinite(v))
+        {
+            finite.push_back(v);
+        }
+    }
+    double mean = 0.0;
+    for(double v : finite)
+    {
+        mean += v;
+    }
+    mean /= finite.size();
+    double M2 = 0.0;
+    for(double v : finite)
+    {
+        M2 += (v - mean) * (v - mean);
+    }
+    io::DenStatisticsOptions opts;
+    opts.percentiles = { 50.0 };
+    io::DenStatistics s = io::DenFileInfo(fileName).computeStatistics(opts);
+    REQUIRE(s.count == finite.size());
+    REQUIRE(s.nanCount == 2);
+    REQUIRE(s.posInfCount == 1);
+    REQUIRE(s.negInfCount == 1);
+    REQUIRE(s.min == 0.0);
+    REQUIRE(s.max == 6.0);
+    REQUIRE(s.mean == Approx(mean));
+    REQUIRE(s.variance == Approx(M2 / finite.size()));
+    REQUIRE(s.percentiles[0] == Approx(naivePercentile(finite, 50.0)).epsilon(1.0 / 128));
+    // Legacy getters keep taking non finite elements into account
+    io::DenFileInfo di(fileName);
+    REQUIRE(di.getMaxVal<double>() == std::numeric_limits<double>::infinity());
+    REQUIRE(di.getMinVal<double>() == -std::numeric_limits<double>::infinity());
+    REQUIRE(std::isnan(di.getl2Square<double>()));
+    REQUIRE(std::isnan(di.getMean<double>()));
+    REQUIRE(std::isnan(di.getVariance<double>()));
+}
+
+TEST_CASE("DenFileInfo computeStatistics exact percentiles", "[DenStatistics]")
+{
+    std::string fileName = "/tmp/DenStatistics_uint16.den";
+    std::vector<uint16_t> data(64 * 32 * 5);
+    for(uint64_t i = 0; i != data.size(); i++)
+    {
+        data[i] = uint16_t((i * 7919) % 65521);
+    }
+    io::DenFileInfo::create3DDenFileFromArray<uint16_t>(data.data(), true, fileName,
+                                                        io::DenSupportedType::UINT16, 64, 32, 5);
+    io::DenStatisticsOptions opts;
+    opts.numThreads = 3;
+    opts.blockByteSize = 1000;
+    opts.percentiles = { 0.0, 1.0, 33.3, 50.0, 90.0, 100.0 };
+    io::DenStatistics s = io::DenFileInfo(fileName).computeStatistics(opts);
+    REQUIRE(s.exactPercentiles);
+    REQUIRE(s.count == data.size());
+    for(uint32_t i = 0; i != opts.percentiles.size(); i++)
+    {
+        REQUIRE(s.percentiles[i] == Approx(naivePercentile(data, opts.percentiles[i])));
+    }
+    REQUIRE(s.min == *std::min_element(data.begin(), data.end()));
+    REQUIRE(s.max == *std::max_element(data.begin(), data.end()));
+    // Legacy getters truncate the mean to the type and take the deviations from it
+    io::DenFileInfo di(fileName);
+    double truncatedMean = double(uint32_t(s.mean));
+    double sumDeviations = 0.0;
+    for(uint16_t v : data)
+    {
+        sumDeviations += (v - truncatedMean) * (v - truncatedMean);
+    }
+    REQUIRE(di.getMean<uint32_t>() == truncatedMean);
+    REQUIRE(di.getVariance<uint32_t>() == Approx(sumDeviations / data.size()).margin(1.0));
+    REQUIRE(di.getVariance<double>() == Approx(s.variance));
+    opts.percentiles = { 101.0 };
+    REQUIRE_THROWS(io::DenFileInfo(fileName).computeStatistics(opts));
+}
@@ -0,0 +1,208 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Internal libs
+#include "BufferedFrame2D.hpp"
+#include "DEN/DenAsyncFrame2DBufferedWritter.hpp"
+#include "DEN/DenAsyncFrame2DWritter.hpp"
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "DEN/DenWriteJournal.hpp"
+#include "RawFile.hpp"
+#include "stringFormatter.h"
+
+using namespace KCT;
+
+namespace {
+template <class Writer>
+void writeFrames(Writer& w, const std::vector<uint64_t>& frames, uint32_t threads)
+{
+    std::vector<std::thread> writers;
+    for(uint32_t t = 0; t != threads; t++)
+    {
+        writers.emplace_back([&w, &frames, t, threads]() {
+            io::BufferedFrame2D<float> f(0.0f, w.dimx(), w.dimy());
+            for(uint64_t i = t; i < frames.size(); i += threads)
+            {
+                std::fill(f.data(), f.data() + w.getFrameSize(), static_cast<float>(frames[i]));
+                w.writeBufferedFrame(f, frames[i]);
+            }
+        });
+    }
+    for(std::thread& t : writers)
+    {
+        t.join();
+    }
+}
+
+std::vector<uint64_t> range(uint64_t from, uint64_t to)
+{
+    std::vector<uint64_t> r;
+    for(uint64_t k = from; k != to; k++)
+    {
+        r.push_back(k);
+    }
+    return r;
+}
+} // namespace
+
+TEST_CASE("DenWriteJournal checkpoints and resume", "[DenWriteJournal]")
+{
+    const uint32_t dimx = 20, dimy = 10, dimz = 100;
+    std::string fileName = "/tmp/DenWriteJournal.den";
+    std::string journalFile = io::DenWriteJournal::getJournalPath(fileName);
+    std::remove(fileName.c_str());
+    std::remove(journalFile.c_str());
+    io::DenWriteJournalPolicy everyFour;
+    everyFour.durability = io::JournalDurability::EVERY_N_FRAMES;
+    everyFour.frames = 4;
+    {
+        io::DenAsyncFrame2DWritter<float> w(fileName, dimx, dimy, dimz);
+        REQUIRE(w.pendingFrames().size() == dimz);
+        w.enableJournal(everyFour);
+        writeFrames(w, range(0, 60), 1);
+        REQUIRE(w.getJournalStatistics().checkpoints == 15);
+        // What survives the crash now
+        std::shared_ptr<io::RawFile> f = std::make_shared<io::RawFile>(fileName, true);
+        io::DenWriteJournal persisted(f, 4096, dimx * dimy * sizeof(float), dimz);
+        REQUIRE(persisted.pendingFrames() == range(60, dimz));
+        REQUIRE(w.pendingFrames() == range(60, dimz));
+    }
+    {
+        // Same dimensions reuse the file and its journal
+        io::DenAsyncFrame2DWritter<float> w(fileName, dimx, dimy, dimz);
+        io::DenWriteJournalPolicy p;
+        p.method = io::JournalSyncMethod::SYNC_FILE_RANGE;
+        w.enableJournal(p);
+        std::vector<uint64_t> pending = w.pendingFrames();
+        REQUIRE(pending == range(60, dimz));
+        w.enableWriteBehind(4, io::BackpressurePolicy::BLOCK, 2);
+        writeFrames(w, pending, 4);
+        w.finalize();
+        REQUIRE(w.pendingFrames().empty());
+        REQUIRE_FALSE(io::pathExists(journalFile));
+    }
+    io::DenFrame2DReader<float> r(fileName);
+    for(uint64_t k = 0; k != dimz; k++)
+    {
+        REQUIRE(r.readFrame(k)->get(dimx - 1, dimy - 1) == static_cast<float>(k));
+    }
+    {
+        // Next run into the completed file writes all the frames again
+        io::DenAsyncFrame2DWritter<float> w(fileName, dimx, dimy, dimz);
+        w.enableJournal(everyFour);
+        REQUIRE(w.pendingFrames().size() == dimz);
+        writeFrames(w, range(0, 8), 2);
+    }
+    {
+        // Journal of other file is not resumed
+        std::string otherFile = "/tmp/DenWriteJournalOther.den";
+        io::DenFileInfo::createEmpty3DDenFile(otherFile, io::DenSupportedType::FLOAT32, dimx,
+                                              dimy, dimz);
+        std::string otherJournal = io::DenWriteJournal::getJournalPath(otherFile);
+        REQUIRE(std::rename(journalFile.c_str(), otherJournal.c_str()) == 0);
+        std::shared_ptr<io::RawFile> f = std::make_shared<io::RawFile>(otherFile, true);
+        {
+            io::DenWriteJournal j(f, 4096, dimx * dimy * sizeof(float), dimz);
+            REQUIRE(j.pendingFrames().size() == dimz);
+        }
+        std::remove(otherJournal.c_str());
+        std::remove(otherFile.c_str());
+    }
+    {
+        // Different dimensions overwrite the file and start a new journal
+        io::DenAsyncFrame2DWritter<float> w(fileName, dimx, dimy, dimz + 1);
+        w.enableJournal();
+        REQUIRE(w.pendingFrames().size() == dimz + 1);
+    }
+    std::remove(journalFile.c_str());
+}
+
+TEST_CASE("DenWriteJournal with DenAsyncFrame2DBufferedWritter", "[DenWriteJournal]")
+{
+    const uint32_t dimx = 16, dimy = 8, dimz = 64;
+    std::string fileName = "/tmp/DenWriteJournalBuffered.den";
+    std::string journalFile = io::DenWriteJournal::getJournalPath(fileName);
+    std::remove(fileName.c_str());
+    std::remove(journalFile.c_str());
+    std::vector<uint64_t> odd, even;
+    for(uint64_t k = 0; k != dimz; k++)
+    {
+        (k % 2 == 0 ? even : odd).push_back(k);
+    }
+    io::DenWriteJournalPolicy everyFrame;
+    everyFrame.seconds = 0.0;
+    {
+        io::DenAsyncFrame2DBufferedWritter<float> w(fileName, dimx, dimy, dimz);
+        w.enableJournal(everyFrame);
+        writeFrames(w, odd, 3);
+        // Odd frames are buffered until their neighbours come
+        REQUIRE(w.pendingFrames().size() == dimz);
+    }
+    {
+        io::DenAsyncFrame2DBufferedWritter<float> w(fileName);
+        w.enableJournal(everyFrame);
+        REQUIRE(w.pendingFrames() == even);
+        writeFrames(w, w.pendingFrames(), 3);
+        w.flush();
+        REQUIRE(w.pendingFrames().empty());
+        REQUIRE(w.getJournalStatistics().checkpoints >= 1);
+        REQUIRE_FALSE(io::pathExists(journalFile));
+    }
+    io::DenFrame2DReader<float> r(fileName);
+    for(uint64_t k = 0; k != dimz; k++)
+    {
+        REQUIRE(r.readFrame(k)->get(dimx - 1, dimy - 1) == static_cast<float>(k));
+    }
+    std::remove(journalFile.c_str());
+}
+
+TEST_CASE("DenWriteJournal durability overhead", "[.][benchmark][DenWriteJournal]")
+{
+    const uint32_t dimx = 1024, dimy = 1024, dimz = 1024;
+    std::string fileName = "/tmp/DenWriteJournalBenchmark.den";
+    const double gigabytes = double(dimx) * dimy * dimz * sizeof(float) / 1e9;
+    io::DenWriteJournalPolicy none;
+    none.durability = io::JournalDurability::NONE;
+    io::DenWriteJournalPolicy syncRange;
+    syncRange.method = io::JournalSyncMethod::SYNC_FILE_RANGE;
+    struct Case
+    {
+        const char* name;
+        io::DenWriteJournalPolicy policy;
+    };
+    // Every case ends with one synchronization by finalize, NONE is the baseline, the first pass
+    // only warms up the file system
+    double baseline = 0.0;
+    for(Case c : { Case{ "warm up", none }, Case{ "none", none },
+                   Case{ "default", io::DenWriteJournalPolicy() },
+                   Case{ "sync_file_range", syncRange } })
+    {
+        std::remove(fileName.c_str());
+        io::DenAsyncFrame2DWritter<float> w(fileName, dimx, dimy, dimz);
+        w.enableJournal(c.policy);
+        auto start = std::chrono::steady_clock::now();
+        writeFrames(w, range(0, dimz), 8);
+        w.finalize();
+        double seconds
+            = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if(c.name == std::string("none"))
+        {
+            baseline = seconds;
+        }
+        io::DenWriteJournalStatistics s = w.getJournalStatistics();
+        LOGI << io::xprintf("%s: %.2f GB/s, %lu checkpoints in %.3fs, overhead %.2f%%", c.name,
+                            gigabytes / seconds, s.checkpoints, s.checkpointSeconds,
+                            baseline == 0.0 ? 0.0 : 100.0 * (seconds - baseline) / baseline);
+    }
+    std::remove(fileName.c_str());
+    std::remove(io::DenWriteJournal::getJournalPath(fileName).c_str());
+}
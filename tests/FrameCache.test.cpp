@@ -0,0 +1,155 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Internal libs
+#include "DEN/DenFileHandle.hpp"
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenFrame2DCachedReader.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "FrameCache.hpp"
+#include "ShardedCache.hpp"
+#include "denfixtures.test.hpp"
+
+using namespace KCT;
+
+TEST_CASE("ShardedCache pinned entries are not evicted", "[FrameCache]")
+{
+    io::ShardedCache<int, int> c(4, io::CachePolicy::LRU, 1);
+    std::vector<std::pair<int, uint64_t>> removed;
+    c.setRemovalListener([&removed](const int& key, uint64_t bytes, bool evicted) {
+        if(evicted)
+        {
+            removed.emplace_back(key, bytes);
+        }
+    });
+    for(int i = 0; i != 4; i++)
+    {
+        REQUIRE(c.insert(i, 10 * i, 1));
+    }
+    REQUIRE(c.pin(0));
+    REQUIRE(c.pin(0));
+    REQUIRE_FALSE(c.pin(100));
+    for(int i = 4; i != 8; i++)
+    {
+        REQUIRE(c.insert(i, 10 * i, 1));
+    }
+    int v;
+    REQUIRE(c.lookup(0, v));
+    REQUIRE(v == 0);
+    REQUIRE(removed.size() == 4);
+    REQUIRE(c.getStatistics().pinned == 1);
+    REQUIRE(c.getStatistics().bytes == 4);
+    // Only pinned entries left would not make room
+    REQUIRE(c.pin(7));
+    REQUIRE(c.pin(6));
+    REQUIRE(c.pin(5));
+    REQUIRE_FALSE(c.insert(8, 80, 1));
+    REQUIRE(c.unpin(0));
+    REQUIRE_FALSE(c.insert(8, 80, 1));
+    REQUIRE(c.unpin(0));
+    REQUIRE_FALSE(c.unpin(0));
+    REQUIRE(c.insert(8, 80, 1));
+    REQUIRE_FALSE(c.lookup(0, v));
+    REQUIRE(removed.back().first == 0);
+}
+
+TEST_CASE("FrameCache shares frames among readers", "[FrameCache]")
+{
+    const uint32_t dimx = 7, dimy = 3, dimz = 8;
+    std::string fileName
+        = createRampDenFile("/tmp/FrameCacheShared.den", dimx, dimy, dimz);
+    io::FrameCache& fc = io::FrameCache::instance();
+    const uint64_t frameBytes = dimx * dimy * sizeof(float);
+    fc.configure(4 * frameBytes, io::CachePolicy::LRU, 1);
+    std::shared_ptr<io::DenFileHandle> h = io::DenFileHandle::open(fileName);
+    io::FileIdentity id = h->getIdentity();
+    io::DenFrame2DReader<float> r1(fileName);
+    io::DenFrame2DCachedReader<float> r2(h, 0, 0);
+    r2.setSharedCache(true);
+    std::shared_ptr<const io::BufferedFrame2DI<float>> a = r1.readSharedFrame(2);
+    std::shared_ptr<const io::BufferedFrame2DI<float>> b = r2.readSharedFrame(2);
+    REQUIRE(a == b);
+    REQUIRE(a->get(3, 1) == static_cast<float>(2 * dimx * dimy + dimx + 3));
+    std::vector<float> buf(dimx * dimy);
+    r2.readFrameIntoBuffer(2, buf.data(), false);
+    REQUIRE(buf[1 + dimy * 3] == a->get(3, 1));
+    std::shared_ptr<io::BufferedFrame2DI<float>> copy = r2.readBufferedFrame(2);
+    REQUIRE(copy.get() != a.get());
+    copy->set(-1.0f, 0, 0);
+    REQUIRE(r1.readSharedFrame(2)->get(0, 0) == static_cast<float>(2 * dimx * dimy));
+    io::CacheStatistics s = fc.getFileStatistics(id);
+    REQUIRE(s.misses == 1);
+    REQUIRE(s.hits == 4);
+    REQUIRE(s.entries == 1);
+    REQUIRE(s.bytes == frameBytes);
+    // Pinned frame survives the scan of the file
+    REQUIRE(fc.pin(io::FrameCacheKey{ id, 2, io::DenSupportedType::FLOAT32, true }));
+    for(uint64_t k = 0; k != dimz; k++)
+    {
+        REQUIRE(r1.readSharedFrame(k)->get(0, 0) == static_cast<float>(k * dimx * dimy));
+    }
+    s = fc.getFileStatistics(id);
+    REQUIRE(s.entries == 4);
+    REQUIRE(s.bytes == 4 * frameBytes);
+    REQUIRE(s.evictions == 4);
+    REQUIRE(r1.readSharedFrame(2) == a);
+    REQUIRE(fc.getStatistics().pinned == 1);
+    REQUIRE(fc.getFileStatistics().count(id) == 1);
+    fc.configure(0);
+    REQUIRE(fc.getFileStatistics(id).entries == 0);
+    REQUIRE(fc.getFileStatistics(id).bytes == 0);
+    // Files without resident frames are dropped by the reset
+    fc.resetStatistics();
+    REQUIRE(fc.getFileStatistics().count(id) == 0);
+    // Without budget frames are read and not retained
+    REQUIRE(r1.readSharedFrame(2) != a);
+    REQUIRE(fc.getStatistics().entries == 0);
+}
+
+TEST_CASE("FrameCache loads each frame once under contention", "[FrameCache]")
+{
+    const uint32_t dimx = 64, dimy = 32, dimz = 16;
+    std::string fileName
+        = createRampDenFile("/tmp/FrameCacheConcurrent.den", dimx, dimy, dimz);
+    io::FrameCache& fc = io::FrameCache::instance();
+    fc.configure(dimz * dimx * dimy * sizeof(float), io::CachePolicy::ARC, 1);
+    io::FileIdentity id = io::DenFileHandle::open(fileName)->getIdentity();
+    std::atomic<uint64_t> loads{ 0 };
+    std::atomic<bool> mismatch{ false };
+    std::vector<std::thread> threads;
+    for(uint32_t t = 0; t != 8; t++)
+    {
+        threads.emplace_back([&, t]() {
+            io::DenFrame2DReader<float> r(fileName);
+            for(uint64_t i = 0; i != 4 * dimz; i++)
+            {
+                uint64_t k = (i + t) % dimz;
+                io::FrameCacheKey key{ id, k, io::DenSupportedType::FLOAT32, true };
+                std::shared_ptr<const io::BufferedFrame2DI<float>> f = fc.getOrLoad<float>(
+                    key, [&]() -> std::shared_ptr<const io::BufferedFrame2DI<float>> {
+                        loads++;
+                        return r.readBufferedFrame(k);
+                    });
+                if(f->get(5, 7) != static_cast<float>(k * dimx * dimy + 7 * dimx + 5))
+                {
+                    mismatch = true;
+                }
+            }
+        });
+    }
+    for(std::thread& t : threads)
+    {
+        t.join();
+    }
+    REQUIRE_FALSE(mismatch);
+    REQUIRE(loads == dimz);
+    REQUIRE(fc.getFileStatistics(id).entries == dimz);
+    fc.configure(0);
+}
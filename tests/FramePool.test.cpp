@@ -0,0 +1,132 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Internal libs
+#include "BufferedFrame2D.hpp"
+#include "DEN/DenFile.hpp"
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenFrame2DCachedReader.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "FramePool.hpp"
+#include "denfixtures.test.hpp"
+#include "stringFormatter.h"
+
+using namespace KCT;
+
+TEST_CASE("FramePool reuses released buffers", "[FramePool]")
+{
+    std::shared_ptr<io::FramePool<float>> pool
+        = std::make_shared<io::FramePool<float>>(100, io::DIRECT_IO_ALIGNMENT, false, 2);
+    {
+        io::FramePool<float>::Buffer a = pool->acquire();
+        io::FramePool<float>::Buffer b = pool->acquire();
+        io::FramePool<float>::Buffer c = pool->acquire();
+        REQUIRE(io::isAligned(a.get(), io::DIRECT_IO_ALIGNMENT));
+        REQUIRE(pool->getStatistics().outstanding == 3);
+    }
+    io::FramePoolStatistics s = pool->getStatistics();
+    REQUIRE(s.allocations == 3);
+    REQUIRE(s.deallocations == 1);
+    REQUIRE(s.idle == 2);
+    REQUIRE(s.outstanding == 0);
+    {
+        io::BufferedFrame2D<float> f(10, 10, pool);
+        f.set(1.0f, 9, 9);
+        io::BufferedFrame2D<float> moved(std::move(f));
+        REQUIRE(moved.get(9, 9) == 1.0f);
+        // Copy is not pooled
+        io::BufferedFrame2D<float> copy(moved);
+        REQUIRE(pool->getStatistics().outstanding == 1);
+        // Too small pool falls back to allocation
+        io::BufferedFrame2D<float> large(11, 10, pool);
+        REQUIRE(pool->getStatistics().outstanding == 1);
+    }
+    s = pool->getStatistics();
+    REQUIRE(s.allocations == 3);
+    REQUIRE(s.acquisitions == 4);
+    REQUIRE(s.idle == 2);
+    pool->shrink();
+    REQUIRE(pool->getStatistics().idle == 0);
+    pool->reserve(5);
+    REQUIRE(pool->getStatistics().idle == 2);
+}
+
+TEST_CASE("Readers with FramePool do not allocate in steady state", "[FramePool]")
+{
+    const uint32_t dimx = 33, dimy = 17, dimz = 40;
+    std::string fileName = createRampDenFile("/tmp/FramePool.den", dimx, dimy, dimz);
+    std::shared_ptr<io::FramePool<float>> pool
+        = std::make_shared<io::FramePool<float>>(dimx * dimy);
+    io::DenFrame2DReader<float> r(fileName);
+    r.setFramePool(pool);
+    for(uint32_t pass = 0; pass != 3; pass++)
+    {
+        for(uint64_t k = 0; k != dimz; k++)
+        {
+            std::shared_ptr<io::BufferedFrame2DI<float>> f = r.readBufferedFrame(k);
+            REQUIRE(f->get(2, 3) == static_cast<float>(k * dimx * dimy + 3 * dimx + 2));
+        }
+    }
+    REQUIRE(pool->getStatistics().allocations == 1);
+    REQUIRE(pool->getStatistics().acquisitions == 3 * dimz);
+    std::shared_ptr<io::FramePool<float>> smallPool
+        = std::make_shared<io::FramePool<float>>(dimx * dimy - 1);
+    REQUIRE_THROWS(r.setFramePool(smallPool));
+
+    // Evicted frames return their memory to the pool
+    io::DenFrame2DCachedReader<float> c(fileName, 0, 4);
+    c.setFramePool(pool);
+    for(uint32_t pass = 0; pass != 3; pass++)
+    {
+        for(uint64_t k = 0; k != dimz; k++)
+        {
+            REQUIRE(c.readFrame(k)->get(1, 1) == static_cast<float>(k * dimx * dimy + dimx + 1));
+        }
+    }
+    REQUIRE(pool->getStatistics().allocations <= 6);
+    REQUIRE(pool->getStatistics().outstanding == 4);
+
+    io::DenFile<float> d(fileName, 2);
+    d.setFramePool(pool);
+    for(uint64_t k = 0; k != dimz; k++)
+    {
+        REQUIRE(d.getFrame(k)->get(4, 5) == static_cast<float>(k * dimx * dimy + 5 * dimx + 4));
+    }
+    REQUIRE(pool->getStatistics().allocations <= 6);
+}
+
+TEST_CASE("FramePool benchmark of readBufferedFrame", "[.][benchmark][FramePool]")
+{
+    const uint32_t dimx = 2048, dimy = 1024, dimz = 64;
+    const uint32_t passes = 8;
+    std::string fileName = createRampDenFile("/tmp/FramePoolBenchmark.den", dimx, dimy, dimz);
+    io::DenFrame2DReader<float> r(fileName);
+    for(bool pooled : { false, true })
+    {
+        std::shared_ptr<io::FramePool<float>> pool
+            = std::make_shared<io::FramePool<float>>(dimx * dimy, 64, true);
+        r.setFramePool(pooled ? pool : nullptr);
+        auto start = std::chrono::steady_clock::now();
+        for(uint32_t pass = 0; pass != passes; pass++)
+        {
+            for(uint64_t k = 0; k != dimz; k++)
+            {
+                r.readBufferedFrame(k);
+            }
+        }
+        double seconds
+            = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t frames = passes * dimz;
+        uint64_t allocations = pooled ? pool->getStatistics().allocations : frames;
+        LOGI << io::xprintf("%s: %.1f frames/s, %.4f buffer allocations per frame",
+                            pooled ? "pooled" : "allocating", frames / seconds,
+                            double(allocations) / frames);
+    }
+}
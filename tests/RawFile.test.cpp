@@ -0,0 +1,208 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Internal libs
+#include "DEN/DenAsyncFrame2DWritter.hpp"
+#include "DEN/DenFile.hpp"
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenFrame2DCachedReader.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "PROG/KCTException.hpp"
+#include "RawFile.hpp"
+#include "rawop.h"
+
+using namespace KCT;
+
+std::string basedir(); // Defined in main file so that it will be accessible to linker
+
+TEST_CASE("RawFile: read matches readBytesFrom", "[rawfile]")
+{
+    std::string fileName = io::xprintf("%s/tests/testFiles/CAMERA.matrices", basedir().c_str());
+    io::RawFile rf(fileName);
+    REQUIRE(rf.getFileSize() == 23814);
+    REQUIRE(!rf.isWritable());
+    std::vector<uint8_t> a(96), b(96);
+    for(uint64_t k = 0; k != 248; k += 31)
+    {
+        rf.readBytesFrom(6 + k * 96, a.data(), 96);
+        io::readBytesFrom(fileName, 6 + k * 96, b.data(), 96);
+        REQUIRE(a == b);
+    }
+    REQUIRE_THROWS_AS(rf.readBytesFrom(23810, a.data(), 96), util::KCTException);
+    REQUIRE_THROWS_AS(rf.writeBytesFrom(0, a.data(), 6), util::KCTException);
+}
+
+TEST_CASE("RawFile: nonexisting file", "[rawfile]")
+{
+    REQUIRE_THROWS_AS(io::RawFile("/tmp/nonexistent_rawfile_test_xyz"), util::KCTException);
+}
+
+TEST_CASE("RawFile: concurrent positional writes and reads", "[rawfile]")
+{
+    std::string fileName = "/tmp/rawfile_test_concurrent.bin";
+    const uint64_t chunk = 4099;
+    const uint32_t threads = 8;
+    io::createEmptyFile(fileName, chunk * threads, true);
+    io::RawFile rf(fileName, true);
+    std::vector<std::thread> workers;
+    for(uint32_t t = 0; t != threads; t++)
+    {
+        workers.emplace_back([&rf, t, chunk]() {
+            std::vector<uint8_t> data(chunk, static_cast<uint8_t>(t + 1));
+            rf.writeBytesFrom(t * chunk, data.data(), chunk);
+        });
+    }
+    for(std::thread& w : workers)
+    {
+        w.join();
+    }
+    std::vector<uint8_t> data(chunk);
+    for(uint32_t t = 0; t != threads; t++)
+    {
+        rf.readBytesFrom(t * chunk, data.data(), chunk);
+        REQUIRE(std::all_of(data.begin(), data.end(),
+                            [t](uint8_t v) { return v == static_cast<uint8_t>(t + 1); }));
+    }
+    std::remove(fileName.c_str());
+}
+
+TEST_CASE("RawFile: DEN writer and readers round trip", "[rawfile][denfileinfo]")
+{
+    std::string fileName = "/tmp/rawfile_test_roundtrip.den";
+    const uint32_t dimx = 7, dimy = 5, dimz = 11;
+    {
+        io::DenAsyncFrame2DWritter<float> w(fileName, dimx, dimy, dimz);
+        std::vector<float> frame(dimx * dimy);
+        for(uint32_t k = 0; k != dimz; k++)
+        {
+            for(uint32_t i = 0; i != dimx * dimy; i++)
+            {
+                frame[i] = k * 1000.0f + i;
+            }
+            w.writeBuffer(frame.data(), k);
+        }
+    }
+    io::DenFrame2DReader<float> r(fileName);
+    io::DenFrame2DCachedReader<float> cr(fileName, 0, 3);
+    io::DenFile<float> df(fileName, 2);
+    std::vector<float> all(dimx * dimy * dimz);
+    io::DenFileInfo(fileName).readIntoArray<float>(all.data());
+    for(uint32_t k = 0; k != dimz; k++)
+    {
+        std::shared_ptr<io::BufferedFrame2DI<float>> f = r.readBufferedFrame(k);
+        std::shared_ptr<io::BufferedFrame2DI<float>> g = cr.readBufferedFrame(k);
+        for(uint32_t i = 0; i != dimx * dimy; i++)
+        {
+            REQUIRE(f->data()[i] == k * 1000.0f + i);
+            REQUIRE(g->data()[i] == k * 1000.0f + i);
+            REQUIRE(df.getFramePointer(k)[i] == k * 1000.0f + i);
+            REQUIRE(all[k * dimx * dimy + i] == k * 1000.0f + i);
+        }
+    }
+    std::string copyName = "/tmp/rawfile_test_roundtrip_copy.den";
+    df.writeFile(copyName, true);
+    REQUIRE(io::fileToString(copyName).substr(4096) == io::fileToString(fileName).substr(4096));
+    std::remove(copyName.c_str());
+    std::remove(fileName.c_str());
+}
+
+TEST_CASE("RawFile: direct I/O matches buffered I/O", "[rawfile][directio]")
+{
+    std::string fileName = "/tmp/rawfile_test_direct.bin";
+    const uint64_t fileSize = 5 * io::DIRECT_IO_ALIGNMENT + 1234;
+    io::createEmptyFile(fileName, fileSize, true);
+    {
+        io::RawFile rf(fileName, true);
+        std::vector<uint8_t> data(fileSize);
+        for(uint64_t i = 0; i != fileSize; i++)
+        {
+            data[i] = static_cast<uint8_t>((i * 31) % 251);
+        }
+        rf.writeBytesFrom(0, data.data(), fileSize);
+    }
+    io::RawFile buffered(fileName);
+    io::RawFile direct(fileName, false, true);
+    // Positions and lengths hitting unaligned head, tail, both and none
+    std::vector<std::pair<uint64_t, uint64_t>> ranges
+        = { { 0, fileSize },    { 6, 3 * io::DIRECT_IO_ALIGNMENT },
+            { 4096, 8192 },     { 4095, 4098 },
+            { 100, 200 },       { 3 * io::DIRECT_IO_ALIGNMENT + 7, fileSize - 3 * 4096 - 7 } };
+    std::vector<uint8_t, io::AlignedAllocator<uint8_t>> a(fileSize + 1), b(fileSize + 1);
+    for(auto [from, count] : ranges)
+    {
+        // Aligned and unaligned destination memory
+        for(uint64_t shift = 0; shift != 2; shift++)
+        {
+            buffered.readBytesFrom(from, a.data(), count);
+            direct.readBytesFrom(from, b.data() + shift, count);
+            REQUIRE(std::memcmp(a.data(), b.data() + shift, count) == 0);
+        }
+    }
+    REQUIRE_THROWS_AS(direct.readBytesFrom(fileSize - 10, a.data(), 4096 * 2),
+                      util::KCTException);
+    {
+        io::RawFile directWritable(fileName, true, true);
+        std::vector<uint8_t> data(3 * io::DIRECT_IO_ALIGNMENT + 17, 7);
+        directWritable.writeBytesFrom(6, data.data() + 1, data.size() - 1);
+    }
+    buffered.readBytesFrom(0, a.data(), fileSize);
+    for(uint64_t i = 0; i != fileSize; i++)
+    {
+        uint8_t expected = (i >= 6 && i < 3 * io::DIRECT_IO_ALIGNMENT + 22)
+            ? 7
+            : static_cast<uint8_t>((i * 31) % 251);
+        REQUIRE(a[i] == expected);
+    }
+    std::remove(fileName.c_str());
+}
+
+TEST_CASE("RawFile: DEN direct I/O on legacy and extended files", "[rawfile][directio]")
+{
+    const uint32_t dimx = 64, dimy = 48, dimz = 9;
+    std::string legacyName = "/tmp/rawfile_test_direct_legacy.den";
+    std::string extendedName = "/tmp/rawfile_test_direct_extended.den";
+    io::DenFileInfo::createEmptyLegacyDenFile(legacyName, io::DenSupportedType::FLOAT32, dimx, dimy,
+                                              dimz);
+    std::vector<float> frame(dimx * dimy);
+    for(std::string fileName : { legacyName, extendedName })
+    {
+        {
+            std::shared_ptr<io::DenAsyncFrame2DWritter<float>> w;
+            if(fileName == legacyName)
+            {
+                w = std::make_shared<io::DenAsyncFrame2DWritter<float>>(fileName, true);
+            } else
+            {
+                w = std::make_shared<io::DenAsyncFrame2DWritter<float>>(fileName, dimx, dimy, dimz,
+                                                                        true, true);
+            }
+            for(uint32_t k = 0; k != dimz; k++)
+            {
+                for(uint32_t i = 0; i != dimx * dimy; i++)
+                {
+                    frame[i] = k * 10000.0f + i;
+                }
+                w->writeBuffer(frame.data(), k);
+            }
+        }
+        io::DenFrame2DReader<float> r(fileName, 0, true);
+        io::DenFile<float> df(fileName, 3, true);
+        for(uint32_t k = 0; k != dimz; k++)
+        {
+            std::shared_ptr<io::BufferedFrame2DI<float>> f = r.readBufferedFrame(k);
+            for(uint32_t i = 0; i != dimx * dimy; i++)
+            {
+                REQUIRE(f->data()[i] == k * 10000.0f + i);
+                REQUIRE(df.getFramePointer(k)[i] == k * 10000.0f + i);
+            }
+        }
+        std::remove(fileName.c_str());
+    }
+}
@@ -0,0 +1,230 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Internal libs
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenFrame2DCachedReader.hpp"
+#include "ShardedCache.hpp"
+#include "denfixtures.test.hpp"
+
+using namespace KCT;
+
+// Hot keys re-read between the frames read once, capacity is 8 entries
+uint64_t scanHits(io::CachePolicy policy)
+{
+    io::ShardedCache<uint64_t, uint64_t> cache(80, policy, 1);
+    uint64_t v, scanned = 100;
+    auto access = [&cache, &v](uint64_t k) {
+        if(!cache.lookup(k, v))
+        {
+            cache.insert(k, k, 10);
+        }
+    };
+    // Frames used twice are recognized as frequent by ARC
+    for(uint64_t k = 0; k != 4; k++)
+    {
+        access(k);
+        access(k);
+    }
+    for(uint32_t round = 0; round != 20; round++)
+    {
+        for(uint64_t k = 0; k != 4; k++)
+        {
+            access(k);
+        }
+        for(uint64_t i = 0; i != 8; i++)
+        {
+            access(scanned++);
+        }
+    }
+    return cache.getStatistics().hits;
+}
+
+TEST_CASE("ShardedCache replacement policies", "[ShardedCache]")
+{
+    uint64_t v;
+    // Key 0 is hot, LRU and CLOCK keep it, FIFO evicts it
+    for(io::CachePolicy policy : { io::CachePolicy::FIFO, io::CachePolicy::LRU,
+                                   io::CachePolicy::CLOCK, io::CachePolicy::ARC })
+    {
+        io::ShardedCache<uint64_t, uint64_t> cache(30, policy, 1);
+        cache.insert(0, 100, 10);
+        cache.insert(1, 101, 10);
+        cache.insert(2, 102, 10);
+        REQUIRE(cache.lookup(0, v));
+        REQUIRE(v == 100);
+        cache.insert(3, 103, 10);
+        io::CacheStatistics s = cache.getStatistics();
+        REQUIRE(s.entries == 3);
+        REQUIRE(s.bytes == 30);
+        REQUIRE(s.evictions == 1);
+        REQUIRE(s.insertions == 4);
+        REQUIRE(cache.lookup(3, v));
+        if(policy == io::CachePolicy::FIFO)
+        {
+            REQUIRE(!cache.lookup(0, v));
+            REQUIRE(cache.lookup(1, v));
+        } else
+        {
+            REQUIRE(cache.lookup(0, v));
+            REQUIRE(!cache.lookup(1, v));
+        }
+        // Too big to be cached
+        cache.insert(4, 104, 31);
+        REQUIRE(!cache.lookup(4, v));
+        REQUIRE(cache.erase(3));
+        REQUIRE(!cache.lookup(3, v));
+        cache.clear();
+        REQUIRE(cache.getStatistics().entries == 0);
+    }
+    // Frames read once flush the hot frames from LRU and FIFO, but not from ARC
+    REQUIRE(scanHits(io::CachePolicy::LRU) == 8);
+    REQUIRE(scanHits(io::CachePolicy::FIFO) == 8);
+    REQUIRE(scanHits(io::CachePolicy::ARC) == 4 + 4 * 20);
+}
+
+TEST_CASE("ShardedCache concurrent access", "[ShardedCache]")
+{
+    io::ShardedCache<uint64_t, std::shared_ptr<uint64_t>> cache(64 * 8, io::CachePolicy::ARC, 8);
+    std::vector<std::thread> threads;
+    for(uint64_t t = 0; t != 8; t++)
+    {
+        threads.emplace_back([&cache, t] {
+            std::shared_ptr<uint64_t> v;
+            for(uint64_t i = 0; i != 20000; i++)
+            {
+                uint64_t k = (i * 7 + t) % 100;
+                if(cache.lookup(k, v))
+                {
+                    REQUIRE(*v == k);
+                } else
+                {
+                    cache.insert(k, std::make_shared<uint64_t>(k), 8);
+                }
+            }
+        });
+    }
+    for(std::thread& t : threads)
+    {
+        t.join();
+    }
+    io::CacheStatistics s = cache.getStatistics();
+    REQUIRE(s.hits + s.misses == 8 * 20000);
+    REQUIRE(s.bytes <= 64 * 8);
+}
+
+TEST_CASE("ShardedCache spreads strided keys over shards", "[ShardedCache]")
+{
+    // Keys of the stride equal to the shard count fall into one shard without mixing the hash
+    io::ShardedCache<uint64_t, uint64_t> cache(16 * 4 * 10, io::CachePolicy::LRU, 16);
+    uint64_t v;
+    for(uint64_t k = 0; k != 16 * 16; k += 16)
+    {
+        cache.insert(k, k, 10);
+    }
+    REQUIRE(cache.getStatistics().entries > 4);
+    REQUIRE(cache.lookup(16 * 15, v));
+}
+
+TEST_CASE("ShardedCache getOrLoad single flight", "[ShardedCache]")
+{
+    io::ShardedCache<uint64_t, std::shared_ptr<uint64_t>> cache(64 * 8, io::CachePolicy::LRU, 4);
+    std::atomic<uint64_t> loads{ 0 };
+    std::vector<std::shared_ptr<uint64_t>> results(8);
+    std::vector<std::thread> threads;
+    for(uint64_t t = 0; t != 8; t++)
+    {
+        threads.emplace_back([&cache, &loads, &results, t] {
+            results[t] = cache.getOrLoad(7, [&loads]() {
+                loads++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                return std::make_pair(std::make_shared<uint64_t>(7), uint64_t(8));
+            });
+        });
+    }
+    for(std::thread& t : threads)
+    {
+        t.join();
+    }
+    REQUIRE(loads == 1);
+    for(std::shared_ptr<uint64_t>& r : results)
+    {
+        REQUIRE(r == results[0]);
+    }
+    bool hit = false;
+    REQUIRE(*cache.getOrLoad(
+                7, []() { return std::make_pair(std::shared_ptr<uint64_t>(), uint64_t(8)); }, &hit)
+            == 7);
+    REQUIRE(hit);
+    // Failed load is not cached and the next call loads again
+    auto failing = []() -> std::pair<std::shared_ptr<uint64_t>, uint64_t> {
+        throw std::runtime_error("load failed");
+    };
+    REQUIRE_THROWS(cache.getOrLoad(8, failing, &hit));
+    REQUIRE(!hit);
+    REQUIRE(*cache.getOrLoad(
+                8, []() { return std::make_pair(std::make_shared<uint64_t>(8), uint64_t(8)); })
+            == 8);
+    REQUIRE(cache.getStatistics().entries == 2);
+}
+
+TEST_CASE("DenFrame2DCachedReader byte budget", "[ShardedCache][DenFrame2DCachedReader]")
+{
+    std::string fileName = "/tmp/DenFrame2DCachedReader_budget.den";
+    const uint32_t dimx = 7, dimy = 5, dimz = 12;
+    createRampDenFile(fileName, dimx, dimy, dimz);
+    uint64_t frameBytes = dimx * dimy * sizeof(float);
+    io::DenFrame2DCachedReader<float> r(fileName, 4 * frameBytes, io::CachePolicy::LRU);
+    REQUIRE(r.getCachePolicy() == io::CachePolicy::LRU);
+    std::vector<float> buf(dimx * dimy);
+    // Frames read into the outside buffer are not inserted
+    r.readFrameIntoBuffer(0, buf.data());
+    REQUIRE(r.getCacheStatistics().entries == 0);
+    for(uint32_t pass = 0; pass != 3; pass++)
+    {
+        for(uint64_t k = 0; k != 4; k++)
+        {
+            if(pass == 0)
+            {
+                r.readBufferedFrame(k);
+            }
+            r.readFrameIntoBuffer(k, buf.data(), false);
+            REQUIRE(buf[1] == static_cast<float>(k * dimx * dimy + dimx));
+            REQUIRE(buf[dimy] == static_cast<float>(k * dimx * dimy + 1));
+        }
+    }
+    io::CacheStatistics s = r.getCacheStatistics();
+    REQUIRE(s.misses == 1 + 4);
+    REQUIRE(s.hits == 12);
+    REQUIRE(s.entries == 4);
+    REQUIRE(s.bytes == 4 * frameBytes);
+    std::shared_ptr<io::Frame2DI<float>> f = r.readFrame(11);
+    REQUIRE(r.getCacheStatistics().evictions == 1);
+    REQUIRE(f->get(2, 3) == static_cast<float>(11 * dimx * dimy + 3 * dimx + 2));
+    // Shard count is clamped so that each shard holds a frame
+    io::DenFrame2DCachedReader<float> clamped(fileName, 2 * frameBytes, io::CachePolicy::LRU, 0,
+                                              16);
+    clamped.readFrame(0);
+    clamped.readFrame(1);
+    REQUIRE(clamped.getCacheStatistics().entries >= 1);
+    REQUIRE(clamped.readFrame(1) == clamped.readFrame(1));
+    // Frame count based cache
+    io::DenFrame2DCachedReader<float> c(fileName, 0, 3);
+    c.fillCache(0, 10);
+    REQUIRE(c.getCacheStatistics().entries == 3);
+    io::DenFrame2DCachedReader<float> none(fileName);
+    none.readFrameIntoBuffer(5, buf.data());
+    REQUIRE(buf[0] == static_cast<float>(5 * dimx * dimy));
+    REQUIRE(none.getCacheStatistics().misses == 0);
+    std::remove(fileName.c_str());
+}
@@ -0,0 +1,155 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Internal libs
+#include "BufferedFrame2D.hpp"
+#include "DEN/DenAsyncFrame2DWritter.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "Transpose.hpp"
+#include "stringFormatter.h"
+
+using namespace KCT;
+
+namespace {
+template <typename E>
+void checkTranspose(uint64_t rows, uint64_t cols)
+{
+    std::vector<E> in(rows * cols), out(rows * cols), expected(rows * cols);
+    for(uint64_t i = 0; i != in.size(); i++)
+    {
+        in[i] = static_cast<E>(i * 2654435761u);
+    }
+    for(uint64_t r = 0; r != rows; r++)
+    {
+        for(uint64_t c = 0; c != cols; c++)
+        {
+            expected[c * rows + r] = in[r * cols + c];
+        }
+    }
+    io::transpose(in.data(), out.data(), rows, cols);
+    REQUIRE(out == expected);
+    if(rows == cols)
+    {
+        io::transposeInPlace(in.data(), rows);
+        REQUIRE(in == expected);
+    }
+}
+
+template <typename E>
+void checkSizes()
+{
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<uint64_t> size(1, 300);
+    for(uint64_t n : { 1, 2, 3, 4, 7, 8, 9, 16, 63, 64, 65, 128, 129, 257 })
+    {
+        checkTranspose<E>(n, n);
+    }
+    for(int i = 0; i != 20; i++)
+    {
+        checkTranspose<E>(size(gen), size(gen));
+    }
+    checkTranspose<E>(1, 1000);
+    checkTranspose<E>(1000, 3);
+}
+} // namespace
+
+TEST_CASE("Transpose of 1, 2, 4 and 8 byte elements", "[Transpose]")
+{
+    LOGD << io::xprintf("Transpose kernels %s.", io::transposeKernelName());
+    checkSizes<uint8_t>();
+    checkSizes<uint16_t>();
+    checkSizes<uint32_t>();
+    checkSizes<uint64_t>();
+    // Strided blocks of larger matrices
+    std::vector<float> in(100 * 90), out(80 * 70, -1.0f);
+    for(uint64_t i = 0; i != in.size(); i++)
+    {
+        in[i] = static_cast<float>(i);
+    }
+    io::transposeElements(in.data() + 5 * 90 + 3, 90, out.data(), 70, 50, 40, sizeof(float));
+    for(uint64_t r = 0; r != 50; r++)
+    {
+        for(uint64_t c = 0; c != 40; c++)
+        {
+            REQUIRE(out[c * 70 + r] == in[(r + 5) * 90 + c + 3]);
+        }
+    }
+    REQUIRE(out[69] == -1.0f);
+    REQUIRE_THROWS(io::transposeElements(in.data(), 1, out.data(), 1, 1, 1, 3));
+}
+
+TEST_CASE("Frames converted between XMajor and YMajor", "[Transpose]")
+{
+    const uint32_t dimx = 37, dimy = 70, dimz = 3;
+    io::BufferedFrame2D<double> f(0.0, dimx, dimy);
+    for(uint32_t y = 0; y != dimy; y++)
+    {
+        for(uint32_t x = 0; x != dimx; x++)
+        {
+            f.set(x + 1000.0 * y, x, y);
+        }
+    }
+    std::shared_ptr<io::BufferedFrame2D<double>> t = f.transposed();
+    REQUIRE(t->dimx() == dimy);
+    REQUIRE(t->dimy() == dimx);
+    REQUIRE(t->get(13, 5) == f.get(5, 13));
+    for(bool XMajor : { true, false })
+    {
+        std::string fileName = "/tmp/Transpose.den";
+        {
+            io::DenAsyncFrame2DWritter<double> w(fileName, dimx, dimy, dimz, XMajor);
+            w.writeBufferedFrame(f, 0);
+            w.writeFrame(f, 1);
+            w.writeBuffer(f.data(), 2);
+        }
+        io::DenFrame2DReader<double> r(fileName);
+        std::vector<double> xmajor(dimx * dimy), ymajor(dimx * dimy);
+        for(uint64_t k = 0; k != dimz; k++)
+        {
+            r.readFrameIntoBuffer(k, xmajor.data(), true);
+            r.readFrameIntoBuffer(k, ymajor.data(), false);
+            REQUIRE(std::memcmp(xmajor.data(), f.data(), dimx * dimy * sizeof(double)) == 0);
+            REQUIRE(std::memcmp(ymajor.data(), t->data(), dimx * dimy * sizeof(double)) == 0);
+        }
+        std::remove(fileName.c_str());
+    }
+}
+
+TEST_CASE("Transposed read throughput", "[.][benchmark][Transpose]")
+{
+    const uint32_t dimx = 2048, dimy = 2048, dimz = 64;
+    std::string fileName = "/tmp/TransposeBenchmark.den";
+    {
+        io::DenAsyncFrame2DWritter<float> w(fileName, dimx, dimy, dimz);
+        io::BufferedFrame2D<float> f(1.0f, dimx, dimy);
+        for(uint64_t k = 0; k != dimz; k++)
+        {
+            w.writeBufferedFrame(f, k);
+        }
+    }
+    io::DenFrame2DReader<float> r(fileName);
+    std::vector<float> buffer(dimx * dimy);
+    const double gigabytes = double(dimx) * dimy * dimz * sizeof(float) / 1e9;
+    for(bool XMajor : { true, false, true, false })
+    {
+        auto start = std::chrono::steady_clock::now();
+        for(uint64_t k = 0; k != dimz; k++)
+        {
+            r.readFrameIntoBuffer(k, buffer.data(), XMajor);
+        }
+        double seconds
+            = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        LOGI << io::xprintf("%s read with %s kernels: %.2f GB/s", XMajor ? "XMajor" : "YMajor",
+                            io::transposeKernelName(), gigabytes / seconds);
+    }
+    std::remove(fileName.c_str());
+}
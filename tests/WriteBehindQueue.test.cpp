@@ -0,0 +1,154 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Internal libs
+#include "BufferedFrame2D.hpp"
+#include "DEN/DenAsyncFrame2DWritter.hpp"
+#include "DEN/DenFile.hpp"
+#include "DEN/DenFileInfo.hpp"
+#include "RawFile.hpp"
+#include "WriteBehindQueue.hpp"
+
+using namespace KCT;
+
+TEST_CASE("WriteBehindQueue backpressure policies", "[WriteBehindQueue]")
+{
+    std::string fileName = "/tmp/WriteBehindQueue.bin";
+    std::ofstream(fileName).close();
+    std::shared_ptr<io::RawFile> f = std::make_shared<io::RawFile>(fileName, true);
+    const uint64_t bytes = 100;
+
+    io::WriteBehindQueue drop(f, bytes, 2, io::BackpressurePolicy::DROP);
+    io::WriteBehindQueue::Buffer a = drop.acquire();
+    io::WriteBehindQueue::Buffer b = drop.acquire();
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+    REQUIRE(drop.acquire() == nullptr);
+    std::memset(a.get(), 1, bytes);
+    std::memset(b.get(), 2, bytes);
+    drop.submit(0, std::move(a));
+    drop.submit(bytes, std::move(b));
+    drop.flush();
+    io::WriteBehindStatistics s = drop.getStatistics();
+    REQUIRE(s.queued == 2);
+    REQUIRE(s.written == 2);
+    REQUIRE(s.dropped == 1);
+
+    io::WriteBehindQueue grow(f, bytes, 1, io::BackpressurePolicy::GROW, 2, 3 * bytes);
+    std::vector<io::WriteBehindQueue::Buffer> held;
+    for(int i = 0; i != 3; i++)
+    {
+        held.push_back(grow.acquire());
+        std::memset(held.back().get(), 3 + i, bytes);
+    }
+    REQUIRE(grow.getStatistics().peakFrames == 3);
+    // Fourth frame waits until a write completes
+    std::thread producer([&]() {
+        io::WriteBehindQueue::Buffer d = grow.acquire();
+        std::memset(d.get(), 6, bytes);
+        grow.submit(5 * bytes, std::move(d));
+    });
+    while(grow.getStatistics().blocked == 0)
+    {
+        std::this_thread::yield();
+    }
+    for(int i = 0; i != 3; i++)
+    {
+        grow.submit((2 + i) * bytes, std::move(held[i]));
+    }
+    producer.join();
+    grow.close();
+    REQUIRE(grow.getStatistics().written == 4);
+    REQUIRE_THROWS(grow.acquire());
+    std::vector<uint8_t> content(6 * bytes);
+    f->readBytesFrom(0, content.data(), content.size());
+    for(uint64_t i = 0; i != content.size(); i++)
+    {
+        REQUIRE(content[i] == i / bytes + 1);
+    }
+
+    // Errors of the background writes are thrown by flush
+    std::shared_ptr<io::RawFile> readOnly = std::make_shared<io::RawFile>(fileName);
+    io::WriteBehindQueue failing(readOnly, bytes);
+    failing.submit(0, failing.acquire());
+    REQUIRE_THROWS(failing.flush());
+    failing.flush();
+
+    // Errors seen by acquire are still thrown by close
+    io::WriteBehindQueue sticky(readOnly, bytes);
+    bool thrown = false;
+    while(!thrown)
+    {
+        try
+        {
+            sticky.submit(0, sticky.acquire());
+        } catch(const std::exception&)
+        {
+            thrown = true;
+        }
+    }
+    REQUIRE_THROWS(sticky.acquire());
+    REQUIRE_THROWS(sticky.close());
+}
+
+TEST_CASE("DenAsyncFrame2DWritter write behind from many threads", "[WriteBehindQueue]")
+{
+    const uint32_t dimx = 50, dimy = 20, dimz = 64;
+    std::string fileName = "/tmp/DenAsyncFrame2DWritterBehind.den";
+    for(bool XMajor : { true, false })
+    {
+        {
+            io::DenAsyncFrame2DWritter<float> w(fileName, dimx, dimy, dimz, XMajor);
+            w.enableWriteBehind(4, io::BackpressurePolicy::BLOCK, 2);
+            std::vector<std::thread> producers;
+            for(uint32_t t = 0; t != 4; t++)
+            {
+                producers.emplace_back([&, t]() {
+                    io::BufferedFrame2D<float> f(0.0f, dimx, dimy);
+                    for(uint64_t k = t; k < dimz; k += 4)
+                    {
+                        for(uint32_t y = 0; y != dimy; y++)
+                        {
+                            for(uint32_t x = 0; x != dimx; x++)
+                            {
+                                f.set(static_cast<float>(k * 1000 + y * dimx + x), x, y);
+                            }
+                        }
+                        if(k % 2 == 0)
+                        {
+                            w.writeFrame(f, k);
+                        } else
+                        {
+                            w.writeBufferedFrame(f, k);
+                        }
+                    }
+                });
+            }
+            for(std::thread& t : producers)
+            {
+                t.join();
+            }
+            w.flush();
+            io::WriteBehindStatistics s = w.getWriteBehindStatistics();
+            REQUIRE(s.written == dimz);
+            REQUIRE(s.peakFrames <= 4);
+            w.close();
+            // Synchronous after close
+            w.writeFrame(io::BufferedFrame2D<float>(-1.0f, dimx, dimy), 0);
+        }
+        io::DenFile<float> d(fileName, 2);
+        REQUIRE(d.getFrame(0)->get(0, 0) == -1.0f);
+        for(uint64_t k = 1; k != dimz; k++)
+        {
+            REQUIRE(d.getFrame(k)->get(7, 3) == static_cast<float>(k * 1000 + 3 * dimx + 7));
+        }
+    }
+}
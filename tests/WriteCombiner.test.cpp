@@ -0,0 +1,165 @@
+// Logging, testing
+#include "catch.hpp"
+#include <plog/Log.h>
+
+// Standard libs
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Internal libs
+#include "BufferedFrame2D.hpp"
+#include "DEN/DenAsyncFrame2DBufferedWritter.hpp"
+#include "DEN/DenFrame2DReader.hpp"
+#include "RawFile.hpp"
+#include "WriteCombiner.hpp"
+
+using namespace KCT;
+
+namespace {
+void addFrame(io::WriteCombiner& c, uint64_t k, uint64_t bytes)
+{
+    io::WriteCombiner::Buffer b = c.acquire();
+    std::memset(b.get(), static_cast<int>(k + 1), bytes);
+    c.add(k, std::move(b));
+}
+
+void checkContent(io::RawFile& f, uint64_t frames, uint64_t bytes)
+{
+    std::vector<uint8_t> content(frames * bytes);
+    f.readBytesFrom(0, content.data(), content.size());
+    for(uint64_t i = 0; i != content.size(); i++)
+    {
+        REQUIRE(content[i] == i / bytes + 1);
+    }
+}
+} // namespace
+
+TEST_CASE("WriteCombiner merges out of order frames into runs", "[WriteCombiner]")
+{
+    std::string fileName = "/tmp/WriteCombiner.bin";
+    std::ofstream(fileName).close();
+    std::shared_ptr<io::RawFile> f = std::make_shared<io::RawFile>(fileName, true);
+    const uint64_t bytes = 100, frames = 8;
+    {
+        io::WriteCombiner c(f, 0, bytes, frames);
+        for(uint64_t k : { 3, 1, 7, 5, 2, 6, 4 })
+        {
+            addFrame(c, k, bytes);
+        }
+        REQUIRE(c.getStatistics().writes == 0);
+        REQUIRE(c.getStatistics().buffered == 7);
+        // Frame 0 completes the whole file
+        addFrame(c, 0, bytes);
+        io::WriteCombinerStatistics s = c.getStatistics();
+        REQUIRE(s.frames == 8);
+        REQUIRE(s.writes == 1);
+        REQUIRE(s.buffered == 0);
+        REQUIRE(io::WriteCombiningBudget::instance().getUsedBytes() == 0);
+    }
+    checkContent(*f, frames, bytes);
+
+    // Runs limited by maxRunBytes and completed against the written frames
+    {
+        io::WriteCombiner c(f, 0, bytes, frames, 2 * bytes);
+        for(uint64_t k : { 1, 0, 5, 4, 3, 2, 7, 6 })
+        {
+            addFrame(c, k, bytes);
+        }
+        REQUIRE(c.getStatistics().writes == 4);
+        REQUIRE(c.getStatistics().buffered == 0);
+    }
+    checkContent(*f, frames, bytes);
+    REQUIRE_THROWS(addFrame(*std::make_unique<io::WriteCombiner>(f, 0, bytes, frames), 8, bytes));
+}
+
+TEST_CASE("WriteCombiner under exhausted budget", "[WriteCombiner]")
+{
+    std::string fileName = "/tmp/WriteCombinerBudget.bin";
+    std::ofstream(fileName).close();
+    std::shared_ptr<io::RawFile> f = std::make_shared<io::RawFile>(fileName, true);
+    const uint64_t bytes = 100, frames = 6;
+    io::WriteCombiningBudget& budget = io::WriteCombiningBudget::instance();
+    budget.configure(2 * bytes);
+    {
+        io::WriteCombiner c(f, 0, bytes, frames);
+        addFrame(c, 1, bytes);
+        addFrame(c, 2, bytes);
+        REQUIRE(budget.getUsedBytes() == 2 * bytes);
+        // Run 1-2 is evicted to make room for 4
+        addFrame(c, 4, bytes);
+        io::WriteCombinerStatistics s = c.getStatistics();
+        REQUIRE(s.evictions == 1);
+        REQUIRE(s.writes == 1);
+        REQUIRE(s.buffered == 1);
+        budget.configure(0);
+        // Nothing left to evict for 0
+        addFrame(c, 0, bytes);
+        REQUIRE(c.getStatistics().evictions == 2);
+        REQUIRE(c.getStatistics().bypassed == 1);
+        addFrame(c, 3, bytes);
+        addFrame(c, 5, bytes);
+        s = c.getStatistics();
+        REQUIRE(s.bypassed == 3);
+        REQUIRE(s.buffered == 0);
+    }
+    budget.configure(io::WriteCombiningBudget::DEFAULT_BYTES);
+    REQUIRE(budget.getUsedBytes() == 0);
+    checkContent(*f, frames, bytes);
+}
+
+TEST_CASE("DenAsyncFrame2DBufferedWritter from many threads", "[WriteCombiner]")
+{
+    const uint32_t dimx = 30, dimy = 20, dimz = 97;
+    std::string fileName = "/tmp/DenAsyncFrame2DBufferedWritter.den";
+    for(bool XMajor : { true, false })
+    {
+        uint64_t writes;
+        {
+            io::DenAsyncFrame2DBufferedWritter<float> w(fileName, dimx, dimy, dimz, XMajor);
+            std::vector<std::thread> producers;
+            for(uint32_t t = 0; t != 4; t++)
+            {
+                producers.emplace_back([&, t]() {
+                    io::BufferedFrame2D<float> f(0.0f, dimx, dimy);
+                    for(uint64_t k = t; k < dimz; k += 4)
+                    {
+                        for(uint32_t y = 0; y != dimy; y++)
+                        {
+                            for(uint32_t x = 0; x != dimx; x++)
+                            {
+                                f.set(static_cast<float>(k * 1000 + y * dimx + x), x, y);
+                            }
+                        }
+                        if(k % 2 == 0)
+                        {
+                            w.writeFrame(f, k);
+                        } else
+                        {
+                            w.writeBufferedFrame(f, k);
+                        }
+                    }
+                });
+            }
+            for(std::thread& t : producers)
+            {
+                t.join();
+            }
+            w.flush();
+            io::WriteCombinerStatistics s = w.getStatistics();
+            REQUIRE(s.frames == dimz);
+            REQUIRE(s.buffered == 0);
+            writes = s.writes;
+        }
+        REQUIRE(writes <= dimz);
+        io::DenFrame2DReader<float> r(fileName);
+        for(uint64_t k = 0; k != dimz; k++)
+        {
+            std::shared_ptr<io::BufferedFrame2DI<float>> f = r.readBufferedFrame(k);
+            REQUIRE(f->get(7, 3) == static_cast<float>(k * 1000 + 3 * dimx + 7));
+            REQUIRE(f->get(29, 19) == static_cast<float>(k * 1000 + 19 * dimx + 29));
+        }
+    }
+}
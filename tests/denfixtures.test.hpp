@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenSupportedType.hpp"
+
+// Test files shared by the tests of DEN readers and writers
+
+/**
+ * Create 3D DEN file of the type S with elements (i * 7919) % 60000, where i is the index of the
+ * element in XMajor order.
+ *
+ * @param fileXMajor Alignment of the frames in the file.
+ *
+ * @return Elements of the file in XMajor order.
+ */
+template <typename S>
+std::vector<S> createPatternDenFile(
+    std::string fileName, uint32_t dimx, uint32_t dimy, uint32_t dimz, bool fileXMajor = true)
+{
+    std::vector<S> data(uint64_t(dimx) * dimy * dimz);
+    for(uint64_t i = 0; i != data.size(); i++)
+    {
+        data[i] = static_cast<S>((i * 7919) % 60000);
+    }
+    KCT::io::DenFileInfo::create3DDenFileFromArray<S>(
+        data.data(), true, fileName, KCT::io::getDenSupportedTypeByTypeID(typeid(S)), dimx, dimy,
+        dimz, fileXMajor);
+    return data;
+}
+
+/**
+ * Create 3D FLOAT32 DEN file with elements equal to their index in XMajor order.
+ *
+ * @return File name.
+ */
+inline std::string
+createRampDenFile(std::string fileName, uint32_t dimx, uint32_t dimy, uint32_t dimz)
+{
+    std::vector<float> data(uint64_t(dimx) * dimy * dimz);
+    for(uint64_t i = 0; i != data.size(); i++)
+    {
+        data[i] = static_cast<float>(i);
+    }
+    KCT::io::DenFileInfo::create3DDenFileFromArray<float>(
+        data.data(), true, fileName, KCT::io::DenSupportedType::FLOAT32, dimx, dimy, dimz);
+    return fileName;
+}
@@ -166,6 +166,65 @@ TEST_CASE("createEmptyFile: overwrite=true replaces existing", "[rawop][createEm
     std::remove(path.c_str());
 }
 
+TEST_CASE("createEmptyFile: allocation policies", "[rawop][createEmptyFile]")
+{
+    std::string path = "/tmp/rawop_test_allocation";
+    const uint64_t size = 1024 * 1024 + 7;
+    for(io::FileAllocation a : { io::FileAllocation::SPARSE, io::FileAllocation::RESERVE,
+                                 io::FileAllocation::ZERO_RANGE })
+    {
+        io::createEmptyFile(path, size, true, a);
+        REQUIRE(io::getFileSize(path) == (long)size);
+        std::string content = io::fileToString(path);
+        REQUIRE(content == std::string(size, '\0'));
+        struct stat st;
+        REQUIRE(stat(path.c_str(), &st) == 0);
+        if(a == io::FileAllocation::SPARSE)
+        {
+            REQUIRE((uint64_t)st.st_blocks * 512 < size);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+// ============================================================================
+// createFileWithHeader
+// ============================================================================
+TEST_CASE("createFileWithHeader: header followed by zeros", "[rawop][createFileWithHeader]")
+{
+    std::string path = "/tmp/rawop_test_with_header";
+    uint8_t header[6] = { 1, 2, 3, 4, 5, 6 };
+    io::createFileWithHeader(path, header, 6, 100, true, io::FileAllocation::RESERVE);
+    std::string content = io::fileToString(path);
+    REQUIRE(content.size() == 100);
+    REQUIRE(content.substr(0, 6) == std::string("\x01\x02\x03\x04\x05\x06"));
+    REQUIRE(content.substr(6) == std::string(94, '\0'));
+    REQUIRE_THROWS(io::createFileWithHeader(path, header, 6, 100, false));
+    REQUIRE_THROWS(io::createFileWithHeader(path, header, 6, 5, true));
+    std::remove(path.c_str());
+}
+
+TEST_CASE("createFileWithHeader: DEN creators with reserved space", "[rawop][createFileWithHeader]")
+{
+    std::string path = "/tmp/rawop_test_den_reserve.den";
+    io::DenFileInfo::createEmpty3DDenFile(path, io::DenSupportedType::FLOAT32, 16, 8, 4, false,
+                                          io::FileAllocation::RESERVE);
+    io::DenFileInfo inf(path);
+    REQUIRE(inf.getFileSize() == 4096 + 16 * 8 * 4 * 4);
+    REQUIRE(inf.dimx() == 16);
+    REQUIRE(inf.dimz() == 4);
+    REQUIRE(!inf.hasXMajorAlignment());
+    REQUIRE(inf.getElementType() == io::DenSupportedType::FLOAT32);
+    // Header bytes not describing dimensions are zero
+    REQUIRE(io::fileToString(path).substr(22) == std::string(4096 - 22 + 16 * 8 * 4 * 4, '\0'));
+    io::DenFileInfo::createEmptyLegacyDenFile(path, io::DenSupportedType::UINT16, 3, 2, 5,
+                                              io::FileAllocation::ZERO_RANGE);
+    io::DenFileInfo legacy(path);
+    REQUIRE(legacy.getFileSize() == 6 + 3 * 2 * 5 * 2);
+    REQUIRE(legacy.getElementType() == io::DenSupportedType::UINT16);
+    std::remove(path.c_str());
+}
+
 // ============================================================================
 // readFirstBytes / writeFirstBytes
 // ============================================================================
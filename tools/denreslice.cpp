@@ -0,0 +1,112 @@
+// Logging
+#include "PLOG/PlogSetup.h"
+
+// External libraries
+#include "CLI/CLI.hpp" //Command line parser
+
+// Internal libraries
+#include "DEN/DenFileInfo.hpp"
+#include "DEN/DenReslice.hpp"
+#include "PROG/ArgumentsForce.hpp"
+#include "PROG/ArgumentsThreading.hpp"
+#include "PROG/ArgumentsVerbose.hpp"
+#include "PROG/KCTException.hpp"
+#include "PROG/Program.hpp"
+#include "stringFormatter.h"
+
+using namespace KCT;
+using namespace KCT::util;
+
+// Virtual inheritance, Arguments is constructed only once
+class Args : public ArgumentsForce, public ArgumentsVerbose, public ArgumentsThreading
+{
+    void defineArguments();
+    int postParse();
+    int preParse() { return 0; };
+
+public:
+    Args(int argc, char** argv, std::string prgName)
+        : Arguments(argc, argv, prgName)
+        , ArgumentsForce(argc, argv, prgName)
+        , ArgumentsVerbose(argc, argv, prgName)
+        , ArgumentsThreading(argc, argv, prgName){};
+    std::string input_den;
+    std::string output_den;
+    std::string order = "xyz";
+    bool ymajor = false;
+    double memoryGB = 1.0;
+    io::DenResliceOptions opts;
+};
+
+void Args::defineArguments()
+{
+    cliApp->add_option("input_den", input_den, "Input 2D or 3D DEN file.")
+        ->required()
+        ->check(CLI::ExistingFile);
+    cliApp->add_option("output_den", output_den, "Output DEN file.")->required();
+    cliApp->add_option("--order", order,
+                       io::xprintf("Input axes of the output x, y and z dimensions, e.g. xzy for "
+                                   "the sinogram order or zxy, defaults to %s.",
+                                   order.c_str()));
+    cliApp->add_flag("--ymajor", ymajor, "Write the output frames with the YMajor alignment.");
+    cliApp
+        ->add_option("--memory", memoryGB,
+                     io::xprintf("Memory for the buffers in GB, defaults to %.1f.", memoryGB))
+        ->check(CLI::PositiveNumber);
+    addForceArgs();
+    addVerboseArgs();
+    addThreadingArgs();
+}
+
+int Args::postParse()
+{
+    if(input_den == output_den)
+    {
+        LOGE << "Error: input and output files must differ.";
+        return -1;
+    }
+    int existFlag = handleFileExistence(output_den, force, true);
+    if(existFlag != 0)
+    {
+        return 1;
+    }
+    try
+    {
+        opts.axisOrder = io::parseAxisOrder(order);
+    } catch(const std::exception& e)
+    {
+        LOGE << e.what();
+        return -1;
+    }
+    opts.XMajor = !ymajor;
+    opts.memoryBytes = static_cast<uint64_t>(memoryGB * 1024.0 * 1024.0 * 1024.0);
+    opts.numThreads = threads;
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    Program PRG(argc, argv);
+    std::string prgInfo = "Reorder the axes of the DEN file or flip its alignment in bounded "
+                          "memory.";
+    Args ARG(argc, argv, prgInfo);
+    int parseResult = ARG.parse();
+    if(parseResult > 0)
+    {
+        return 0; // Exited sucesfully, help message printed
+    } else if(parseResult != 0)
+    {
+        return -1; // Exited somehow wrong
+    }
+    PRG.startLog(true);
+    io::DenResliceStatistics stats = io::resliceDenFile(ARG.input_den, ARG.output_den, ARG.opts);
+    if(ARG.verbose)
+    {
+        LOGI << io::xprintf("Resliced in %u passes, read %lu bytes by %lu reads, wrote %lu bytes "
+                            "by %lu writes.",
+                            stats.passes, stats.bytesRead, stats.reads, stats.bytesWritten,
+                            stats.writes);
+    }
+    PRG.endLog(true);
+    return 0;
+}